@@ -29,6 +29,8 @@ enum DAPCommandEnum {
     ID_DAP_SWO_Data           = 0x1CU,
     ID_DAP_QueueCommands      = 0x7EU,
     ID_DAP_ExecuteCommands    = 0x7FU,
+    ID_DAP_Vendor8            = 0x88U, // elaphureLink vendor command, see docs/vendor_command.md
+    ID_DAP_Invalid            = 0xFFU,
 };
 
 enum DAPResponseEnum {
@@ -39,3 +41,22 @@ enum DAPResponseEnum {
     DAP_RES_VALUE_MISMATCH = 16,
     DAP_RES_ERROR          = 0xFF
 };
+
+// elaphureLink vendor command: 0x88, type, payload length (16), payload
+enum ELVendorCommandEnum {
+    EL_VENDOR_CAPABILITY            = 0x00U,
+    EL_VENDOR_NATIVE_PASSTHROUGH    = 0x01U,
+    EL_VENDOR_SCOPE_ENTER           = 0x02U,
+    EL_VENDOR_SCOPE_EXIT            = 0x03U,
+    EL_FLASHOS_LOAD_ALGORITHM       = 0x04U,
+    EL_FLASHOS_EXECUTE_FUNCTION     = 0x05U,
+    EL_FLASHOS_ERASE_SECTOR         = 0x06U,
+    EL_FLASHOS_PROGRAM_PAGE         = 0x07U,
+};
+
+// elaphureLink vendor response: 0x88, status, payload length (16), payload
+enum ELVendorStatusEnum {
+    EL_VENDOR_STATUS_OK      = 0,
+    EL_VENDOR_STATUS_FAILED  = 1,
+    EL_VENDOR_STATUS_PENDING = 2,
+};
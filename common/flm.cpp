@@ -0,0 +1,372 @@
+﻿/**
+ * @file flm.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief CMSIS flash algorithm (FLM) parser and page planner
+ *
+ * An FLM is an ELF32 file. Only the program headers, the section headers and the symbol
+ * table are needed: the FlashDevice symbol names the load segment of the device
+ * description, the other load segment holds the code and data of the algorithm, and the
+ * first writable data section gives the static base.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "flm.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+#define ELF_HEADER_SIZE  52
+#define ELF_EI_DATA      5   // Data encoding in e_ident
+#define ELF_DATA_MSB     2   // Big-Endian
+#define ELF_PT_LOAD      1
+#define ELF_SHT_PROGBITS 1
+#define ELF_SHT_SYMTAB   2
+#define ELF_SHT_NOBITS   8
+#define ELF_SHF_WRITE    0x1
+#define ELF_SHF_ALLOC    0x2
+
+// Offsets in struct FlashDevice
+#define DEV_VERS      0
+#define DEV_NAME      2
+#define DEV_NAME_SIZE 128
+#define DEV_TYPE      130
+#define DEV_ADR       132
+#define DEV_SIZE      136
+#define DEV_PAGE      140
+#define DEV_RES       144
+#define DEV_EMPTY     148
+#define DEV_TO_PROG   152
+#define DEV_TO_ERASE  156
+#define DEV_SECTORS   160
+
+
+namespace flm
+{
+uint32_t File::get_u16(size_t ofs) const
+{
+    if (is_big_endian_) {
+        return (data_[ofs] << 8) | data_[ofs + 1];
+    }
+    return data_[ofs] | (data_[ofs + 1] << 8);
+}
+
+uint32_t File::get_u32(size_t ofs) const
+{
+    if (is_big_endian_) {
+        return ((uint32_t)data_[ofs] << 24) | (data_[ofs + 1] << 16) | (data_[ofs + 2] << 8) | data_[ofs + 3];
+    }
+    return data_[ofs] | (data_[ofs + 1] << 8) | (data_[ofs + 2] << 16) | ((uint32_t)data_[ofs + 3] << 24);
+}
+
+uint32_t File::get_symbol(const char *name, uint32_t *size) const
+{
+    auto it = symbols_.find(name);
+    if (it == symbols_.end()) {
+        return kNotFound;
+    }
+    if (size) {
+        *size = it->second.size;
+    }
+    return it->second.value;
+}
+
+
+bool File::load(const std::string &path, std::string &error)
+{
+    std::vector<uint8_t> data;
+    uint8_t              buf[4096];
+    size_t               n;
+
+    FILE *fh = fopen(path.c_str(), "rb");
+    if (fh == nullptr) {
+        error = "cannot open " + path;
+        return false;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), fh)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(fh);
+
+    return parse(std::move(data), error);
+}
+
+
+bool File::parse(std::vector<uint8_t> data, std::string &error)
+{
+    data_ = std::move(data);
+    segments_.clear();
+    sections_.clear();
+    symbols_.clear();
+
+    if (data_.size() < ELF_HEADER_SIZE || memcmp(data_.data(), "\x7F" "ELF", 4) != 0 || data_[4] != 1) {
+        error = "not an ELF32 file";
+        return false;
+    }
+    is_big_endian_ = (data_[ELF_EI_DATA] == ELF_DATA_MSB);
+
+    const uint32_t phoff     = get_u32(28);
+    const uint32_t shoff     = get_u32(32);
+    const uint32_t phentsize = get_u16(42);
+    const uint32_t phnum     = get_u16(44);
+    const uint32_t shentsize = get_u16(46);
+    const uint32_t shnum     = get_u16(48);
+
+    if ((uint64_t)phoff + (uint64_t)phnum * phentsize > data_.size() || (phnum && phentsize < 32)
+        || (uint64_t)shoff + (uint64_t)shnum * shentsize > data_.size() || (shnum && shentsize < 40)) {
+        error = "corrupt ELF header";
+        return false;
+    }
+
+    for (uint32_t n = 0; n < phnum; n++) {
+        const size_t p = phoff + n * phentsize;
+        if (get_u32(p) != ELF_PT_LOAD)
+            continue;
+        segments_.push_back({ get_u32(p + 4), get_u32(p + 8), get_u32(p + 16), get_u32(p + 20) });
+        if ((uint64_t)segments_.back().offset + segments_.back().filesz > data_.size()) {
+            error = "corrupt ELF program header";
+            return false;
+        }
+    }
+
+    for (uint32_t n = 0; n < shnum; n++) {
+        const size_t s = shoff + n * shentsize;
+        sections_.push_back({ get_u32(s + 4), get_u32(s + 8), get_u32(s + 12),
+                              get_u32(s + 16), get_u32(s + 20), get_u32(s + 24) });
+    }
+
+    for (auto &sec : sections_) {
+        if (sec.type != ELF_SHT_SYMTAB || sec.link >= sections_.size())
+            continue;
+        const Section &str = sections_[sec.link];
+        if ((uint64_t)sec.offset + sec.size > data_.size() || (uint64_t)str.offset + str.size > data_.size()) {
+            error = "corrupt ELF symbol table";
+            return false;
+        }
+        for (uint32_t s = sec.offset; s + 16 <= sec.offset + sec.size; s += 16) {
+            const uint32_t name = get_u32(s);
+            if (name >= str.size)
+                continue;
+            const char *p   = reinterpret_cast<const char *>(&data_[str.offset + name]);
+            size_t      len = strnlen(p, str.size - name);
+            symbols_.emplace(std::string(p, len), Symbol{ get_u32(s + 4), get_u32(s + 8) });
+        }
+    }
+
+    return true;
+}
+
+
+bool File::get_device(Device &dev, std::string &error) const
+{
+    uint32_t size;
+    uint32_t adr = get_symbol("FlashDevice", &size);
+
+    if (adr == kNotFound) {
+        error = "FlashDevice not found";
+        return false;
+    }
+
+    const Segment *seg = nullptr;
+    for (auto &s : segments_) {
+        if (s.vaddr == adr && s.filesz == size)
+            seg = &s;
+    }
+    if (seg == nullptr || seg->filesz < DEV_SECTORS + 8) {
+        error = "FlashDevice not loadable";
+        return false;
+    }
+
+    const size_t d   = seg->offset;
+    const char  *name = reinterpret_cast<const char *>(&data_[d + DEV_NAME]);
+
+    dev.vers        = (uint16_t)get_u16(d + DEV_VERS);
+    dev.name        = std::string(name, strnlen(name, DEV_NAME_SIZE));
+    dev.type        = (uint16_t)get_u16(d + DEV_TYPE);
+    dev.adr         = get_u32(d + DEV_ADR);
+    dev.size        = get_u32(d + DEV_SIZE);
+    dev.page_size   = get_u32(d + DEV_PAGE);
+    dev.res         = get_u32(d + DEV_RES);
+    dev.value_empty = data_[d + DEV_EMPTY];
+    dev.to_prog     = get_u32(d + DEV_TO_PROG);
+    dev.to_erase    = get_u32(d + DEV_TO_ERASE);
+    if (dev.to_prog == 0)
+        dev.to_prog = 1;
+    if (dev.to_erase == 0)
+        dev.to_erase = 1;
+
+    dev.sectors.clear();
+    for (size_t s = d + DEV_SECTORS; s + 8 <= d + seg->filesz && dev.sectors.size() < kSectorNum; s += 8) {
+        const uint32_t sz  = get_u32(s);
+        const uint32_t ofs = get_u32(s + 4);
+        if (sz == 0xFFFFFFFF && ofs == 0xFFFFFFFF)
+            break; // SECTOR_END
+        dev.sectors.push_back({ sz, ofs });
+    }
+
+    return true;
+}
+
+
+bool File::get_algorithm(Algorithm &alg, std::string &error) const
+{
+    const uint32_t dev_adr = get_symbol("FlashDevice");
+
+    alg = Algorithm();
+    if (symbols_.count("STACK_SIZE"))
+        alg.stack_size = get_symbol("STACK_SIZE");
+    alg.break_point   = get_symbol("BreakPoint");
+    alg.init          = get_symbol("Init");
+    alg.uninit        = get_symbol("UnInit");
+    alg.calculate_crc = get_symbol("CalculateCRC", &alg.crc_size);
+    alg.blank_check   = get_symbol("CheckPattern");
+    if (alg.blank_check == kNotFound)
+        alg.blank_check = get_symbol("BlankCheck");
+    alg.erase_chip   = get_symbol("EraseChip");
+    alg.erase_sector = get_symbol("EraseSector");
+    alg.program_page = get_symbol("ProgramPage");
+    alg.verify       = get_symbol("Verify");
+    if (alg.calculate_crc == kNotFound)
+        alg.crc_size = 0;
+
+    // Static Base: first .data or .bss section
+    auto sec = std::find_if(sections_.begin(), sections_.end(), [](const Section &s) {
+        return s.flags == (ELF_SHF_WRITE | ELF_SHF_ALLOC) && (s.type == ELF_SHT_PROGBITS || s.type == ELF_SHT_NOBITS);
+    });
+    if (sec == sections_.end()) {
+        error = "no data section for the static base";
+        return false;
+    }
+    alg.static_base = sec->addr;
+
+    if (alg.init == kNotFound || alg.uninit == kNotFound || alg.erase_sector == kNotFound || alg.program_page == kNotFound) {
+        error = "Missing Flash Algorithms";
+        return false;
+    }
+
+    // Missing functions are kNotFound, which is odd as well
+    for (uint32_t f : { alg.break_point, alg.init, alg.uninit, alg.calculate_crc, alg.blank_check,
+                        alg.erase_chip, alg.erase_sector, alg.program_page, alg.verify }) {
+        if (!(f & 1)) {
+            error = "Flash Algorithms not in Thumb Code";
+            return false;
+        }
+    }
+
+    // Algorithm code: the load segment which is not the FlashDevice
+    for (auto &seg : segments_) {
+        if (seg.vaddr == dev_adr)
+            continue;
+        alg.code.assign(data_.begin() + seg.offset, data_.begin() + seg.offset + seg.filesz);
+        alg.code_memsz = seg.memsz;
+        return true;
+    }
+
+    error = "no algorithm code";
+    return false;
+}
+
+
+void find_sector(const std::vector<Sector> &sectors, uint32_t start, uint32_t adr,
+                 uint32_t *sector_adr, uint32_t *sector_size)
+{
+    uint32_t a = 0, sz = 0, n;
+    uint32_t old_adr = 0, old_sz = 0;
+
+    for (size_t i = 0; i < sectors.size(); i++) {
+        a  = sectors[i].offset + start;
+        sz = sectors[i].size;
+        if (adr < a) {
+            if (i != 0) {
+                n  = old_adr + old_sz;
+                sz = old_sz;
+                a  = n + sz * ((adr - n) / sz);
+                break;
+            }
+        } else if (adr >= a + sz) {
+            if (i + 1 == sectors.size()) {
+                n = a + sz;
+                a = n + sz * ((adr - n) / sz);
+                break;
+            }
+        } else {
+            break;
+        }
+        old_adr = a;
+        old_sz  = sz;
+    }
+
+    *sector_adr  = a;
+    *sector_size = sz;
+}
+
+
+// Drop the last page if it holds only the empty value
+static bool drop_blank(const std::vector<Layout> &layouts, std::vector<Page> &pages, std::vector<uint8_t> &buffer)
+{
+    if (pages.empty())
+        return false;
+
+    const Page    &p = pages.back();
+    const Layout  &l = layouts[p.alg];
+    const uint8_t *b = &buffer[p.ofs];
+    if (b[0] != l.value_empty || memcmp(b, b + 1, l.page_size - 1))
+        return false;
+
+    buffer.resize(p.ofs);
+    pages.pop_back();
+    return true;
+}
+
+
+int plan_pages(std::vector<Fragment> &fragments, const std::vector<Layout> &layouts, bool blank,
+               std::vector<Page> &pages, std::vector<uint8_t> &buffer)
+{
+    int drop = 0;
+
+    pages.clear();
+    buffer.clear();
+
+    std::stable_sort(fragments.begin(), fragments.end(), [](const Fragment &a, const Fragment &b) {
+        return a.adr < b.adr;
+    });
+
+    for (auto &f : fragments) {
+        const Layout &l = layouts[f.alg];
+
+        uint32_t       adr   = f.adr;
+        uint32_t       n     = f.many;
+        const uint8_t *image = f.image;
+        while (n) {
+            const uint32_t pz = l.start + (((adr - l.start) / l.page_size) * l.page_size); // Page Address
+            if (pages.empty() || pages.back().alg != f.alg || pages.back().adr != pz) {
+                if (blank && drop_blank(layouts, pages, buffer))
+                    drop++;
+                // ProgramPage downloads whole words
+                pages.push_back({ f.alg, pz, 0, 0, (uint32_t)buffer.size() });
+                buffer.resize(buffer.size() + ((l.page_size + 3) & ~0x00000003), l.value_empty);
+            }
+            Page &p = pages.back();
+
+            const uint32_t ofs = adr - pz;
+            uint32_t       m   = l.page_size - ofs;
+            if (m > n)
+                m = n;
+            memcpy(&buffer[p.ofs + ofs], image, m);
+            if (p.sz < ofs + m)
+                p.sz = ofs + m;
+            p.cnt += m;
+
+            adr += m;
+            image += m;
+            n -= m;
+        }
+    }
+    if (blank && drop_blank(layouts, pages, buffer))
+        drop++;
+
+    return drop;
+}
+} // namespace flm
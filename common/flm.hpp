@@ -0,0 +1,182 @@
+﻿/**
+ * @file flm.hpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief CMSIS flash algorithm (FLM) parser and page planner
+ *
+ * Shared by the flash download of the debug driver (elaphureLinkAGDI/DbgCM/Flash.cpp) and the
+ * gang programmer. Nothing here has global state: a parsed file, a device description and a
+ * plan are plain values, so any number of them can be used at the same time.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace flm
+{
+constexpr uint32_t kNotFound  = 0xFFFFFFFF; // Symbol or function not in the FLM
+constexpr uint32_t kSectorNum = 512;        // Max Number of Sector Items, SECTOR_NUM of FlashOS.h
+constexpr uint32_t kPageMax   = 65536;      // Max Page Size for Programming, PAGE_MAX of FlashOS.h
+
+
+struct Sector {
+    uint32_t size;   // Sector Size in Bytes
+    uint32_t offset; // Address of Sector, relative to the Device Start Address
+};
+
+
+/*
+ * struct FlashDevice of FlashOS.h in host byte order.
+ */
+struct Device {
+    uint16_t            vers;        // Version Number and Architecture
+    std::string         name;        // Device Name and Description
+    uint16_t            type;        // Device Type: ONCHIP, EXT8BIT, EXT16BIT, ...
+    uint32_t            adr;         // Default Device Start Address
+    uint32_t            size;        // Total Size of Device
+    uint32_t            page_size;   // Programming Page Size
+    uint32_t            res;         // Reserved for future Extension
+    uint8_t             value_empty; // Content of Erased Memory
+    uint32_t            to_prog;     // Time Out of Program Page Function (ms), at least 1
+    uint32_t            to_erase;    // Time Out of Erase Sector Function (ms), at least 1
+    std::vector<Sector> sectors;     // Sector items up to SECTOR_END
+};
+
+
+/*
+ * Functions of the algorithm at their link addresses, not relocated. Missing ones are kNotFound.
+ */
+struct Algorithm {
+    uint32_t break_point   = kNotFound;
+    uint32_t init          = kNotFound;
+    uint32_t uninit        = kNotFound;
+    uint32_t calculate_crc = kNotFound;
+    uint32_t blank_check   = kNotFound; // CheckPattern, else BlankCheck
+    uint32_t erase_chip    = kNotFound;
+    uint32_t erase_sector  = kNotFound;
+    uint32_t program_page  = kNotFound;
+    uint32_t verify        = kNotFound;
+    uint32_t crc_size      = 0;  // Size of CalculateCRC
+    uint32_t stack_size    = 64; // STACK_SIZE, 64 if not given
+    uint32_t static_base   = 0;  // Address of the first .data or .bss section
+
+    std::vector<uint8_t> code;           // Load segment of code and data, as stored in the file
+    uint32_t             code_memsz = 0; // Size of the load segment in memory, with .bss
+};
+
+
+/*
+ * One FLM file. It is read with one bulk read and parsed from memory, little and big endian.
+ */
+class File
+{
+    public:
+    /**
+     * @brief Read and parse an FLM file.
+     *
+     * @param error receives the reason on failure
+     * @return true on success
+     */
+    bool load(const std::string &path, std::string &error);
+
+    /**
+     * @brief Parse an FLM file already in memory.
+     */
+    bool parse(std::vector<uint8_t> data, std::string &error);
+
+    /**
+     * @brief Get the FlashDevice description. Zero time outs are raised to 1 ms.
+     */
+    bool get_device(Device &dev, std::string &error) const;
+
+    /**
+     * @brief Get the functions and the load segment of the algorithm. Init, UnInit, EraseSector
+     *        and ProgramPage must be present and all functions must be Thumb code.
+     */
+    bool get_algorithm(Algorithm &alg, std::string &error) const;
+
+    private:
+    struct Segment {
+        uint32_t offset;
+        uint32_t vaddr;
+        uint32_t filesz;
+        uint32_t memsz;
+    };
+
+    struct Section {
+        uint32_t type;
+        uint32_t flags;
+        uint32_t addr;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t link;
+    };
+
+    struct Symbol {
+        uint32_t value;
+        uint32_t size;
+    };
+
+    uint32_t get_u16(size_t ofs) const;
+    uint32_t get_u32(size_t ofs) const;
+    uint32_t get_symbol(const char *name, uint32_t *size = nullptr) const;
+
+    std::vector<uint8_t>          data_;
+    bool                          is_big_endian_ = false;
+    std::vector<Segment>          segments_;
+    std::vector<Section>          sections_;
+    std::map<std::string, Symbol> symbols_;
+};
+
+
+/**
+ * @brief Find the sector which holds an address. The last sector item repeats up to the end
+ *        of the device, an item repeats up to the next item.
+ *
+ * @param start device start address
+ */
+extern void find_sector(const std::vector<Sector> &sectors, uint32_t start, uint32_t adr,
+                        uint32_t *sector_adr, uint32_t *sector_size);
+
+
+// Page planner
+
+struct Fragment {
+    uint32_t       adr;   // Start Address
+    uint32_t       many;  // Size
+    const uint8_t *image; // Image Data
+    int            alg;   // Flash Algorithm, index into the layouts
+};
+
+struct Layout {
+    uint32_t start;       // Device Start Address
+    uint32_t page_size;   // Programming Page Size, 1 .. kPageMax
+    uint8_t  value_empty; // Content of Erased Memory
+};
+
+struct Page {
+    int      alg; // Flash Algorithm
+    uint32_t adr; // Page Address
+    uint32_t sz;  // Size to program, up to the last Image Byte
+    uint32_t cnt; // Image Bytes in the Page
+    uint32_t ofs; // Offset of the Page Data in the page buffer
+};
+
+/**
+ * @brief Merge the image fragments into pages padded with the empty value, so each page needs
+ *        one ProgramPage call however the image is split. The fragments are sorted by address.
+ *
+ * @param blank drop pages which hold only the empty value (flash erased before)
+ * @param pages receives the pages in address order
+ * @param buffer receives the page data, each page rounded up to whole words
+ * @return number of dropped pages
+ */
+extern int plan_pages(std::vector<Fragment> &fragments, const std::vector<Layout> &layouts, bool blank,
+                      std::vector<Page> &pages, std::vector<uint8_t> &buffer);
+} // namespace flm
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <stdint.h>
 #include "windows.h"
 
@@ -11,6 +13,54 @@
 #define EL_EVENT_PRODUCER_NAME "elaphure.Event.Producer"
 #define EL_EVENT_CONSUMER_NAME "elaphure.Event.Consumer"
 
+// Multiple proxy instances, one per probe.
+// The RDDI side selects its instance with the environment variable below, default 0.
+#define EL_MAX_PROXY_INSTANCE  16
+#define EL_INSTANCE_ENV_NAME   "ELAPHURELINK_INSTANCE"
+#define EL_OBJECT_NAME_MAX_LEN 64
+
+// Several RDDI clients (processes) can share the probe of one instance, each client claims a
+// slot in the slot table of the instance. Client 0 uses the objects of the instance itself,
+// client n uses "<instance name>.client<n>". The priority is selected with the environment
+// variable below: "low", "normal" or "high", default normal.
+#define EL_MAX_PROXY_CLIENT       4
+#define EL_PRIORITY_ENV_NAME      "ELAPHURELINK_PRIORITY"
+
+#define EL_CLIENT_PRIORITY_LOW    0
+#define EL_CLIENT_PRIORITY_NORMAL 1
+#define EL_CLIENT_PRIORITY_HIGH   2
+
+// The proxy fails a request when the probe does not respond within the timeout of the client.
+// RDDI only gives up by itself when the proxy is gone, the request may wait for other clients.
+#define EL_DEFAULT_COMM_TIMEOUT_MS        3000
+#define EL_CONSUMER_WAIT_TIMEOUT_MS(time) ((time) * 2 * (EL_MAX_PROXY_CLIENT + 1) + 1000)
+
+/**
+ * @brief Get the kernel object name of a proxy instance.
+ *        Instance 0 keeps the legacy name, instance n uses "<name>.<n>".
+ */
+inline void el_get_instance_object_name(char *buf, const char *name, int instance)
+{
+    if (instance == 0) {
+        snprintf(buf, EL_OBJECT_NAME_MAX_LEN, "%s", name);
+    } else {
+        snprintf(buf, EL_OBJECT_NAME_MAX_LEN, "%s.%d", name, instance);
+    }
+}
+
+/**
+ * @brief Get the kernel object name of a client channel of a proxy instance.
+ *        Client 0 is the instance itself.
+ */
+inline void el_get_client_object_name(char *buf, const char *name, int instance, int client)
+{
+    el_get_instance_object_name(buf, name, instance);
+    if (client != 0) {
+        const size_t len = strlen(buf);
+        snprintf(buf + len, EL_OBJECT_NAME_MAX_LEN - len, ".client%d", client);
+    }
+}
+
 
 typedef struct el_memory_ {
     // for RDDI
@@ -53,6 +103,13 @@ typedef struct el_memory_ {
             char     firmware_version[20];
             uint32_t device_dap_buffer_size;
             char     enable_vendor_command;
+
+            // Client slot table, only valid in the memory of client 0
+            uint32_t client_owner[EL_MAX_PROXY_CLIENT];    // process id of the owner, 0: free
+            uint32_t client_priority[EL_MAX_PROXY_CLIENT]; // EL_CLIENT_PRIORITY_xxx
+
+            // Timeout of a probe response for the client of this memory, 0: default
+            uint32_t comm_timeout_ms;
         };
         uint8_t base[4096];
     } info_page;
@@ -83,6 +140,9 @@ CHECK_EL_MEMORY_ALIGN(info_page.product_name, 4096 * 500 * 2 + 20 + 240);
 CHECK_EL_MEMORY_ALIGN(info_page.serial_number, 4096 * 500 * 2 + 20 + 160 + 240);
 CHECK_EL_MEMORY_ALIGN(info_page.firmware_version, 4096 * 500 * 2 + 20 + 160 + 160 + 240);
 CHECK_EL_MEMORY_ALIGN(info_page.device_dap_buffer_size, 4096 * 500 * 2 + 20 + 160 + 160 + 20 + 240);
+CHECK_EL_MEMORY_ALIGN(info_page.client_owner, 4096 * 500 * 2 + 28 + 160 + 160 + 20 + 240);
+CHECK_EL_MEMORY_ALIGN(info_page.client_priority, 4096 * 500 * 2 + 28 + 160 + 160 + 20 + 240 + 4 * EL_MAX_PROXY_CLIENT);
+CHECK_EL_MEMORY_ALIGN(info_page.comm_timeout_ms, 4096 * 500 * 2 + 28 + 160 + 160 + 20 + 240 + 8 * EL_MAX_PROXY_CLIENT);
 
 
 #endif
@@ -99,9 +159,18 @@ inline void produce_and_wait_consumer_response(int command_count, int data_len)
 
     k_shared_memory_ptr->consumer_page.command_response = 0xFFFFFFFF; // invalid value
 
+    // drop a late response of a request that has been given up
+    ResetEvent(k_consumer_event);
     SetEvent(k_producer_event);
 
-    WaitForSingleObject(k_consumer_event, INFINITE);
+    uint32_t timeout = k_shared_memory_ptr->info_page.comm_timeout_ms;
+    if (timeout == 0) {
+        timeout = EL_DEFAULT_COMM_TIMEOUT_MS;
+    }
+
+    if (WaitForSingleObject(k_consumer_event, EL_CONSUMER_WAIT_TIMEOUT_MS(timeout)) != WAIT_OBJECT_0) {
+        k_shared_memory_ptr->consumer_page.command_response = 0xFFFFFFFF; // proxy is not responding
+    }
 }
 
 inline void set_consumer_status(int status)
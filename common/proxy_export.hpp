@@ -27,6 +27,7 @@ PROXY_DLL_FUNCTION int el_proxy_init();
 
 /**
  * @brief Start the Proxy with the specified address.
+ *        Same as `el_proxy_start_instance_with_address(0, address)`.
  *
  * @param address DAP host url address
  * @return 0: on success, other on fail
@@ -36,6 +37,7 @@ PROXY_DLL_FUNCTION int el_proxy_start_with_address(char *address);
 
 /**
  * @brief Force the Proxy to stop. This function can be used at any time.
+ *        Same as `el_proxy_stop_instance(0)`.
  *
  */
 PROXY_DLL_FUNCTION void el_proxy_stop();
@@ -56,3 +58,51 @@ PROXY_DLL_FUNCTION void el_proxy_set_on_connect_callback(onSocketConnectCallback
  * @param callback
  */
 PROXY_DLL_FUNCTION void el_proxy_set_on_disconnect_callback(onSocketDisconnectCallbackType callback);
+
+
+
+/*
+ * Multiple proxy instances
+ *
+ * Each instance serves one probe with its own shared memory and events. Instance 0 is the
+ * default instance used by the functions above and keeps the legacy object names, instance n
+ * is selected on the RDDI side by setting the environment variable `ELAPHURELINK_INSTANCE=n`
+ * for the debugger process. `el_proxy_init` must be called first.
+ */
+
+
+/**
+ * @brief Start the Proxy instance with the specified address. Other instances are not affected.
+ *
+ * @param instance instance number, 0 ~ 15
+ * @param address DAP host url address
+ * @return 0: on success, other on fail
+ */
+PROXY_DLL_FUNCTION int el_proxy_start_instance_with_address(int instance, char *address);
+
+
+/**
+ * @brief Force the Proxy instance to stop. This function can be used at any time.
+ *
+ * @param instance instance number, 0 ~ 15
+ */
+PROXY_DLL_FUNCTION void el_proxy_stop_instance(int instance);
+
+
+/**
+ * @brief Set the connect callback of the Proxy instance.
+ *        This function should be called before `el_proxy_start_instance_with_address`
+ *
+ * @param instance instance number, 0 ~ 15
+ * @param callback
+ */
+PROXY_DLL_FUNCTION void el_proxy_set_instance_on_connect_callback(int instance, onSocketConnectCallbackType callback);
+
+
+/**
+ * @brief Set the disconnect callback of the Proxy instance.
+ *
+ * @param instance instance number, 0 ~ 15
+ * @param callback
+ */
+PROXY_DLL_FUNCTION void el_proxy_set_instance_on_disconnect_callback(int instance, onSocketDisconnectCallbackType callback);
@@ -165,4 +165,26 @@ RDDI_FUNC int CMSIS_DAP_SWJ_Sequence(const RDDIHandle handle, int num, unsigned
 
 RDDI_FUNC int CMSIS_DAP_SWJ_Pins(const RDDIHandle handle, unsigned char pinselect, unsigned char pinout, int *res, int wait);
 
+/**
+ * @brief Set the time the proxy waits for a probe response (elaphureLink extension)
+ *
+ * @param[in] handle opaque pointer - obtained from DAP_Open call
+ * @param[in] timeout timeout in milliseconds, 0: default
+ *
+ * @return RDDI_SUCCESS on success, other on fail
+ */
+RDDI_FUNC int DAP_SetCommTimeout(const RDDIHandle handle, const int timeout);
+
+/**
+ * @brief Get the registers of the last failed DAP_RegAccessBlock call that the probe completed
+ *        (elaphureLink extension). The values of the completed register reads are stored in
+ *        the data array of that call.
+ *
+ * @param[in] handle opaque pointer - obtained from DAP_Open call
+ * @param[out] count number of registers before the failing one
+ *
+ * @return RDDI_SUCCESS on success, RDDI_FAILED if the failing register is not known
+ */
+RDDI_FUNC int DAP_GetRegAccessDone(const RDDIHandle handle, int *count);
+
 #endif
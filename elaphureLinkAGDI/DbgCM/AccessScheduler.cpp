@@ -0,0 +1,245 @@
+﻿/**
+ * @file AccessScheduler.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Scheduling of target accesses from several threads
+ *
+ * The debugger GUI, the Device State Monitor and the periodic window update access the
+ * target from different threads. All of them share one recursive lock. When the lock is
+ * released it is handed to a waiting thread of the highest priority, so GUI requests do
+ * not queue behind background polling. Memory item reads of threads which wait for the
+ * lock are merged and executed by the next owner with one ReadVector() call.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+#include "COLLECT.H"
+#include "..\BOM.H"
+#include "Debug.h"
+
+#include "AccessScheduler.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+
+struct AS_VECTOR_REQ {
+    MEM_VECTOR *pV;     // Items to read
+    DWORD       nMany;  // Number of items
+    BYTE        attrib; // Attributes for memory access
+    BOOL        done;   // Executed by the lock owner
+    int         status; // Result if done
+};
+
+
+static std::mutex                   kASMutex;
+static std::condition_variable      kASCond;
+static DWORD                        kASOwner;                  // Thread ID of the lock owner, 0 if free
+static int                          kASDepth;                  // Recursion depth of the owner
+static int                          kASWaiting[AS_PRIO_COUNT]; // Waiting threads per priority
+static std::vector<AS_VECTOR_REQ *> kASVectorQueue;            // Reads waiting to be merged
+static thread_local int             kASPrio = AS_PRIO_INTERACTIVE;
+
+
+int AS_SetThreadPriority(int prio)
+{
+    int prev = kASPrio;
+
+    if (prio >= 0 && prio < AS_PRIO_COUNT)
+        kASPrio = prio;
+
+    return (prev);
+}
+
+
+// Lock can be given to a thread of priority 'prio' (kASMutex held)
+static bool AS_Available(int prio)
+{
+    int p;
+
+    if (kASOwner != 0)
+        return (false);
+    for (p = prio + 1; p < AS_PRIO_COUNT; p++) {
+        if (kASWaiting[p])
+            return (false);
+    }
+    return (true);
+}
+
+
+int AS_Lock(DWORD timeout)
+{
+    std::unique_lock<std::mutex> lk(kASMutex);
+    DWORD                        self = GetCurrentThreadId();
+    int                          prio = kASPrio;
+    bool                         ok   = true;
+
+    if (kASOwner == self) {
+        kASDepth++;
+        return (0);
+    }
+
+    kASWaiting[prio]++;
+    if (timeout == INFINITE) {
+        kASCond.wait(lk, [prio] { return AS_Available(prio); });
+    } else {
+        ok = kASCond.wait_for(lk, std::chrono::milliseconds(timeout), [prio] { return AS_Available(prio); });
+    }
+    kASWaiting[prio]--;
+
+    if (!ok) {
+        kASCond.notify_all(); // Lower priorities may proceed now
+        return (EU13);        // Timeout
+    }
+
+    kASOwner = self;
+    kASDepth = 1;
+    return (0);
+}
+
+
+int AS_Unlock(void)
+{
+    std::lock_guard<std::mutex> lk(kASMutex);
+
+    if (kASOwner != GetCurrentThreadId())
+        return (EU12);
+
+    if (--kASDepth == 0) {
+        kASOwner = 0;
+        kASCond.notify_all();
+    }
+    return (0);
+}
+
+
+int AS_BeginAPTransaction(DWORD apSel, DWORD *pSaved)
+{
+    int status;
+
+    status = AS_Lock(AS_LOCK_TIMEOUT);
+    if (status)
+        return (status);
+
+    *pSaved = AP_Sel; // Save AP_Sel
+    AP_Sel  = apSel;  // Switch Access Port
+    return (0);
+}
+
+
+int AS_EndAPTransaction(DWORD saved)
+{
+    {
+        std::lock_guard<std::mutex> lk(kASMutex);
+
+        if (kASOwner != GetCurrentThreadId())
+            return (EU12); // No transaction started, keep AP_Sel
+    }
+
+    AP_Sel = saved; // Restore AP_Sel
+    return (AS_Unlock());
+}
+
+
+/*
+ * Execute the queued reads with the same attributes as 'req', at most AS_MERGE_MAX items.
+ * If the merged read fails, VectorDone tells the failing item: the requests before it are
+ * complete, the request of the failing item gets the error and the requests after it are
+ * read on their own, so no item is read twice. Called by the lock owner.
+ */
+
+static void AS_ExecuteVector(AS_VECTOR_REQ *req)
+{
+    std::vector<AS_VECTOR_REQ *> batch;
+    std::vector<MEM_VECTOR>      items;
+    DWORD                        n = req->nMany;
+    DWORD                        i, done;
+    int                          status;
+
+    batch.push_back(req);
+    {
+        std::lock_guard<std::mutex> lk(kASMutex);
+
+        for (auto it = kASVectorQueue.begin(); it != kASVectorQueue.end();) {
+            if (*it == req) {
+                it = kASVectorQueue.erase(it);
+            } else if ((*it)->attrib == req->attrib && n + (*it)->nMany <= AS_MERGE_MAX) {
+                n += (*it)->nMany;
+                batch.push_back(*it);
+                it = kASVectorQueue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    if (batch.size() == 1) {
+        req->status = ReadVector(req->pV, req->nMany, req->attrib);
+    } else {
+        for (auto r : batch) {
+            items.insert(items.end(), r->pV, r->pV + r->nMany);
+        }
+        status = ReadVector(items.data(), n, req->attrib);
+        done   = (status == EU01) ? 0 : VectorDone; // EU01: invalid item, nothing was read
+        i      = 0;
+        for (auto r : batch) {
+            if (status == 0 || i + r->nMany <= done) {
+                memcpy(r->pV, &items[i], r->nMany * sizeof(MEM_VECTOR));
+                r->status = 0;
+            } else if (i <= done && status != EU01) {
+                memcpy(r->pV, &items[i], (done - i) * sizeof(MEM_VECTOR));
+                r->status = status; // Request of the failing item
+            } else {
+                r->status = ReadVector(r->pV, r->nMany, r->attrib);
+            }
+            i += r->nMany;
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(kASMutex);
+    for (auto r : batch) {
+        r->done = TRUE;
+    }
+    kASCond.notify_all();
+}
+
+
+int AS_ReadVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib)
+{
+    AS_VECTOR_REQ req  = { pV, nMany, attrib, FALSE, 0 };
+    DWORD         self = GetCurrentThreadId();
+    int           prio = kASPrio;
+
+    if (ReadVector == NULL)
+        return (EU01);
+
+    {
+        std::unique_lock<std::mutex> lk(kASMutex);
+
+        if (kASOwner == self) { // Nested call, nothing to merge with
+            lk.unlock();
+            return (ReadVector(pV, nMany, attrib));
+        }
+
+        // Wait for the lock, another thread may execute the read meanwhile
+        kASVectorQueue.push_back(&req);
+        kASWaiting[prio]++;
+        kASCond.wait(lk, [&req, prio] { return req.done || AS_Available(prio); });
+        kASWaiting[prio]--;
+
+        if (req.done) {
+            kASCond.notify_all(); // Lower priorities may proceed now
+            return (req.status);
+        }
+
+        kASOwner = self;
+        kASDepth = 1;
+    }
+
+    AS_ExecuteVector(&req);
+
+    AS_Unlock();
+    return (req.status);
+}
@@ -0,0 +1,78 @@
+﻿/**
+ * @file AccessScheduler.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Scheduling of target accesses from several threads
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#define AS_PRIO_BACKGROUND  0 // Polling, e.g. Device State Monitor, periodic window update
+#define AS_PRIO_NORMAL      1
+#define AS_PRIO_INTERACTIVE 2 // Requests of the debugger GUI (default)
+#define AS_PRIO_COUNT       3
+
+#define AS_LOCK_TIMEOUT 3000 // Time in ms to wait for an AP transaction
+#define AS_MERGE_MAX    200  // Max. number of vector items merged into one request
+
+
+/**
+ * @brief Set the access priority of the calling thread.
+ *
+ * @return previous priority of the thread
+ */
+extern int AS_SetThreadPriority(int prio);
+
+/**
+ * @brief Get exclusive target access for the calling thread. Recursive, waiting threads
+ *        with a higher priority are served first.
+ *
+ * @param timeout time in ms to wait or INFINITE
+ * @return 0: OK, EU13: timeout
+ */
+extern int AS_Lock(DWORD timeout);
+
+/**
+ * @brief Release target access taken with AS_Lock().
+ *
+ * @return 0: OK, EU12: not owned by the calling thread
+ */
+extern int AS_Unlock(void);
+
+/**
+ * @brief Start an AP transaction: get target access and select the access port.
+ *
+ * @param apSel AP_Sel value of the access port
+ * @param pSaved receives the previous AP_Sel for AS_EndAPTransaction()
+ * @return 0: OK, else error code
+ */
+extern int AS_BeginAPTransaction(DWORD apSel, DWORD *pSaved);
+
+/**
+ * @brief End an AP transaction: restore the access port and release target access.
+ *
+ * @param saved AP_Sel returned by AS_BeginAPTransaction()
+ * @return 0: OK, else error code
+ */
+extern int AS_EndAPTransaction(DWORD saved);
+
+/**
+ * @brief Read memory items. Requests of threads waiting for target access are
+ *        merged and executed with one ReadVector() call.
+ *
+ * @return 0: OK, else error code
+ */
+extern int AS_ReadVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);
+
+
+// Target access of the calling thread for the lifetime of the object
+class AS_Guard
+{
+    public:
+    AS_Guard() { AS_Lock(INFINITE); }
+    ~AS_Guard() { AS_Unlock(); }
+
+    AS_Guard(const AS_Guard &) = delete;
+    AS_Guard &operator=(const AS_Guard &) = delete;
+};
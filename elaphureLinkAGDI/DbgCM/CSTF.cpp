@@ -35,6 +35,7 @@
 #include "..\AGDI.H"
 #include "..\Alloc.h"
 #include "Debug.h"
+#include "AccessScheduler.h"
 #include "Collect.h"
 #include "PDSCDebug.h"
 
@@ -370,15 +371,12 @@ static int CSTF_ConfigureSingle(DWORD ap, DWORD addr, DWORD connSlaves)
     int   status = 0, n;
     DWORD APSel;
 
-    status = LinkCom(1); // 16.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ap << 24, &APSel); // Switch to CSTF Access Port
     if (status) {
         OutErrorMessage(status);
         return (status);
     }
 
-    APSel  = AP_Sel;   // Save AP_Sel
-    AP_Sel = ap << 24; // Switch to CSTF Access Port
-
     // Read funnel control register to get holdtime after reset
 #if DBGCM_V8M
     status = ReadD32(CSTF_CONTROL(addr), &ctrl, BLOCK_SECTYPE_ANY);
@@ -423,11 +421,10 @@ static int CSTF_ConfigureSingle(DWORD ap, DWORD addr, DWORD connSlaves)
         goto end;
 
 end:
-    AP_Sel = APSel; // Restore AP_Sel
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
     return (0);
 }
@@ -34,6 +34,7 @@
 #include "..\Alloc.h"
 #include "Collect.h"
 #include "Debug.h"
+#include "AccessScheduler.h"
 #include "CTI.h"
 
 static CTI_Instance *CTI_Instances = NULL;
@@ -53,14 +54,12 @@ int CTI_AddInstance(DWORD addr, BYTE ap, DWORD dp)
         tail = inst;
     }
 
-    status = LinkCom(1); // 08.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ap << 24, &APSel); // Switch to CTI Access Port
     if (status) {
         OutErrorMessage(status);
         return (status);
     }
 
-    APSel  = AP_Sel;   // Save AP_Sel
-    AP_Sel = ap << 24; // Switch to CTI Access Port
 #if DBGCM_V8M
     status = ReadD32(CTI_DEVID(addr), &val, BLOCK_SECTYPE_ANY); // Read Device Configuration Register to determine
                                                                 // number of channels and triggers
@@ -68,12 +67,10 @@ int CTI_AddInstance(DWORD addr, BYTE ap, DWORD dp)
     status = ReadD32(CTI_DEVID(addr), &val);  // Read Device Configuration Register to determine
                                               // number of channels and triggers
 #endif                                                          // DBGCM_V8M
-    AP_Sel = APSel;                                             // Restore AP_Sel
-
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     // Check Status
@@ -105,25 +102,21 @@ static bool _Activated(CTI_Instance *cti)
     DWORD status, val, APSel;
     DWORD ofs = cti->addr;
 
-    status = LinkCom(1); // 08.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(cti->ap << 24, &APSel); // Switch to CTI Access Port
     if (status) {
         OutErrorMessage(status);
         return (false);
     }
 
-    APSel  = AP_Sel;        // Save AP_Sel
-    AP_Sel = cti->ap << 24; // Switch to CTI Access Port
 #if DBGCM_V8M
     status = ReadD32(CTI_CONTROL(ofs), &val, BLOCK_SECTYPE_ANY); // Check if CTI Instance enabled
 #else                                                            // DBGCM_V8M
     status = ReadD32(CTI_CONTROL(ofs), &val); // Check if CTI Instance enabled
 #endif                                                           // DBGCM_V8M
-    AP_Sel = APSel;                                              // Restore AP_Sel
-
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     if (status) {
@@ -157,25 +150,21 @@ static DWORD _GetTrigInChannels(CTI_Instance *cti, DWORD trignum)
         return (0);
     }
 
-    status = LinkCom(1); // 08.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(cti->ap << 24, &APSel); // Switch to CTI Access Port
     if (status) {
         OutErrorMessage(status);
         return (0);
     }
 
-    APSel  = AP_Sel;        // Save AP_Sel
-    AP_Sel = cti->ap << 24; // Switch to CTI Access Port
 #if DBGCM_V8M
     status = ReadD32(CTI_INEN0(ofs) + trignum * 4, &val, BLOCK_SECTYPE_ANY);
 #else               // DBGCM_V8M
     status = ReadD32(CTI_INEN0(ofs) + trignum * 4, &val);
 #endif              // DBGCM_V8M
-    AP_Sel = APSel; // Restore AP_Sel
-
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     if (status) {
@@ -197,25 +186,21 @@ static DWORD _GetTrigOutChannels(CTI_Instance *cti, DWORD trignum)
         return (0);
     }
 
-    status = LinkCom(1); // 08.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(cti->ap << 24, &APSel); // Switch to CTI Access Port
     if (status) {
         OutErrorMessage(status);
         return (0);
     }
 
-    APSel  = AP_Sel;        // Save AP_Sel
-    AP_Sel = cti->ap << 24; // Switch to CTI Access Port
 #if DBGCM_V8M
     status = ReadD32(CTI_OUTEN0(ofs) + trignum * 4, &val, BLOCK_SECTYPE_ANY);
 #else               // DBGCM_V8M
     status = ReadD32(CTI_OUTEN0(ofs) + trignum * 4, &val);
 #endif              // DBGCM_V8M
-    AP_Sel = APSel; // Restore AP_Sel
-
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     if (status) {
@@ -232,15 +217,12 @@ static int _ClearAppTriggers(CTI_Instance *cti, DWORD mask)
     DWORD ofs    = cti->addr;
     DWORD chmask = ((1 << cti->channels) - 1);
 
-    status = LinkCom(1); // 08.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(cti->ap << 24, &APSel); // Switch to CTI Access Port
     if (status) {
         OutErrorMessage(status);
         return (0);
     }
 
-    APSel  = AP_Sel;        // Save AP_Sel
-    AP_Sel = cti->ap << 24; // Switch to CTI Access Port
-
     // Read active Application Triggers
 #if DBGCM_V8M
     status = ReadD32(CTI_APPSET(ofs), &val, BLOCK_SECTYPE_ANY);
@@ -267,11 +249,10 @@ static int _ClearAppTriggers(CTI_Instance *cti, DWORD mask)
         goto end;
 
 end:
-    AP_Sel = APSel; // Restore AP_Sel
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     return (0);
@@ -303,15 +284,12 @@ static int _AcknowledgeTriggers(CTI_Instance *cti, DWORD mask, bool setclr)
     DWORD ofs      = cti->addr;
     DWORD trigmask = ((1 << cti->triggers) - 1);
 
-    status = LinkCom(1); // 08.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(cti->ap << 24, &APSel); // Switch to CTI Access Port
     if (status) {
         OutErrorMessage(status);
         return (0);
     }
 
-    APSel  = AP_Sel;        // Save AP_Sel
-    AP_Sel = cti->ap << 24; // Switch to CTI Access Port
-
     // Read active Output Triggers
 #if DBGCM_V8M
     status = ReadD32(CTI_TRIGOUTSTATUS(ofs), &val, BLOCK_SECTYPE_ANY);
@@ -348,11 +326,10 @@ static int _AcknowledgeTriggers(CTI_Instance *cti, DWORD mask, bool setclr)
     }
 
 end:
-    AP_Sel = APSel; // Restore AP_Sel
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     return (0);
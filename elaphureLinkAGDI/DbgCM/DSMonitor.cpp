@@ -46,6 +46,8 @@
 #endif // DBGCM_DBG_DESCRIPTION
 
 #include "DSMonitor.h"
+#include "PeriodicUpdate.h"
+#include "AccessScheduler.h"
 #include "Trace.h"
 
 DSM_THREAD DSMonitorThread;
@@ -71,6 +73,7 @@ static __inline void DSMonitor_DoPeriodicUpdate(void)
         UpdateDebugAuthentication(); // Read debug authentication status from target
 #endif                               // DBGCM_V8M
         UpdateCycles();
+        PeriodicUpdate_Begin(); // Fetch the memory the views read with one batch
         UpdateAllDlg();
         pio->Notify(UV_UPDATE_SELECTIVE, (void *)updates);
     }
@@ -219,6 +222,9 @@ static void DSMonitor_Thread(void *vp)
     int daLevel;
 #endif // DBGCM_RECOVERY
 
+    // Polling gives way to debugger requests
+    AS_SetThreadPriority(AS_PRIO_BACKGROUND);
+
     // Init Monitor Thread Structure
     DSMonitorThread.threadID           = GetCurrentThreadId();
     DSMonitorThread.interval           = 250; // Poll frequently at start
@@ -42,6 +42,7 @@
 #include "JTAG.h"
 
 #include "rddi_dll.hpp"
+#include "AccessScheduler.h"
 
 
 #ifdef _DEBUG
@@ -153,6 +154,8 @@ inline BOOL LoadRddiDllFunction()
     RDDILL_GetProcAddress(CMSIS_DAP_Commands);
     RDDILL_GetProcAddress(CMSIS_DAP_SWJ_Sequence);
     RDDILL_GetProcAddress(CMSIS_DAP_SWJ_Pins);
+    RDDILL_GetProcAddress(DAP_SetCommTimeout);
+    RDDILL_GetProcAddress(DAP_GetRegAccessDone);
 
     return TRUE;
 }
@@ -820,24 +823,18 @@ int _EXPO_ DllUv3Cap(DWORD nCode, void *p)
 #endif
 
 
-//  Link Communication Mutex (prevent multiple commands), used normally in JTAG.cpp, SWD.cpp and Trace modules.
-// This mutex syncs the communication with the Debug unit
+//  Link Communication Lock (prevent multiple commands), used by AGDI commands which need several
+// accesses without interruption. Access port switches use AS_BeginAPTransaction() instead.
+// The lock is the one of the access scheduler, so it also syncs with JTAG.cpp and SWD.cpp.
 //    Parameter:      stat: 1 - Open Communication, 1 - Close Communication
 //    Return Value:   0 - OK,  else Error Code
-#if 1                        // Example Code
-static HANDLE LinkMutex = 0; // Communication Mutex
-
+#if 1 // Example Code
 HANDLE kDebugAccessMutex = 0;
 
-#define EL_MUTEX_AGDI_LINK_COM_NAME     "elaphure.Mutex.agdi.link"
 #define EL_MUTEX_AGDI_DEBUG_ACCESS_NAME "elaphure.Mutex.agdi.debugAcc"
 
 static int CreateLinkCom()
 {
-    // Create mutex (buf holds unique name for the USB device)
-    if (!LinkMutex)
-        LinkMutex = CreateMutex(NULL, FALSE, EL_MUTEX_AGDI_LINK_COM_NAME);
-
     if (!kDebugAccessMutex)
         kDebugAccessMutex = CreateMutex(NULL, FALSE, EL_MUTEX_AGDI_DEBUG_ACCESS_NAME);
 
@@ -847,11 +844,6 @@ static int CreateLinkCom()
 
 void DeleteLinkCom()
 {
-    // Delete mutex
-    if (LinkMutex) {
-        CloseHandle(LinkMutex);
-        LinkMutex = 0;
-    }
 }
 #endif
 
@@ -871,20 +863,10 @@ int LinkCom(int stat)
     // }
 
 #if 1
-    DWORD res;
-
-    if (!LinkMutex)
-        return (EU12);
-
     if (stat) {
-        res = WaitForSingleObject(LinkMutex, 3000); // Wait 3s to get Mutex
-        if (res == WAIT_TIMEOUT)
-            return (EU13); // Timeout
-        if (res != WAIT_OBJECT_0)
-            return (EU12);
+        return (AS_Lock(AS_LOCK_TIMEOUT)); // Wait 3s to get access
     } else {
-        if (!ReleaseMutex(LinkMutex))
-            return (EU12);
+        return (AS_Unlock());
     }
 #endif
 
@@ -86,10 +86,11 @@ DWORD RWPage = 0x1000; // R/W Page (Auto Increment)
 DWORD SWBKPT32 = 0xE1200070; // SW Breakpoint: ARM Instruction BKPT 0
 WORD  SWBKPT16 = 0xBE00;     // SW Breakpoint: Thumb Instruction BKPT 0
 
-DWORD DHCSR_MaskIntsStop = 0; // Mask Interrupts on stop (0 - don't mask, C_MASKINTS - do mask)
-WORD  SWJ_SwitchSeq;          // Succeeding Switch Sequence (for later recovery)
-RgFPB RegFPB;                 // FPB Registers
-RgDWT RegDWT;                 // DWT Registers
+DWORD DHCSR_MaskIntsStop    = 0; // Mask Interrupts on stop (0 - don't mask, C_MASKINTS - do mask)
+DWORD DHCSR_MaskIntsSysCall = 0; // Mask Interrupts while a system call runs (0 - don't mask, C_MASKINTS - do mask)
+WORD  SWJ_SwitchSeq;             // Succeeding Switch Sequence (for later recovery)
+RgFPB RegFPB;                    // FPB Registers
+RgDWT RegDWT;                    // DWT Registers
 
 
 // Debug Block Addresses
@@ -160,6 +161,7 @@ int (*SetARMRegs)(RgARMCM *regs, RgARMFPU *rfpu, U64 mask);       // Set ARM Reg
 #endif                                                                        // DBGCM_V8M
 int (*SysCallExec)(RgARMCM *regs);                                            // System Call Execute
 int (*SysCallRes)(DWORD *rval);                                               // System Call Result
+int (*SysCallWait)(DWORD *rval, BOOL *done);                                  // System Call Wait and Result
 int (*TestSizesAP)(void);                                                     // Test Sizes Supported in AP CSW
 int (*DAPAbortVal)(DWORD val);                                                // DAP Abort with value to write
 int (*ReadBlockD8)(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib);            // Read Data Block of nMany 8-bit accesses
@@ -177,6 +179,12 @@ int (*WriteARMMemD32)(DWORD *nAdr, U32 *pB, DWORD nMany, BYTE attrib);        //
 int (*SwitchDP)(DWORD id, bool force);                                        // Switch DP
 int (*SWJ_Sequence)(int cnt, U64 val);                                        // Execute SWJ (SWDIO_TMS) Sequence
 int (*SWJ_Clock)(BYTE cid, BOOL rtck);
+int (*ReadRanges)(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges); // Read Data Ranges
+int (*WriteRanges)(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges); // Write Data Ranges
+int (*ReadVector)(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);                  // Read Data Vector
+int (*WriteVector)(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);                 // Write Data Vector
+DWORD VectorDone;                                                             // Items of the last ReadVector/WriteVector before the failing one
+int (*LoadARMMem)(DWORD *nAdr, BYTE *pB, DWORD nMany);                        // Load ARM Memory (Program Download to RAM)
 
 
 // Big Endian 16-bit Swap
@@ -348,9 +356,10 @@ BYTE OverlapSCSv8M(DWORD adr, DWORD many)
 // Read CID
 static int ReadCID(DWORD *cid, DWORD adr, DWORD r32)
 {
-    BYTE  buf[16];
-    DWORD n;
-    int   status;
+    BYTE       buf[16];
+    MEM_VECTOR vec[4];
+    DWORD      n;
+    int        status;
 
 #if DBGCM_V8M
     if (r32) {
@@ -359,9 +368,14 @@ static int ReadCID(DWORD *cid, DWORD adr, DWORD r32)
             return (status);
     } else {
         for (n = 0; n < 16; n += 4) {
-            status = ReadD8(adr + n, &buf[n], BLOCK_SECTYPE_ANY);
-            if (status)
-                return (status);
+            vec[n / 4].Addr = adr + n;
+            vec[n / 4].Size = 1;
+        }
+        status = ReadVector(vec, 16 / 4, BLOCK_SECTYPE_ANY);
+        if (status)
+            return (status);
+        for (n = 0; n < 16; n += 4) {
+            buf[n] = (BYTE)vec[n / 4].Val;
         }
     }
 #else  // DBGCM_V8M
@@ -371,9 +385,14 @@ static int ReadCID(DWORD *cid, DWORD adr, DWORD r32)
             return (status);
     } else {
         for (n = 0; n < 16; n += 4) {
-            status = ReadD8(adr + n, &buf[n]);
-            if (status)
-                return (status);
+            vec[n / 4].Addr = adr + n;
+            vec[n / 4].Size = 1;
+        }
+        status = ReadVector(vec, 16 / 4, 0 /*attrib*/);
+        if (status)
+            return (status);
+        for (n = 0; n < 16; n += 4) {
+            buf[n] = (BYTE)vec[n / 4].Val;
         }
     }
 #endif // DBGCM_V8M
@@ -386,9 +405,10 @@ static int ReadCID(DWORD *cid, DWORD adr, DWORD r32)
 // Read PID
 static int ReadPID(UINT64 *pid, DWORD adr, DWORD r32)
 {
-    BYTE  buf[32];
-    DWORD n;
-    int   status;
+    BYTE       buf[32];
+    MEM_VECTOR vec[8];
+    DWORD      n;
+    int        status;
 
 #if DBGCM_V8M
     if (r32) {
@@ -397,9 +417,14 @@ static int ReadPID(UINT64 *pid, DWORD adr, DWORD r32)
             return (status);
     } else {
         for (n = 0; n < 32; n += 4) {
-            status = ReadD8(adr + n, &buf[n], BLOCK_SECTYPE_ANY);
-            if (status)
-                return (status);
+            vec[n / 4].Addr = adr + n;
+            vec[n / 4].Size = 1;
+        }
+        status = ReadVector(vec, 32 / 4, BLOCK_SECTYPE_ANY);
+        if (status)
+            return (status);
+        for (n = 0; n < 32; n += 4) {
+            buf[n] = (BYTE)vec[n / 4].Val;
         }
     }
 #else  // DBGCM_V8M
@@ -409,9 +434,14 @@ static int ReadPID(UINT64 *pid, DWORD adr, DWORD r32)
             return (status);
     } else {
         for (n = 0; n < 32; n += 4) {
-            status = ReadD8(adr + n, &buf[n]);
-            if (status)
-                return (status);
+            vec[n / 4].Addr = adr + n;
+            vec[n / 4].Size = 1;
+        }
+        status = ReadVector(vec, 32 / 4, 0 /*attrib*/);
+        if (status)
+            return (status);
+        for (n = 0; n < 32; n += 4) {
+            buf[n] = (BYTE)vec[n / 4].Val;
         }
     }
 #endif // DBGCM_V8M
@@ -426,12 +456,13 @@ static DWORD rompn = 0;
 // Process ROM Table
 int ROM_Table(DWORD ptr)
 {
-    int    status;
-    DWORD  adr, val, cnt, n, type;
-    DWORD  cid;
-    UINT64 pid;
-    DWORD  r32;
-    BYTE   buf[32];
+    int        status;
+    DWORD      adr, val, cnt, n, k, type;
+    DWORD      cid;
+    UINT64     pid;
+    DWORD      r32;
+    BYTE       buf[32];
+    MEM_VECTOR vec[4];
     DWORD  dev;
     DWORD  cpupn = 0;
 
@@ -489,19 +520,14 @@ int ROM_Table(DWORD ptr)
                     if (status)
                         return (status);
                 } else {
-                    status = ReadD8(adr + 16 * n + 0, &buf[0], BLOCK_SECTYPE_ANY);
-                    if (status)
-                        return (status);
-                    status = ReadD8(adr + 16 * n + 4, &buf[1], BLOCK_SECTYPE_ANY);
-                    if (status)
-                        return (status);
-                    status = ReadD8(adr + 16 * n + 8, &buf[2], BLOCK_SECTYPE_ANY);
-                    if (status)
-                        return (status);
-                    status = ReadD8(adr + 16 * n + 12, &buf[3], BLOCK_SECTYPE_ANY);
+                    for (k = 0; k < 4; k++) {
+                        vec[k].Addr = adr + 16 * n + 4 * k;
+                        vec[k].Size = 1;
+                    }
+                    status = ReadVector(vec, 4, BLOCK_SECTYPE_ANY);
                     if (status)
                         return (status);
-                    val = *((DWORD *)&buf[0]);
+                    val = vec[0].Val | (vec[1].Val << 8) | (vec[2].Val << 16) | (vec[3].Val << 24);
                 }
                 if (val == 0)
                     return (0); // End of Table Marker
@@ -516,19 +542,14 @@ int ROM_Table(DWORD ptr)
                     if (status)
                         return (status);
                 } else {
-                    status = ReadD8(adr + 16 * n + 0, &buf[0]);
-                    if (status)
-                        return (status);
-                    status = ReadD8(adr + 16 * n + 4, &buf[1]);
-                    if (status)
-                        return (status);
-                    status = ReadD8(adr + 16 * n + 8, &buf[2]);
-                    if (status)
-                        return (status);
-                    status = ReadD8(adr + 16 * n + 12, &buf[3]);
+                    for (k = 0; k < 4; k++) {
+                        vec[k].Addr = adr + 16 * n + 4 * k;
+                        vec[k].Size = 1;
+                    }
+                    status = ReadVector(vec, 4, 0 /*attrib*/);
                     if (status)
                         return (status);
-                    val = *((DWORD *)&buf[0]);
+                    val = vec[0].Val | (vec[1].Val << 8) | (vec[2].Val << 16) | (vec[3].Val << 24);
                 }
                 if (val == 0)
                     return (0); // End of Table Marker
@@ -840,6 +861,7 @@ int Debug_Init(void)
             SetARMRegs     = JTAG_SetARMRegs;
             SysCallExec    = JTAG_SysCallExec;
             SysCallRes     = JTAG_SysCallRes;
+            SysCallWait    = JTAG_SysCallWait;
             TestSizesAP    = JTAG_TestSizesAP;
             DAPAbortVal    = JTAG_DAPAbortVal;
             ReadBlockD8    = JTAG_ReadBlockD8;
@@ -857,6 +879,11 @@ int Debug_Init(void)
             SwitchDP       = JTAG_SwitchDP;
             SWJ_Sequence   = JTAG_SWJ_Sequence;
             SWJ_Clock      = JTAG_SWJ_Clock;
+            ReadRanges     = JTAG_ReadRanges;
+            WriteRanges    = JTAG_WriteRanges;
+            ReadVector     = JTAG_ReadVector;
+            WriteVector    = JTAG_WriteVector;
+            LoadARMMem     = JTAG_LoadARMMem;
             status         = JTAG_DebugInit();
             break;
         case SW_DP:
@@ -880,6 +907,7 @@ int Debug_Init(void)
             SetARMRegs     = SWD_SetARMRegs;
             SysCallExec    = SWD_SysCallExec;
             SysCallRes     = SWD_SysCallRes;
+            SysCallWait    = SWD_SysCallWait;
             TestSizesAP    = SWD_TestSizesAP;
             DAPAbortVal    = SWD_DAPAbortVal;
             ReadBlockD8    = SWD_ReadBlockD8;
@@ -897,6 +925,11 @@ int Debug_Init(void)
             SwitchDP       = SWD_SwitchDP;
             SWJ_Sequence   = SWD_SWJ_Sequence;
             SWJ_Clock      = SWD_SWJ_Clock;
+            ReadRanges     = SWD_ReadRanges;
+            WriteRanges    = SWD_WriteRanges;
+            ReadVector     = SWD_ReadVector;
+            WriteVector    = SWD_WriteVector;
+            LoadARMMem     = SWD_LoadARMMem;
             status         = SWD_DebugInit();
             break;
         default:
@@ -1473,8 +1506,9 @@ void InitDebug()
     SWBKPT32 = 0xE1200070; // SW Breakpoint: ARM Instruction BKPT 0
     SWBKPT16 = 0xBE00;     // SW Breakpoint: Thumb Instruction BKPT 0
 
-    DHCSR_MaskIntsStop = 0; // Mask Interrupts on stop (0 - don't mask, C_MASKINTS - do mask)
-    SWJ_SwitchSeq      = 0; // Succeeding Switch Sequence (for later recovery)
+    DHCSR_MaskIntsStop    = 0; // Mask Interrupts on stop (0 - don't mask, C_MASKINTS - do mask)
+    DHCSR_MaskIntsSysCall = 0; // Mask Interrupts while a system call runs (0 - don't mask, C_MASKINTS - do mask)
+    SWJ_SwitchSeq         = 0; // Succeeding Switch Sequence (for later recovery)
 
     memset(&RegFPB, 0, sizeof(RegFPB)); // FPB Registers
     memset(&RegDWT, 0, sizeof(RegDWT)); // DWT Registers
@@ -1520,6 +1554,7 @@ void InitDebug()
     SetARMRegs     = NULL; // Set ARM Registers
     SysCallExec    = NULL; // System Call Execute
     SysCallRes     = NULL; // System Call Result
+    SysCallWait    = NULL; // System Call Wait and Result
     TestSizesAP    = NULL; // Test Sizes Supported in AP CSW
     DAPAbortVal    = NULL; // DAP Abort with value to write
     ReadBlockD8    = NULL; // Read Data Block of nMany 8-bit accesses
@@ -1537,6 +1572,11 @@ void InitDebug()
     SwitchDP       = NULL; // Switch DP
     SWJ_Sequence   = NULL; // Execute SWJ (SWDIO_TMS) Sequence
     SWJ_Clock      = NULL; // Change Debug Clock Frequency
+    ReadRanges     = NULL; // Read Data Ranges
+    WriteRanges    = NULL; // Write Data Ranges
+    ReadVector     = NULL; // Read Data Vector
+    WriteVector    = NULL; // Write Data Vector
+    LoadARMMem     = NULL; // Load ARM Memory (Program Download to RAM)
     level          = 0;
     rompn          = 0;
     CSW_Val_Base   = CSW_RESERVED | // Basic CSW Value
@@ -269,8 +269,9 @@ extern DWORD RWPage; // R/W Page (Auto Increment)
 extern DWORD SWBKPT32; // SW Breakpoint: ARM Instruction BKPT 0
 extern WORD  SWBKPT16; // SW Breakpoint: Thumb Instruction BKPT 0
 
-extern DWORD DHCSR_MaskIntsStop; // Mask Interrupts on stop (0 - don't mask, C_MASKINTS - do mask)
-extern BOOL  DSCSR_Has_CDSKEY;   // DSCSR has CDSKEY Bit (Security Extensions only)
+extern DWORD DHCSR_MaskIntsStop;    // Mask Interrupts on stop (0 - don't mask, C_MASKINTS - do mask)
+extern DWORD DHCSR_MaskIntsSysCall; // Mask Interrupts while a system call runs (0 - don't mask, C_MASKINTS - do mask)
+extern BOOL  DSCSR_Has_CDSKEY;      // DSCSR has CDSKEY Bit (Security Extensions only)
 
 extern WORD SWJ_SwitchSeq; // Succeeding Switch Sequence (for later recovery)
 // 02.07.2019: Deprecated CSW_Val_Base - Use AP_CONTEXT::CSW_Val_Base mechanism instead (see "Usage of AP_Context" in JTAG.CPP/SWD.CPP)
@@ -298,8 +299,16 @@ typedef struct {
     DWORD Addr; // Component Offset
 } CS_LOCATION;
 
+// Memory Vector Item - See ReadVector/WriteVector
+typedef struct MEM_VECTOR {
+    DWORD Addr; // Address, aligned to the access size
+    DWORD Val;  // Value, 8-bit and 16-bit values in the low bits
+    BYTE  Size; // Access Size in Bytes (1, 2 or 4)
+} MEM_VECTOR;
 
-#define RWBlock 1024 // R/W Block Size
+
+#define RWBlock 1024           // R/W Block Size
+#define RWBulk  (64 * RWBlock) // Max. R/W Size of one bulk memory access
 
 #define PPBAddr 0xE0000000 // Private Peripheral Bus Address
 
@@ -1009,6 +1018,7 @@ extern int (*SetARMRegs)(RgARMCM *regs, RgARMFPU *rfpu, U64 mask);       // Set
 #endif                                                                               // DBGCM_V8M
 extern int (*SysCallExec)(RgARMCM *regs);                                            // System Call Execute
 extern int (*SysCallRes)(DWORD *rval);                                               // System Call Result
+extern int (*SysCallWait)(DWORD *rval, BOOL *done);                                  // System Call Wait and Result
 extern int (*TestSizesAP)(void);                                                     // Test Sizes Supported in AP CSW
 extern int (*DAPAbortVal)(DWORD val);                                                // DAP Abort with value to write
 extern int (*ReadBlockD8)(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib);            // Read Data Block of nMany 8-bit accesses
@@ -1026,6 +1036,12 @@ extern int (*WriteARMMemD32)(DWORD *nAdr, U32 *pB, DWORD nMany, BYTE attrib);
 extern int (*SwitchDP)(DWORD id, bool force);                                        // Switch DP
 extern int (*SWJ_Sequence)(int cnt, U64 val);                                        // Execute SWJ (SWDIO_TMS) Sequence
 extern int (*SWJ_Clock)(BYTE cid, BOOL rtck);                                        // Change Debug Clock Frequency
+extern int (*ReadRanges)(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges); // Read Data Ranges
+extern int (*WriteRanges)(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges); // Write Data Ranges
+extern int (*LoadARMMem)(DWORD *nAdr, BYTE *pB, DWORD nMany);                        // Load ARM Memory (Program Download to RAM)
+extern int (*ReadVector)(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);                  // Read Data Vector
+extern int (*WriteVector)(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);                 // Write Data Vector
+extern DWORD VectorDone;                                                             // Items of the last ReadVector/WriteVector before the failing one
 extern WORD  Swap16(WORD v);                                                         // 16-bit Endian Swap
 extern DWORD Swap32(DWORD v);                                                        // 32-bit Endian Swap
 extern int   ROM_Table(DWORD ptr);                                                   // Read ROM Table
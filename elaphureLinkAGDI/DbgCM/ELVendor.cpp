@@ -0,0 +1,289 @@
+﻿/**
+ * @file ELVendor.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Client of the elaphureLink vendor commands, flash programming on the probe
+ *
+ * The vendor commands (docs/vendor_command.md) are sent with the 0x88 prefix through
+ * CMSIS_DAP_Commands(). A probe with the FlashOS commands loads the flash algorithm and
+ * runs its functions by itself, so a page is programmed with one bulk transfer instead of
+ * the block writes, register writes and halt polling of the native DAP path.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+#include "COLLECT.H"
+#include "..\BOM.H"
+#include "Debug.h"
+#include "rddi_dll.hpp"
+#include "dap.hpp"
+#include "AccessScheduler.h"
+
+#include "ELVendor.h"
+
+
+#define ELV_HEADER_SIZE  4    // Prefix, command type, payload length
+#define ELV_RES_MAX      64   // Max. response size, the commands used have short responses
+#define ELV_DESC_PRESENT 0x80 // First bit of load_algorithm: FlashOS description present
+#define ELV_LAST_DATA    0x80 // First bit of program_page: last data of the page
+#define ELV_COMM_MARGIN  1000 // Time in ms added to the function timeout for the transfer
+
+
+static BYTE kELVReq[ELV_HEADER_SIZE + 64 + ELV_CHUNK_SIZE];
+static BYTE kELVRes[ELV_RES_MAX];
+static BOOL kELVScope; // Inside the vendor scope, target access is held
+
+
+static void ELV_PutWord(BYTE *p, DWORD val)
+{
+    p[0] = (BYTE)val;
+    p[1] = (BYTE)(val >> 8);
+    p[2] = (BYTE)(val >> 16);
+    p[3] = (BYTE)(val >> 24);
+}
+
+
+/*
+ * Send one vendor command, the payload is already in kELVReq behind the header.
+ * A command which runs a flash function extends the response timeout of the proxy by
+ * the function timeout. *pStatus receives the response status, *pLen the response
+ * payload length.
+ */
+
+static int ELV_Command(BYTE type, DWORD nPayload, DWORD timeout, BYTE *pStatus, DWORD *pLen)
+{
+    AS_Guard lk;
+    BYTE    *req = kELVReq;
+    BYTE    *res = kELVRes;
+    int      req_len, res_len;
+    int      status;
+
+    kELVReq[0] = ID_DAP_Vendor8;
+    kELVReq[1] = type;
+    kELVReq[2] = (BYTE)nPayload;
+    kELVReq[3] = (BYTE)(nPayload >> 8);
+
+    req_len = ELV_HEADER_SIZE + nPayload;
+    res_len = sizeof(kELVRes);
+
+    if (timeout) {
+        rddi::DAP_SetCommTimeout(rddi::k_rddi_handle, timeout + ELV_COMM_MARGIN);
+    }
+    status = rddi::CMSIS_DAP_Commands(rddi::k_rddi_handle, 1, &req, &req_len, &res, &res_len);
+    if (timeout) {
+        rddi::DAP_SetCommTimeout(rddi::k_rddi_handle, 0); // default
+    }
+    if (status) {
+        return (status);
+    }
+    if (res_len < ELV_HEADER_SIZE || kELVRes[0] != ID_DAP_Vendor8) {
+        return (rddi::RDDI_DAP_ERROR_SWJ);
+    }
+
+    *pStatus = kELVRes[1];
+    *pLen    = kELVRes[2] | (kELVRes[3] << 8);
+    if (*pLen > (DWORD)(res_len - ELV_HEADER_SIZE)) {
+        return (rddi::RDDI_DAP_ERROR_SWJ);
+    }
+
+    return (0);
+}
+
+
+// Command without response payload, every status except OK is a failure
+static int ELV_Simple(BYTE type, DWORD nPayload, DWORD timeout)
+{
+    BYTE  st;
+    DWORD len;
+    int   status;
+
+    status = ELV_Command(type, nPayload, timeout, &st, &len);
+    if (status)
+        return (status);
+
+    return ((st == EL_VENDOR_STATUS_OK) ? 0 : ELV_FAILED);
+}
+
+
+int ELV_Capability(DWORD *pCaps)
+{
+    BYTE  st;
+    DWORD len, i;
+    int   status;
+
+    kELVReq[ELV_HEADER_SIZE] = 0x00; // Capabilities of all commands
+
+    status = ELV_Command(EL_VENDOR_CAPABILITY, 1, 0, &st, &len);
+    if (status)
+        return (status);
+    if (st != EL_VENDOR_STATUS_OK || len < 1 || kELVRes[ELV_HEADER_SIZE] != 0x00)
+        return (ELV_FAILED);
+
+    // Bitmap, left bit first: command type n is bit (7 - n % 8) of byte n / 8
+    *pCaps = 0;
+    for (i = 0; i < 32 && (1 + i / 8) < len; i++) {
+        if (kELVRes[ELV_HEADER_SIZE + 1 + i / 8] & (0x80 >> (i % 8)))
+            *pCaps |= 1UL << i;
+    }
+
+    return (0);
+}
+
+
+int ELV_ScopeEnter(void)
+{
+    int status;
+
+    if (kELVScope)
+        return (0);
+
+    // Native commands of other threads would fail inside the scope
+    status = AS_Lock(AS_LOCK_TIMEOUT);
+    if (status)
+        return (status);
+
+    status = ELV_Simple(EL_VENDOR_SCOPE_ENTER, 0, 0);
+    if (status) {
+        AS_Unlock();
+        return (status);
+    }
+
+    kELVScope = TRUE;
+    return (0);
+}
+
+
+int ELV_ScopeExit(void)
+{
+    AP_CONTEXT *apCtx;
+    int         status, st;
+
+    if (!kELVScope)
+        return (0);
+
+    status    = ELV_Simple(EL_VENDOR_SCOPE_EXIT, 0, 0);
+    kELVScope = FALSE;
+
+    // The flash algorithm ran with its own SELECT and CSW
+    AP_Bank        = 0x10; // Any value except 0, forces SELECT for block accesses
+    k_last_ap_bank = 0xE0; // Differs from AP_Bank, forces SELECT for AP register accesses
+
+    st = AP_Switch(&apCtx);
+    if (st == 0)
+        st = WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+
+    AS_Unlock();
+    return (status ? status : st);
+}
+
+
+int ELV_LoadAlgorithm(DWORD nAdr, const ELV_FLASHOS *pDesc, const BYTE *pB, DWORD nMany)
+{
+    BYTE *p;
+    DWORD n;
+    int   status;
+
+    do {
+        p = &kELVReq[ELV_HEADER_SIZE];
+
+        // The description goes with the first command only
+        ELV_PutWord(p, pDesc ? ELV_DESC_PRESENT : 0);
+        ELV_PutWord(p + 4, nAdr);
+        p += 8;
+        if (pDesc) {
+            ELV_PutWord(p + 0, pDesc->BreakPoint);
+            ELV_PutWord(p + 4, pDesc->rSP);
+            ELV_PutWord(p + 8, pDesc->rSB);
+            ELV_PutWord(p + 12, pDesc->ProgramPage);
+            ELV_PutWord(p + 16, pDesc->BlankCheck);
+            ELV_PutWord(p + 20, pDesc->EraseSector);
+            ELV_PutWord(p + 24, pDesc->PrgBuf);
+            ELV_PutWord(p + 28, pDesc->valEmpty); // Value Empty, 24 reserved bits
+            p += 32;
+            pDesc = NULL;
+        }
+
+        n = (nMany > ELV_CHUNK_SIZE) ? ELV_CHUNK_SIZE : nMany;
+        memcpy(p, pB, n);
+        p += n;
+
+        status = ELV_Simple(EL_FLASHOS_LOAD_ALGORITHM, (DWORD)(p - &kELVReq[ELV_HEADER_SIZE]), 0);
+        if (status)
+            return (status);
+
+        nAdr += n;
+        pB += n;
+        nMany -= n;
+    } while (nMany);
+
+    return (0);
+}
+
+
+int ELV_ExecuteFunction(const RgARMCM *regs, DWORD timeout, DWORD *pR0)
+{
+    BYTE *p = &kELVReq[ELV_HEADER_SIZE];
+    BYTE  st;
+    DWORD len;
+    int   status;
+
+    ELV_PutWord(p + 0, regs->A1);
+    ELV_PutWord(p + 4, regs->A2);
+    ELV_PutWord(p + 8, regs->A3);
+    ELV_PutWord(p + 12, regs->A4);
+    ELV_PutWord(p + 16, regs->PC);
+    ELV_PutWord(p + 20, regs->SB);
+    ELV_PutWord(p + 24, regs->SP);
+    ELV_PutWord(p + 28, regs->LR);
+
+    status = ELV_Command(EL_FLASHOS_EXECUTE_FUNCTION, 32, timeout, &st, &len);
+    if (status)
+        return (status);
+
+    // R0 of the function, older probes report only the status
+    if (len >= 4) {
+        p    = &kELVRes[ELV_HEADER_SIZE];
+        *pR0 = p[0] | (p[1] << 8) | (p[2] << 16) | ((DWORD)p[3] << 24);
+        return (0);
+    }
+
+    *pR0 = (st == EL_VENDOR_STATUS_OK) ? 0 : 1;
+    return (ELV_NO_RESULT);
+}
+
+
+int ELV_ProgramPage(DWORD nAdr, DWORD nSize, const BYTE *pB, DWORD nMany, DWORD timeout)
+{
+    BYTE *p;
+    BYTE  st;
+    DWORD cnt, n, len;
+    int   status;
+
+    cnt = (nMany + 3) & ~0x00000003;
+    do {
+        p = &kELVReq[ELV_HEADER_SIZE];
+        n = (cnt > ELV_CHUNK_SIZE) ? ELV_CHUNK_SIZE : cnt;
+
+        if (n == cnt) { // Last data, the probe programs the page
+            *p++ = ELV_LAST_DATA;
+            ELV_PutWord(p, nAdr);
+            ELV_PutWord(p + 4, nSize);
+            p += 8;
+        } else {
+            *p++ = 0;
+        }
+        memcpy(p, pB, n);
+        p += n;
+
+        status = ELV_Command(EL_FLASHOS_PROGRAM_PAGE, (DWORD)(p - &kELVReq[ELV_HEADER_SIZE]), (n == cnt) ? timeout : 0, &st, &len);
+        if (status)
+            return (status);
+        if (st != EL_VENDOR_STATUS_OK && (n == cnt || st != EL_VENDOR_STATUS_PENDING))
+            return (ELV_FAILED);
+
+        pB += n;
+        cnt -= n;
+    } while (cnt);
+
+    return (0);
+}
@@ -0,0 +1,81 @@
+﻿/**
+ * @file ELVendor.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Client of the elaphureLink vendor commands, flash programming on the probe
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#define ELV_CHUNK_SIZE  1024       // Data bytes per command, one request must fit into the 1400 bytes MTU
+#define ELV_CAP_FLASHOS 0x000000BC // Command types 0x2 - 0x5, 0x7: vendor scope and the FlashOS commands in use
+#define ELV_FAILED      (-1)       // The probe executed the command and reports failure
+#define ELV_NO_RESULT   (-2)       // The probe executed the function, but does not report R0
+
+
+struct ELV_FLASHOS {
+    DWORD BreakPoint;  // Exit Point of the Flash Algorithm Functions
+    DWORD rSP;         // Stack Pointer
+    DWORD rSB;         // Static Base
+    DWORD ProgramPage; // ProgramPage Entry Point
+    DWORD BlankCheck;  // BlankCheck Entry Point
+    DWORD EraseSector; // EraseSector Entry Point
+    DWORD PrgBuf;      // RAM Buffer for the Page Data
+    BYTE  valEmpty;    // Content of erased Memory
+};
+
+
+/**
+ * @brief Query the vendor commands the probe supports.
+ *
+ * @param pCaps receives the command bitmap, bit n: command type n present
+ * @return 0: OK, else error code
+ */
+extern int ELV_Capability(DWORD *pCaps);
+
+/**
+ * @brief Enter the vendor scope. Native DAP commands are not allowed inside the scope,
+ *        so target access is held by the calling thread until ELV_ScopeExit().
+ *
+ * @return 0: OK, ELV_FAILED, else error code
+ */
+extern int ELV_ScopeEnter(void);
+
+/**
+ * @brief Exit the vendor scope and release target access. The probe changed SELECT and
+ *        CSW, both are written again.
+ *
+ * @return 0: OK, ELV_FAILED, else error code
+ */
+extern int ELV_ScopeExit(void);
+
+/**
+ * @brief Load the flash algorithm into target RAM, split into several commands if needed.
+ *
+ * @param nAdr load address
+ * @param pDesc entry points and buffers of the algorithm
+ * @return 0: OK, ELV_FAILED, else error code
+ */
+extern int ELV_LoadAlgorithm(DWORD nAdr, const ELV_FLASHOS *pDesc, const BYTE *pB, DWORD nMany);
+
+/**
+ * @brief Execute a flash algorithm function on the probe and wait for its completion.
+ *
+ * @param regs R0 - R3, PC, SB, SP and LR for the function
+ * @param timeout timeout of the function in ms
+ * @param pR0 receives R0 returned by the function, with ELV_NO_RESULT only 0 (OK) or 1 (failed)
+ * @return 0: OK, ELV_NO_RESULT: the probe reports only success or failure, else error code
+ */
+extern int ELV_ExecuteFunction(const RgARMCM *regs, DWORD timeout, DWORD *pR0);
+
+/**
+ * @brief Program one page with the loaded algorithm. The page data is sent in chunks,
+ *        the probe programs the page with the last one.
+ *
+ * @param nSize size passed to ProgramPage
+ * @param pB page data for the RAM buffer, nMany bytes
+ * @param timeout timeout of the programming in ms
+ * @return 0: OK, ELV_FAILED, else error code
+ */
+extern int ELV_ProgramPage(DWORD nAdr, DWORD nSize, const BYTE *pB, DWORD nMany, DWORD timeout);
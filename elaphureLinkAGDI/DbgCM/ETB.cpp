@@ -33,6 +33,7 @@
 #include "..\BOM.h"
 #include "Collect.h"
 #include "Debug.h"
+#include "AccessScheduler.h"
 #include "ETB.h"
 #include "CSTF.h"
 
@@ -605,13 +606,10 @@ static int ETB_ReadData(DWORD nMany)
         while (nBytes > 0) {
             bi = (nBytes > MaxLinkData) ? MaxLinkData : nBytes; // bytes in iteration
 
-            status = LinkCom(1); // Apply lock to protect AP_Sel
+            status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Select ETB AP
             if (status)
                 return (status);
 
-            APSel  = AP_Sel;
-            AP_Sel = (ETB_Location.AP << APSEL_P); // Select ETB AP
-
             if (nIdx + bi > ETB_BUFFER_SIZE) {
                 // ETB_BUFFER_SIZE multiple of 4 bytes, buffer entries will be 4-byte aligned when reaching buffer boundary.
                 //  => Can simply split up the data read into two block reads
@@ -641,8 +639,7 @@ static int ETB_ReadData(DWORD nMany)
                 nIdx = (nIdx + bi) & (ETB_BUFFER_SIZE - 1);
             }
 
-            AP_Sel = APSel; // Restore previous AP setting
-            status = LinkCom(0);
+            status = AS_EndAPTransaction(APSel);
             if (status)
                 return (status);
 
@@ -651,13 +648,10 @@ static int ETB_ReadData(DWORD nMany)
     } else {
         // ETB width is not multiple of 4 (ETB in 24bit mode), slow read (should be a rare case)
         while (nAccesses) {
-            status = LinkCom(1); // 09.11.2018: Apply lock to protect AP_Sel, do inside loop for fairness (other threads may need some access time)
+            status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Select ETB AP
             if (status)
                 return (status);
 
-            APSel  = AP_Sel;
-            AP_Sel = (ETB_Location.AP << APSEL_P); // Select ETB AP
-
             if (nIdx + sizeof(DWORD) > ETB_BUFFER_SIZE) {
                 // Read to temp buffer and write byte by byte to buffer (wraparound)
 #if DBGCM_V8M
@@ -683,8 +677,7 @@ static int ETB_ReadData(DWORD nMany)
                 nIdx = (nIdx + bytesPerAccess) & (ETB_BUFFER_SIZE - 1);
             }
 
-            AP_Sel = APSel; // Restore previous AP setting
-            status = LinkCom(0);
+            status = AS_EndAPTransaction(APSel);
             if (status)
                 return (status);
 
@@ -704,8 +697,7 @@ static int ETB_ReadData(DWORD nMany)
     return (0);
 
 end_err:
-    AP_Sel = APSel; // Restore previous AP setting
-    LinkCom(0);
+    AS_EndAPTransaction(APSel);
 
     return (status);
 }
@@ -723,13 +715,10 @@ static int ETB_StopCapture()
     if (status)
         return status;
 
-    status = LinkCom(1); // 16.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         goto end;
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
     // Disable trace capture
     RegETB.CTRL = 0;
 #if DBGCM_V8M
@@ -787,11 +776,10 @@ static int ETB_StopCapture()
         goto end;
 
 end:
-    AP_Sel = APSel; // Restore previous AP setting
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     return (status);
@@ -836,13 +824,10 @@ int ETB_Process()
     if (status)
         return status;
 
-    status = LinkCom(1); // 16.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         return status;
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
     // Check if ETB is full (wrapped around)
 #if DBGCM_V8M
     status = ReadD32(ETB_STATUS, &val, BLOCK_SECTYPE_ANY);
@@ -917,11 +902,10 @@ int ETB_Process()
         goto init_end;
 
 init_end:
-    AP_Sel = APSel; // Restore previous AP setting
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
     if (status)
         return (status);
@@ -971,13 +955,10 @@ int ETB_Flush()
     int   status = 0;
     DWORD APSel;
 
-    status = LinkCom(1); // 16.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         return (status);
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
 #if DBGCM_V8M
     status = ReadD32(ETB_FFSR, &val, BLOCK_SECTYPE_ANY);
 #else  // DBGCM_V8M
@@ -1032,11 +1013,10 @@ int ETB_Flush()
     } // else stopped by a previous flush
 
 end:
-    AP_Sel = APSel; // Restore previous AP setting
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     return (status);
@@ -1055,13 +1035,10 @@ int ETB_Activate(void)
         return (EU32); // Trace HW not present
     }
 
-    status = LinkCom(1); // 16.11.2018: Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         return (status);
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
     // Clear the stop bits if set
 #if DBGCM_V8M
     status = ReadD32(ETB_FFCR, &val, BLOCK_SECTYPE_ANY);
@@ -1096,19 +1073,14 @@ int ETB_Activate(void)
     if (ETB_TMC) {
         // TODO: Review this once we got a properly working target!!
 
-        AP_Sel = APSel; // Restore previous AP setting
-
-        status = LinkCom(0); // 16.11.2018: Release temporarily. A potentially long timeout is ahead
+        status = AS_EndAPTransaction(APSel); // 16.11.2018: Release temporarily. A potentially long timeout is ahead
         if (status)
             return (status);
 
-        status = LinkCom(1); // 16.11.2018: Reapply lock to protect AP_Sel
+        status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
         if (status)
             return (status);
 
-        APSel  = AP_Sel;
-        AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
         // Wait for TMC to stop
         ticks = GetTickCount();
         do {
@@ -1127,20 +1099,15 @@ int ETB_Activate(void)
             goto end;
         }
 
-        AP_Sel = APSel; // Restore previous AP setting
-
-        status = LinkCom(0); // 16.11.2018: Release temporarily. Coming back from a potentially long timeout
+        status = AS_EndAPTransaction(APSel); // 16.11.2018: Release temporarily. Coming back from a potentially long timeout
         if (status)
             return (status);
 
 
-        status = LinkCom(1); // 16.11.2018: Reapply lock to protect AP_Sel
+        status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
         if (status)
             return (status);
 
-        APSel  = AP_Sel;
-        AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
         // Disable TMC if required
 #if DBGCM_V8M
         status = ReadD32(ETB_CTRL, &val, BLOCK_SECTYPE_ANY);
@@ -1190,11 +1157,10 @@ int ETB_Activate(void)
     ETB_Wraparound = FALSE;
 
 end:
-    AP_Sel = APSel; // Restore previous AP setting
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     return (status);
@@ -1236,13 +1202,10 @@ int ETB_Setup(void)
         }
     }
 
-    status = LinkCom(1); // Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         return (status);
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
     // Get initital information
     adr = ETB_Location.Addr;
 #if DBGCM_V8M
@@ -1295,11 +1258,10 @@ int ETB_Setup(void)
     }
 
 etb_end:
-    AP_Sel = APSel; // Restore previous AP setting
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
     if (status)
         return (status);
@@ -1346,25 +1308,20 @@ BOOL ETB_CanAccess()
         return FALSE;
     }
 
-    status = LinkCom(1); // Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         return FALSE;
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
 #if DBGCM_V8M
     status = ReadD32(ETB_FFSR, &val, BLOCK_SECTYPE_ANY);
 #else  // DBGCM_V8M
     status = ReadD32(ETB_FFSR, &val);
 #endif // DBGCM_V8M
 
-    AP_Sel = APSel; // Restore previous AP setting
-
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     if (status)
@@ -1389,13 +1346,10 @@ int ETB_Recovery(void)
     DWORD val;
     DWORD APSel;
 
-    status = LinkCom(1); // Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         return (status);
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
     // Check ETB state
 #if DBGCM_V8M
     status = ReadD32(ETB_CTRL, &val, BLOCK_SECTYPE_ANY);
@@ -1403,11 +1357,10 @@ int ETB_Recovery(void)
     status = ReadD32(ETB_CTRL, &val);
 #endif // DBGCM_V8M
 
-    AP_Sel = APSel; // Restore previous AP setting
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     if (status)
@@ -1418,13 +1371,10 @@ int ETB_Recovery(void)
         return (0);
     }
 
-    status = LinkCom(1); // Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(ETB_Location.AP << APSEL_P, &APSel); // Set ETB AP
     if (status)
         return (status);
 
-    APSel  = AP_Sel;
-    AP_Sel = (ETB_Location.AP << APSEL_P); // Set ETB AP
-
     // Clear the stop bits if set
 #if DBGCM_V8M
     status = ReadD32(ETB_FFCR, &val, BLOCK_SECTYPE_ANY);
@@ -1471,11 +1421,10 @@ int ETB_Recovery(void)
         goto end;
 
 end:
-    AP_Sel = APSel; // Restore previous AP setting
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
 
     return (status);
@@ -33,14 +33,21 @@
 #include "..\BOM.h"
 #include "..\ComTyp.h"
 #include "Collect.h"
-#include "ELF.h"
 #include "Flash.h"
+#include "FlashCache.h"
 #include "Debug.h"
+#include "ELVendor.h"
+#include "flm.hpp"
 
 #if DBGCM_DBG_DESCRIPTION
 #include "PDSCDebug.h"
 #endif // DBGCM_DBG_DESCRIPTION
 
+#include <algorithm>
+#include <future>
+#include <string>
+#include <vector>
+
 #if DBGCM_RECOVERY
 #include "DebugAccess.h"
 #endif // DBGCM_RECOVERY
@@ -64,22 +71,52 @@ static int Silent = 0; // Silent Mode without some Warnings
 static DWORD Counter;    // Byte Counter
 static DWORD TotalCount; // Total Byte Counter
 
-static int SecCount; // Number of Sectors (from FlashDevice)
-static int TotalSec; // Total Number of Sectors in Device
+static std::vector<flm::Sector> Sectors; // Sector Items (from FlashDevice)
 
-static DWORD ESecAddr; // Last Erased Sector Address
-static DWORD ESecSize; // Last Erased Sector Size
+static int TotalSec; // Total Number of Sectors in Device
 
-static DWORD PageAddr; // Pending Program Page Address
-static DWORD PageSize; // Pending Program Page Size
-static DWORD PageItem; // Pending Program Page Item Count
+static DWORD PageSize; // Program Page Size
 
 static DWORD NextAddr; // Next Address with known Algorithm
 
 static BOOL ExeError; // System Call Execution Error
 
+static BOOL  PrgPending; // Program Page running in the target (double buffered programming)
+static DWORD PrgBufNext; // Program Buffer for the next page (double buffered programming)
+
+static BOOL FlashOS; // Flash Algorithm runs on the probe (elaphureLink Vendor Commands)
+
 static BYTE Buffer[0x10000];
 
+struct DELTASEC {
+    DWORD adr; // Sector Address
+    DWORD sz;  // Sector Size
+};
+
+static std::vector<DELTASEC> DeltaSec; // Unchanged Sectors, skipped by Erase and Program (Delta Flashing)
+static std::vector<BYTE>     DeltaBuf; // Expected Sector Contents (Delta Flashing)
+
+static std::vector<flm::Fragment> PlanFrag; // Image Fragments with known Algorithm (Programming Plan)
+static std::vector<flm::Layout>   PlanAlg;  // Page Layout per Algorithm (Programming Plan)
+static std::vector<flm::Page>     PlanPage; // Pages to program in Address order (Programming Plan)
+static std::vector<BYTE>          PlanBuf;  // Page Data padded with the empty value (Programming Plan)
+
+struct ERASESEC {
+    DWORD adr; // Sector Address
+    DWORD sz;  // Sector Size
+    DWORD cnt; // Image Bytes in the Sector
+};
+
+static std::vector<ERASESEC> EraseSec; // Sectors to erase with the selected Algorithm (Erase Plan)
+static struct FLASHCACHE    *FlashC;   // Cache Entry of the loaded Algorithm, holds the measured Erase Timings
+
+#define ERASE_BATCH     32     // Sectors per Erase Sectors call until the Sector Erase Time is measured
+#define ERASE_BATCH_MAX 256    // Sectors per Erase Sectors call, maximum
+#define ERASE_BATCH_MS  1000   // Estimated Time per Erase Sectors call, keeps the Progress Bar moving
+#define ERASE_BLANK_MAX 0x8000 // Bytes per Blank Check call outside the Sectors to erase
+
+#define VERIFY_BLOCK 0x1000 // Ranges up to this size are read back when the CRC does not match
+
 //================================================================
 
 static OIL oil; // Progress-Bar data
@@ -134,19 +171,13 @@ static void SetPercent(DWORD val)
 
 
 /*
- *  Execute Function in Target
- *    Parameter:      timeout:  Timeout in ms
+ *  Start Function in Target
  *    Return Value:   0 - OK,  1 - Failed
  */
 
-static int ExecuteFunction(unsigned long timeout)
+static int ExecuteStart(void)
 {
-    DWORD tick1ms;
-    DWORD tdisp;
-    DWORD tick;
-    DWORD rval;
-    DWORD val;
-    int   status;
+    int status;
 
     ExeError = TRUE;
 
@@ -164,6 +195,26 @@ static int ExecuteFunction(unsigned long timeout)
         return (1);
     }
 
+    return (0);
+}
+
+
+/*
+ *  Wait for Function in Target started with ExecuteStart
+ *    Parameter:      timeout:  Timeout in ms
+ *    Return Value:   Function Result, 1 - Failed
+ */
+
+static int ExecuteWait(unsigned long timeout)
+{
+    DWORD tick1ms;
+    DWORD tdisp;
+    DWORD tick;
+    DWORD rval;
+    DWORD val;
+    BOOL  done;
+    int   status;
+
     tdisp = 0;
     tick  = GetTickCount();
     do {
@@ -171,29 +222,18 @@ static int ExecuteFunction(unsigned long timeout)
                                               // 11.09.2019: Moved up here to have at least one UV_DOXEVENTS
                                               //   per flash algorithm function call. Otherwise it could be often skipped
                                               //   for fast algorithm functions.
-#if DBGCM_V8M
-        status = ReadD32(DBG_HCSR, &val, BLOCK_SECTYPE_ANY);
-        if (status) {
-            OutError(status);
-            return (1);
-        }
-#else  // DBGCM_V8M
-        status = ReadD32(DBG_HCSR, &val);
+
+        // The probe waits for the halt and reads the result with the same request
+        status = SysCallWait(&rval, &done);
         if (status) {
             OutError(status);
             return (1);
         }
-#endif // DBGCM_V8M
-
-        if (val & S_HALT) {
-            status = SysCallRes(&rval);
-            if (status) {
-                OutError(status);
-                return (1);
-            }
+        if (done) {
             ExeError = FALSE;
             return (rval);
         }
+
         tick1ms = GetTickCount() - tick;
         if ((tick1ms - tdisp) > 500) {
             if (TimeOutTick) {
@@ -213,6 +253,175 @@ static int ExecuteFunction(unsigned long timeout)
 }
 
 
+/*
+ *  Wait for the pending Program Page (double buffered programming)
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int ProgramPageWait(void)
+{
+    if (!PrgPending)
+        return (0);
+
+    PrgPending = FALSE;
+    return (ExecuteWait(FlashDev.toProg));
+}
+
+
+/*
+ *  Result of a Vendor Command (elaphureLink FlashOS)
+ *    Parameter:      status:  Vendor Command Status
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int FlashOSResult(int status)
+{
+    if (status == 0)
+        return (0);
+    if (status != ELV_FAILED)
+        OutError(status);
+    return (1);
+}
+
+
+static int FlashOSExit(void);
+
+
+/*
+ *  Execute Function on the probe (elaphureLink FlashOS)
+ *    Parameter:      timeout:  Timeout in ms
+ *                    value:    Function returns a Value (CalculateCRC, Verify), not 0 / 1
+ *    Return Value:   Function Result, 1 - Failed
+ */
+
+static int FlashOSExecute(unsigned long timeout, BOOL value)
+{
+    DWORD r0;
+    int   status;
+
+    ExeError = TRUE;
+
+    if (TimeOut)
+        return (1);
+
+    RegARM.SB = FlashAlg.rSB;        // SB: Static Base
+    RegARM.SP = FlashAlg.rSP;        // SP: Stack Pointer
+    RegARM.LR = FlashAlg.BreakPoint; // LR: Exit Point
+
+    status = ELV_ExecuteFunction(&RegARM, timeout, &r0);
+    if (status == ELV_NO_RESULT && value) {
+        // The probe does not report R0, leave the Vendor Scope and run the Function in the Target
+        if (FlashOSExit())
+            return (1);
+        if (ExecuteStart())
+            return (1);
+        return (ExecuteWait(timeout));
+    }
+    if (status != 0 && status != ELV_NO_RESULT) {
+        OutError(status);
+        return (1);
+    }
+
+    ExeError = FALSE;
+    return ((int)r0);
+}
+
+
+/*
+ *  Enter the Vendor Scope if the probe supports the FlashOS Commands
+ */
+
+static void FlashOSEnter(void)
+{
+    DWORD caps;
+
+    FlashOS = FALSE;
+
+    if (ELV_Capability(&caps))
+        return; // Vendor Commands disabled or not supported
+    if ((caps & ELV_CAP_FLASHOS) != ELV_CAP_FLASHOS)
+        return;
+    if (ELV_ScopeEnter())
+        return;
+
+    FlashOS = TRUE;
+}
+
+
+/*
+ *  Exit the Vendor Scope
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int FlashOSExit(void)
+{
+    if (!FlashOS)
+        return (0);
+
+    FlashOS = FALSE;
+    return (FlashOSResult(ELV_ScopeExit()));
+}
+
+
+/*
+ *  Load Flash Algorithm on the probe (elaphureLink FlashOS)
+ *    Parameter:      sz:  Size of the Algorithm in Buffer
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int FlashOSLoad(DWORD sz)
+{
+    struct ELV_FLASHOS desc;
+
+    desc.BreakPoint  = FlashAlg.BreakPoint;
+    desc.rSP         = FlashAlg.rSP;
+    desc.rSB         = FlashAlg.rSB;
+    desc.ProgramPage = FlashAlg.ProgramPage;
+    desc.BlankCheck  = FlashAlg.BlankCheck;
+    desc.EraseSector = FlashAlg.EraseSector;
+    desc.PrgBuf      = FlashAlg.PrgBuf;
+    desc.valEmpty    = (BYTE)FlashDev.valEmpty;
+
+    return (FlashOSResult(ELV_LoadAlgorithm(FlashConf.RAMStart, &desc, Buffer, sz)));
+}
+
+
+/*
+ *  Execute Function in Target
+ *    Parameter:      timeout:  Timeout in ms
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int ExecuteFunction(unsigned long timeout)
+{
+    if (FlashOS)
+        return (FlashOSExecute(timeout, FALSE));
+
+    if (ProgramPageWait()) // Complete the pending page first
+        return (1);
+
+    if (ExecuteStart())
+        return (1);
+
+    return (ExecuteWait(timeout));
+}
+
+
+/*
+ *  Execute Function in Target that returns a Value
+ *    Parameter:      timeout:  Timeout in ms
+ *    Return Value:   Function Result, 1 - Failed
+ */
+
+static int ExecuteValueFunction(unsigned long timeout)
+{
+    if (FlashOS)
+        return (FlashOSExecute(timeout, TRUE));
+
+    return (ExecuteFunction(timeout));
+}
+
+
 /*
  *  Initialize Flash Programming Functions
  *    Parameter:      adr:  Device Base Address
@@ -267,7 +476,7 @@ unsigned int CalculateCRC(unsigned long crc,
     RegARM.A4 = cpv;                   // R3: Argument 4
     RegARM.PC = FlashAlg.CalculateCRC; // PC: Entry Point
 
-    return (ExecuteFunction(10000));
+    return (ExecuteValueFunction(10000));
 }
 
 
@@ -323,6 +532,26 @@ int EraseSector(unsigned long adr)
 }
 
 
+/*
+ *  Erase consecutive Sectors of the same Size, each only if it is not blank
+ *    Parameter:      adr:  First Sector Address
+ *                    sz:   Sector Size
+ *                    cnt:  Number of Sectors
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int EraseSectors(unsigned long adr, unsigned long sz, unsigned long cnt)
+{
+    RegARM.A1 = adr;                   // R0: Argument 1
+    RegARM.A2 = sz;                    // R1: Argument 2
+    RegARM.A3 = cnt;                   // R2: Argument 3
+    RegARM.A4 = FlashDev.valEmpty;     // R3: Argument 4
+    RegARM.PC = FlashAlg.EraseSectors; // PC: Entry Point
+
+    return (ExecuteFunction(2 * cnt * FlashDev.toErase)); // Blank Check and Erase per Sector
+}
+
+
 /*
  *  Program Page in Flash Memory
  *    Parameter:      adr:  Page Start Address
@@ -336,8 +565,16 @@ int ProgramPage(unsigned long adr, unsigned long sz, unsigned char *buf)
     unsigned long ba, cnt, n;
     int           status;
     DWORD         rwpage;
+    DWORD         prg;
+
+    // The probe downloads the page and programs it
+    if (FlashOS) {
+        return (FlashOSResult(ELV_ProgramPage(adr, sz, buf, PageSize, FlashDev.toProg)));
+    }
 
-    ba  = FlashAlg.PrgBuf;
+    // With two buffers the page is downloaded while the previous one is programmed
+    prg = (FlashAlg.PrgBuf2 != 0) ? PrgBufNext : FlashAlg.PrgBuf;
+    ba  = prg;
     cnt = (PageSize + 3) & ~0x00000003;
 
     rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
@@ -367,12 +604,30 @@ int ProgramPage(unsigned long adr, unsigned long sz, unsigned char *buf)
         cnt -= n;
     }
 
+    if (FlashAlg.PrgBuf2 == 0) {
+        RegARM.A1 = adr;                  // R0: Argument 1
+        RegARM.A2 = sz;                   // R1: Argument 2
+        RegARM.A3 = prg;                  // R2: Argument 3
+        RegARM.PC = FlashAlg.ProgramPage; // PC: Entry Point
+
+        return (ExecuteFunction(FlashDev.toProg));
+    }
+
+    if (ProgramPageWait()) // Previous page done ?
+        return (1);
+
     RegARM.A1 = adr;                  // R0: Argument 1
     RegARM.A2 = sz;                   // R1: Argument 2
-    RegARM.A3 = FlashAlg.PrgBuf;      // R2: Argument 3
+    RegARM.A3 = prg;                  // R2: Argument 3
     RegARM.PC = FlashAlg.ProgramPage; // PC: Entry Point
 
-    return (ExecuteFunction(FlashDev.toProg));
+    if (ExecuteStart())
+        return (1);
+
+    // Result is checked before the next function call
+    PrgPending = TRUE;
+    PrgBufNext = (prg == FlashAlg.PrgBuf) ? FlashAlg.PrgBuf2 : FlashAlg.PrgBuf;
+    return (0);
 }
 
 
@@ -390,6 +645,9 @@ unsigned long Verify(unsigned long adr, unsigned long sz, unsigned char *buf)
     int           status;
     DWORD         rwpage;
 
+    if (ProgramPageWait()) // Program Buffer may still be in use
+        return (1);
+
     ba     = FlashAlg.PrgBuf;
     cnt    = (PageSize + 3) & ~0x00000003;
     rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
@@ -423,7 +681,7 @@ unsigned long Verify(unsigned long adr, unsigned long sz, unsigned char *buf)
     RegARM.A3 = FlashAlg.PrgBuf; // R2: Argument 3
     RegARM.PC = FlashAlg.Verify; // PC: Entry Point
 
-    return (ExecuteFunction(FlashDev.toProg));
+    return (ExecuteValueFunction(FlashDev.toProg));
 }
 
 
@@ -478,6 +736,69 @@ static const BYTE BlankCheck_ARM[] = {
 
 
 
+/*
+ * ARM Erase Sectors Function (Standalone Function)
+ */
+
+// C Code
+/*
+int EraseSectors (unsigned long adr, unsigned long sz, unsigned long cnt, unsigned char pat) {
+
+  do {
+    if (BlankCheck(adr, sz, pat) != 0) {
+      if (EraseSector(adr) != 0) return (1);
+    }
+    adr += sz;
+  } while (--cnt);
+
+  return (0);
+}
+*/
+
+// Thumb Assembly Code, BlankCheck and EraseSector Entry Points are stored at 0x2C and 0x30
+/*
+000000  B5F0              PUSH     {r4-r7,lr}
+000002  0004              MOVS     r4,r0
+000004  000D              MOVS     r5,r1
+000006  0016              MOVS     r6,r2
+000008  001F              MOVS     r7,r3
+00000A  0020      loop:   MOVS     r0,r4
+00000C  0029              MOVS     r1,r5
+00000E  003A              MOVS     r2,r7
+000010  4B06              LDR      r3,[pc,#24]   ; BlankCheck
+000012  4798              BLX      r3
+000014  2800              CMP      r0,#0
+000016  D004              BEQ      next
+000018  0020              MOVS     r0,r4
+00001A  4B05              LDR      r3,[pc,#20]   ; EraseSector
+00001C  4798              BLX      r3
+00001E  2800              CMP      r0,#0
+000020  D102              BNE      done
+000022  1964      next:   ADDS     r4,r4,r5
+000024  1E76              SUBS     r6,r6,#1
+000026  D1F0              BNE      loop
+000028  BDF0      done:   POP      {r4-r7,pc}
+00002A  46C0              NOP
+00002C  00000000          DCD      BlankCheck
+000030  00000000          DCD      EraseSector
+*/
+
+// ARM - Thumb Erase Sectors Function, word aligned
+static const BYTE EraseSectors_ARM[] = {
+    0xF0, 0xB5, 0x04, 0x00, 0x0D, 0x00, 0x16, 0x00,
+    0x1F, 0x00, 0x20, 0x00, 0x29, 0x00, 0x3A, 0x00,
+    0x06, 0x4B, 0x98, 0x47, 0x00, 0x28, 0x04, 0xD0,
+    0x20, 0x00, 0x05, 0x4B, 0x98, 0x47, 0x00, 0x28,
+    0x02, 0xD1, 0x64, 0x19, 0x76, 0x1E, 0xF0, 0xD1,
+    0xF0, 0xBD, 0xC0, 0x46, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00
+};
+
+#define ERASESECTORS_BLANK 0x2C // Offset of the BlankCheck Entry Point
+#define ERASESECTORS_ERASE 0x30 // Offset of the EraseSector Entry Point
+
+
+
 /*
  * ARM CRC Algorithm (Standalone Algorithm)
  */
@@ -528,7 +849,7 @@ unsigned int CalculateCRC (unsigned long crc,
 */
 
 // ARM - Thumb CRC Algorithm
-static const BYTE CRC32_ARM[] = {
+const BYTE CRC32_ARM[] = {
     0x0A, 0xE0, 0x0D, 0x78, 0x2D, 0x06, 0x68, 0x40,
     0x08, 0x24, 0x40, 0x00, 0x00, 0xD3, 0x58, 0x40,
     0x64, 0x1E, 0xFA, 0xD1, 0x49, 0x1C, 0x52, 0x1E,
@@ -536,8 +857,32 @@ static const BYTE CRC32_ARM[] = {
 };
 
 
-#define CRC_Polynom 0x04C11DB7
-#define CRC_InitVal 0xFFFFFFFF
+static DWORD CRC32_Tab[8][256]; // CRC of a byte followed by 0..7 zero bytes
+
+
+/*
+ * Setup the CRC Tables
+ */
+
+static void CRC32_InitTab(void)
+{
+    DWORD crc;
+    DWORD i, k;
+
+    for (i = 0; i < 256; i++) {
+        crc = i << 24;
+        for (k = 8; k != 0; k--) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ CRC_Polynom : (crc << 1);
+        }
+        CRC32_Tab[0][i] = crc;
+    }
+    for (k = 1; k < 8; k++) {
+        for (i = 0; i < 256; i++) {
+            crc             = CRC32_Tab[k - 1][i];
+            CRC32_Tab[k][i] = (crc << 8) ^ CRC32_Tab[0][crc >> 24];
+        }
+    }
+}
 
 
 /*
@@ -547,349 +892,341 @@ static const BYTE CRC32_ARM[] = {
  *    Return Value:   CRC Code (32-bit)
  */
 
-static DWORD CRC32(BYTE *dat, DWORD sz)
+DWORD CRC32(BYTE *dat, DWORD sz)
 {
     DWORD crc;
-    DWORD i;
 
     crc = CRC_InitVal;
+    while (sz >= 8) { // Slice-by-8
+        crc ^= ((DWORD)dat[0] << 24) | ((DWORD)dat[1] << 16) | ((DWORD)dat[2] << 8) | dat[3];
+        crc = CRC32_Tab[7][crc >> 24] ^ CRC32_Tab[6][(crc >> 16) & 0xFF] ^
+              CRC32_Tab[5][(crc >> 8) & 0xFF] ^ CRC32_Tab[4][crc & 0xFF] ^
+              CRC32_Tab[3][dat[4]] ^ CRC32_Tab[2][dat[5]] ^
+              CRC32_Tab[1][dat[6]] ^ CRC32_Tab[0][dat[7]];
+        dat += 8;
+        sz -= 8;
+    }
     while (sz) {
-        crc ^= *dat++ << 24;
-        for (i = 8; i != 0; i--) {
-            if (crc & 0x80000000) {
-                crc <<= 1;
-                crc ^= CRC_Polynom;
-            } else {
-                crc <<= 1;
-            }
-        }
+        crc = (crc << 8) ^ CRC32_Tab[0][(crc >> 24) ^ *dat++];
         sz--;
     }
     return (crc);
 }
 
 
-
 /*
- *  Load Flash Device Description
+ *  Check if the cached Flash Algorithm is still resident in the Target RAM
+ *    Parameter:      pC:  Cache Entry of the Algorithm
+ *                    sz:  Size of the Algorithm in Buffer
+ *    Return Value:   TRUE - resident,  FALSE - download needed
  */
 
-BOOL LoadFlashDevice(char *fname)
+static BOOL FlashAlgResident(struct FLASHCACHE *pC, DWORD sz)
 {
-    DWORD     adr, sz;
-    DWORD     n, m;
-    BOOL      ok;
-    char      szP[MAX_PATH + 32];
-    TpPATHEXP FpP;
-
-    //---17.11.2012: expand path first, e.g. '$RTE_ROOT$.\Device\Flash\LPC_IAP_512.FLM'
-    strcpy(szP, fname);
-    FpP = (TpPATHEXP)pio->SXX_PATHEXPAND;
-    if (FpP != NULL) {                 // path-expansion interface is present
-        FpP(FPEXP_NORMAL, fname, szP); // nCode, pIn, pOut
-    }
-    //txtout ("---LoadFlashDevice (%s)\n", szP);
-    Elf.fh = fopen(szP, "rb"); // (fname, "rb");
-                               //-------------
-                               //txtout ("--- %s.\n", Elf.fh == NULL ? "failed" : "passed");
+    DWORD adr, ofs, crc;
+    BYTE  buf[256];
+    int   status;
 
-    if (Elf.fh == NULL)
+    if (pC == NULL || !(pC->Flags & FC_ALGORITHM) || pC->szImage != sz)
+        return (FALSE);
+    if (pC->szCRC == 0 || pC->szCRC > sizeof(buf))
         return (FALSE);
 
-    ElfInit();
-
-    ok = ReadElf();
-
-    if (ok) {
-        // Search for FlashDevice structure
-        ok = FALSE;
-        for (n = 0; n < Elf.sym_cnt; n++) {
-            if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "FlashDevice") == 0) {
-                adr = Elf.sym[n].st_value;
-                sz  = Elf.sym[n].st_size;
-                ok  = TRUE;
-                break;
-            }
-        }
-    }
-
-    if (ok) {
-        // Load the FlashDevice structure
-        ok = FALSE;
-        for (n = 0; n < Elf.ehdr.e_phnum; n++) {
-            if ((Elf.phdr[n].p_type == PT_LOAD) && (Elf.phdr[n].p_vaddr == adr) && (Elf.phdr[n].p_filesz == sz)) {
-                if (fseek(Elf.fh, Elf.phdr[n].p_offset, SEEK_SET))
-                    break;
-                if (fread(&FlashDev, 1, sizeof(struct FlashDevice), Elf.fh) == sz) {
-                    if (Elf.ehdr.e_ident[EI_DATA] == ELFDATA2MSB) { // Big-Endian
-                        FlashDev.Vers    = Swap16(FlashDev.Vers);
-                        FlashDev.DevType = Swap16(FlashDev.DevType);
-                        FlashDev.DevAdr  = Swap32(FlashDev.DevAdr);
-                        FlashDev.szDev   = Swap32(FlashDev.szDev);
-                        FlashDev.szPage  = Swap32(FlashDev.szPage);
-                        FlashDev.Res     = Swap32(FlashDev.Res);
-                        FlashDev.toProg  = Swap32(FlashDev.toProg);
-                        FlashDev.toErase = Swap32(FlashDev.toErase);
-                        for (m = 0; m < SECTOR_NUM; m++) {
-                            FlashDev.sectors[m].szSector   = Swap32(FlashDev.sectors[m].szSector);
-                            FlashDev.sectors[m].AddrSector = Swap32(FlashDev.sectors[m].AddrSector);
-                        }
-                    }
-                    if (FlashDev.toProg == 0)
-                        FlashDev.toProg = 1;
-                    if (FlashDev.toErase == 0)
-                        FlashDev.toErase = 1;
-                    ok = TRUE;
-                    break;
-                }
-            }
-        }
-    }
+    // CalculateCRC and BreakPoint are executed, read them back first
+    ofs = (FlashAlg.CalculateCRC & ~1) - FlashConf.RAMStart;
+    if (ofs >= sz || pC->szCRC > sz - ofs)
+        return (FALSE);
+    adr = FlashConf.RAMStart + ofs;
+#if DBGCM_V8M
+    status = ReadARMMem(&adr, buf, pC->szCRC, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+    status = ReadARMMem(&adr, buf, pC->szCRC);
+#endif // DBGCM_V8M
+    if (status || memcmp(buf, Buffer + ofs, pC->szCRC))
+        return (FALSE);
 
-    ElfUnInit();
+    ofs = (FlashAlg.BreakPoint & ~1) - FlashConf.RAMStart;
+    if (ofs >= sz || sizeof(BreakPoint_ARM) > sz - ofs)
+        return (FALSE);
+    adr = FlashConf.RAMStart + ofs;
+#if DBGCM_V8M
+    status = ReadARMMem(&adr, buf, sizeof(BreakPoint_ARM), BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+    status = ReadARMMem(&adr, buf, sizeof(BreakPoint_ARM));
+#endif // DBGCM_V8M
+    if (status || memcmp(buf, Buffer + ofs, sizeof(BreakPoint_ARM)))
+        return (FALSE);
 
-    fclose(Elf.fh);
+    // CRC of the whole Algorithm Image, code and initialized data
+    crc = CalculateCRC(CRC_InitVal, FlashConf.RAMStart, sz, CRC_Polynom);
 
-    return (ok);
+    return (!ExeError && crc == pC->CRC);
 }
 
 
 /*
- *  Load Flash Device Algorithm
+ *  Download Flash Algorithm in Buffer to RAM
+ *    Parameter:      pC:  Cache Entry of the Algorithm, NULL - not cached
+ *                    sz:  Size of the Algorithm in Buffer
+ *    Return Value:   0 - OK,  1 - Failed
  */
 
-BOOL LoadFlashAlgorithm(char *fname)
+static int DownloadFlashAlgorithm(struct FLASHCACHE *pC, DWORD sz)
 {
-    DWORD     adr, ofs;
-    DWORD     sz, szb, szm;
-    DWORD     n, m, i;
-    BYTE      buf[0x10000];
-    int       status;
-    BOOL      ok;
-    char      szP[MAX_PATH + 32];
-    TpPATHEXP FpP;
+    DWORD adr;
+    BYTE  buf[0x10000];
+    int   status;
 
-    //---21.2.2013: expand path first, e.g. '$RTE_ROOT$.\Device\Flash\LPC_IAP_512.FLM'
+    // The probe loads the Algorithm, the DAP download is the fallback
+    if (FlashOS) {
+        if (FlashOSLoad(sz) == 0)
+            return (0);
+        FlashOSExit();
+    }
+
+    // Skip the download if a previous session left the same Algorithm in RAM
+    if (FlashAlgResident(pC, sz))
+        return (0);
+
+    // Write the Flash Algorithm to RAM
+    adr = FlashConf.RAMStart;
+#if DBGCM_V8M
+    status = WriteARMMem(&adr, Buffer, sz, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+    status = WriteARMMem(&adr, Buffer, sz);
+#endif // DBGCM_V8M
+    if (status) {
+        OutError(status);
+        return (1);
+    }
+
+    // Check Downloaded Algorithm
+    adr = FlashConf.RAMStart;
+#if DBGCM_V8M
+    status = ReadARMMem(&adr, buf, sz, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+    status = ReadARMMem(&adr, buf, sz);
+#endif // DBGCM_V8M
+    if (status) {
+        OutError(status);
+        return (1);
+    }
+    if (memcmp(Buffer, buf, sz)) {
+        txtout("Cannot Write to RAM for Flash Algorithms !");
+        return (1);
+    }
+
+    return (0);
+}
+
+
+
+/*
+ *  Load Flash Device Description
+ */
+
+BOOL LoadFlashDevice(char *fname)
+{
+    DWORD              n;
+    char               szP[MAX_PATH + 32];
+    TpPATHEXP          FpP;
+    struct FLASHCACHE *pC;
+    flm::File          flmFile;
+    flm::Device        dev;
+    std::string        error;
+
+    //---17.11.2012: expand path first, e.g. '$RTE_ROOT$.\Device\Flash\LPC_IAP_512.FLM'
     strcpy(szP, fname);
     FpP = (TpPATHEXP)pio->SXX_PATHEXPAND;
     if (FpP != NULL) {                 // path-expansion interface is present
         FpP(FPEXP_NORMAL, fname, szP); // nCode, pIn, pOut
     }
-    //txtout ("---LoadFlashDevice (%s)\n", szP);
-    Elf.fh = fopen(szP, "rb"); // (fname, "rb");
-                               //-------------
-                               //txtout ("--- %s.\n", Elf.fh == NULL ? "failed" : "passed");
 
-    if (Elf.fh == NULL)
+    // Parsed before with the same file content
+    pC = FlashCache_Find(szP, FlashConf.RAMStart, FlashConf.RAMSize);
+    if (pC != NULL && (pC->Flags & FC_DEVICE)) {
+        FlashDev = pC->Dev;
+        return (TRUE);
+    }
+
+    //txtout ("---LoadFlashDevice (%s)\n", szP);
+    if (!flmFile.load(szP, error) || !flmFile.get_device(dev, error))
         return (FALSE);
-    ElfInit();
 
-    ok = ReadElf();
+    // FlashDevice structure in host byte order, sector items up to SECTOR_END
+    memset(&FlashDev, 0, sizeof(struct FlashDevice));
+    FlashDev.Vers = dev.vers;
+    dev.name.copy(FlashDev.DevName, sizeof(FlashDev.DevName));
+    FlashDev.DevType  = dev.type;
+    FlashDev.DevAdr   = dev.adr;
+    FlashDev.szDev    = dev.size;
+    FlashDev.szPage   = dev.page_size;
+    FlashDev.Res      = dev.res;
+    FlashDev.valEmpty = dev.value_empty;
+    FlashDev.toProg   = dev.to_prog;
+    FlashDev.toErase  = dev.to_erase;
+    memset(FlashDev.sectors, 0xFF, sizeof(FlashDev.sectors));
+    for (n = 0; n < dev.sectors.size(); n++) {
+        FlashDev.sectors[n].szSector   = dev.sectors[n].size;
+        FlashDev.sectors[n].AddrSector = dev.sectors[n].offset;
+    }
 
-    memset(&FlashAlg, 0xFF, sizeof(struct FlashAlgorithm));
-    FlashAlg.StackSize = 64; // Default Stack size
-
-    if (ok) {
-        // Search for Programming Algorithms
-        for (n = 0; n < Elf.sym_cnt; n++) {
-            if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "STACK_SIZE") == 0)
-                FlashAlg.StackSize = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "BreakPoint") == 0)
-                FlashAlg.BreakPoint = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "Init") == 0)
-                FlashAlg.Init = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "UnInit") == 0)
-                FlashAlg.UnInit = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "CalculateCRC") == 0)
-                FlashAlg.CalculateCRC = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "CheckPattern") == 0)
-                FlashAlg.BlankCheck = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "BlankCheck") == 0)
-                FlashAlg.BlankCheck = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "EraseChip") == 0)
-                FlashAlg.EraseChip = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "EraseSector") == 0)
-                FlashAlg.EraseSector = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "ProgramPage") == 0)
-                FlashAlg.ProgramPage = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "Verify") == 0)
-                FlashAlg.Verify = Elf.sym[n].st_value;
-            else if (strcmp(&Elf.strtab[Elf.sym[n].st_name], "FlashDevice") == 0)
-                adr = Elf.sym[n].st_value;
-        }
+    if (pC != NULL) {
+        FlashCache_Device(pC, &FlashDev);
+    }
 
-        // Search for .data or .bss section for Static Base offset
-        ok = FALSE;
-        for (n = 0; n < Elf.ehdr.e_shnum; n++) {
-            if (Elf.shdr[n].sh_flags == (SHF_WRITE | SHF_ALLOC)) {
-                if ((Elf.shdr[n].sh_type == SHT_PROGBITS) || (Elf.shdr[n].sh_type == SHT_NOBITS)) {
-                    FlashAlg.rSB = Elf.shdr[n].sh_addr;
-                    ok           = TRUE;
-                    break;
-                }
-            }
-        }
+    return (TRUE);
+}
 
-        if (ok) {
-            // Check if minimum of necessary Algorithms are found
-            if ((FlashAlg.Init == 0xFFFFFFFF) || (FlashAlg.UnInit == 0xFFFFFFFF) ||
-                //        (FlashAlg.EraseChip    == 0xFFFFFFFF) ||
-                (FlashAlg.EraseSector == 0xFFFFFFFF) || (FlashAlg.ProgramPage == 0xFFFFFFFF)) {
-                ok = FALSE;
-                txtout("Missing Flash Algorithms !");
-            }
-        }
 
-        if (ok) {
-            // Check if Functions are coded in Thumb
-            if (!(FlashAlg.BreakPoint & 1) || !(FlashAlg.Init & 1) || !(FlashAlg.UnInit & 1) || !(FlashAlg.CalculateCRC & 1) || !(FlashAlg.BlankCheck & 1) || !(FlashAlg.EraseChip & 1) || !(FlashAlg.EraseSector & 1) || !(FlashAlg.ProgramPage & 1) || !(FlashAlg.Verify & 1)) {
-                ok = FALSE;
-                txtout("Flash Algorithms not in Thumb Code !");
-            }
-        }
+/*
+ *  Load Flash Device Algorithm
+ */
 
-        if (ok) {
-            // Check Internal Algorithms and Calculate External Algorithms Offset
-            ofs = 0;
-            if (FlashAlg.BreakPoint == 0xFFFFFFFF)
-                ofs += sizeof(BreakPoint_ARM);
-            if (FlashAlg.CalculateCRC == 0xFFFFFFFF)
-                ofs += sizeof(CRC32_ARM);
-            if (FlashAlg.BlankCheck == 0xFFFFFFFF)
-                ofs += sizeof(BlankCheck_ARM);
-            ofs = (ofs + 3) & ~0x00000003;
-
-            // Relocate Programming Algorithms
-            n = 0;
-            if (FlashAlg.BreakPoint == 0xFFFFFFFF) {
-                FlashAlg.BreakPoint = FlashConf.RAMStart + n;
-                FlashAlg.BreakPoint |= 1;
-                memcpy(Buffer + n, BreakPoint_ARM, sizeof(BreakPoint_ARM));
-                n += sizeof(BreakPoint_ARM);
-            } else {
-                FlashAlg.BreakPoint += FlashConf.RAMStart + ofs;
-            }
-            if (FlashAlg.CalculateCRC == 0xFFFFFFFF) {
-                FlashAlg.CalculateCRC = FlashConf.RAMStart + n;
-                FlashAlg.CalculateCRC |= 1;
-                memcpy(Buffer + n, CRC32_ARM, sizeof(CRC32_ARM));
-                n += sizeof(CRC32_ARM);
-            } else {
-                FlashAlg.CalculateCRC += FlashConf.RAMStart + ofs;
-            }
-            if (FlashAlg.BlankCheck == 0xFFFFFFFF) {
-                FlashAlg.BlankCheck = FlashConf.RAMStart + n;
-                FlashAlg.BlankCheck |= 1;
-                memcpy(Buffer + n, BlankCheck_ARM, sizeof(BlankCheck_ARM));
-                n += sizeof(BlankCheck_ARM);
-            } else {
-                FlashAlg.BlankCheck += FlashConf.RAMStart + ofs;
-            }
-            FlashAlg.Init += FlashConf.RAMStart + ofs;
-            FlashAlg.UnInit += FlashConf.RAMStart + ofs;
-            if (FlashAlg.EraseChip != 0xFFFFFFFF) {
-                FlashAlg.EraseChip += FlashConf.RAMStart + ofs;
-            }
-            FlashAlg.EraseSector += FlashConf.RAMStart + ofs;
-            FlashAlg.ProgramPage += FlashConf.RAMStart + ofs;
-            if (FlashAlg.Verify != 0xFFFFFFFF) {
-                FlashAlg.Verify += FlashConf.RAMStart + ofs;
-            }
-            FlashAlg.rSB += FlashConf.RAMStart + ofs;
-            FlashAlg.rSP    = FlashConf.RAMStart + FlashConf.RAMSize;
-            FlashAlg.PrgBuf = FlashConf.RAMStart;
-
-            FlashAlg.StackSize = (FlashAlg.StackSize + 7) & ~0x00000007;
-            if (FlashAlg.StackSize < 32)
-                FlashAlg.StackSize = 32;
-
-            // Load Programming Algorithms
-            ok = FALSE;
-            for (n = 0; n < Elf.ehdr.e_phnum; n++) {
-                if ((Elf.phdr[n].p_type == PT_LOAD) && (Elf.phdr[n].p_vaddr != adr)) {
-                    sz  = Elf.phdr[n].p_filesz;
-                    szm = Elf.phdr[n].p_memsz + ofs;
-                    szm = (szm + 3) & ~0x00000003;
-                    szb = sz + ofs;
-
-                    if ((szm + FlashDev.szPage + FlashAlg.StackSize) > FlashConf.RAMSize) {
-                        txtout("Insufficient RAM for Flash Algorithms !");
-                        break;
-                    }
+BOOL LoadFlashAlgorithm(char *fname)
+{
+    DWORD              ofs;
+    DWORD              sz, szb, szm;
+    DWORD              n;
+    DWORD              szCRC;
+    char               szP[MAX_PATH + 32];
+    TpPATHEXP          FpP;
+    struct FLASHCACHE *pC;
+    flm::File          flmFile;
+    flm::Algorithm     alg;
+    std::string        error;
 
-                    FlashAlg.PrgBuf += szm; // Append Buffer at end of Algorithm
+    //---21.2.2013: expand path first, e.g. '$RTE_ROOT$.\Device\Flash\LPC_IAP_512.FLM'
+    strcpy(szP, fname);
+    FpP = (TpPATHEXP)pio->SXX_PATHEXPAND;
+    if (FpP != NULL) {                 // path-expansion interface is present
+        FpP(FPEXP_NORMAL, fname, szP); // nCode, pIn, pOut
+    }
 
-                    // Read Flash Algoritm from ELF file
-                    if (fseek(Elf.fh, Elf.phdr[n].p_offset, SEEK_SET))
-                        break;
-                    if (fread(Buffer + ofs, 1, sz, Elf.fh) != sz)
-                        break;
+    // Parsed and relocated before for the same RAM, download it in one block
+    pC     = FlashCache_Find(szP, FlashConf.RAMStart, FlashConf.RAMSize);
+    FlashC = pC;
+    if (pC != NULL && (pC->Flags & FC_ALGORITHM)) {
+        FlashAlg = pC->Alg;
+        memcpy(Buffer, pC->Image, pC->szImage);
+        return (DownloadFlashAlgorithm(pC, pC->szImage) == 0);
+    }
 
-                    status = 0;
+    //txtout ("---LoadFlashDevice (%s)\n", szP);
+    if (!flmFile.load(szP, error))
+        return (FALSE);
+    if (!flmFile.get_algorithm(alg, error)) {
+        txtout("%s !", error.c_str());
+        return (FALSE);
+    }
 
+    // Programming Algorithms, missing ones are 0xFFFFFFFF
+    memset(&FlashAlg, 0xFF, sizeof(struct FlashAlgorithm));
+    FlashAlg.StackSize    = alg.stack_size;
+    FlashAlg.BreakPoint   = alg.break_point;
+    FlashAlg.Init         = alg.init;
+    FlashAlg.UnInit       = alg.uninit;
+    FlashAlg.CalculateCRC = alg.calculate_crc;
+    FlashAlg.BlankCheck   = alg.blank_check;
+    FlashAlg.EraseChip    = alg.erase_chip;
+    FlashAlg.EraseSector  = alg.erase_sector;
+    FlashAlg.ProgramPage  = alg.program_page;
+    FlashAlg.Verify       = alg.verify;
+    FlashAlg.rSB          = alg.static_base;
+    szCRC                 = alg.crc_size;
+
+    // Check Internal Algorithms and Calculate External Algorithms Offset
+    ofs = 0;
+    if (FlashAlg.BreakPoint == 0xFFFFFFFF)
+        ofs += sizeof(BreakPoint_ARM);
+    if (FlashAlg.CalculateCRC == 0xFFFFFFFF)
+        ofs += sizeof(CRC32_ARM);
+    if (FlashAlg.BlankCheck == 0xFFFFFFFF)
+        ofs += sizeof(BlankCheck_ARM);
+    ofs = (ofs + 3) & ~0x00000003;
+    ofs += sizeof(EraseSectors_ARM);
+    memset(Buffer, 0, ofs);
+
+    // Relocate Programming Algorithms
+    n = 0;
+    if (FlashAlg.BreakPoint == 0xFFFFFFFF) {
+        FlashAlg.BreakPoint = FlashConf.RAMStart + n;
+        FlashAlg.BreakPoint |= 1;
+        memcpy(Buffer + n, BreakPoint_ARM, sizeof(BreakPoint_ARM));
+        n += sizeof(BreakPoint_ARM);
+    } else {
+        FlashAlg.BreakPoint += FlashConf.RAMStart + ofs;
+    }
+    if (FlashAlg.CalculateCRC == 0xFFFFFFFF) {
+        FlashAlg.CalculateCRC = FlashConf.RAMStart + n;
+        FlashAlg.CalculateCRC |= 1;
+        memcpy(Buffer + n, CRC32_ARM, sizeof(CRC32_ARM));
+        n += sizeof(CRC32_ARM);
+        szCRC = sizeof(CRC32_ARM);
+    } else {
+        FlashAlg.CalculateCRC += FlashConf.RAMStart + ofs;
+    }
+    if (FlashAlg.BlankCheck == 0xFFFFFFFF) {
+        FlashAlg.BlankCheck = FlashConf.RAMStart + n;
+        FlashAlg.BlankCheck |= 1;
+        memcpy(Buffer + n, BlankCheck_ARM, sizeof(BlankCheck_ARM));
+        n += sizeof(BlankCheck_ARM);
+    } else {
+        FlashAlg.BlankCheck += FlashConf.RAMStart + ofs;
+    }
+    n = (n + 3) & ~0x00000003; // Literal Pool of the Function is word aligned
+    FlashAlg.EraseSectors = FlashConf.RAMStart + n;
+    FlashAlg.EraseSectors |= 1;
+    memcpy(Buffer + n, EraseSectors_ARM, sizeof(EraseSectors_ARM));
+    FlashAlg.Init += FlashConf.RAMStart + ofs;
+    FlashAlg.UnInit += FlashConf.RAMStart + ofs;
+    if (FlashAlg.EraseChip != 0xFFFFFFFF) {
+        FlashAlg.EraseChip += FlashConf.RAMStart + ofs;
+    }
+    FlashAlg.EraseSector += FlashConf.RAMStart + ofs;
+    FlashAlg.ProgramPage += FlashConf.RAMStart + ofs;
+    if (FlashAlg.Verify != 0xFFFFFFFF) {
+        FlashAlg.Verify += FlashConf.RAMStart + ofs;
+    }
 
-#if DBGCM_V8M
-                    // Write the Flash Algorithm to RAM
-                    i      = 0;
-                    m      = szb;
-                    adr    = FlashConf.RAMStart;
-                    status = WriteARMMem(&adr, Buffer, m, BLOCK_SECTYPE_ANY);
-                    if (status) {
-                        OutError(status);
-                        break;
-                    }
+    // Entry Points called by the Erase Sectors Function
+    *((DWORD *)&Buffer[n + ERASESECTORS_BLANK]) = FlashAlg.BlankCheck;
+    *((DWORD *)&Buffer[n + ERASESECTORS_ERASE]) = FlashAlg.EraseSector;
 
-                    // Check Downloaded Algorithm
-                    i      = 0;
-                    m      = szb;
-                    adr    = FlashConf.RAMStart;
-                    status = ReadARMMem(&adr, buf, m, BLOCK_SECTYPE_ANY);
-                    if (status) {
-                        OutError(status);
-                        break;
-                    }
-                    if (memcmp(Buffer, buf, szb)) {
-                        txtout("Cannot Write to RAM for Flash Algorithms !");
-                        break;
-                    }
-#else  // DBGCM_V8M \
-       // Write the Flash Algorithm to RAM
-                    i      = 0;
-                    m      = szb;
-                    adr    = FlashConf.RAMStart;
-                    status = WriteARMMem(&adr, Buffer, m);
-                    if (status) {
-                        OutError(status);
-                        break;
-                    }
+    FlashAlg.rSB += FlashConf.RAMStart + ofs;
+    FlashAlg.rSP     = FlashConf.RAMStart + FlashConf.RAMSize;
+    FlashAlg.PrgBuf  = FlashConf.RAMStart;
+    FlashAlg.PrgBuf2 = 0;
 
-                    // Check Downloaded Algorithm
-                    i      = 0;
-                    m      = szb;
-                    adr    = FlashConf.RAMStart;
-                    status = ReadARMMem(&adr, buf, m);
-                    if (status) {
-                        OutError(status);
-                        break;
-                    }
-                    if (memcmp(Buffer, buf, szb)) {
-                        txtout("Cannot Write to RAM for Flash Algorithms !");
-                        break;
-                    }
-#endif // DBGCM_V8M
+    FlashAlg.StackSize = (FlashAlg.StackSize + 7) & ~0x00000007;
+    if (FlashAlg.StackSize < 32)
+        FlashAlg.StackSize = 32;
 
-                    ok = TRUE;
-                    break;
-                }
-            }
-        }
+    // Load Programming Algorithms
+    sz  = (DWORD)alg.code.size();
+    szm = alg.code_memsz + ofs;
+    szm = (szm + 3) & ~0x00000003;
+    szb = sz + ofs;
+
+    if (((szm + FlashDev.szPage + FlashAlg.StackSize) > FlashConf.RAMSize) || (szb > sizeof(Buffer))) {
+        txtout("Insufficient RAM for Flash Algorithms !");
+        return (FALSE);
     }
 
-    ElfUnInit();
+    FlashAlg.PrgBuf += szm; // Append Buffer at end of Algorithm
+
+    // Second Buffer for double buffered programming if RAM allows
+    if ((szm + 2 * ((FlashDev.szPage + 3) & ~0x00000003) + FlashAlg.StackSize) <= FlashConf.RAMSize) {
+        FlashAlg.PrgBuf2 = FlashAlg.PrgBuf + ((FlashDev.szPage + 3) & ~0x00000003);
+    }
 
-    fclose(Elf.fh);
+    memcpy(Buffer + ofs, alg.code.data(), sz);
+
+    if (pC != NULL) {
+        FlashCache_Algorithm(pC, &FlashAlg, szCRC, CRC32(Buffer, szb), Buffer, szb);
+    }
 
-    return (ok);
+    return (DownloadFlashAlgorithm(pC, szb) == 0);
 }
 
 
@@ -1096,13 +1433,12 @@ static int LoadFlashDevAlg(void)
         FlashDev.szPage = 1;
 
     // Search and Check Flash Sectors
-    SecCount = 0;
+    Sectors.clear();
     TotalSec = 0;
     for (i = 0; i < SECTOR_NUM; i++) {
         adr = FlashDev.sectors[i].AddrSector;
         sz  = FlashDev.sectors[i].szSector;
         if ((adr == 0xFFFFFFFF) && (sz == 0xFFFFFFFF)) {
-            SecCount = i;
             TotalSec += (FlashDev.szDev - oldadr) / oldsz;
             break;
         }
@@ -1111,8 +1447,9 @@ static int LoadFlashDevAlg(void)
         }
         if (SectorCheck(i, adr, sz))
             return (-1);
+        Sectors.push_back({ (uint32_t)sz, (uint32_t)adr });
     }
-    if (SecCount == 0) {
+    if ((i == SECTOR_NUM) || Sectors.empty()) {
         sprintf(buf, "Missing Flash Sectors Description!\n\n%s", szFP);
         AGDIMsgBox(hMfrm, buf, ErrTitle, MB_ICONERROR, IDOK);
         return (-1);
@@ -1120,11 +1457,10 @@ static int LoadFlashDevAlg(void)
 
     memset(&RegARM, 0, sizeof(RegARM)); // Clear Initial ARM Registers
 
-    ESecAddr = 0;
-    ESecSize = 0;
-    PageAddr = 0;
+    PrgPending = FALSE;
+    PrgBufNext = FlashAlg.PrgBuf;
+
     PageSize = FlashDev.szPage;
-    PageItem = 0;
 
     return (0);
 }
@@ -1132,81 +1468,457 @@ static int LoadFlashDevAlg(void)
 
 
 /*
- *  Erase Flash Memory
+ *  Find Flash Sector
  *    Parameter:      nAdr:  Address
- *                    nMany: Size
+ *                    pAdr:  Sector Start Address
+ *                    pSz:   Sector Size
+ */
+
+static void FindSector(DWORD nAdr, DWORD *pAdr, DWORD *pSz)
+{
+    uint32_t adr, sz;
+
+    flm::find_sector(Sectors, FlashConf.Dev[SelAlg].Start, nAdr, &adr, &sz);
+
+    *pAdr = adr;
+    *pSz  = sz;
+}
+
+
+/*
+ *  Check for unchanged Sector (Delta Flashing)
+ *    Parameter:      nAdr:  Address
+ *    Return Value:   Bytes up to the end of the unchanged Sector, 0 - Sector not unchanged
+ */
+
+static DWORD DeltaSkip(DWORD nAdr)
+{
+    for (auto &s : DeltaSec) {
+        if ((nAdr >= s.adr) && (nAdr < (s.adr + s.sz)))
+            return ((s.adr + s.sz) - nAdr);
+    }
+    return (0);
+}
+
+
+/*
+ *  Compare Flash Sector with the expected Sector Contents in DeltaBuf
+ *    Parameter:      adr:  Sector Start Address
+ *                    sz:   Sector Size
  *    Return Value:   0 - OK,  1 - Failed
  */
 
-static int EraseFlash(DWORD nAdr, DWORD nMany)
+static int DeltaSector(DWORD adr, DWORD sz)
 {
-    DWORD adr, sz, n;
-    int   i;
+    std::future<DWORD> crc;
+    DWORD              crcarm;
+    DWORD              crcpc;
 
-    while (nMany) {
-        // Check for Last Erased Sector
-        if ((nAdr >= ESecAddr) && (nAdr < (ESecAddr + ESecSize))) {
-            n = (ESecAddr + ESecSize) - nAdr;
-            if (nMany > n) {
-                nAdr += n;
-                nMany -= n;
-                Counter += n;
-                UpdatePos(100 * Counter / TotalCount);
+    // Program Pages must not cross into a skipped Sector
+    if (((adr - FlashConf.Dev[SelAlg].Start) % PageSize) || (sz % PageSize))
+        return (0);
+
+    SetHex8(adr);
+    crc    = std::async(std::launch::async, CRC32, DeltaBuf.data(), sz);
+    crcarm = CalculateCRC(CRC_InitVal, adr, sz, CRC_Polynom);
+    crcpc  = crc.get();
+    if (ExeError)
+        return (1);
+
+    if (crcarm == crcpc) {
+        DeltaSec.push_back({ adr, sz });
+    }
+    return (0);
+}
+
+
+/*
+ *  Compare Flash Sectors with the Image (Delta Flashing)
+ *    The expected contents of each Sector is the Image padded with the empty value,
+ *    Sectors with a matching CRC are skipped by Erase and Program.
+ *    Return Value:   0 - OK,  1 - Failed (all Sectors are erased and programmed)
+ */
+
+static int DeltaAll(void)
+{
+    FLASHPARM *pF;
+    DWORD      n, m;
+    DWORD      sadr  = 0; // Current Sector Address
+    DWORD      ssz   = 0; // Current Sector Size
+    DWORD      send  = 0; // End of the last Sector
+    int        count = 0; // Compared Sectors
+    int        alg;
+    int        error = 0;
+
+    DeltaSec.clear();
+
+    InitProgress("Compare: ");
+    UpdatePos(0);
+
+    SelAlg  = -1;
+    TimeOut = 0;
+    Counter = 0;
+    pF      = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, NULL); // get parameters, NOTE: first call with NULL !
+    if (pF->ActSize == 0)
+        pF->many = 0;
+    TotalCount = pF->ActSize;
+    while (pF->many) {
+        // Skip non-Flash Algorithm Areas, reported by Erase
+        Silent = 1;
+        alg    = FindFlashAlgorithm(pF->start, pF->many);
+        Silent = 0;
+        if (alg == -3) {
+            error = 1;
+            break;
+        }
+        if (alg < 0) {
+            n = NextAddr - pF->start;
+            if ((alg == -2) && (pF->many > n)) {
+                pF->start += n;
+                pF->many -= n;
             } else {
-                Counter += nMany;
-                UpdatePos(100 * Counter / TotalCount);
-                return (0); // Previously Erased
+                pF = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, pF);
             }
+            continue;
         }
-
-        // Search for Sector to be erased
-        for (i = 0; i < SecCount; i++) {
-            adr = FlashDev.sectors[i].AddrSector + FlashConf.Dev[SelAlg].Start;
-            sz  = FlashDev.sectors[i].szSector;
-            if (nAdr < adr) {
-                if (i != 0) {
-                    n   = oldadr + oldsz;
-                    sz  = oldsz;
-                    adr = n + sz * ((nAdr - n) / sz);
+        if (alg != SelAlg) {
+            if (ssz) {
+                if (DeltaSector(sadr, ssz)) {
+                    error = 1;
                     break;
                 }
-            } else if (nAdr >= (adr + sz)) {
-                if ((i + 1) == SecCount) {
-                    n   = adr + sz;
-                    adr = n + sz * ((nAdr - n) / sz);
+                count++;
+                ssz = 0;
+            }
+            if (SelAlg != -1) {
+                if (UnInit(3)) {
+                    SelAlg = -1;
+                    error  = 1;
                     break;
                 }
-            } else
+            }
+            SelAlg = alg;
+            if (LoadFlashDevAlg()) {
+                SelAlg = -1;
+                error  = 1;
                 break;
-            oldadr = adr;
-            oldsz  = sz;
+            }
+            if (Init(FlashConf.Dev[SelAlg].Start, pdbg->Clock, 3)) {
+                error = 1;
+                break;
+            }
         }
+        n = (FlashConf.Dev[SelAlg].Start + FlashConf.Dev[SelAlg].Size) - pF->start;
+        if (n > pF->many)
+            n = pF->many;
+        while (n) {
+            if ((ssz == 0) || (pF->start >= (sadr + ssz))) {
+                if (ssz) {
+                    if (DeltaSector(sadr, ssz)) {
+                        error = 1;
+                        break;
+                    }
+                    count++;
+                }
+                FindSector(pF->start, &sadr, &ssz);
+                if (sadr < send) { // Image not in ascending order
+                    error = 1;
+                    break;
+                }
+                send = sadr + ssz;
+                DeltaBuf.assign(ssz, (BYTE)FlashDev.valEmpty);
+            }
+            if (pF->start < sadr) {
+                error = 1;
+                break;
+            }
+            m = (sadr + ssz) - pF->start;
+            if (m > n)
+                m = n;
+            memcpy(&DeltaBuf[pF->start - sadr], pF->image, m);
+            pF->start += m;
+            pF->many -= m;
+            pF->image += m;
+            n -= m;
+            Counter += m;
+            UpdatePos(100 * Counter / TotalCount);
+        }
+        if (error)
+            break;
+        if (pF->many)
+            continue;
+        pF = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, pF); // Note: use pF from first call, get next parameters
+    }
+    if (!error && ssz) {
+        if (DeltaSector(sadr, ssz)) {
+            error = 1;
+        } else {
+            count++;
+        }
+    }
+    if (SelAlg != -1) {
+        if (UnInit(3))
+            error = 1;
+    }
+
+    StopProgress();
+
+    if (error) {
+        DeltaSec.clear();
+        txtout("Sector Compare Failed, all Sectors are programmed.");
+        return (1);
+    }
+    txtout("Sector Compare Done: %d of %d Sectors unchanged.", (int)DeltaSec.size(), count);
+    return (0);
+}
+
+
+/*
+ *  Estimated Time of a Sector Erase (Erase Plan)
+ *    Parameter:      sz:  Sector Size
+ *    Return Value:   Time in us, measured by previous runs or the Timeout of the Flash Device
+ */
+
+static ULONGLONG EraseTimeSector(DWORD sz)
+{
+    if (FlashC != NULL && FlashC->tSector != 0)
+        return (((ULONGLONG)FlashC->tSector * sz) / 1024);
+    return ((ULONGLONG)FlashDev.toErase * 1000);
+}
+
+
+/*
+ *  Estimated Time of a Chip Erase (Erase Plan)
+ *    Return Value:   Time in us, measured by previous runs or the Timeout of the Flash Device
+ */
 
-        // Erase Sector (if not already erased)
-        SetHex8(adr);
-        if (BlankCheck(adr, sz, FlashDev.valEmpty)) {
-            if (EraseSector(adr))
+static ULONGLONG EraseTimeChip(void)
+{
+    if (FlashC != NULL && FlashC->tChip != 0)
+        return (FlashC->tChip);
+    return ((ULONGLONG)TotalSec * FlashDev.toErase * 1000);
+}
+
+
+/*
+ *  Estimated Time of a Blank Check (Erase Plan)
+ *    Parameter:      sz:  Block Size
+ *    Return Value:   Time in us, 0 - not measured yet
+ */
+
+static ULONGLONG EraseTimeBlank(DWORD sz)
+{
+    if (FlashC != NULL)
+        return (((ULONGLONG)FlashC->tBlank * sz) / 1024);
+    return (0);
+}
+
+
+/*
+ *  Update a measured Rate (Erase Plan)
+ *    Parameter:      pRate:  Rate in us per KB
+ *                    ms:     Measured Time
+ *                    sz:     Bytes handled in this Time
+ */
+
+static void EraseMeasure(DWORD *pRate, DWORD ms, DWORD sz)
+{
+    DWORD r;
+
+    if (sz == 0)
+        return;
+    r = (DWORD)(((ULONGLONG)ms * 1000 * 1024) / sz);
+    if (r == 0)
+        r = 1; // Below the tick resolution, 0 is unknown
+    *pRate = (*pRate == 0) ? r : (3 * *pRate + r) / 4;
+}
+
+
+/*
+ *  Add the Sectors of an Address Range to the Erase Plan
+ *    Parameter:      nAdr:  Address
+ *                    nMany: Size
+ */
+
+static void EraseAddSectors(DWORD nAdr, DWORD nMany)
+{
+    DWORD adr, sz, n;
+
+    while (nMany) {
+        FindSector(nAdr, &adr, &sz);
+        n = (adr + sz) - nAdr;
+        if (n > nMany)
+            n = nMany;
+        if (!EraseSec.empty() && (EraseSec.back().adr == adr)) {
+            EraseSec.back().cnt += n;
+        } else {
+            EraseSec.push_back({ adr, sz, n });
+        }
+        nAdr += n;
+        nMany -= n;
+    }
+}
+
+
+/*
+ *  Check the Flash outside the Sectors of the Erase Plan for the empty value
+ *    Return Value:   0 - blank,  1 - not blank,  2 - Failed
+ */
+
+static int EraseGapsBlank(void)
+{
+    DWORD adr, end, n;
+    DWORD t;
+    int   status;
+
+    adr = FlashConf.Dev[SelAlg].Start;
+    for (size_t i = 0; i <= EraseSec.size(); i++) {
+        end = (i < EraseSec.size()) ? EraseSec[i].adr : FlashConf.Dev[SelAlg].Start + FlashConf.Dev[SelAlg].Size;
+        while (adr < end) {
+            n = end - adr;
+            if (n > ERASE_BLANK_MAX)
+                n = ERASE_BLANK_MAX; // Keep each call well inside the Timeout
+            t      = GetTickCount();
+            status = BlankCheck(adr, n, FlashDev.valEmpty);
+            if (ExeError)
+                return (2);
+            if (status)
                 return (1);
+            if (FlashC != NULL)
+                EraseMeasure(&FlashC->tBlank, GetTickCount() - t, n);
+            adr += n;
+        }
+        if (i < EraseSec.size())
+            adr = EraseSec[i].adr + EraseSec[i].sz;
+    }
+    return (0);
+}
+
+
+/*
+ *  Sectors per Erase Sectors call (Erase Plan)
+ *    Parameter:      sz:  Sector Size
+ *    Return Value:   Number of Sectors, calls take about ERASE_BATCH_MS once measured
+ */
+
+static DWORD EraseBatch(DWORD sz)
+{
+    ULONGLONG t;
+    ULONGLONG n;
+
+    if (FlashC == NULL || FlashC->tSector == 0)
+        return (ERASE_BATCH);
+
+    t = EraseTimeSector(sz);
+    n = (t != 0) ? ((ULONGLONG)ERASE_BATCH_MS * 1000) / t : ERASE_BATCH_MAX;
+    if (n < 1)
+        n = 1;
+    if (n > ERASE_BATCH_MAX)
+        n = ERASE_BATCH_MAX;
+    return ((DWORD)n);
+}
+
+
+/*
+ *  Erase the Sectors of the Erase Plan with the selected Algorithm
+ *    Chip Erase replaces the Sector Erase if it is estimated faster and destroys nothing:
+ *    no Sector is unchanged (Delta Flashing) and the Flash outside the Sectors is blank.
+ *    Consecutive Sectors of the same Size are erased by one Erase Sectors call.
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int EraseDevice(void)
+{
+    ULONGLONG tsec, tchip;
+    DWORD     cnt, k, n;
+    DWORD     t;
+    BOOL      chip;
+
+    // Strategy with the lower estimated Time
+    chip = (FlashAlg.EraseChip != 0xFFFFFFFF);
+    tsec = 0;
+    for (size_t i = 0; chip && (i < EraseSec.size()); i++) {
+        if (DeltaSkip(EraseSec[i].adr))
+            chip = FALSE;
+        tsec += EraseTimeSector(EraseSec[i].sz);
+    }
+    if (chip) {
+        tchip = EraseTimeChip();
+        for (size_t i = 0; i <= EraseSec.size(); i++) {
+            n = (i < EraseSec.size()) ? EraseSec[i].adr : FlashConf.Dev[SelAlg].Start + FlashConf.Dev[SelAlg].Size;
+            n -= (i == 0) ? FlashConf.Dev[SelAlg].Start : EraseSec[i - 1].adr + EraseSec[i - 1].sz;
+            tchip += EraseTimeBlank(n);
+        }
+        chip = (tchip < tsec);
+    }
+    if (chip) {
+        switch (EraseGapsBlank()) {
+            case 0:
+                break;
+            case 1:
+                chip = FALSE; // Data outside the Image, erase the Sectors
+                break;
+            default:
+                return (1);
+        }
+    }
+
+    if (chip) {
+        SetText(FlashConf.Dev[SelAlg].FileName);
+        t = GetTickCount();
+        if (EraseChip())
+            return (1);
+        if (FlashC != NULL)
+            EraseMeasure(&FlashC->tChip, GetTickCount() - t, 1024);
+        for (auto &s : EraseSec) {
+            Counter += s.cnt;
+        }
+        UpdatePos(100 * Counter / TotalCount);
+    } else {
+        for (size_t i = 0; i < EraseSec.size(); i += k) {
+            const ERASESEC &s = EraseSec[i];
+
+            k   = 1;
+            cnt = s.cnt;
+            if (DeltaSkip(s.adr) == 0) { // Skip unchanged Sector (Delta Flashing)
+                n = EraseBatch(s.sz);
+                while ((k < n) && (i + k < EraseSec.size())) {
+                    const ERASESEC &e = EraseSec[i + k];
+                    if ((e.sz != s.sz) || (e.adr != s.adr + k * s.sz) || DeltaSkip(e.adr))
+                        break;
+                    cnt += e.cnt;
+                    k++;
+                }
+
+                SetHex8(s.adr);
+                t = GetTickCount();
+                if (EraseSectors(s.adr, s.sz, k))
+                    return (1);
+                if (FlashC != NULL)
+                    EraseMeasure(&FlashC->tSector, GetTickCount() - t, k * s.sz);
+            }
+            Counter += cnt;
+            UpdatePos(100 * Counter / TotalCount);
         }
-        ESecAddr = adr;
-        ESecSize = sz;
     }
 
+    if (FlashC != NULL)
+        FlashCache_Timing(FlashC);
     return (0);
 }
 
 
 /*
  *  Erase Entire Flash Memory (which is needed)
+ *    The Sectors holding the Image are collected per Algorithm, then erased with
+ *    the Strategy estimated fastest (Erase Plan).
  *    Return Value:   0 - OK,  1 - Failed
  */
 
 static int EraseAll(void)
 {
-    FLASHPARM *pF;
-    DWORD      n;
-    int        alg;
-    int        flg = 0;
+    int alg;
+    int flg;
 
     InitProgress("Erase: ");
     UpdatePos(0);
@@ -1214,59 +1926,56 @@ static int EraseAll(void)
     SelAlg  = -1;
     TimeOut = 0;
     Counter = 0;
-    pF      = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, NULL); // get parameters, NOTE: first call with NULL !
-    if (pF->ActSize == 0)
-        pF->many = 0;
-    TotalCount = pF->ActSize;
-    while (pF->many) {
-        alg = FindFlashAlgorithm(pF->start, pF->many);
-        if (alg == -3)
-            break;
-        if (alg < 0) {
-            n = NextAddr - pF->start;
-            if ((alg == -2) && (pF->many > n)) {
-                pF->start += n;
-                pF->many -= n;
-            } else {
-                pF = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, pF);
-            }
-            flg |= 1;
-            continue;
+
+    flg = PlanImage();
+    if (!(flg & 4) && !PlanFrag.empty()) {
+        std::stable_sort(PlanFrag.begin(), PlanFrag.end(), [](const flm::Fragment &a, const flm::Fragment &b) {
+            return a.adr < b.adr;
+        });
+
+        TotalCount = 0;
+        for (auto &f : PlanFrag) {
+            TotalCount += f.many;
         }
-        flg |= 2;
-        if (alg != SelAlg) {
+
+        FlashOSEnter();
+        for (alg = 0; alg < FlashConf.Nitems; alg++) {
+            if (std::none_of(PlanFrag.begin(), PlanFrag.end(), [alg](const flm::Fragment &f) { return f.alg == alg; }))
+                continue;
             if (SelAlg != -1) {
                 if (UnInit(1)) {
                     SelAlg = -1;
+                    flg |= 4;
                     break;
                 }
             }
             SelAlg = alg;
             if (LoadFlashDevAlg()) {
                 SelAlg = -1;
+                flg |= 4;
                 break;
             }
-            if (Init(FlashConf.Dev[SelAlg].Start, pdbg->Clock, 1))
-                break;
-        }
-        n = (FlashConf.Dev[SelAlg].Start + FlashConf.Dev[SelAlg].Size) - pF->start;
-        if (pF->many > n) {
-            if (EraseFlash(pF->start, n))
+            if (Init(FlashConf.Dev[SelAlg].Start, pdbg->Clock, 1)) {
+                flg |= 4;
                 break;
-            pF->start += n;
-            pF->many -= n;
-            continue;
-        } else {
-            if (EraseFlash(pF->start, pF->many))
+            }
+
+            EraseSec.clear();
+            for (auto &f : PlanFrag) {
+                if (f.alg == alg)
+                    EraseAddSectors(f.adr, f.many);
+            }
+            if (EraseDevice()) {
+                flg |= 4;
                 break;
+            }
         }
-        pF = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, pF); // Note: use pF from first call, get next parameters
     }
     if (SelAlg != -1) {
         if (UnInit(1))
             flg |= 4;
     }
-    if (pF->many)
+    if (FlashOSExit())
         flg |= 4;
 
     StopProgress();
@@ -1297,7 +2006,8 @@ static int EraseAll(void)
 
 static int EraseFull(void)
 {
-    int alg;
+    DWORD t;
+    int   alg;
 
     SelAlg  = -1;
     TimeOut = 0;
@@ -1324,10 +2034,17 @@ static int EraseFull(void)
             break;
         if (FlashAlg.EraseChip != 0xFFFFFFFF) {
             SetText(FlashConf.Dev[SelAlg].FileName);
+            t = GetTickCount();
             if (EraseChip())
                 break;
+            if (FlashC != NULL) {
+                EraseMeasure(&FlashC->tChip, GetTickCount() - t, 1024);
+                FlashCache_Timing(FlashC);
+            }
         } else {
-            if (EraseFlash(FlashConf.Dev[SelAlg].Start, FlashConf.Dev[SelAlg].Size))
+            EraseSec.clear();
+            EraseAddSectors(FlashConf.Dev[SelAlg].Start, FlashConf.Dev[SelAlg].Size);
+            if (EraseDevice())
                 break;
         }
         StopProgress();
@@ -1350,84 +2067,26 @@ static int EraseFull(void)
 
 
 /*
- *  Write Flash Memory
- *    Parameter:      nAdr:  Address
- *                    nMany: Size
- *                    image: Data
- *    Return Value:   0 - OK,  1 - Failed
- */
-
-static int WriteFlash(DWORD nAdr, DWORD nMany, BYTE *image)
-{
-    DWORD n, m;
-    DWORD i;
-
-    // Check for Pending Program Page
-    if (PageItem && ((nMany == 0) || (nAdr < PageAddr) || (nAdr >= (PageAddr + PageSize)))) {
-        if (ProgramPage(PageAddr, PageItem, Buffer))
-            return (1);
-        PageItem = 0;
-    }
-
-    while (nMany) {
-        SetHex8(nAdr);
-
-        //  PageAddr = nAdr & ~(PageSize - 1);
-        PageAddr = FlashConf.Dev[SelAlg].Start + (((nAdr - FlashConf.Dev[SelAlg].Start) / PageSize) * PageSize);
-        n        = nAdr - PageAddr;
-        m        = ((nMany + n) < PageSize) ? nMany + n : PageSize;
-
-        if (PageItem == 0) {
-            for (i = 0; i < n; i++)
-                Buffer[i] = (BYTE)FlashDev.valEmpty;
-        }
-        for (i = n; i < m; i++)
-            Buffer[i] = *image++;
-
-        if (m < PageSize) {
-            for (i = m; i < PageSize; i++)
-                Buffer[i] = (BYTE)FlashDev.valEmpty;
-            PageItem = m;
-        } else {
-            if (ProgramPage(PageAddr, PageSize, Buffer))
-                return (1);
-            PageItem = 0;
-        }
-
-        n = m - n;
-
-        nAdr += n;
-        nMany -= n;
-        Counter += n;
-        UpdatePos(100 * Counter / TotalCount);
-    }
-
-    return (0);
-}
-
-
-/*
- *  Write Entire Flash Memory (which is needed)
- *    Return Value:   0 - OK,  1 - Failed
+ *  Collect the Image Fragments with a Flash Algorithm (Programming Plan)
+ *    Return Value:   1 - Areas without Algorithm,  2 - Areas with Algorithm,  4 - Failed
  */
 
-static int WriteAll(void)
+static int PlanImage(void)
 {
     FLASHPARM *pF;
     DWORD      n;
+    char       buf[512];
+    char       szFP[MAX_PATH + 32];
     int        alg;
     int        flg = 0;
 
-    InitProgress("Program: ");
-    UpdatePos(0);
+    PlanFrag.clear();
+    PlanAlg.assign(FlashConf.Nitems, { 0, 0, 0 });
 
-    SelAlg  = -1;
-    TimeOut = 0;
-    Counter = 0;
-    pF      = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, NULL); // get parameters, NOTE: first call with NULL !
+    SelAlg = -1;
+    pF     = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, NULL); // get parameters, NOTE: first call with NULL !
     if (pF->ActSize == 0)
         pF->many = 0;
-    TotalCount = pF->ActSize;
     while (pF->many) {
         alg = FindFlashAlgorithm(pF->start, pF->many);
         if (alg == -3)
@@ -1445,45 +2104,136 @@ static int WriteAll(void)
         }
         flg |= 2;
         if (alg != SelAlg) {
-            if (SelAlg != -1) {
-                if (UnInit(2)) {
-                    SelAlg = -1;
+            SelAlg = alg;
+            if (PlanAlg[alg].page_size == 0) { // Page Layout, the Algorithm is loaded later
+                ComposeFlashDevAlgString(szFP);
+                if (LoadFlashDevice(szFP) == FALSE) {
+                    sprintf(buf, "Cannot Load Flash Device Description!\n\n%s", szFP);
+                    AGDIMsgBox(hMfrm, buf, ErrTitle, MB_ICONERROR, IDOK);
                     break;
                 }
+                PlanAlg[alg].start       = FlashConf.Dev[alg].Start;
+                PlanAlg[alg].page_size   = FlashDev.szPage;
+                PlanAlg[alg].value_empty = (BYTE)FlashDev.valEmpty;
+                if (PlanAlg[alg].page_size > PAGE_MAX)
+                    PlanAlg[alg].page_size = PAGE_MAX;
+                if (PlanAlg[alg].page_size == 0)
+                    PlanAlg[alg].page_size = 1;
             }
-            SelAlg = alg;
-            if (LoadFlashDevAlg()) {
-                SelAlg = -1;
-                break;
-            }
-            if (Init(FlashConf.Dev[SelAlg].Start, pdbg->Clock, 2))
-                break;
         }
         n = (FlashConf.Dev[SelAlg].Start + FlashConf.Dev[SelAlg].Size) - pF->start;
         if (pF->many > n) {
-            if (WriteFlash(pF->start, n, pF->image))
-                break;
+            PlanFrag.push_back({ (uint32_t)pF->start, (uint32_t)n, pF->image, alg });
             pF->start += n;
             pF->many -= n;
             pF->image += n;
             continue;
-        } else {
-            if (WriteFlash(pF->start, pF->many, pF->image))
-                break;
         }
+        PlanFrag.push_back({ (uint32_t)pF->start, (uint32_t)pF->many, pF->image, alg });
         pF = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, pF); // Note: use pF from first call, get next parameters
-        if ((pF->many == 0) || (pF->start >= (FlashConf.Dev[SelAlg].Start + FlashConf.Dev[SelAlg].Size))) {
-            if (WriteFlash(pF->start, 0, NULL)) { // Write any Pending Program Pages
-                flg |= 4;
+    }
+    if (pF->many)
+        flg |= 4;
+
+    SelAlg = -1;
+    return (flg);
+}
+
+
+/*
+ *  Build the Page Buffers of the Programming Plan
+ *    The Image Fragments are sorted and merged into Pages padded with the empty value.
+ *    Runs in a worker thread without target access.
+ *    Parameter:      blank:  Drop Pages which hold only the empty value (Flash erased)
+ *    Return Value:   Number of dropped Pages
+ */
+
+static int PlanPages(BOOL blank)
+{
+    return (flm::plan_pages(PlanFrag, PlanAlg, blank != FALSE, PlanPage, PlanBuf));
+}
+
+
+/*
+ *  Write Entire Flash Memory (which is needed)
+ *    The Page Buffers are built in a worker thread while the first Algorithm is
+ *    loaded, then the Pages are programmed straight from the Programming Plan.
+ *    Return Value:   0 - OK,  1 - Failed
+ */
+
+static int WriteAll(void)
+{
+    std::future<int> plan;
+    int              alg;
+    int              flg;
+
+    InitProgress("Program: ");
+    UpdatePos(0);
+
+    SelAlg  = -1;
+    TimeOut = 0;
+    Counter = 0;
+
+    flg = PlanImage();
+    if (!(flg & 4) && !PlanFrag.empty()) {
+        alg = std::min_element(PlanFrag.begin(), PlanFrag.end(), [](const flm::Fragment &a, const flm::Fragment &b) {
+                  return a.adr < b.adr;
+              })->alg;
+
+        // Pages are blank after Erase, blank Pages need no programming
+        plan = std::async(std::launch::async, PlanPages, (FlashConf.Opt & FLASH_ERASE) ? TRUE : FALSE);
+
+        FlashOSEnter();
+        SelAlg = alg;
+        if (LoadFlashDevAlg()) {
+            SelAlg = -1;
+            flg |= 4;
+        } else if (Init(FlashConf.Dev[SelAlg].Start, pdbg->Clock, 2)) {
+            flg |= 4;
+        }
+        plan.get();
+
+        TotalCount = 0;
+        for (auto &p : PlanPage) {
+            TotalCount += p.cnt;
+        }
+
+        for (auto &p : PlanPage) {
+            if (flg & 4)
                 break;
+            if (p.alg != SelAlg) {
+                if (UnInit(2)) {
+                    SelAlg = -1;
+                    flg |= 4;
+                    break;
+                }
+                SelAlg = p.alg;
+                if (LoadFlashDevAlg()) {
+                    SelAlg = -1;
+                    flg |= 4;
+                    break;
+                }
+                if (Init(FlashConf.Dev[SelAlg].Start, pdbg->Clock, 2)) {
+                    flg |= 4;
+                    break;
+                }
+            }
+            if (DeltaSkip(p.adr) == 0) { // Skip unchanged Sector (Delta Flashing)
+                SetHex8(p.adr);
+                if (ProgramPage(p.adr, p.sz, &PlanBuf[p.ofs])) {
+                    flg |= 4;
+                    break;
+                }
             }
+            Counter += p.cnt;
+            UpdatePos(100 * Counter / TotalCount);
         }
     }
     if (SelAlg != -1) {
         if (UnInit(2))
             flg |= 4;
     }
-    if (pF->many)
+    if (FlashOSExit())
         flg |= 4;
 
     StopProgress();
@@ -1508,6 +2258,99 @@ static int WriteAll(void)
 
 
 
+/*
+ *  Read Flash Memory and compare with the expected data
+ *    Parameter:      adr:   Start Address
+ *                    image: Expected Data
+ *                    sz:    Size
+ *                    error: Error Counter
+ *    Return Value:   0 - OK,  1 - Failed (Read Error or too many errors)
+ */
+
+static int ReadCompare(DWORD adr, BYTE *image, DWORD sz, int *error)
+{
+    DWORD a, n, i;
+    int   status;
+
+    while (sz) {
+        n = (sz > VERIFY_BLOCK) ? VERIFY_BLOCK : sz;
+        a = adr;
+
+#if DBGCM_V8M
+        status = ReadARMMem(&a, Buffer, n, BLOCK_SECTYPE_ANY);
+        if (status) {
+            OutError(status);
+            return (1);
+        }
+#else  // DBGCM_V8M
+        status = ReadARMMem(&a, Buffer, n);
+        if (status) {
+            OutError(status);
+            return (1);
+        }
+#endif // DBGCM_V8M
+
+        // Compare data read from Flash with the expected data
+        for (i = 0; i < n; i++) {
+            if (Buffer[i] != image[i]) {
+                if (*error < 100) {
+                    txtout("Contents mismatch at: %08XH  (Flash=%02XH  Required=%02XH) !",
+                           adr + i, Buffer[i], image[i]);
+                } else if (*error == 100) {
+                    txtout("Too many errors to display !");
+                    return (1);
+                }
+                (*error)++;
+            }
+        }
+
+        adr += n;
+        image += n;
+        sz -= n;
+    }
+
+    return (0);
+}
+
+
+/*
+ *  Verify Flash Memory by CRC. The host CRC is calculated while the target calculates
+ *  its CRC. A range with a mismatch is halved until the parts are small enough to be
+ *  read back, so only failing blocks are read.
+ *    Parameter:      adr:   Start Address
+ *                    image: Expected Data
+ *                    sz:    Size
+ *                    error: Error Counter
+ *    Return Value:   0 - OK,  1 - Failed (Read Error or too many errors)
+ */
+
+static int VerifyCRC(DWORD adr, BYTE *image, DWORD sz, int *error)
+{
+    std::future<DWORD> crc;
+    DWORD              crcarm;
+    DWORD              crcpc;
+    DWORD              n;
+
+    if (sz == 0)
+        return (0);
+
+    crc    = std::async(std::launch::async, CRC32, image, sz);
+    crcarm = CalculateCRC(CRC_InitVal, adr, sz, CRC_Polynom);
+    crcpc  = crc.get();
+    if (!ExeError && (crcarm == crcpc))
+        return (0);
+
+    // Standard Verify (Read & Compare) if the range is small or CRC is not available
+    if (ExeError || sz <= VERIFY_BLOCK)
+        return (ReadCompare(adr, image, sz, error));
+
+    n = ((sz / 2) + VERIFY_BLOCK - 1) & ~(VERIFY_BLOCK - 1);
+    if (VerifyCRC(adr, image, n, error))
+        return (1);
+    return (VerifyCRC(adr + n, image + n, sz - n, error));
+}
+
+
 /*
  *  Verify Flash Memory (which was Erased/Programed)
  *    Return Value:   0 - OK,  1 - Failed
@@ -1516,12 +2359,8 @@ static int WriteAll(void)
 static int VerifyAll(void)
 {
     FLASHPARM *pF;
-    DWORD      ofs, cnt;
     DWORD      adr, n, m;
-    DWORD      crcarm;
-    DWORD      crcpc;
     int        alg;
-    int        status;
     int        flg   = 0;
     int        error = 0;
 
@@ -1607,87 +2446,15 @@ static int VerifyAll(void)
             goto next;
         }
 
-        cnt = pF->many;
-        ofs = 0;
-
-        // CRC Verify
-        crcarm = CalculateCRC(CRC_InitVal, pF->start, pF->many, CRC_Polynom);
-        crcpc  = CRC32(pF->image, pF->many);
-        if (!ExeError && (crcarm == crcpc)) {
-            Counter += pF->many;
-            SetPercent(100 * Counter / TotalCount);
-            UpdatePos(100 * Counter / TotalCount);
-            goto next;
-        }
-
-        // Standard Verify (Read & Compare)
-
-        while (cnt > 0x1000) {
-            adr = pF->start + ofs;
-            //    SetHex8(adr);
-
-#if DBGCM_V8M
-            status = ReadARMMem(&adr, Buffer + ofs, 0x1000, BLOCK_SECTYPE_ANY);
-            if (status) {
-                StopProgress();
-                OutError(status);
-                return (1);
-            }
-#else  // DBGCM_V8M
-            status = ReadARMMem(&adr, Buffer + ofs, 0x1000);
-            if (status) {
-                StopProgress();
-                OutError(status);
-                return (1);
-            }
-#endif // DBGCM_V8M
-
-            ofs += 0x1000;
-            cnt -= 0x1000;
-            Counter += 0x1000;
-            SetPercent(100 * Counter / TotalCount);
-            UpdatePos(100 * Counter / TotalCount);
-        }
-        if (cnt) {
-            adr = pF->start + ofs;
-            //    SetHex8(adr);
-
-#if DBGCM_V8M
-            status = ReadARMMem(&adr, Buffer + ofs, cnt, BLOCK_SECTYPE_ANY);
-            if (status) {
-                StopProgress();
-                OutError(status);
-                return (1);
-            }
-#else  // DBGCM_V8M
-            status = ReadARMMem(&adr, Buffer + ofs, cnt);
-            if (status) {
-                StopProgress();
-                OutError(status);
-                return (1);
-            }
-#endif // DBGCM_V8M
-
-            Counter += cnt;
-            SetPercent(100 * Counter / TotalCount);
-            UpdatePos(100 * Counter / TotalCount);
-        }
-
-        // Compare data read from Flash with the expected data
-        for (n = 0; n < pF->many; n++) {
-            if (Buffer[n] != pF->image[n]) {
-                if (error < 100) {
-                    txtout("Contents mismatch at: %08XH  (Flash=%02XH  Required=%02XH) !",
-                           pF->start + n, Buffer[n], pF->image[n]);
-                } else if (error == 100) {
-                    txtout("Too many errors to display !");
-                    StopProgress();
-                    return (1);
-                }
-                error++;
-            }
+        // CRC Verify, only ranges with a CRC mismatch are read back
+        if (VerifyCRC(pF->start, pF->image, pF->many, &error)) {
+            StopProgress();
+            return (1);
         }
-        pF->many -= n;
+        Counter += pF->many;
+        SetPercent(100 * Counter / TotalCount);
+        UpdatePos(100 * Counter / TotalCount);
+        pF->many = 0;
 
     next:
         pF = (FLASHPARM *)pCbFunc(AG_CB_GETFLASHPARAM, pF); // Note: use pF from first call, get next parameters
@@ -1816,6 +2583,8 @@ DWORD FlashLoad(void)
     PDSCDebug_DebugContext = DBGCON_FLASH_ERASE;
 #endif // DBGCM_DBG_DESCRIPTION
 
+    DeltaSec.clear();
+
 #if DBGCM_DS_MONITOR
     if (FlashConf.Opt & FLASH_ERASE) {
         status = DSM_SuspendMonitor();
@@ -1827,6 +2596,9 @@ DWORD FlashLoad(void)
         if (FlashConf.Opt & FLASH_ERASEALL) {
             status = EraseFull();
         } else {
+            if ((FlashConf.Opt & (FLASH_DELTA | FLASH_PROGRAM)) == (FLASH_DELTA | FLASH_PROGRAM)) {
+                DeltaAll(); // Failure: all Sectors are erased and programmed
+            }
             status = EraseAll();
         }
         if (status) {
@@ -1846,6 +2618,9 @@ DWORD FlashLoad(void)
             if (EraseFull())
                 return (1);
         } else {
+            if ((FlashConf.Opt & (FLASH_DELTA | FLASH_PROGRAM)) == (FLASH_DELTA | FLASH_PROGRAM)) {
+                DeltaAll(); // Failure: all Sectors are erased and programmed
+            }
             if (EraseAll())
                 return (1);
         }
@@ -1966,6 +2741,8 @@ DWORD EraseFlash(void)
 {
     U32 status = 0;
 
+    DeltaSec.clear();
+
 #if DBGCM_DBG_DESCRIPTION
     PDSCDebug_DebugContext = DBGCON_FLASH_ERASE;
     if (EraseFull())
@@ -2015,22 +2792,28 @@ void InitFlash()
     Counter    = 0; // Byte Counter
     TotalCount = 0; // Total Byte Counter
 
-    SecCount = 0; // Number of Sectors (from FlashDevice)
+    Sectors.clear(); // Sector Items (from FlashDevice)
     TotalSec = 0; // Total Number of Sectors in Device
 
-    ESecAddr = 0; // Last Erased Sector Address
-    ESecSize = 0; // Last Erased Sector Size
-
-    PageAddr = 0; // Pending Program Page Address
-    PageSize = 0; // Pending Program Page Size
-    PageItem = 0; // Pending Program Page Item Count
+    PageSize = 0; // Program Page Size
 
     NextAddr = 0; // Next Address with known Algorithm
 
     ExeError = 0; // System Call Execution Error
 
+    PrgPending = FALSE; // Program Page running in the target
+    PrgBufNext = 0;     // Program Buffer for the next page
+
     memset(Buffer, 0, sizeof(Buffer));
 
+    CRC32_InitTab(); // CRC Tables for Verify
+
+    DeltaSec.clear(); // Unchanged Sectors (Delta Flashing)
+    DeltaBuf.clear(); // Expected Sector Contents
+
+    EraseSec.clear(); // Sectors to erase (Erase Plan)
+    FlashC = NULL;    // Cache Entry of the loaded Algorithm
+
     memset(&oil, 0, sizeof(oil)); // Progress-Bar data
     oldadr = 0;
     oldsz  = 0;
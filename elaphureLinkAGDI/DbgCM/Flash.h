@@ -39,6 +39,7 @@
 
 struct FlashAlgorithm {
     DWORD PrgBuf;       // Program Buffer
+    DWORD PrgBuf2;      // Second Program Buffer, 0 if RAM is too small
     DWORD BreakPoint;   // BreakPoint
     DWORD Init;         // Init Function
     DWORD UnInit;       // UnInit Function
@@ -46,6 +47,7 @@ struct FlashAlgorithm {
     DWORD BlankCheck;   // Blank Check Function
     DWORD EraseChip;    // EraseChip Function
     DWORD EraseSector;  // EraseSector Function
+    DWORD EraseSectors; // Erase Sectors Function, consecutive Sectors in one call
     DWORD ProgramPage;  // ProgramPage Function
     DWORD Verify;       // Verify Function
     DWORD rSB;          // Static Base
@@ -63,6 +65,7 @@ extern struct FlashAlgorithm FlashAlg; // Flash Device Algorithm Info
 #define FLASH_VERIFY   0x0004
 #define FLASH_RESETRUN 0x0008
 #define FLASH_ERASEALL 0x0010
+#define FLASH_DELTA    0x0020 // Skip Sectors which already hold the Image (Erase Sectors)
 
 
 // Flash Configuration
@@ -91,4 +94,12 @@ extern DWORD FlashLoad(void);
 extern DWORD EraseFlash(void);
 
 extern void InitFlash(void); // Initialize module variables
+
+
+// CRC used by CalculateCRC
+#define CRC_Polynom 0x04C11DB7
+#define CRC_InitVal 0xFFFFFFFF
+
+extern const BYTE CRC32_ARM[30];              // Thumb CRC Algorithm, CalculateCRC interface
+extern DWORD      CRC32(BYTE *dat, DWORD sz); // PC CRC Calculation
 #endif
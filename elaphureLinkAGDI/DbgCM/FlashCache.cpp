@@ -0,0 +1,300 @@
+﻿/**
+ * @file FlashCache.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Cache of parsed flash algorithms, keyed by FLM content and RAM for Algorithm
+ *
+ * Each flash download parses the FLM again: the ELF headers, the symbol table and the load
+ * segments are read with many small file accesses, then the algorithm is relocated. The
+ * result only depends on the file content and the RAM for Algorithm, so it is kept in
+ * memory and in the temp directory. The content hash of a file is computed with one bulk
+ * read and reused while its size and write time do not change. The erase timings measured
+ * with the algorithm are kept in the same entry for the erase planning of later sessions.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+#include "COLLECT.H"
+#include "..\BOM.H"
+#include "Flash.h"
+
+#include "FlashCache.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+#define FC_MAGIC    0x43464C45 // 'ELFC'
+#define FC_FNV_INIT 0xCBF29CE484222325ULL
+#define FC_FNV_PRIM 0x00000100000001B3ULL
+
+
+struct FC_FILEID {
+    ULONGLONG size;  // File Size
+    FILETIME  mtime; // Last Write Time
+    ULONGLONG hash;  // Content Hash
+};
+
+struct FC_ENTRY {
+    struct FLASHCACHE c;
+    std::vector<BYTE> image; // Storage of c.Image
+};
+
+// Header of the disk copy, followed by Dev, Alg and the Image
+struct FC_FILE {
+    DWORD     Magic;   // FC_MAGIC
+    DWORD     szDev;   // sizeof (struct FlashDevice), layout check
+    DWORD     szAlg;   // sizeof (struct FlashAlgorithm), layout check
+    DWORD     Flags;   // FC_DEVICE, FC_ALGORITHM
+    DWORD     szCRC;   // Size of the CalculateCRC Function
+    DWORD     CRC;     // CRC32 of the Image
+    DWORD     szImage; // Size of the Image
+    DWORD     tSector; // Measured Sector Erase Time in us per KB
+    DWORD     tBlank;  // Measured Blank Check Time in us per KB
+    DWORD     tChip;   // Measured Chip Erase Time in us
+    ULONGLONG Check;   // Hash of Dev, Alg and Image
+};
+
+using FC_KEY = std::tuple<ULONGLONG, DWORD, DWORD>; // Content Hash, RAMStart, RAMSize
+
+
+static std::map<std::string, FC_FILEID>         kFCFiles;   // Content Hash by path
+static std::map<FC_KEY, std::unique_ptr<FC_ENTRY>> kFCEntries; // Parsed Algorithms
+
+
+static ULONGLONG FC_Hash(ULONGLONG h, const void *p, size_t sz)
+{
+    const BYTE *b = (const BYTE *)p;
+
+    while (sz--) {
+        h ^= *b++;
+        h *= FC_FNV_PRIM;
+    }
+    return (h);
+}
+
+
+// Content hash of the file, read again only if size or write time changed
+static BOOL FC_FileHash(const char *fname, ULONGLONG *pHash)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fa;
+    ULONGLONG                 size;
+    ULONGLONG                 h;
+    std::vector<BYTE>         buf;
+    FILE                     *fh;
+
+    if (!GetFileAttributesExA(fname, GetFileExInfoStandard, &fa))
+        return (FALSE);
+    size = ((ULONGLONG)fa.nFileSizeHigh << 32) | fa.nFileSizeLow;
+
+    auto it = kFCFiles.find(fname);
+    if (it != kFCFiles.end() && it->second.size == size && CompareFileTime(&it->second.mtime, &fa.ftLastWriteTime) == 0) {
+        *pHash = it->second.hash;
+        return (TRUE);
+    }
+
+    if (size > 0x01000000) // FLM files are small, do not hash anything else
+        return (FALSE);
+    fh = fopen(fname, "rb");
+    if (fh == NULL)
+        return (FALSE);
+    buf.resize((size_t)size);
+    if (size && fread(buf.data(), 1, (size_t)size, fh) != size) {
+        fclose(fh);
+        return (FALSE);
+    }
+    fclose(fh);
+
+    h = FC_Hash(FC_FNV_INIT, buf.data(), buf.size());
+    h = FC_Hash(h, &size, sizeof(size));
+
+    kFCFiles[fname] = { size, fa.ftLastWriteTime, h };
+    *pHash          = h;
+    return (TRUE);
+}
+
+
+static BOOL FC_DiskPath(const FC_KEY &key, char *path)
+{
+    char  dir[MAX_PATH];
+    DWORD n;
+
+    n = GetTempPathA(MAX_PATH, dir);
+    if (n == 0 || n > MAX_PATH - 64)
+        return (FALSE);
+
+    strcat(dir, "elaphureLink");
+    CreateDirectoryA(dir, NULL);
+    strcat(dir, "\\FlashCache");
+    CreateDirectoryA(dir, NULL);
+
+    sprintf(path, "%s\\%016llX_%08X_%08X.bin", dir, std::get<0>(key), std::get<1>(key), std::get<2>(key));
+    return (TRUE);
+}
+
+
+static ULONGLONG FC_Check(const FC_ENTRY *e)
+{
+    ULONGLONG h;
+
+    h = FC_Hash(FC_FNV_INIT, &e->c.Dev, sizeof(e->c.Dev));
+    h = FC_Hash(h, &e->c.Alg, sizeof(e->c.Alg));
+    return (FC_Hash(h, e->image.data(), e->image.size()));
+}
+
+
+static void FC_DiskRead(const FC_KEY &key, FC_ENTRY *e)
+{
+    char    path[MAX_PATH + 64];
+    FC_FILE hdr;
+    FILE   *fh;
+    BOOL    ok;
+
+    if (!FC_DiskPath(key, path))
+        return;
+    fh = fopen(path, "rb");
+    if (fh == NULL)
+        return;
+
+    ok = fread(&hdr, 1, sizeof(hdr), fh) == sizeof(hdr) && hdr.Magic == FC_MAGIC &&
+         hdr.szDev == sizeof(struct FlashDevice) && hdr.szAlg == sizeof(struct FlashAlgorithm) &&
+         hdr.szImage <= 0x10000;
+    if (ok) {
+        e->image.resize(hdr.szImage);
+        ok = fread(&e->c.Dev, 1, sizeof(e->c.Dev), fh) == sizeof(e->c.Dev) &&
+             fread(&e->c.Alg, 1, sizeof(e->c.Alg), fh) == sizeof(e->c.Alg) &&
+             fread(e->image.data(), 1, hdr.szImage, fh) == hdr.szImage;
+    }
+    fclose(fh);
+
+    if (ok && FC_Check(e) == hdr.Check) {
+        e->c.Flags   = hdr.Flags & (FC_DEVICE | FC_ALGORITHM);
+        e->c.szCRC   = hdr.szCRC;
+        e->c.CRC     = hdr.CRC;
+        e->c.szImage = hdr.szImage;
+        e->c.Image   = e->image.data();
+        e->c.tSector = hdr.tSector;
+        e->c.tBlank  = hdr.tBlank;
+        e->c.tChip   = hdr.tChip;
+    } else {
+        e->c.Flags = 0; // Damaged or from another driver version, rebuilt by the next parse
+        e->image.clear();
+    }
+}
+
+
+static void FC_DiskWrite(const FC_KEY &key, const FC_ENTRY *e)
+{
+    char    path[MAX_PATH + 64];
+    FC_FILE hdr;
+    FILE   *fh;
+    BOOL    ok;
+
+    if (!FC_DiskPath(key, path))
+        return;
+
+    hdr.Magic   = FC_MAGIC;
+    hdr.szDev   = sizeof(struct FlashDevice);
+    hdr.szAlg   = sizeof(struct FlashAlgorithm);
+    hdr.Flags   = e->c.Flags;
+    hdr.szCRC   = e->c.szCRC;
+    hdr.CRC     = e->c.CRC;
+    hdr.szImage = (DWORD)e->image.size();
+    hdr.tSector = e->c.tSector;
+    hdr.tBlank  = e->c.tBlank;
+    hdr.tChip   = e->c.tChip;
+    hdr.Check   = FC_Check(e);
+
+    fh = fopen(path, "wb");
+    if (fh == NULL)
+        return;
+    ok = fwrite(&hdr, 1, sizeof(hdr), fh) == sizeof(hdr) &&
+         fwrite(&e->c.Dev, 1, sizeof(e->c.Dev), fh) == sizeof(e->c.Dev) &&
+         fwrite(&e->c.Alg, 1, sizeof(e->c.Alg), fh) == sizeof(e->c.Alg) &&
+         fwrite(e->image.data(), 1, e->image.size(), fh) == e->image.size();
+    fclose(fh);
+
+    if (!ok)
+        remove(path); // A partial file fails the check anyway, do not leave it behind
+}
+
+
+struct FLASHCACHE *FlashCache_Find(const char *fname, DWORD nRAMStart, DWORD nRAMSize)
+{
+    ULONGLONG hash;
+
+    if (!FC_FileHash(fname, &hash))
+        return (NULL);
+
+    FC_KEY key(hash, nRAMStart, nRAMSize);
+    auto  &e = kFCEntries[key];
+    if (!e) {
+        e = std::make_unique<FC_ENTRY>();
+        memset(&e->c, 0, sizeof(e->c));
+        FC_DiskRead(key, e.get());
+    }
+
+    return (&e->c);
+}
+
+
+// Entry and key of a cache slot returned by FlashCache_Find, the slot holds no back reference
+static FC_ENTRY *FC_EntryOf(const struct FLASHCACHE *pC, const FC_KEY **pKey)
+{
+    for (auto &e : kFCEntries) {
+        if (&e.second->c == pC) {
+            *pKey = &e.first;
+            return (e.second.get());
+        }
+    }
+    return (NULL);
+}
+
+
+void FlashCache_Device(struct FLASHCACHE *pC, const struct FlashDevice *pDev)
+{
+    const FC_KEY *key;
+    FC_ENTRY     *e = FC_EntryOf(pC, &key);
+
+    if (e == NULL)
+        return;
+
+    e->c.Dev = *pDev;
+    e->c.Flags |= FC_DEVICE;
+    FC_DiskWrite(*key, e);
+}
+
+
+void FlashCache_Algorithm(struct FLASHCACHE *pC, const struct FlashAlgorithm *pAlg,
+                          DWORD szCRC, DWORD crc, const BYTE *pImage, DWORD szImage)
+{
+    const FC_KEY *key;
+    FC_ENTRY     *e = FC_EntryOf(pC, &key);
+
+    if (e == NULL)
+        return;
+
+    e->image.assign(pImage, pImage + szImage);
+    e->c.Alg     = *pAlg;
+    e->c.szCRC   = szCRC;
+    e->c.CRC     = crc;
+    e->c.szImage = szImage;
+    e->c.Image   = e->image.data();
+    e->c.Flags |= FC_ALGORITHM;
+    FC_DiskWrite(*key, e);
+}
+
+
+void FlashCache_Timing(struct FLASHCACHE *pC)
+{
+    const FC_KEY *key;
+    FC_ENTRY     *e = FC_EntryOf(pC, &key);
+
+    if (e == NULL)
+        return;
+
+    FC_DiskWrite(*key, e);
+}
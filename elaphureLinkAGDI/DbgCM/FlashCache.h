@@ -0,0 +1,55 @@
+﻿/**
+ * @file FlashCache.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Cache of parsed flash algorithms, keyed by FLM content and RAM for Algorithm
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#define FC_DEVICE    0x0001 // Flash Device Description valid
+#define FC_ALGORITHM 0x0002 // Flash Algorithm and Image valid
+
+
+struct FLASHCACHE {
+    DWORD                 Flags;   // FC_DEVICE, FC_ALGORITHM
+    struct FlashDevice    Dev;     // Flash Device Description
+    struct FlashAlgorithm Alg;     // Flash Algorithm, relocated to RAMStart
+    DWORD                 szCRC;   // Size of the CalculateCRC Function, 0 - unknown
+    DWORD                 CRC;     // CRC32 of the Image
+    DWORD                 szImage; // Size of the Image
+    BYTE                 *Image;   // Algorithm Image as written to RAMStart
+    DWORD                 tSector; // Measured Sector Erase Time in us per KB, 0 - unknown
+    DWORD                 tBlank;  // Measured Blank Check Time in us per KB, 0 - unknown
+    DWORD                 tChip;   // Measured Chip Erase Time in us, 0 - unknown
+};
+
+
+/**
+ * @brief Find the cache entry of an FLM file for the RAM for Algorithm. The entry is
+ *        created empty if neither the memory nor the disk cache holds it.
+ *
+ * @param fname expanded path of the FLM file
+ * @return cache entry, NULL if the file cannot be read
+ */
+extern struct FLASHCACHE *FlashCache_Find(const char *fname, DWORD nRAMStart, DWORD nRAMSize);
+
+/**
+ * @brief Store the parsed Flash Device Description in the entry and on disk.
+ */
+extern void FlashCache_Device(struct FLASHCACHE *pC, const struct FlashDevice *pDev);
+
+/**
+ * @brief Store the relocated Flash Algorithm and its RAM image in the entry and on disk.
+ *
+ * @param szCRC size of the CalculateCRC function, 0 if unknown
+ * @param crc CRC32 of the image
+ */
+extern void FlashCache_Algorithm(struct FLASHCACHE *pC, const struct FlashAlgorithm *pAlg,
+                                 DWORD szCRC, DWORD crc, const BYTE *pImage, DWORD szImage);
+
+/**
+ * @brief Store the measured erase timings of the entry on disk.
+ */
+extern void FlashCache_Timing(struct FLASHCACHE *pC);
@@ -0,0 +1,166 @@
+﻿/**
+ * @file HaltSnapshot.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Fetch of the memory the views show with one batch when the target halts
+ *
+ * After each halt the call stack, watch and memory views read their data one item at a
+ * time, which costs one round trip each. The ranges read while the target is halted are
+ * recorded. At the next halt they are merged with the top of the active stack, fetched
+ * with one ReadRanges() call and written to the memory cache, so the views are answered
+ * from the cache. Ranges no longer read by any view drop out after one halt.
+ *
+ * Gaps between ranges are only filled where the memory map allows to read ahead. If the
+ * batch faults anyway, e.g. because a view shows an address without memory, the ranges
+ * are read one at a time so the others are still cached.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+#include "COLLECT.H"
+#include "..\BOM.H"
+#include "Debug.h"
+
+#include "HaltSnapshot.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+
+struct HS_RANGE {
+    DWORD nAdr; // Start address
+    DWORD nLen; // Length in bytes
+};
+
+
+static std::mutex            kHSMutex;
+static std::vector<HS_RANGE> kHSRequested; // Ranges read since the last halt
+static BYTE                  kHSData[HS_MAX_BYTES];
+
+
+static BOOL IsSFR(DWORD nStart, DWORD nEnd)
+{
+    return (nStart <= MonConf.SFREnd && nEnd > MonConf.SFRStart);
+}
+
+
+/*
+ * Merge the requested ranges into word aligned fetch ranges.
+ *   pReadable : checks if a gap may be read, NULL: only touching ranges are merged
+ */
+
+static void HaltSnapshot_Plan(std::vector<HS_RANGE> &ranges, BOOL (*pReadable)(DWORD nAdr, DWORD nLen))
+{
+    std::vector<HS_RANGE> merged;
+    DWORD                 nTotal = 0;
+
+    std::sort(ranges.begin(), ranges.end(), [](const HS_RANGE &a, const HS_RANGE &b) {
+        return a.nAdr < b.nAdr;
+    });
+
+    for (auto &r : ranges) {
+        DWORD nStart = r.nAdr & ~3UL;
+        DWORD nEnd   = (r.nAdr + r.nLen + 3) & ~3UL;
+
+        if (!merged.empty()) {
+            HS_RANGE &last     = merged.back();
+            DWORD     nLastEnd = last.nAdr + last.nLen;
+
+            // Fill small gaps, but never read registers or unmapped memory no view asked for
+            if (nStart <= nLastEnd ||
+                (nStart <= nLastEnd + HS_MERGE_GAP && pReadable != NULL && pReadable(nLastEnd, nStart - nLastEnd))) {
+                if (nEnd > nLastEnd) {
+                    DWORD nGrow = nEnd - nLastEnd;
+                    if (nTotal + nGrow > HS_MAX_BYTES)
+                        break;
+                    last.nLen += nGrow;
+                    nTotal += nGrow;
+                }
+                continue;
+            }
+        }
+
+        if (merged.size() >= HS_MAX_RANGES || nTotal + (nEnd - nStart) > HS_MAX_BYTES)
+            break;
+        merged.push_back({ nStart, nEnd - nStart });
+        nTotal += nEnd - nStart;
+    }
+
+    ranges.swap(merged);
+}
+
+
+void HaltSnapshot_Record(DWORD nAdr, DWORD nMany)
+{
+    std::lock_guard<std::mutex> lk(kHSMutex);
+
+    if (nMany == 0 || nAdr + nMany - 1 < nAdr) {
+        return;
+    }
+    if (nAdr + nMany > PPBAddr) {
+        return; // Debug registers are never cached
+    }
+    if (IsSFR(nAdr, nAdr + nMany)) {
+        return; // SFRs are never cached
+    }
+
+    if (kHSRequested.size() < HS_MAX_RANGES * 2) {
+        kHSRequested.push_back({ nAdr, nMany });
+    }
+}
+
+
+int HaltSnapshot_Fetch(DWORD nSP, void (*pCache)(DWORD nAdr, BYTE *pB, DWORD nMany),
+                       BOOL (*pReadable)(DWORD nAdr, DWORD nLen))
+{
+    std::vector<HS_RANGE> ranges, single;
+    std::vector<DWORD>    adr, len;
+    DWORD                 nStart, nEnd, nOfs;
+    int                   status;
+
+    std::lock_guard<std::mutex> lk(kHSMutex);
+
+    ranges.swap(kHSRequested);
+
+    // Top of the active stack, the call stack view reads it first
+    nStart = nSP & ~3UL;
+    nEnd   = (nStart + HS_STACK_PAGE - 1) & ~(HS_STACK_PAGE - 1);
+    if (nEnd - nStart > HS_STACK_BYTES)
+        nEnd = nStart + HS_STACK_BYTES;
+    if (nEnd > nStart && nEnd <= PPBAddr && !IsSFR(nStart, nEnd)) {
+        ranges.push_back({ nStart, nEnd - nStart });
+    }
+
+    if (ranges.empty() || ReadRanges == NULL)
+        return (0);
+
+    single = ranges;
+    HaltSnapshot_Plan(ranges, pReadable);
+
+    for (auto &r : ranges) {
+        adr.push_back(r.nAdr);
+        len.push_back(r.nLen);
+    }
+
+    status = ReadRanges(adr.data(), len.data(), kHSData, (DWORD)ranges.size());
+    if (status) {
+        // Read the ranges without gaps one at a time, the failing ones are
+        // read by the views themselves which report the error
+        HaltSnapshot_Plan(single, NULL);
+        for (auto &r : single) {
+            if (ReadRanges(&r.nAdr, &r.nLen, kHSData, 1) == 0) {
+                pCache(r.nAdr, kHSData, r.nLen);
+            }
+        }
+        return (status);
+    }
+
+    nOfs = 0;
+    for (auto &r : ranges) {
+        pCache(r.nAdr, &kHSData[nOfs], r.nLen);
+        nOfs += r.nLen;
+    }
+
+    return (0);
+}
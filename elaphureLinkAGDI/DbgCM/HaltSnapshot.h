@@ -0,0 +1,35 @@
+﻿/**
+ * @file HaltSnapshot.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Fetch of the memory the views show with one batch when the target halts
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#define HS_MAX_RANGES  128   // Ranges fetched per halt
+#define HS_MAX_BYTES   8192  // Bytes fetched per halt
+#define HS_MERGE_GAP   32    // Ranges closer than this are fetched as one range
+#define HS_STACK_BYTES 256   // Bytes fetched from the top of the active stack
+#define HS_STACK_PAGE  0x400 // The stack fetch does not cross the end of this page, memory ends on it
+
+
+/**
+ * @brief Record a memory read of the views while the target is halted. The range is
+ *        fetched with the next snapshot.
+ */
+extern void HaltSnapshot_Record(DWORD nAdr, DWORD nMany);
+
+/**
+ * @brief Fetch the top of the stack and all ranges the views read during the previous
+ *        halt with one ReadRanges() call. If that call fails, the ranges are read one
+ *        at a time.
+ *
+ * @param nSP current stack pointer
+ * @param pCache called with each fetched range to prime the memory cache
+ * @param pReadable checks if the gap between two ranges may be read as well
+ * @return 0: OK, else error code of the batch (the ranges read alone are primed)
+ */
+extern int HaltSnapshot_Fetch(DWORD nSP, void (*pCache)(DWORD nAdr, BYTE *pB, DWORD nMany),
+                              BOOL (*pReadable)(DWORD nAdr, DWORD nLen));
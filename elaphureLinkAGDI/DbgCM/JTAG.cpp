@@ -110,6 +110,8 @@ JTAG_SysCallRes: Returns the result of the SysCall (register R0).
 #include "JTAG.h"
 #include "..\BOM.h"
 #include "rddi_dll.hpp"
+#include "AccessScheduler.h"
+#include "RAMLoad.h"
 
 #if DBGCM_DBG_DESCRIPTION
 #include "PDSCDebug.h"
@@ -119,13 +121,16 @@ JTAG_SysCallRes: Returns the result of the SysCall (register R0).
 #include "DSMonitor.h"
 #endif // DBGCM_DS_MONITOR
 #include <cassert>
-#include <mutex>
 
 JDEVS JTAG_devs; // JTAG Device List
 
 DWORD JTAG_IDCode; // JTAG ID Code
 
-static std::recursive_mutex kJTAGOpMutex;
+static BOOL kJTAGRegRdyWait; // Wait for DHCSR.S_REGRDY when reading core registers
+
+#define BULK_BATCH_SIZE     255  // DAP registers per request of JTAG_TransferRanges (8-bit transfer count)
+#define VECTOR_BATCH_SIZE   200  // DAP registers per request of JTAG_ReadVector/JTAG_WriteVector
+#define SYSCALL_MATCH_RETRY 2000 // DHCSR reads of the probe per JTAG_SysCallWait request
 
 struct KNOWNDEVICES KnownDevices[] = {
     //      ID         Mask      CpuType   Name
@@ -159,8 +164,9 @@ struct KNOWNDEVICES KnownDevices[] = {
     { 0x00000000, 0x00000000, NOCPU, "Unknown JTAG device" },     // table termination
 };
 
-#if DBGCM_V8M
 // Forward declarations
+static int JTAG_TransferRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges, BYTE attrib, BOOL bWrite);
+#if DBGCM_V8M
 static int JTAG_UpdateDSCSR(DWORD adr, DWORD many, BYTE attrib);
 #endif // DBGCM_V8M
 
@@ -320,7 +326,7 @@ int JTAG_DAPAbort(void)
 //   return value: error status
 int JTAG_ReadDP(BYTE adr, DWORD *val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
 #if DBGCM_DBG_DESCRIPTION
     int status = 0, pstatus = 0, retry_count = 1;
@@ -369,7 +375,7 @@ int JTAG_ReadDP(BYTE adr, DWORD *val)
 //   return value: error status
 int JTAG_WriteDP(BYTE adr, DWORD val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int status = 0, retry_count = 1;
 
@@ -402,7 +408,7 @@ int JTAG_WriteDP(BYTE adr, DWORD val)
 //   return value: error status
 int JTAG_ReadAP(BYTE adr, DWORD *val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
 #if DBGCM_DBG_DESCRIPTION
     int status = 0, pstatus = 0;
@@ -449,7 +455,7 @@ int JTAG_ReadAP(BYTE adr, DWORD *val)
 //   return value: error status
 int JTAG_WriteAP(BYTE adr, DWORD val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int status;
 
@@ -528,7 +534,7 @@ int JTAG_ReadD32(DWORD adr, DWORD *val, BYTE attrib)
 int JTAG_ReadD32(DWORD adr, DWORD *val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -660,7 +666,7 @@ int JTAG_ReadD16(DWORD adr, WORD *val, BYTE attrib)
 int JTAG_ReadD16(DWORD adr, WORD *val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     // #if DBGCM_DBG_DESCRIPTION || DBGCM_V8M
     int   status = 0;
@@ -763,7 +769,7 @@ int JTAG_ReadD8(DWORD adr, BYTE *val, BYTE attrib)
 int JTAG_ReadD8(DWORD adr, BYTE *val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     //#if DBGCM_DBG_DESCRIPTION || DBGCM_V8M
     int   status = 0;
@@ -869,7 +875,7 @@ int JTAG_WriteD32(DWORD adr, DWORD val, BYTE attrib)
 int JTAG_WriteD32(DWORD adr, DWORD val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -938,7 +944,7 @@ int JTAG_WriteD16(DWORD adr, WORD val, BYTE attrib)
 int JTAG_WriteD16(DWORD adr, WORD val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -1007,7 +1013,7 @@ int JTAG_WriteD8(DWORD adr, BYTE val, BYTE attrib)
 int JTAG_WriteD8(DWORD adr, BYTE val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -1073,11 +1079,10 @@ int JTAG_WriteD8(DWORD adr, BYTE val)
 //   return value: error status
 int JTAG_ReadBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
-    int         status = 0;
-    AP_CONTEXT *apCtx;
-    DWORD       rwpage;
+    int   status = 0;
+    DWORD rwpage;
 
 
 #if DBGCM_DBG_DESCRIPTION || DBGCM_DS_MONITOR
@@ -1111,59 +1116,8 @@ int JTAG_ReadBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
         }
     }
 
-    // 27.06.2019: Updated AP handling
-    status = AP_Switch(&apCtx);
-    if (status)
-        goto end;
-
-#if DBGCM_V8M
-    status = JTAG_UpdateDSCSR(adr, nMany, attrib);
-    if (status)
-        goto end;
-
-    status = _UpdateAPSecAttr(attrib);
-    if (status)
-        goto end;
-#endif // DBGCM_V8M
-
-    assert(attrib == 0);
-
-    do {
-        if (AP_Bank != 0) {
-            status = JTAG_WriteDP(DP_SELECT, AP_Sel | 0);
-            if (status)
-                break;
-            AP_Bank = 0;
-        }
-
-        if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
-            apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
-            apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
-            status = JTAG_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
-            if (status)
-                break;
-        }
-
-        status = JTAG_WriteAP(AP_TAR, adr);
-        if (status)
-            break;
-
-        // Multiple Read AP DRW
-        status = rddi::DAP_RegReadRepeat(rddi::k_rddi_handle, JTAG_devs.com_no,
-                                         nMany >> 2, DAP_AP_REG_DRW, (int *)pB);
-        status = JTAG_CheckStatus(status);
-        if (status)
-            break;
-
-        status = JTAG_StickyError();
-        if (status)
-            break;
-    } while (0);
-
-
-    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
-        status = EU14;
-    }
+    // AP handling, TAR, DRW and the sticky error check with as few DAP requests as possible
+    status = JTAG_TransferRanges(&adr, &nMany, pB, 1, attrib, FALSE);
 
     // See "Setting up target memory accesses based on AP_Context" above in this file for how
     // to construct the AP CSW value to write.
@@ -1212,51 +1166,75 @@ end:
 }
 
 
-// JTAG Write Data Block (32-bit Elements inside R/W Page Block)
-// Block parameters 'adr' and 'nMany' must be 4-Byte aligned to allow an efficient implementation.
-//   adr    : Address
-//   pB     : Pointer to Buffer
-//   nMany  : Number of bytes
-//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
-//   return value: error status
-int JTAG_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+// Execute the DAP requests collected by JTAG_TransferRanges and store the DRW and CTRL/STAT read values
+static int JTAG_TransferRangesFlush(int nReg, int *regID, int *regData, BYTE **pData)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    int status, k;
 
-    // #if DBGCM_V8M
-    int status = 0;
-    // #endif // DBGCM_V8M
+    // R/W DAP Registers
+    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, JTAG_devs.com_no, nReg, regID, regData);
+    status = JTAG_CheckStatus(status);
+    if (status)
+        return (status);
 
-    AP_CONTEXT *apCtx;
-    DWORD       rwpage;
+    for (k = 0; k < nReg; k++) {
+        if (pData[k])
+            memcpy(pData[k], &regData[k], 4);
+    }
 
-    if (nMany == 0)
-        return (EU01);
-    if (nMany & 0x03)
-        return (EU01);
-    // if (nMany > RWPage) return (EU01);
+    return (0);
+}
 
-    if (!(attrib & BLOCK_NADDRINC)) {
-        rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
-        if (nMany > rwpage)
+
+// JTAG Read/Write Data Ranges (32-bit Elements)
+// Transfers several address ranges with as few DAP requests as possible. Each request packs TAR writes
+// and DRW accesses of many ranges, TAR is reloaded at every auto-increment page boundary, so a range
+// may cross R/W pages. DP CTRL/STAT is read with the last request to check the sticky error, so a
+// transfer that fits into one request costs a single round trip.
+// Range addresses and lengths must be 4-Byte aligned.
+//   pAdr    : Array of range start addresses
+//   pLen    : Array of range lengths in bytes
+//   pB      : Pointer to Buffer, holds the data of all ranges back to back
+//   nRanges : Number of ranges
+//   attrib  : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   bWrite  : FALSE - Read, TRUE - Write
+//   return value: error status
+static int JTAG_TransferRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges, BYTE attrib, BOOL bWrite)
+{
+    AS_Guard lk;
+
+    int         status = 0;
+    AP_CONTEXT *apCtx;
+    DWORD       rwpage, adr, n, i;
+    DWORD       dp_stat = 0;
+    int         nReg;
+    int         regID[BULK_BATCH_SIZE];
+    int         regData[BULK_BATCH_SIZE];
+    BYTE       *pData[BULK_BATCH_SIZE];
+
+    for (i = 0; i < nRanges; i++) {
+        if ((pAdr[i] & 0x03) || (pLen[i] & 0x03))
             return (EU01);
     }
 
-    // 27.06.2019: Updated AP handling
     status = AP_Switch(&apCtx);
     if (status)
         return (status);
 
 #if DBGCM_V8M
-    status = JTAG_UpdateDSCSR(adr, nMany, attrib);
-    if (status)
-        return (status);
+    for (i = 0; i < nRanges; i++) {
+        status = JTAG_UpdateDSCSR(pAdr[i], pLen[i], attrib);
+        if (status)
+            return (status);
+    }
 
     status = _UpdateAPSecAttr(attrib);
     if (status)
         return (status);
 #endif // DBGCM_V8M
 
+    rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
+
     do {
         if (AP_Bank != 0) {
             status = JTAG_WriteDP(DP_SELECT, AP_Sel | 0);
@@ -1273,18 +1251,50 @@ int JTAG_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
                 break;
         }
 
-        status = JTAG_WriteAP(AP_TAR, adr);
+        nReg = 0;
+        for (i = 0; i < nRanges && status == 0; i++) {
+            adr = pAdr[i];
+            for (n = pLen[i]; n != 0; n -= 4, adr += 4, pB += 4) {
+                // Keep room for TAR, DRW and the final DP_CTRL_STAT read
+                if (nReg + 3 > BULK_BATCH_SIZE) {
+                    status = JTAG_TransferRangesFlush(nReg, regID, regData, pData);
+                    if (status)
+                        break;
+                    nReg = 0;
+                }
+
+                // TAR at range start, page boundary and after each request
+                if (n == pLen[i] || (adr & (rwpage - 1)) == 0 || nReg == 0) {
+                    regID[nReg]   = DAP_AP_REG_TAR;
+                    regData[nReg] = adr;
+                    pData[nReg]   = NULL;
+                    nReg++;
+                }
+
+                if (bWrite) { // DRW write
+                    regID[nReg] = DAP_AP_REG_DRW;
+                    memcpy(&regData[nReg], pB, 4);
+                    pData[nReg] = NULL;
+                } else { // DRW read
+                    regID[nReg] = DAP_AP_REG_DRW | DAP_REG_RnW;
+                    pData[nReg] = pB;
+                }
+                nReg++;
+            }
+        }
         if (status)
             break;
 
-        // Multiple Write AP DRW
-        status = rddi::DAP_RegWriteRepeat(rddi::k_rddi_handle, JTAG_devs.com_no,
-                                          nMany >> 2, DAP_AP_REG_DRW, (int *)pB);
-        status = JTAG_CheckStatus(status);
+        // DP_CTRL_STAT read
+        regID[nReg] = DAP_REG_DP_0x4 | DAP_REG_RnW;
+        pData[nReg] = (BYTE *)&dp_stat;
+        nReg++;
+
+        status = JTAG_TransferRangesFlush(nReg, regID, regData, pData);
         if (status)
             break;
 
-        status = JTAG_StickyError();
+        status = JTAG_CheckStickyError(dp_stat);
         if (status)
             break;
     } while (0);
@@ -1293,80 +1303,508 @@ int JTAG_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
         status = EU14;
     }
 
+    return (status);
+}
+
 
-    // See "Setting up target memory accesses based on AP_Context" above in this file for how
-    // to construct the AP CSW value to write.
+// JTAG Read Data Ranges (32-bit Elements)
+// Range addresses and lengths must be 4-Byte aligned.
+//   pAdr    : Array of range start addresses
+//   pLen    : Array of range lengths in bytes
+//   pB      : Pointer to Buffer, receives the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+int JTAG_ReadRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges)
+{
+    int status;
+
+#if DBGCM_DBG_DESCRIPTION
+    int   pstatus = 0;
+    DWORD i;
+#endif // DBGCM_DBG_DESCRIPTION
+
+    status = JTAG_TransferRanges(pAdr, pLen, pB, nRanges, BLOCK_SECTYPE_ANY, FALSE);
+    if (status)
+        return (status);
+
+#if DBGCM_DBG_DESCRIPTION
+    if (PDSCDebug_IsEnabled()) {
+        for (i = 0; i < nRanges; pB += pLen[i], i++) {
+            if (pLen[i] == 0)
+                continue;
+            pstatus = PDSCDebug_PatchData((U32)ACCESS_MEM, 4, pAdr[i], pLen[i], (UC8 *)pB, 0 /*attrib*/);
+            if (pstatus != 0 && pstatus != EU38)
+                return (pstatus);
+        }
+    }
+#endif // DBGCM_DBG_DESCRIPTION
+
+    return (0);
+}
+
+
+// JTAG Write Data Ranges (32-bit Elements)
+// Range addresses and lengths must be 4-Byte aligned.
+//   pAdr    : Array of range start addresses
+//   pLen    : Array of range lengths in bytes
+//   pB      : Pointer to Buffer, holds the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+int JTAG_WriteRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges)
+{
+    return (JTAG_TransferRanges(pAdr, pLen, pB, nRanges, BLOCK_SECTYPE_ANY, TRUE));
+}
+
+
+// JTAG Read Data Bulk (32-bit Elements, may cross R/W Pages)
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned.
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+static int JTAG_ReadBulk(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+{
+    int status;
+
+#if DBGCM_DBG_DESCRIPTION
+    int pstatus = 0;
+#endif // DBGCM_DBG_DESCRIPTION
+
+    status = JTAG_TransferRanges(&adr, &nMany, pB, 1, attrib, FALSE);
 
     // Extend error message with details if memory access failed
-    // Ideally use the actual address of the failing access
     if (status == EU14)
-        SetStatusMem(EU14, adr, STATUS_MEMWRITE, 4);
+        SetStatusMem(EU14, adr, STATUS_MEMREAD, 4);
     if (status)
         return (status);
 
+#if DBGCM_DBG_DESCRIPTION
+    if (PDSCDebug_IsEnabled()) {
+        pstatus = PDSCDebug_PatchData((U32)ACCESS_MEM, 4, adr, nMany, (UC8 *)pB, 0 /*attrib*/);
+        if (pstatus != 0 && pstatus != EU38)
+            return (pstatus);
+    }
+#endif // DBGCM_DBG_DESCRIPTION
+
     return (0);
 }
 
 
-// JTAG Verify Data Block (32-bit Elements inside R/W Page Block)
+// JTAG Write Data Bulk (32-bit Elements, may cross R/W Pages)
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned.
 //   adr    : Address
 //   pB     : Pointer to Buffer
 //   nMany  : Number of bytes
-//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
-//   return value: error status or -1 on Verify Missmatch
-#if DBGCM_V8M
-int JTAG_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+static int JTAG_WriteBulk(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
 {
-    // int status = 0;
-#else  // DBGCM_V8M
-int JTAG_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany)
+    int status;
+
+    status = JTAG_TransferRanges(&adr, &nMany, pB, 1, attrib, TRUE);
+
+    // Extend error message with details if memory access failed
+    if (status == EU14)
+        SetStatusMem(EU14, adr, STATUS_MEMWRITE, 4);
+
+    return (status);
+}
+
+
+// Execute one item of JTAG_ReadVector/JTAG_WriteVector with the single access functions
+static int JTAG_VectorItem(MEM_VECTOR *pV, BOOL bWrite, BYTE attrib)
 {
+    int  status = 0;
+    WORD v16;
+    BYTE v8;
+
+#if DBGCM_V8M
+    switch (pV->Size) {
+        case 1:
+            if (bWrite)
+                return (JTAG_WriteD8(pV->Addr, (BYTE)pV->Val, attrib));
+            status = JTAG_ReadD8(pV->Addr, &v8, attrib);
+            if (status == 0)
+                pV->Val = v8;
+            break;
+        case 2:
+            if (bWrite)
+                return (JTAG_WriteD16(pV->Addr, (WORD)pV->Val, attrib));
+            status = JTAG_ReadD16(pV->Addr, &v16, attrib);
+            if (status == 0)
+                pV->Val = v16;
+            break;
+        default:
+            if (bWrite)
+                return (JTAG_WriteD32(pV->Addr, pV->Val, attrib));
+            status = JTAG_ReadD32(pV->Addr, &pV->Val, attrib);
+            break;
+    }
+#else  // DBGCM_V8M
+    switch (pV->Size) {
+        case 1:
+            if (bWrite)
+                return (JTAG_WriteD8(pV->Addr, (BYTE)pV->Val));
+            status = JTAG_ReadD8(pV->Addr, &v8);
+            if (status == 0)
+                pV->Val = v8;
+            break;
+        case 2:
+            if (bWrite)
+                return (JTAG_WriteD16(pV->Addr, (WORD)pV->Val));
+            status = JTAG_ReadD16(pV->Addr, &v16);
+            if (status == 0)
+                pV->Val = v16;
+            break;
+        default:
+            if (bWrite)
+                return (JTAG_WriteD32(pV->Addr, pV->Val));
+            status = JTAG_ReadD32(pV->Addr, &pV->Val);
+            break;
+    }
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
 
-    int   status = 0;
-    int   flag   = 0;
-    DWORD rwpage, val;
+    return (status);
+}
 
+
+// JTAG Read/Write Data Vector
+// All items are packed into as few DAP requests as possible: a CSW write only where the access
+// size changes, then TAR and DRW for each item. If a request faults, the items before the
+// failing one are kept, and only the failing item is repeated with JTAG_ReadD32/JTAG_ReadD16/
+// JTAG_ReadD8 (or the write functions) to report its error, then the vector resumes after it.
+//   pV     : Pointer to Items
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   bWrite : FALSE - Read, TRUE - Write
+//   return value: error status
+static int JTAG_AccessVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib, BOOL bWrite)
+{
+    AS_Guard lk;
+
+    int         status = 0;
     AP_CONTEXT *apCtx;
+    MEM_VECTOR *p;
+    DWORD       i, first, last, csw, sh, tar;
+    BOOL        bSingle = FALSE;
+    int         nReg, k;
+    int         regID[VECTOR_BATCH_SIZE];
+    int         regData[VECTOR_BATCH_SIZE];
+    DWORD       regItem[VECTOR_BATCH_SIZE]; // Item of a DRW read
 
-    if (nMany == 0)
-        return (EU01);
-    if (nMany & 0x03)
-        return (EU01);
-    // if (nMany > RWPage) return (EU01);
+#if DBGCM_DBG_DESCRIPTION
+    int pstatus = 0;
+#endif // DBGCM_DBG_DESCRIPTION
 
-    rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
-    if (nMany > rwpage)
-        return (EU01);
+    VectorDone = 0;
+    for (i = 0; i < nMany; i++) {
+        if ((pV[i].Size != 1 && pV[i].Size != 2 && pV[i].Size != 4) || (pV[i].Addr & (pV[i].Size - 1)))
+            return (EU01);
+#if DBGCM_DS_MONITOR
+        if (pV[i].Addr == DBG_HCSR)
+            bSingle = TRUE; // Monitor must be suspended around DHCSR accesses
+#endif // DBGCM_DS_MONITOR
+    }
+
+    if (bSingle) {
+        for (i = 0; i < nMany; i++) {
+            status = JTAG_VectorItem(&pV[i], bWrite, attrib);
+            if (status)
+                return (status);
+            VectorDone = i + 1;
+        }
+        return (0);
+    }
 
     status = AP_Switch(&apCtx);
     if (status)
         return (status);
+
 #if DBGCM_V8M
-    status = JTAG_UpdateDSCSR(adr, nMany, attrib);
-    if (status)
-        return (status);
+    for (i = 0; i < nMany; i++) {
+        status = JTAG_UpdateDSCSR(pV[i].Addr, pV[i].Size, attrib);
+        if (status)
+            return (status);
+    }
 
     status = _UpdateAPSecAttr(attrib);
     if (status)
         return (status);
 #endif // DBGCM_V8M
 
-    // See "Setting up target memory accesses based on AP_Context" above in this file for how
-    // to construct the AP CSW value to write.
+    do {
+        if (AP_Bank != 0) {
+            status = JTAG_WriteDP(DP_SELECT, AP_Sel | 0);
+            if (status)
+                break;
+            AP_Bank = 0;
+        }
 
-    if (AP_Bank != 0) {
-        status = JTAG_WriteDP(DP_SELECT, AP_Sel | 0);
-        if (status)
-            goto fail;
-        AP_Bank = 0;
-    }
+        nReg  = 0;
+        first = 0;
+        for (i = 0; i < nMany; i++) {
+            switch (pV[i].Size) {
+                case 1:
+                    csw = CSW_SIZE8;
+                    sh  = (pV[i].Addr & 0x03) << 3;
+                    break;
+                case 2:
+                    csw = CSW_SIZE16;
+                    sh  = (pV[i].Addr & 0x02) << 3;
+                    break;
+                default:
+                    csw = CSW_SIZE32;
+                    sh  = 0;
+                    break;
+            }
 
-    if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
-        apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
-        apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
-        status = JTAG_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+            // CSW only where the access size changes
+            if ((apCtx->CSW_Val_Base & CSW_SIZE) != csw) {
+                apCtx->CSW_Val_Base &= ~CSW_SIZE;
+                apCtx->CSW_Val_Base |= csw;
+                regID[nReg]   = DAP_AP_REG_CSW;
+                regData[nReg] = apCtx->CSW_Val_Base;
+                regItem[nReg] = 0;
+                nReg++;
+            }
+
+            // TAR = adr
+            regID[nReg]   = DAP_AP_REG_TAR;
+            regData[nReg] = pV[i].Addr;
+            regItem[nReg] = 0;
+            nReg++;
+
+            // DRW read or write, data is placed on the byte lanes of the address
+            if (bWrite) {
+                regID[nReg]   = DAP_AP_REG_DRW;
+                regData[nReg] = pV[i].Val << sh;
+                regItem[nReg] = 0;
+            } else {
+                regID[nReg]   = DAP_AP_REG_DRW | DAP_REG_RnW;
+                regItem[nReg] = i;
+            }
+            nReg++;
+
+            if (nReg + 3 <= VECTOR_BATCH_SIZE && i + 1 < nMany)
+                continue;
+
+            // R/W DAP Registers
+            status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, JTAG_devs.com_no, nReg, regID, regData);
+            status = JTAG_CheckStatus(status);
+            if (status == 0)
+                status = JTAG_StickyError(); // JTAG transfers do not report faults
+            last = i + 1;                    // Items before 'last' are complete
+            if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+                // The probe completes all transfers of a JTAG request, but the AP discards
+                // the accesses after a fault, so TAR still holds the address of the failing item
+                status = JTAG_ReadAP(AP_TAR, &tar);
+                if (status)
+                    break;
+                for (last = first; last <= i && pV[last].Addr != tar; last++)
+                    ;
+                if (last > i) {
+                    // Failing item not known, sync CSW with the base value
+                    status = JTAG_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+                    if (status == 0)
+                        status = rddi::RDDI_DAP_ERROR_MEMORY;
+                    break; // Items from 'first' on are not known
+                }
+                status = rddi::RDDI_DAP_ERROR_MEMORY;
+            } else if (status)
+                break;
+
+            if (!bWrite) {
+                for (k = 0; k < nReg; k++) {
+                    if ((regID[k] & DAP_REG_RnW) == 0 || regItem[k] >= last)
+                        continue;
+                    p = &pV[regItem[k]];
+                    switch (p->Size) {
+                        case 1:
+                            p->Val = (BYTE)((DWORD)regData[k] >> ((p->Addr & 0x03) << 3));
+                            break;
+                        case 2:
+                            p->Val = (WORD)((DWORD)regData[k] >> ((p->Addr & 0x02) << 3));
+                            break;
+                        default:
+                            p->Val = (DWORD)regData[k];
+                            break;
+                    }
+                }
+
+#if DBGCM_DBG_DESCRIPTION
+                if (PDSCDebug_IsEnabled()) {
+                    for (; first < last; first++) {
+                        pstatus = PDSCDebug_PatchData((U32)ACCESS_MEM, pV[first].Size, pV[first].Addr, pV[first].Size, (UC8 *)&pV[first].Val, attrib);
+                        if (pstatus != 0 && pstatus != EU38)
+                            return (pstatus);
+                    }
+                }
+#endif // DBGCM_DBG_DESCRIPTION
+            }
+
+            if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+                // Sync CSW with the base value, then repeat the failing item alone
+                status = JTAG_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+                if (status)
+                    break;
+                VectorDone = last;
+                status     = JTAG_VectorItem(&pV[last], bWrite, attrib);
+                if (status)
+                    return (status);
+                status = JTAG_StickyError();
+                if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+                    SetStatusMem(EU14, pV[last].Addr, bWrite ? STATUS_MEMWRITE : STATUS_MEMREAD, pV[last].Size);
+                    return (EU14);
+                }
+                if (status)
+                    return (status);
+                i = last; // Resume after the failing item
+            }
+
+            nReg       = 0;
+            first      = i + 1;
+            VectorDone = first;
+        }
+    } while (0);
+
+    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+        status = EU14;
+    }
+    if (status)
+        return (status);
+
+    return (0);
+}
+
+
+// JTAG Read Data Vector
+//   pV     : Pointer to Items, 'Addr' and 'Size' are inputs, 'Val' receives the value
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+int JTAG_ReadVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib)
+{
+    return (JTAG_AccessVector(pV, nMany, attrib, FALSE));
+}
+
+
+// JTAG Write Data Vector
+//   pV     : Pointer to Items, 'Addr', 'Size' and 'Val' are inputs
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+int JTAG_WriteVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib)
+{
+    return (JTAG_AccessVector(pV, nMany, attrib, TRUE));
+}
+
+
+// JTAG Write Data Block (32-bit Elements inside R/W Page Block)
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned to allow an efficient implementation.
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
+//   return value: error status
+int JTAG_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+{
+    AS_Guard lk;
+
+    // #if DBGCM_V8M
+    int status = 0;
+    // #endif // DBGCM_V8M
+
+    DWORD rwpage;
+
+    if (nMany == 0)
+        return (EU01);
+    if (nMany & 0x03)
+        return (EU01);
+    // if (nMany > RWPage) return (EU01);
+
+    if (!(attrib & BLOCK_NADDRINC)) {
+        rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
+        if (nMany > rwpage)
+            return (EU01);
+    }
+
+    // AP handling, TAR, DRW and the sticky error check with as few DAP requests as possible
+    status = JTAG_TransferRanges(&adr, &nMany, pB, 1, attrib, TRUE);
+
+    // See "Setting up target memory accesses based on AP_Context" above in this file for how
+    // to construct the AP CSW value to write.
+
+    // Extend error message with details if memory access failed
+    // Ideally use the actual address of the failing access
+    if (status == EU14)
+        SetStatusMem(EU14, adr, STATUS_MEMWRITE, 4);
+    if (status)
+        return (status);
+
+    return (0);
+}
+
+
+// JTAG Verify Data Block (32-bit Elements inside R/W Page Block)
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
+//   return value: error status or -1 on Verify Missmatch
+#if DBGCM_V8M
+int JTAG_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+{
+    // int status = 0;
+#else  // DBGCM_V8M
+int JTAG_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany)
+{
+#endif // DBGCM_V8M
+    AS_Guard lk;
+
+    int   status = 0;
+    int   flag   = 0;
+    DWORD rwpage, val;
+
+    AP_CONTEXT *apCtx;
+
+    if (nMany == 0)
+        return (EU01);
+    if (nMany & 0x03)
+        return (EU01);
+    // if (nMany > RWPage) return (EU01);
+
+    rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
+    if (nMany > rwpage)
+        return (EU01);
+
+    status = AP_Switch(&apCtx);
+    if (status)
+        return (status);
+#if DBGCM_V8M
+    status = JTAG_UpdateDSCSR(adr, nMany, attrib);
+    if (status)
+        return (status);
+
+    status = _UpdateAPSecAttr(attrib);
+    if (status)
+        return (status);
+#endif // DBGCM_V8M
+
+    // See "Setting up target memory accesses based on AP_Context" above in this file for how
+    // to construct the AP CSW value to write.
+
+    if (AP_Bank != 0) {
+        status = JTAG_WriteDP(DP_SELECT, AP_Sel | 0);
+        if (status)
+            goto fail;
+        AP_Bank = 0;
+    }
+
+    if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
+        apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
+        apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
+        status = JTAG_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
         if (status)
             goto fail;
     }
@@ -1456,7 +1894,7 @@ int JTAG_ReadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib)
 int JTAG_ReadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int   status   = 0;
     int   acc_size = 0;
@@ -1494,6 +1932,21 @@ int JTAG_ReadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
         nMany -= 2;
     }
 
+    // Read Data Blocks across R/W Pages with one bulk transfer. If it faults, the
+    // page wise loop below finds the failing address. DHCSR is left to JTAG_ReadBlock.
+    n = nMany & 0xFFFFFFFC;
+    if (n > rwpage - (*nAdr & (rwpage - 1)) && !(*nAdr <= DBG_HCSR && (*nAdr + n) > DBG_HCSR)) {
+        acc_size = 4;
+        status   = JTAG_ReadBulk(*nAdr, pB, n, attrib);
+        if (status == 0) {
+            pB += n;
+            *nAdr += n;
+            nMany -= n;
+        } else if (status != rddi::RDDI_DAP_ERROR_MEMORY && status != EU14) {
+            goto out;
+        }
+    }
+
     // Read Data Block (32-bit Aligned)
     while (nMany >= 4) {
         acc_size = 4;
@@ -1586,7 +2039,7 @@ int JTAG_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib)
 int JTAG_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int   status   = 0;
     int   acc_size = 0;
@@ -1624,6 +2077,21 @@ int JTAG_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
         nMany -= 2;
     }
 
+    // Write Data Blocks across R/W Pages with one bulk transfer. If it faults, the
+    // page wise loop below finds the failing address. DHCSR is left to JTAG_WriteBlock.
+    n = nMany & 0xFFFFFFFC;
+    if (n > rwpage - (*nAdr & (rwpage - 1)) && !(*nAdr <= DBG_HCSR && (*nAdr + n) > DBG_HCSR)) {
+        acc_size = 4;
+        status   = JTAG_WriteBulk(*nAdr, pB, n, attrib);
+        if (status == 0) {
+            pB += n;
+            *nAdr += n;
+            nMany -= n;
+        } else if (status != rddi::RDDI_DAP_ERROR_MEMORY && status != EU14) {
+            goto out;
+        }
+    }
+
     // Write Data Block (32-bit Aligned)
     while (nMany >= 4) {
         acc_size = 4;
@@ -1702,6 +2170,124 @@ out:
 }
 
 
+// JTAG Load Data Bulk (32-bit Elements, may cross R/W Pages)
+// Written with the load packets of RAMLoad_Transfer, DP CTRL/STAT is read once at the end.
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned.
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   return value: error status
+static int JTAG_LoadBulk(DWORD adr, BYTE *pB, DWORD nMany)
+{
+    AS_Guard lk;
+
+    int         status = 0;
+    AP_CONTEXT *apCtx;
+
+    status = AP_Switch(&apCtx);
+    if (status)
+        return (status);
+
+#if DBGCM_V8M
+    status = JTAG_UpdateDSCSR(adr, nMany, BLOCK_SECTYPE_ANY);
+    if (status)
+        return (status);
+
+    status = _UpdateAPSecAttr(BLOCK_SECTYPE_ANY);
+    if (status)
+        return (status);
+#endif // DBGCM_V8M
+
+    do {
+        if (AP_Bank != 0) {
+            status = JTAG_WriteDP(DP_SELECT, AP_Sel | 0);
+            if (status)
+                break;
+            AP_Bank = 0;
+        }
+
+        if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
+            apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
+            apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
+            status = JTAG_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+            if (status)
+                break;
+        }
+
+        status = RAMLoad_Transfer(JTAG_devs.com_no, adr, pB, nMany, AP_CurrentRWPage());
+        if (status) {
+            // The probe stopped at a fault, clear the sticky flag
+            status = (JTAG_StickyError() == rddi::RDDI_DAP_ERROR_MEMORY) ? rddi::RDDI_DAP_ERROR_MEMORY : rddi::RDDI_DAP_ERROR;
+            break;
+        }
+
+        // One sticky error check for all load packets
+        status = JTAG_StickyError();
+    } while (0);
+
+    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+        status = EU14;
+    }
+
+    return (status);
+}
+
+
+// JTAG Load ARM Memory (Program Download to RAM)
+// Word aligned data is written with load packets and one sticky error check, the unaligned
+// head and tail with JTAG_WriteARMMem. On error the caller writes the range again with
+// WriteARMMem to find the failing address.
+//   nAdr   : Start Address (used also to return error addresses)
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes to Write
+//   return value: error status
+int JTAG_LoadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
+{
+    AS_Guard lk;
+
+    int   status = 0;
+    DWORD n;
+
+    // Write unaligned Head
+    n = (4 - (*nAdr & 0x03)) & 0x03;
+    if (n > nMany)
+        n = nMany;
+    if (n) {
+#if DBGCM_V8M
+        status = JTAG_WriteARMMem(nAdr, pB, n, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+        status = JTAG_WriteARMMem(nAdr, pB, n);
+#endif // DBGCM_V8M
+        if (status)
+            return (status);
+        pB += n;
+        nMany -= n;
+    }
+
+    // Write Data Blocks, DHCSR is left to JTAG_WriteARMMem
+    n = nMany & 0xFFFFFFFC;
+    if (n && !(*nAdr <= DBG_HCSR && (*nAdr + n) > DBG_HCSR)) {
+        status = JTAG_LoadBulk(*nAdr, pB, n);
+        if (status)
+            return (status);
+        pB += n;
+        *nAdr += n;
+        nMany -= n;
+    }
+
+    // Write the Rest
+    if (nMany) {
+#if DBGCM_V8M
+        status = JTAG_WriteARMMem(nAdr, pB, nMany, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+        status = JTAG_WriteARMMem(nAdr, pB, nMany);
+#endif // DBGCM_V8M
+    }
+
+    return (status);
+}
+
+
 // JTAG Verify ARM Memory
 //   nAdr   : Start Address (used also to return error addresses)
 //   pB     : Pointer to Buffer
@@ -1715,7 +2301,7 @@ int JTAG_VerifyARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib)
 int JTAG_VerifyARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     // No requirement to how the target memory is verified. Can be for example a combination of 8, 16, and
     // 32 Bit accesses. It is valid to call other access functions implemented in this source file.
@@ -1855,87 +2441,107 @@ int JTAG_GetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, RgARMV8MSE *rsec, U64 mask)
 int JTAG_GetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, U64 mask)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     if (mask == 0)
         return (EU01);
 
     int   status;
-    int   regID[3 * 64];
-    int   regData[3 * 64];
+    int   regID[5 + 3 * 64 + 1];
+    int   regData[5 + 3 * 64 + 1];
     int   i, n, m;
     DWORD val;
 
-    // Match Retry = 100
-    regID[0]   = DAP_REG_MATCH_RETRY;
-    regData[0] = 100;
+    // Setup and register reads are sent with one request
+    for (;;) {
+        // Match Retry = 100
+        regID[0]   = DAP_REG_MATCH_RETRY;
+        regData[0] = 100;
+
+        // Match Mask = S_REGRDY
+        regID[1]   = DAP_REG_MATCH_MASK;
+        regData[1] = S_REGRDY;
+
+        // SELECT = AP_Sel
+        regID[2]   = DAP_DP_REG_APSEL;
+        regData[2] = AP_Sel;
+
+        // TAR = DBG_Addr
+        regID[3]   = DAP_AP_REG_TAR;
+        regData[3] = DBG_Addr;
+
+        // SELECT = AP_Sel | 0x10, DHCSR/DCRSR/DCRDR are accessed through the banked data registers
+        regID[4]   = DAP_DP_REG_APSEL;
+        regData[4] = AP_Sel | 0x10;
+
+        // Prepare Register Access
+        for (i = 5, n = 0; n < 64; n++) {
+            if (mask & (1ULL << n)) {
+                // Get register selector
+                if (n < 21) {
+                    m = n; // Core Registers
+                } else if (n >= 32) {
+                    m = 64 + (n - 32); // FPU Sn
+                } else if (n == 31) {
+                    m = 33; // FPU FPCSR
+                } else {
+                    continue;
+                }
 
-    // Match Mask = 0x00010000
-    regID[1]   = DAP_REG_MATCH_MASK;
-    regData[1] = 0x00010000;
+                // Select register to read (write to DCRSR)
+                regID[i + 0]   = DAP_REG_AP_0x4;
+                regData[i + 0] = m;
+                if (kJTAGRegRdyWait) {
+                    // Read and wait for register ready flag (read DHCSR.16)
+                    regID[i + 1]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
+                    regData[i + 1] = S_REGRDY; // Value to Match
+                } else {
+                    // Read register ready flag (read DHCSR.16), checked below
+                    regID[i + 1] = DAP_REG_AP_0x0 | DAP_REG_RnW;
+                }
+                // Read register value (read DCRDR)
+                regID[i + 2] = DAP_REG_AP_0x8 | DAP_REG_RnW;
 
-    // SELECT = AP_Sel
-    regID[2]   = DAP_DP_REG_APSEL;
-    regData[2] = AP_Sel;
+                i += 3;
+            }
+        }
 
-    // TAR = DBG_Addr
-    regID[3]   = DAP_AP_REG_TAR;
-    regData[3] = DBG_Addr;
+        // skip empty request
+        if (i == 5)
+            return 0;
 
-    // SELECT = AP_Sel | 0x10
-    regID[4]   = DAP_DP_REG_APSEL;
-    regData[4] = AP_Sel | 0x10;
-
-    // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, JTAG_devs.com_no, 5, regID, regData);
-    status = JTAG_CheckStatus(status);
-    if (status) {
-        goto fail;
-    }
+        // DP_CTRL_STAT read
+        regID[i] = DAP_REG_DP_0x4 | DAP_REG_RnW;
 
+        // R/W DAP Registers
+        status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, JTAG_devs.com_no, i + 1, regID, regData);
+        status = JTAG_CheckStatus(status);
+        if (status)
+            goto fail;
 
-    AP_Bank = 0x10;
+        AP_Bank = 0x10;
 
-    // Prepare Register Access
-    for (i = 0, n = 0; n < 64; n++) {
-        if (mask & (1ULL << n)) {
-            // Get register selector
-            if (n < 21) {
-                m = n; // Core Registers
-            } else if (n >= 32) {
-                m = 64 + (n - 32); // FPU Sn
-            } else if (n == 31) {
-                m = 33; // FPU FPCSR
-            } else {
-                continue;
-            }
+        status = JTAG_CheckStickyError(regData[i]);
+        if (status)
+            goto fail;
 
-            // Select register to read (write to DCRSR)
-            regID[i + 0]   = DAP_REG_AP_0x4;
-            regData[i + 0] = m;
-            // Read and wait for register ready flag (read DHCSR.16)
-            regID[i + 1]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
-            regData[i + 1] = 0x00010000; // Value to Match
-            // Read register value (read DCRDR)
-            regID[i + 2] = DAP_REG_AP_0x8 | DAP_REG_RnW;
+        if (kJTAGRegRdyWait)
+            break;
 
-            i += 3;
+        // The core usually completes the transfer before DHCSR is read
+        for (m = 5; m < i; m += 3) {
+            if ((regData[m + 1] & S_REGRDY) == 0)
+                break;
         }
-    }
-
-    // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, JTAG_devs.com_no, i, regID, regData);
-    status = JTAG_CheckStatus(status);
-    if (status)
-        goto fail;
+        if (m >= i)
+            break;
 
-    status = JTAG_StickyError();
-    if (status)
-        goto fail;
+        kJTAGRegRdyWait = TRUE; // Too slow for this debug clock, wait for the flag from now on
+    }
 
     // Store register values
-    for (i = 0, n = 0; n < 64; n++) {
-        if (mask & (1ULL << n)) {
+    for (i = 5, n = 0; n < 64; n++) {
+        if ((mask & (1ULL << n)) && (n < 21 || n >= 31)) {
             val = regData[i + 2];
             i += 3;
             if ((n < 21) && regs) {
@@ -1990,7 +2596,7 @@ int JTAG_SetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, RgARMV8MSE *rsec, U64 mask)
 int JTAG_SetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, U64 mask)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     if (mask == 0)
         return (EU01);
@@ -2087,7 +2693,7 @@ fail:
 //   return value: error status
 int JTAG_SysCallExec(RgARMCM *regs)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int   status;
     int   regID[3 * 16];
@@ -2147,9 +2753,9 @@ int JTAG_SysCallExec(RgARMCM *regs)
         }
     }
 
-    // DHCSR = DBGKEY | C_DEBUGEN
+    // DHCSR = DBGKEY | C_DEBUGEN | DHCSR_MaskIntsSysCall
     regID[i]   = DAP_REG_AP_0x0;
-    regData[i] = DBGKEY | C_DEBUGEN;
+    regData[i] = DBGKEY | C_DEBUGEN | DHCSR_MaskIntsSysCall;
     i++;
 
     // DP_CTRL_STAT read
@@ -2178,7 +2784,7 @@ fail:
 //   return value: error status
 int JTAG_SysCallRes(DWORD *rval)
 {
-    std::lock_guard<std::recursive_mutex> lk(kJTAGOpMutex);
+    AS_Guard lk;
 
     int status;
     int regID[4];
@@ -2244,6 +2850,102 @@ fail:
 }
 
 
+// JTAG Wait for System Call completion and read the Result
+//   The probe reads DHCSR until S_HALT is set (at most SYSCALL_MATCH_RETRY times)
+//   and reads R0 with the same request.
+//   rval   : Pointer to Result Value
+//   done   : Set to TRUE if the System Call completed and *rval is valid
+//   return value: error status
+int JTAG_SysCallWait(DWORD *rval, BOOL *done)
+{
+    AS_Guard lk;
+
+    int   status;
+    int   regID[10];
+    int   regData[10];
+    DWORD val;
+
+    *done = FALSE;
+
+    // Match Retry = SYSCALL_MATCH_RETRY
+    regID[0]   = DAP_REG_MATCH_RETRY;
+    regData[0] = SYSCALL_MATCH_RETRY;
+
+    // Match Mask = S_HALT
+    regID[1]   = DAP_REG_MATCH_MASK;
+    regData[1] = S_HALT;
+
+    // TAR = DBG_Addr
+    regID[2]   = DAP_AP_REG_TAR;
+    regData[2] = DBG_Addr;
+
+    // SELECT = AP_Sel | 0x10
+    regID[3]   = DAP_DP_REG_APSEL;
+    regData[3] = AP_Sel | 0x10;
+
+    // Read and wait for halt (read DHCSR.17)
+    regID[4]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
+    regData[4] = S_HALT; // Value to Match
+
+    // Match Mask = S_REGRDY
+    regID[5]   = DAP_REG_MATCH_MASK;
+    regData[5] = S_REGRDY;
+
+    // Select register R0 to read (write to DCRSR)
+    regID[6]   = DAP_REG_AP_0x4;
+    regData[6] = 0;
+    // Read and wait for register ready flag (read DHCSR.16)
+    regID[7]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
+    regData[7] = S_REGRDY; // Value to Match
+    // Read register value (read DCRDR)
+    regID[8] = DAP_REG_AP_0x8 | DAP_REG_RnW;
+
+    // DP_CTRL_STAT read
+    regID[9] = DAP_REG_DP_0x4 | DAP_REG_RnW;
+
+    // R/W DAP Registers
+    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, JTAG_devs.com_no, 10, regID, regData);
+    status = JTAG_CheckStatus(status);
+
+    AP_Bank = 0x10; // SELECT is written before the wait
+
+    if (status) {
+        // A value mismatch fails the request, check if the core is still running
+#if DBGCM_V8M
+        if (JTAG_ReadD32(DBG_HCSR, &val, BLOCK_SECTYPE_ANY))
+            goto fail;
+#else  // DBGCM_V8M
+        if (JTAG_ReadD32(DBG_HCSR, &val))
+            goto fail;
+#endif // DBGCM_V8M
+        if ((val & S_HALT) == 0)
+            return (0);
+
+        // Halted after the last match retry
+        status = JTAG_SysCallRes(rval);
+        if (status == 0)
+            *done = TRUE;
+        return (status);
+    }
+
+    status = JTAG_CheckStickyError(regData[9]);
+    if (status)
+        goto fail;
+
+
+    *rval = regData[8];
+    *done = TRUE;
+
+fail:
+    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+        return EU14;
+    } else if (status != 0) {
+        return EU01;
+    }
+    return (0);
+}
+
+
 // JTAG Init Debugger
 //   return value: error status
 int JTAG_DebugInit(void)
@@ -2252,6 +2954,8 @@ int JTAG_DebugInit(void)
     DWORD tick;
     DWORD val;
 
+    kJTAGRegRdyWait = FALSE; // Try without waiting, checked with each register read
+
     switch (JTAG_IDCode) {
         case 0x0BA00477: // ARM Cortex-M3
         case 0x0BA80477: // ARM Cortex-M1
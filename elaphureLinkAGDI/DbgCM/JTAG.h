@@ -33,6 +33,8 @@
 
 #include "COLLECT.H"
 
+typedef struct MEM_VECTOR MEM_VECTOR; // Memory Vector Item, see Debug.h
+
 // Public JTAG Instructions
 #define JTAG_EXTEST  0x00
 #define JTAG_SCAN_N  0x02
@@ -187,6 +189,36 @@ extern int JTAG_WriteD8(DWORD adr, BYTE val);
 //   return value: error status
 extern int JTAG_ReadBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib);
 
+// JTAG Read Data Ranges (32-bit Elements)
+//   pAdr    : Array of range start addresses (4-Byte aligned)
+//   pLen    : Array of range lengths in bytes (4-Byte aligned)
+//   pB      : Pointer to Buffer, receives the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+extern int JTAG_ReadRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges);
+
+// JTAG Write Data Ranges (32-bit Elements)
+//   pAdr    : Array of range start addresses (4-Byte aligned)
+//   pLen    : Array of range lengths in bytes (4-Byte aligned)
+//   pB      : Pointer to Buffer, holds the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+extern int JTAG_WriteRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges);
+
+// JTAG Read Data Vector (8/16/32-bit Elements at individual addresses)
+//   pV     : Pointer to Items, 'Addr' and 'Size' are inputs, 'Val' receives the value
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+extern int JTAG_ReadVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);
+
+// JTAG Write Data Vector (8/16/32-bit Elements at individual addresses)
+//   pV     : Pointer to Items, 'Addr', 'Size' and 'Val' are inputs
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+extern int JTAG_WriteVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);
+
 // JTAG Write Data Block (32-bit Elements inside R/W Page Block)
 //   adr    : Address
 //   pB     : Pointer to Buffer
@@ -232,6 +264,13 @@ extern int JTAG_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib);
 extern int JTAG_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany);
 #endif // DBGCM_V8M
 
+// JTAG Load ARM Memory (Program Download to RAM)
+//   nAdr   : Start Address (used also to return error addresses)
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes to Write
+//   return value: error status
+extern int JTAG_LoadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany);
+
 // JTAG Verify ARM Memory
 //   nAdr   : Start Address (used also to return error addresses)
 //   pB     : Pointer to Buffer
@@ -280,6 +319,12 @@ extern int JTAG_SysCallExec(RgARMCM *regs);
 //   return value: error status
 extern int JTAG_SysCallRes(DWORD *rval);
 
+// JTAG Wait for System Call completion and read the Result
+//   rval   : Pointer to Result Value
+//   done   : Set to TRUE if the System Call completed and *rval is valid
+//   return value: error status
+extern int JTAG_SysCallWait(DWORD *rval, BOOL *done);
+
 
 // JTAG Init Debugger
 //   return value: error status
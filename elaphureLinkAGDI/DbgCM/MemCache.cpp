@@ -0,0 +1,239 @@
+﻿/**
+ * @file MemCache.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Page granular target memory cache
+ *
+ * Each page holds 1KB of target memory and one valid bit per byte. A page is only
+ * valid for the cache generation it was filled in, so invalidating the whole cache
+ * after Go/Step is a single increment regardless of how much memory is cached.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+
+#include "MemCache.h"
+
+#include <mutex>
+#include <unordered_map>
+
+
+#define MEMCACHE_PAGE_MASK  (MEMCACHE_PAGE_SIZE - 1)
+#define MEMCACHE_VALID_BITS 32
+#define MEMCACHE_VALID_SIZE (MEMCACHE_PAGE_SIZE / MEMCACHE_VALID_BITS)
+
+struct MEMCACHE_PAGE {
+    DWORD          nPage;                      // page number: address >> MEMCACHE_PAGE_SHIFT
+    DWORD          nGen;                       // generation the valid bits belong to
+    DWORD          valid[MEMCACHE_VALID_SIZE]; // one bit per byte
+    MEMCACHE_PAGE *pPrev;                      // LRU list, head is the most recently used page
+    MEMCACHE_PAGE *pNext;
+    BYTE           data[MEMCACHE_PAGE_SIZE];
+};
+
+
+static std::mutex                                kCacheMutex;
+static std::unordered_map<DWORD, MEMCACHE_PAGE *> kCachePages;
+static MEMCACHE_PAGE                            *kLruHead = NULL;
+static MEMCACHE_PAGE                            *kLruTail = NULL;
+static DWORD                                     kCacheGen = 1;
+
+
+static void LruRemove(MEMCACHE_PAGE *p)
+{
+    if (p->pPrev)
+        p->pPrev->pNext = p->pNext;
+    else
+        kLruHead = p->pNext;
+
+    if (p->pNext)
+        p->pNext->pPrev = p->pPrev;
+    else
+        kLruTail = p->pPrev;
+}
+
+static void LruPushFront(MEMCACHE_PAGE *p)
+{
+    p->pPrev = NULL;
+    p->pNext = kLruHead;
+    if (kLruHead)
+        kLruHead->pPrev = p;
+    else
+        kLruTail = p;
+    kLruHead = p;
+}
+
+
+/*
+ * Find the page for 'nPage'. Pages of an older generation are returned as empty pages.
+ */
+
+static MEMCACHE_PAGE *FindPage(DWORD nPage)
+{
+    auto it = kCachePages.find(nPage);
+    if (it == kCachePages.end()) {
+        return NULL;
+    }
+
+    MEMCACHE_PAGE *p = it->second;
+    if (p->nGen != kCacheGen) {
+        memset(p->valid, 0, sizeof(p->valid));
+        p->nGen = kCacheGen;
+    }
+
+    if (p != kLruHead) {
+        LruRemove(p);
+        LruPushFront(p);
+    }
+    return p;
+}
+
+
+/*
+ * Get the page for 'nPage', reuse the least recently used page if the cache is full.
+ */
+
+static MEMCACHE_PAGE *GetPage(DWORD nPage)
+{
+    MEMCACHE_PAGE *p = FindPage(nPage);
+    if (p) {
+        return p;
+    }
+
+    if (kCachePages.size() >= MEMCACHE_MAX_PAGES) {
+        p = kLruTail;
+        LruRemove(p);
+        kCachePages.erase(p->nPage);
+    } else {
+        p = (MEMCACHE_PAGE *)malloc(sizeof(MEMCACHE_PAGE));
+        if (p == NULL)
+            return NULL;
+    }
+
+    p->nPage = nPage;
+    p->nGen  = kCacheGen;
+    memset(p->valid, 0, sizeof(p->valid));
+
+    kCachePages[nPage] = p;
+    LruPushFront(p);
+    return p;
+}
+
+
+/*
+ * Valid bit handling: 'nOfs' and 'nMany' are byte offset and count within one page.
+ */
+
+static void SetValid(MEMCACHE_PAGE *p, DWORD nOfs, DWORD nMany)
+{
+    DWORD *pV = &p->valid[nOfs / MEMCACHE_VALID_BITS];
+    DWORD  nBit;
+
+    nBit = nOfs % MEMCACHE_VALID_BITS;
+    if (nBit) {
+        DWORD n = min(nMany, MEMCACHE_VALID_BITS - nBit);
+        *pV++ |= ((1UL << n) - 1) << nBit;
+        nMany -= n;
+    }
+    for (; nMany >= MEMCACHE_VALID_BITS; nMany -= MEMCACHE_VALID_BITS) {
+        *pV++ = 0xFFFFFFFF;
+    }
+    if (nMany) {
+        *pV |= (1UL << nMany) - 1;
+    }
+}
+
+static BOOL IsValid(MEMCACHE_PAGE *p, DWORD nOfs, DWORD nMany)
+{
+    const DWORD *pV = &p->valid[nOfs / MEMCACHE_VALID_BITS];
+    DWORD        nBit, nMask;
+
+    nBit = nOfs % MEMCACHE_VALID_BITS;
+    if (nBit) {
+        DWORD n = min(nMany, MEMCACHE_VALID_BITS - nBit);
+        nMask   = ((1UL << n) - 1) << nBit;
+        if ((*pV++ & nMask) != nMask)
+            return (FALSE);
+        nMany -= n;
+    }
+    for (; nMany >= MEMCACHE_VALID_BITS; nMany -= MEMCACHE_VALID_BITS) {
+        if (*pV++ != 0xFFFFFFFF)
+            return (FALSE);
+    }
+    if (nMany) {
+        nMask = (1UL << nMany) - 1;
+        if ((*pV & nMask) != nMask)
+            return (FALSE);
+    }
+    return (TRUE);
+}
+
+
+void MemCacheWrite(DWORD nAdr, const BYTE *pB, DWORD nMany)
+{
+    std::lock_guard<std::mutex> lk(kCacheMutex);
+
+    while (nMany) {
+        DWORD nOfs = nAdr & MEMCACHE_PAGE_MASK;
+        DWORD n    = min(nMany, MEMCACHE_PAGE_SIZE - nOfs);
+
+        MEMCACHE_PAGE *p = GetPage(nAdr >> MEMCACHE_PAGE_SHIFT);
+        if (p == NULL)
+            return;
+
+        memcpy(&p->data[nOfs], pB, n);
+        SetValid(p, nOfs, n);
+
+        nAdr += n; // wraps to 0 at the end of the address space
+        pB += n;
+        nMany -= n;
+    }
+}
+
+
+int MemCacheRead(DWORD nAdr, BYTE *pB, DWORD nMany)
+{
+    std::lock_guard<std::mutex> lk(kCacheMutex);
+
+    while (nMany) {
+        DWORD nOfs = nAdr & MEMCACHE_PAGE_MASK;
+        DWORD n    = min(nMany, MEMCACHE_PAGE_SIZE - nOfs);
+
+        MEMCACHE_PAGE *p = FindPage(nAdr >> MEMCACHE_PAGE_SHIFT);
+        if (p == NULL || !IsValid(p, nOfs, n))
+            return (0); // Cached Data Invalid
+
+        memcpy(pB, &p->data[nOfs], n);
+
+        nAdr += n;
+        pB += n;
+        nMany -= n;
+    }
+    return (1); // Cached Data Valid
+}
+
+
+void MemCacheInvalidate(void)
+{
+    std::lock_guard<std::mutex> lk(kCacheMutex);
+
+    if (++kCacheGen == 0) { // wrapped, make sure no page looks current
+        for (auto &item : kCachePages) {
+            item.second->nGen = 0;
+        }
+        kCacheGen = 1;
+    }
+}
+
+
+void MemCacheFree(void)
+{
+    std::lock_guard<std::mutex> lk(kCacheMutex);
+
+    for (auto &item : kCachePages) {
+        free(item.second);
+    }
+    kCachePages.clear();
+    kLruHead = NULL;
+    kLruTail = NULL;
+}
@@ -0,0 +1,36 @@
+﻿/**
+ * @file MemCache.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Page granular target memory cache
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#define MEMCACHE_PAGE_SHIFT 10
+#define MEMCACHE_PAGE_SIZE  (1UL << MEMCACHE_PAGE_SHIFT) // 1KB, same as RWBlock
+#define MEMCACHE_MAX_PAGES  4096                         // 4MB, least recently used pages are reused
+
+
+/**
+ * @brief Store target memory contents in the cache.
+ */
+extern void MemCacheWrite(DWORD nAdr, const BYTE *pB, DWORD nMany);
+
+/**
+ * @brief Read target memory contents from the cache.
+ *
+ * @return 1: all bytes are valid and copied to pB, 0: at least one byte is not cached
+ */
+extern int MemCacheRead(DWORD nAdr, BYTE *pB, DWORD nMany);
+
+/**
+ * @brief Mark all cached contents as invalid, the pages are kept for reuse.
+ */
+extern void MemCacheInvalidate(void);
+
+/**
+ * @brief Free all cache pages.
+ */
+extern void MemCacheFree(void);
@@ -2650,6 +2650,7 @@ U32 PDSCDebug_InitDriver(void)
             SetARMRegs     = SWD_SetARMRegs;
             SysCallExec    = SWD_SysCallExec;
             SysCallRes     = SWD_SysCallRes;
+            SysCallWait    = SWD_SysCallWait;
             SWJ_Sequence   = SWD_SWJ_Sequence;
             SWJ_Clock      = SWD_SWJ_Clock;
             DAPAbortVal    = SWD_DAPAbortVal;
@@ -2691,6 +2692,7 @@ U32 PDSCDebug_InitDriver(void)
             SetARMRegs     = JTAG_SetARMRegs;
             SysCallExec    = JTAG_SysCallExec;
             SysCallRes     = JTAG_SysCallRes;
+            SysCallWait    = JTAG_SysCallWait;
             SWJ_Sequence   = JTAG_SWJ_Sequence;
             SWJ_Clock      = JTAG_SWJ_Clock;
             DAPAbortVal    = JTAG_DAPAbortVal;
@@ -0,0 +1,258 @@
+﻿/**
+ * @file PeriodicUpdate.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Batched memory reads for the periodic window update while the target is running
+ *
+ * Watch, memory and peripheral views read one variable or register at a time, which costs
+ * one round trip each. The ranges read during an update are recorded. At the start of the
+ * next update they are merged and fetched with ReadRanges(), and the reads of the views are
+ * answered from that snapshot. Ranges no longer read by any view drop out after one update.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+#include "COLLECT.H"
+#include "..\BOM.H"
+#include "Debug.h"
+
+#include "PeriodicUpdate.h"
+#include "AccessScheduler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+
+struct PU_RANGE {
+    DWORD nAdr; // Start address
+    DWORD nLen; // Length in bytes
+    DWORD nOfs; // Offset in the snapshot data
+};
+
+
+static std::mutex            kPUMutex;
+static std::vector<PU_RANGE> kPURequested; // Ranges read since the last update
+static std::vector<PU_RANGE> kPUSnapshot;  // Fetched ranges, sorted by address
+static std::vector<BYTE>     kPUData;      // Data of the fetched ranges
+static std::vector<PU_RANGE> kPUSkipSet;   // SFR ranges the views read when kPUSkipSFR was set
+static DWORD                 kPUTick;       // Time of the fetch
+static DWORD                 kPUGeneration; // Incremented whenever the target memory may have changed
+static BOOL                  kPUValid;      // Snapshot can be used
+static BOOL                  kPUSkipSFR;    // A batch with SFRs failed, e.g. because of the access size
+
+
+static BOOL IsSFR(DWORD nStart, DWORD nEnd)
+{
+    return (nStart <= MonConf.SFREnd && nEnd > MonConf.SFRStart);
+}
+
+
+/*
+ * Word aligned SFR ranges read by the views, sorted and without duplicates.
+ */
+
+static std::vector<PU_RANGE> PeriodicUpdate_SFRSet(const std::vector<PU_RANGE> &ranges)
+{
+    std::vector<PU_RANGE> set;
+
+    for (auto &r : ranges) {
+        DWORD nStart = r.nAdr & ~3UL;
+        DWORD nEnd   = (r.nAdr + r.nLen + 3) & ~3UL;
+
+        if (IsSFR(nStart, nEnd))
+            set.push_back({ nStart, nEnd - nStart, 0 });
+    }
+
+    std::sort(set.begin(), set.end(), [](const PU_RANGE &a, const PU_RANGE &b) {
+        return (a.nAdr != b.nAdr) ? (a.nAdr < b.nAdr) : (a.nLen < b.nLen);
+    });
+    set.erase(std::unique(set.begin(), set.end(), [](const PU_RANGE &a, const PU_RANGE &b) {
+                  return a.nAdr == b.nAdr && a.nLen == b.nLen;
+              }),
+              set.end());
+    return set;
+}
+
+
+static BOOL IsSameSet(const std::vector<PU_RANGE> &a, const std::vector<PU_RANGE> &b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const PU_RANGE &x, const PU_RANGE &y) {
+               return x.nAdr == y.nAdr && x.nLen == y.nLen;
+           });
+}
+
+
+/*
+ * Merge the requested ranges into word aligned fetch ranges.
+ *   bSkipSFR : SFR ranges are left out
+ */
+
+static void PeriodicUpdate_Plan(std::vector<PU_RANGE> &ranges, BOOL bSkipSFR)
+{
+    std::vector<PU_RANGE> merged;
+    DWORD                 nTotal = 0;
+
+    std::sort(ranges.begin(), ranges.end(), [](const PU_RANGE &a, const PU_RANGE &b) {
+        return a.nAdr < b.nAdr;
+    });
+
+    for (auto &r : ranges) {
+        DWORD nStart = r.nAdr & ~3UL;
+        DWORD nEnd   = (r.nAdr + r.nLen + 3) & ~3UL;
+
+        if (bSkipSFR && IsSFR(nStart, nEnd))
+            continue;
+
+        if (!merged.empty()) {
+            PU_RANGE &last     = merged.back();
+            DWORD     nLastEnd = last.nAdr + last.nLen;
+
+            // Fill small gaps, but never read registers no view asked for
+            if (nStart <= nLastEnd || (nStart <= nLastEnd + PU_MERGE_GAP && !IsSFR(nLastEnd, nStart))) {
+                if (nEnd > nLastEnd) {
+                    DWORD nGrow = nEnd - nLastEnd;
+                    if (nTotal + nGrow > PU_MAX_BYTES)
+                        break;
+                    last.nLen += nGrow;
+                    nTotal += nGrow;
+                }
+                continue;
+            }
+        }
+
+        if (merged.size() >= PU_MAX_RANGES || nTotal + (nEnd - nStart) > PU_MAX_BYTES)
+            break;
+        merged.push_back({ nStart, nEnd - nStart, nTotal });
+        nTotal += nEnd - nStart;
+    }
+
+    ranges.swap(merged);
+}
+
+
+/*
+ * The lock is only held to take the requested ranges and to publish the result,
+ * so the views are not blocked while the batch is on the way. A snapshot is
+ * dropped if the target memory may have changed during the fetch.
+ */
+
+void PeriodicUpdate_Begin(void)
+{
+    std::vector<PU_RANGE> ranges, sfr;
+    std::vector<DWORD>    adr, len;
+    std::vector<BYTE>     data;
+    DWORD                 generation;
+    BOOL                  bSkipSFR;
+    int                   status, prio;
+
+    {
+        std::lock_guard<std::mutex> lk(kPUMutex);
+        ranges.swap(kPURequested);
+        kPUValid = FALSE;
+
+        // Another view set may read SFRs which can be batched
+        sfr = PeriodicUpdate_SFRSet(ranges);
+        if (kPUSkipSFR && !ranges.empty() && !IsSameSet(sfr, kPUSkipSet)) {
+            kPUSkipSFR = FALSE;
+            kPUSkipSet.clear();
+        }
+        bSkipSFR   = kPUSkipSFR;
+        generation = kPUGeneration;
+    }
+
+    if (ranges.empty() || ReadRanges == NULL)
+        return;
+
+    PeriodicUpdate_Plan(ranges, bSkipSFR);
+    if (ranges.empty())
+        return;
+
+    for (auto &r : ranges) {
+        adr.push_back(r.nAdr);
+        len.push_back(r.nLen);
+    }
+    data.resize(ranges.back().nOfs + ranges.back().nLen);
+
+    prio   = AS_SetThreadPriority(AS_PRIO_BACKGROUND); // Debugger requests go first
+    status = ReadRanges(adr.data(), len.data(), data.data(), (DWORD)ranges.size());
+    AS_SetThreadPriority(prio);
+
+    std::lock_guard<std::mutex> lk(kPUMutex);
+
+    if (generation != kPUGeneration)
+        return;
+
+    if (status) {
+        // Views read the target themselves and report the error
+        for (auto &r : ranges) {
+            if (IsSFR(r.nAdr, r.nAdr + r.nLen)) {
+                kPUSkipSFR = TRUE;
+                kPUSkipSet = sfr;
+            }
+        }
+        return;
+    }
+
+    kPUSnapshot.swap(ranges);
+    kPUData.swap(data);
+    kPUTick  = GetTickCount();
+    kPUValid = TRUE;
+}
+
+
+int PeriodicUpdate_Read(DWORD nAdr, BYTE *pB, DWORD nMany)
+{
+    std::lock_guard<std::mutex> lk(kPUMutex);
+
+    if (nMany == 0 || nAdr + nMany - 1 < nAdr) {
+        return (0);
+    }
+    if (nAdr + nMany > PPBAddr) {
+        return (0); // Debug registers are always read directly
+    }
+
+    if (kPURequested.size() < PU_MAX_RANGES * 2) {
+        kPURequested.push_back({ nAdr, nMany, 0 });
+    }
+
+    if (!kPUValid || (GetTickCount() - kPUTick) > PU_SNAPSHOT_TIME) {
+        return (0);
+    }
+
+    // Last snapshot range starting at or below nAdr
+    auto it = std::upper_bound(kPUSnapshot.begin(), kPUSnapshot.end(), nAdr, [](DWORD a, const PU_RANGE &r) {
+        return a < r.nAdr;
+    });
+    if (it == kPUSnapshot.begin()) {
+        return (0);
+    }
+    --it;
+    if (nAdr + nMany > it->nAdr + it->nLen) {
+        return (0);
+    }
+
+    memcpy(pB, &kPUData[it->nOfs + (nAdr - it->nAdr)], nMany);
+    return (1);
+}
+
+
+void PeriodicUpdate_Invalidate(void)
+{
+    std::lock_guard<std::mutex> lk(kPUMutex);
+
+    kPUValid = FALSE;
+    kPUGeneration++;
+}
+
+
+void PeriodicUpdate_Reset(void)
+{
+    std::lock_guard<std::mutex> lk(kPUMutex);
+
+    kPUValid = FALSE;
+    kPUGeneration++;
+    kPURequested.clear();
+    kPUSkipSFR = FALSE; // The SFRs may be accessible after the reset
+    kPUSkipSet.clear();
+}
@@ -0,0 +1,38 @@
+﻿/**
+ * @file PeriodicUpdate.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Batched memory reads for the periodic window update while the target is running
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#define PU_MAX_RANGES    128  // Ranges fetched per update
+#define PU_MAX_BYTES     8192 // Bytes fetched per update
+#define PU_MERGE_GAP     32   // Ranges closer than this are fetched as one range
+#define PU_SNAPSHOT_TIME 400  // Time in ms a snapshot is used to answer reads
+
+
+/**
+ * @brief Start of a periodic update: fetch all ranges the views read during the
+ *        previous update with one batch and keep them as a snapshot.
+ */
+extern void PeriodicUpdate_Begin(void);
+
+/**
+ * @brief Answer a memory read while the target is running. The range is recorded for the next update.
+ *
+ * @return 1: data copied from the snapshot, 0: the range must be read from the target
+ */
+extern int PeriodicUpdate_Read(DWORD nAdr, BYTE *pB, DWORD nMany);
+
+/**
+ * @brief Drop the snapshot, e.g. after a memory write or when execution stops.
+ */
+extern void PeriodicUpdate_Invalidate(void);
+
+/**
+ * @brief Forget the recorded ranges and retry batched SFR reads, e.g. after a target reset or reconnect.
+ */
+extern void PeriodicUpdate_Reset(void);
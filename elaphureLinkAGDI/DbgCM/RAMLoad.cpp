@@ -0,0 +1,248 @@
+﻿/**
+ * @file RAMLoad.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Program download to RAM with load packets and CRC verify on the target
+ *
+ * Images of load-and-run configurations are written to RAM while the target is halted.
+ * The generic write path sends DAP_Transfer requests: 5 bytes per word, at most 255
+ * registers per request and a TAR write at each R/W page. A load packet instead holds
+ * DAP_TransferBlock writes: TAR and the DRW words up to the next page boundary, as many
+ * pages as fit into the MTU, inside one DAP_ExecuteCommands. So each round trip carries
+ * about 340 words, and the sticky error is checked once for the whole image.
+ *
+ * The load packets of one CMSIS_DAP_Commands() call are sent one after the other, each
+ * waits for its response: the RDDI link carries one request at a time. The gain comes from
+ * the packing, not from overlapping the round trips.
+ *
+ * The loaded image is verified with the CRC of the flash download. The CRC function runs
+ * in the RAM for Algorithm with masked interrupts while the host calculates its CRC, only
+ * the CRC value goes over the link.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+#include "COLLECT.H"
+#include "..\BOM.H"
+#include "Debug.h"
+#include "Flash.h"
+#include "rddi_dll.hpp"
+#include "dap.hpp"
+#include "AccessScheduler.h"
+
+#include "RAMLoad.h"
+
+#include <future>
+
+
+#define RL_PACKET_SIZE  1400 // Load packet size, one request must fit into the 1400 bytes MTU
+#define RL_PACKETS      16   // Load packets per CMSIS_DAP_Commands() call
+#define RL_BLOCK_HEADER 5    // DAP_TransferBlock: command, DAP index, transfer count, request
+#define RL_REQ_TAR      0x05 // Transfer request: AP write, A[3:2] of TAR
+#define RL_REQ_DRW      0x0D // Transfer request: AP write, A[3:2] of DRW
+
+#define RL_CRC_MIN     0x2000     // Smaller ranges are verified faster by the pushed verify
+#define RL_CRC_SIZE    0x80       // RAM used by the CRC verify: function, breakpoint and stack
+#define RL_CRC_BKPT    0x20       // Offset of the breakpoint, exit point of the function
+#define RL_CRC_REGS    0x0001FFFF // R0..R15 and xPSR, restored after the function
+#define RL_CRC_TIMEOUT 10000      // Timeout of the CRC function in ms
+
+
+static BYTE kRLPacket[RL_PACKETS][RL_PACKET_SIZE];
+
+
+static void RL_PutWord(BYTE *p, DWORD val)
+{
+    p[0] = (BYTE)val;
+    p[1] = (BYTE)(val >> 8);
+    p[2] = (BYTE)(val >> 16);
+    p[3] = (BYTE)(val >> 24);
+}
+
+
+static void RL_PutBlock(BYTE *p, int dap, DWORD count, BYTE request)
+{
+    p[0] = ID_DAP_TransferBlock;
+    p[1] = (BYTE)dap;
+    p[2] = (BYTE)count;
+    p[3] = (BYTE)(count >> 8);
+    p[4] = request;
+}
+
+
+int RAMLoad_Transfer(int dap, DWORD adr, const BYTE *pB, DWORD nMany, DWORD rwpage)
+{
+    AS_Guard lk;
+
+    BYTE *req[RL_PACKETS];
+    BYTE *res[RL_PACKETS];
+    int   req_len[RL_PACKETS];
+    int   res_len[RL_PACKETS];
+    BYTE *p;
+    DWORD n, m;
+    int   num, len, cmd;
+    int   status;
+
+    if ((adr & 0x03) || (nMany & 0x03))
+        return (RDDI_BADARG);
+
+    while (nMany) {
+        num = 0;
+        do {
+            p   = kRLPacket[num];
+            len = 2;
+            cmd = 0;
+
+            // TAR block and DRW block with at least one word
+            while (nMany && len + 2 * RL_BLOCK_HEADER + 8 <= RL_PACKET_SIZE) {
+                n = rwpage - (adr & (rwpage - 1));                         // up to the page boundary
+                m = (RL_PACKET_SIZE - len - 2 * RL_BLOCK_HEADER - 4) & ~3; // room left in the packet
+                if (n > m)
+                    n = m;
+                if (n > nMany)
+                    n = nMany;
+
+                RL_PutBlock(&p[len], dap, 1, RL_REQ_TAR);
+                RL_PutWord(&p[len + RL_BLOCK_HEADER], adr);
+                len += RL_BLOCK_HEADER + 4;
+
+                RL_PutBlock(&p[len], dap, n >> 2, RL_REQ_DRW);
+                memcpy(&p[len + RL_BLOCK_HEADER], pB, n);
+                len += RL_BLOCK_HEADER + n;
+
+                cmd += 2;
+                adr += n;
+                pB += n;
+                nMany -= n;
+            }
+
+            p[0]         = ID_DAP_ExecuteCommands;
+            p[1]         = (BYTE)cmd;
+            req[num]     = p;
+            req_len[num] = len;
+            res[num]     = NULL; // Load packets return no data
+            res_len[num] = 0;
+            num++;
+        } while (nMany && num < RL_PACKETS);
+
+        status = rddi::CMSIS_DAP_Commands(rddi::k_rddi_handle, num, req, req_len, res, res_len);
+        if (status)
+            return (status);
+    }
+
+    return (RDDI_SUCCESS);
+}
+
+
+int RAMLoad_VerifyCRC(DWORD adr, BYTE *pB, DWORD nMany, BOOL *pMatch)
+{
+    AS_Guard lk;
+
+    std::future<DWORD> crc;
+    RgARMCM            save, regs;
+    BYTE               ram[RL_CRC_SIZE];
+    BYTE               code[RL_CRC_SIZE];
+    DWORD              start, a, rval, tick, dhcsr;
+    BOOL               done;
+    int                status, st;
+
+    *pMatch = FALSE;
+
+    start = FlashConf.RAMStart;
+    if (nMany < RL_CRC_MIN || FlashConf.RAMSize < RL_CRC_SIZE || (start & 0x07))
+        return (0);
+    if (adr < start + RL_CRC_SIZE && start < adr + nMany)
+        return (0); // The CRC function would overwrite the data to check
+
+    crc = std::async(std::launch::async, CRC32, pB, nMany);
+
+    // Save DHCSR, the RAM and the core registers used by the CRC function
+    a = start;
+#if DBGCM_V8M
+    status = ReadD32(DBG_HCSR, &dhcsr, BLOCK_SECTYPE_ANY);
+    if (status == 0)
+        status = ReadARMMem(&a, ram, RL_CRC_SIZE, BLOCK_SECTYPE_ANY);
+    if (status == 0)
+        status = GetARMRegs(&save, NULL, NULL, RL_CRC_REGS);
+#else  // DBGCM_V8M
+    status = ReadD32(DBG_HCSR, &dhcsr);
+    if (status == 0)
+        status = ReadARMMem(&a, ram, RL_CRC_SIZE);
+    if (status == 0)
+        status = GetARMRegs(&save, NULL, RL_CRC_REGS);
+#endif // DBGCM_V8M
+    if (status)
+        return (status);
+
+    memset(code, 0, sizeof(code));
+    memcpy(code, CRC32_ARM, sizeof(CRC32_ARM));
+    code[RL_CRC_BKPT]     = 0x00; // BKPT 0
+    code[RL_CRC_BKPT + 1] = 0xBE;
+
+    // No interrupt handler may run on the core while the function runs. MASKINTS
+    // can only be changed while the core is halted, so it is set before the start.
+    a = start;
+#if DBGCM_V8M
+    status = WriteARMMem(&a, code, RL_CRC_SIZE, BLOCK_SECTYPE_ANY);
+    if (status == 0)
+        status = WriteD32(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT | C_MASKINTS, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+    status = WriteARMMem(&a, code, RL_CRC_SIZE);
+    if (status == 0)
+        status = WriteD32(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT | C_MASKINTS);
+#endif // DBGCM_V8M
+
+    done = FALSE;
+    if (status == 0) {
+        regs      = save;
+        regs.A1   = CRC_InitVal;                  // R0: Initial CRC Value
+        regs.A2   = adr;                          // R1: Block Start Address
+        regs.A3   = nMany;                        // R2: Block Size
+        regs.A4   = CRC_Polynom;                  // R3: CRC Polynom Value
+        regs.PC   = start | 1;                    // PC: Entry Point
+        regs.LR   = (start + RL_CRC_BKPT) | 1;    // LR: Exit Point
+        regs.SP   = start + RL_CRC_SIZE;          // SP: Stack Pointer
+        regs.xPSR = 0x01000000;                   // xPSR: T = 1, ISR = 0
+
+        DHCSR_MaskIntsSysCall = C_MASKINTS;
+        status                = SysCallExec(&regs);
+        DHCSR_MaskIntsSysCall = 0;
+        tick                  = GetTickCount();
+        while (status == 0) {
+            status = SysCallWait(&rval, &done);
+            if (status || done)
+                break;
+            if ((GetTickCount() - tick) > RL_CRC_TIMEOUT) {
+#if DBGCM_V8M
+                status = WriteD32(DBG_HCSR, DBGKEY | C_HALT | C_DEBUGEN | C_MASKINTS, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+                status = WriteD32(DBG_HCSR, DBGKEY | C_HALT | C_DEBUGEN | C_MASKINTS);
+#endif // DBGCM_V8M
+                break; // No CRC, verified by read back
+            }
+        }
+    }
+
+    // Restore the RAM, the core registers and DHCSR, the core stays halted
+    a = start;
+#if DBGCM_V8M
+    st = WriteARMMem(&a, ram, RL_CRC_SIZE, BLOCK_SECTYPE_ANY);
+    if (st == 0)
+        st = SetARMRegs(&save, NULL, NULL, RL_CRC_REGS);
+    if (st == 0)
+        st = WriteD32(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT | (dhcsr & (C_MASKINTS | C_SNAPSTALL)), BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+    st = WriteARMMem(&a, ram, RL_CRC_SIZE);
+    if (st == 0)
+        st = SetARMRegs(&save, NULL, RL_CRC_REGS);
+    if (st == 0)
+        st = WriteD32(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT | (dhcsr & (C_MASKINTS | C_SNAPSTALL)));
+#endif // DBGCM_V8M
+    if (status == 0)
+        status = st;
+
+    if (status == 0 && done)
+        *pMatch = (rval == crc.get());
+
+    return (status);
+}
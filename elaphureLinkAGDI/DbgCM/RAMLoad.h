@@ -0,0 +1,36 @@
+﻿/**
+ * @file RAMLoad.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Program download to RAM with load packets and CRC verify on the target
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+
+/**
+ * @brief Write word aligned data with DAP_ExecuteCommands load packets. Each packet holds
+ *        DAP_TransferBlock writes of TAR and DRW up to the next R/W page boundary, several
+ *        packets go out with one CMSIS_DAP_Commands() call, one after the other. The sticky error is not
+ *        checked, the caller reads DP CTRL/STAT once after the whole image. The AP, bank 0
+ *        and a 32-bit auto increment CSW must be selected already.
+ *
+ * @param dap DAP index of the transfers
+ * @param adr start address, 4-Byte aligned
+ * @param nMany number of bytes, 4-Byte aligned
+ * @param rwpage TAR auto increment page
+ * @return RDDI status
+ */
+extern int RAMLoad_Transfer(int dap, DWORD adr, const BYTE *pB, DWORD nMany, DWORD rwpage);
+
+/**
+ * @brief Verify loaded data with a CRC calculated by the target while the host calculates
+ *        its CRC. The CRC function runs in the RAM for Algorithm with masked interrupts,
+ *        that RAM, the core registers and DHCSR are restored afterwards. The target must be halted.
+ *
+ * @param pMatch receives TRUE if the CRC matches. FALSE if it does not match or if the
+ *        CRC is not available: small range, no RAM for Algorithm or the range overlaps it
+ * @return 0: OK, else error code
+ */
+extern int RAMLoad_VerifyCRC(DWORD adr, BYTE *pB, DWORD nMany, BOOL *pMatch);
@@ -110,6 +110,8 @@ SWD_SysCallRes: Returns the result of the SysCall (register R0).
 #include "SWD.h"
 #include "..\BOM.h"
 #include "rddi_dll.hpp"
+#include "AccessScheduler.h"
+#include "RAMLoad.h"
 
 #if DBGCM_DBG_DESCRIPTION
 #include "PDSCDebug.h"
@@ -119,14 +121,20 @@ SWD_SysCallRes: Returns the result of the SysCall (register R0).
 #include "DSMonitor.h"
 #endif // DBGCM_DS_MONITOR
 #include <cassert>
-#include <mutex>
 
 DWORD SWD_IDCode; // SWD ID Code
 
-static std::recursive_mutex kSWDOpMutex;
+static DWORD kSWDAbortPending; // ABORT bits written speculatively with the next DAP request
+static BOOL  kSWDRegRdyWait;   // Wait for DHCSR.S_REGRDY when reading core registers
+static int   kSWDRegPrefix;    // Registers SWD_RegAccessBlock put in front of the last request
+
+#define BULK_BATCH_SIZE     255  // DAP registers per request of SWD_TransferRanges (8-bit transfer count)
+#define VECTOR_BATCH_SIZE   200  // DAP registers per request of SWD_ReadVector/SWD_WriteVector
+#define SYSCALL_MATCH_RETRY 2000 // DHCSR reads of the probe per SWD_SysCallWait request
 
-#if DBGCM_V8M
 // Forward declarations
+static int SWD_TransferRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges, BYTE attrib, BOOL bWrite);
+#if DBGCM_V8M
 static int SWD_UpdateDSCSR(DWORD adr, DWORD many, BYTE attrib);
 #endif // DBGCM_V8M
 
@@ -201,9 +209,8 @@ int SWD_CheckStatus(int status)
     }
     if (status == RDDI_DAP_DP_STICKY_ERR) {
         // Only for SW (not availalbe for JTAG)
-        status = SWD_DAPAbortVal(STKERRCLR | WDERRCLR);
-        if (status)
-            return (status);
+        // Sticky flags are cleared with the next DAP request
+        kSWDAbortPending |= STKERRCLR | WDERRCLR;
         return (rddi::RDDI_DAP_ERROR_MEMORY);
     }
     if (status)
@@ -214,12 +221,9 @@ int SWD_CheckStatus(int status)
 
 static int SWD_CheckStickyError(DWORD dp_stat)
 {
-    int status;
-
     if (dp_stat & (STICKYERR | WDATAERR)) {
-        status = SWD_DAPAbortVal(STKERRCLR | WDERRCLR);
-        if (status)
-            return (status);
+        // Sticky flags are cleared with the next DAP request
+        kSWDAbortPending |= STKERRCLR | WDERRCLR;
         return (rddi::RDDI_DAP_ERROR_MEMORY);
     }
 
@@ -240,6 +244,77 @@ static int SWD_StickyError(void)
 }
 
 
+// Write the pending ABORT bits of a previous error, for accesses that cannot carry them
+//   return value: RDDI status
+static int SWD_AbortPending(void)
+{
+    int status;
+
+    if (kSWDAbortPending == 0)
+        return (RDDI_SUCCESS);
+
+    status = rddi::DAP_WriteReg(rddi::k_rddi_handle, 0, DAP_REG_DP_ABORT, kSWDAbortPending);
+    if (status == RDDI_SUCCESS)
+        kSWDAbortPending = 0;
+
+    return (status);
+}
+
+
+// R/W DAP Registers, the pending ABORT bits of a previous error are written
+// at the start of the same request
+//   nReg    : Number of DAP registers
+//   regID   : DAP register IDs
+//   regData : DAP register values
+//   return value: RDDI status
+static int SWD_RegAccessBlock(int nReg, int *regID, int *regData)
+{
+    int status;
+    int abortID[BULK_BATCH_SIZE];
+    int abortData[BULK_BATCH_SIZE];
+
+    kSWDRegPrefix = 0;
+    if (kSWDAbortPending == 0)
+        return (rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, nReg, regID, regData));
+
+    if (nReg + 1 > BULK_BATCH_SIZE) {
+        status = SWD_AbortPending();
+        if (status)
+            return (status);
+        return (rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, nReg, regID, regData));
+    }
+
+    // ABORT is DP register 0x0 for writes
+    abortID[0]   = DAP_REG_DP_0x0;
+    abortData[0] = kSWDAbortPending;
+    memcpy(&abortID[1], regID, nReg * sizeof(int));
+    memcpy(&abortData[1], regData, nReg * sizeof(int));
+
+    kSWDRegPrefix = 1;
+    status        = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, nReg + 1, abortID, abortData);
+    if (status == RDDI_SUCCESS || status == RDDI_DAP_DP_STICKY_ERR)
+        kSWDAbortPending = 0; // ABORT is written first
+
+    memcpy(regData, &abortData[1], nReg * sizeof(int));
+
+    return (status);
+}
+
+
+// Registers of the last failed SWD_RegAccessBlock that the probe completed
+//   return : number of registers before the failing one, -1 if not known
+static int SWD_RegAccessDone(void)
+{
+    int nDone;
+
+    if (rddi::DAP_GetRegAccessDone(rddi::k_rddi_handle, &nDone) != RDDI_SUCCESS)
+        return (-1);
+    if (nDone < kSWDRegPrefix)
+        return (-1); // ABORT write failed
+    return (nDone - kSWDRegPrefix);
+}
+
+
 //   adr    : Address
 //   val    : Pointer to Value
 //   return : 0 - Success, else Error Code
@@ -257,7 +332,7 @@ static int SWD_ReadData(DWORD adr, DWORD *val)
     regID[1] = DAP_AP_REG_DRW | DAP_REG_RnW;
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, 2, regID, regData);
+    status = SWD_RegAccessBlock(2, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         return (status);
@@ -286,7 +361,7 @@ static int SWD_WriteData(DWORD adr, DWORD val)
     regData[1] = val;
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, 2, regID, regData);
+    status = SWD_RegAccessBlock(2, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         return (status);
@@ -310,7 +385,7 @@ int SWD_DAPAbort(void)
 //   return value: error status
 int SWD_ReadDP(BYTE adr, DWORD *val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
 #if DBGCM_DBG_DESCRIPTION
     int status = 0, pstatus = 0, retry_count = 1;
@@ -318,8 +393,10 @@ int SWD_ReadDP(BYTE adr, DWORD *val)
 
     // Read DP Register
     do {
-        status = rddi::DAP_ReadReg(rddi::k_rddi_handle, 0,
-                                   DAP_REG_DP_0x0 + (adr >> 2), (int *)val);
+        status = SWD_AbortPending();
+        if (status == RDDI_SUCCESS)
+            status = rddi::DAP_ReadReg(rddi::k_rddi_handle, 0,
+                                       DAP_REG_DP_0x0 + (adr >> 2), (int *)val);
         status = SWD_CheckStatus(status);
         if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
             if (retry_count == 0)
@@ -359,14 +436,16 @@ int SWD_ReadDP(BYTE adr, DWORD *val)
 //   return value: error status
 int SWD_WriteDP(BYTE adr, DWORD val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int status = 0, retry_count = 1;
 
     // Read DP Register
     do {
-        status = rddi::DAP_WriteReg(rddi::k_rddi_handle, 0,
-                                    DAP_REG_DP_0x0 + (adr >> 2), val);
+        status = SWD_AbortPending();
+        if (status == RDDI_SUCCESS)
+            status = rddi::DAP_WriteReg(rddi::k_rddi_handle, 0,
+                                        DAP_REG_DP_0x0 + (adr >> 2), val);
         status = SWD_CheckStatus(status);
         if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
             if (retry_count == 0)
@@ -392,7 +471,7 @@ int SWD_WriteDP(BYTE adr, DWORD val)
 //   return value: error status
 int SWD_ReadAP(BYTE adr, DWORD *val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
 #if DBGCM_DBG_DESCRIPTION
     int status = 0, pstatus = 0;
@@ -407,8 +486,10 @@ int SWD_ReadAP(BYTE adr, DWORD *val)
     }
 
     // Read AP Register
-    status = rddi::DAP_ReadReg(rddi::k_rddi_handle, 0,
-                               DAP_REG_AP_0x0 + ((adr & 0x0F) >> 2), (int *)val);
+    status = SWD_AbortPending();
+    if (status == RDDI_SUCCESS)
+        status = rddi::DAP_ReadReg(rddi::k_rddi_handle, 0,
+                                   DAP_REG_AP_0x0 + ((adr & 0x0F) >> 2), (int *)val);
     status = SWD_CheckStatus(status);
     if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
         return EU14;
@@ -439,7 +520,7 @@ int SWD_ReadAP(BYTE adr, DWORD *val)
 //   return value: error status
 int SWD_WriteAP(BYTE adr, DWORD val)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int status;
 
@@ -454,8 +535,10 @@ int SWD_WriteAP(BYTE adr, DWORD val)
     adr &= 0x0F;
 
     // Write AP Register
-    status = rddi::DAP_WriteReg(rddi::k_rddi_handle, rddi::k_rddi_if_index,
-                                DAP_REG_AP_0x0 + (adr >> 2), val);
+    status = SWD_AbortPending();
+    if (status == RDDI_SUCCESS)
+        status = rddi::DAP_WriteReg(rddi::k_rddi_handle, rddi::k_rddi_if_index,
+                                    DAP_REG_AP_0x0 + (adr >> 2), val);
     status = SWD_CheckStatus(status);
     if (status)
         return (status);
@@ -518,7 +601,7 @@ int SWD_ReadD32(DWORD adr, DWORD *val, BYTE attrib)
 int SWD_ReadD32(DWORD adr, DWORD *val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -649,7 +732,7 @@ int SWD_ReadD16(DWORD adr, WORD *val, BYTE attrib)
 int SWD_ReadD16(DWORD adr, WORD *val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     // #if DBGCM_DBG_DESCRIPTION || DBGCM_V8M
     int   status = 0;
@@ -741,7 +824,7 @@ int SWD_ReadD8(DWORD adr, BYTE *val, BYTE attrib)
 int SWD_ReadD8(DWORD adr, BYTE *val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     // #if DBGCM_DBG_DESCRIPTION || DBGCM_V8M
     int   status = 0;
@@ -836,7 +919,7 @@ int SWD_WriteD32(DWORD adr, DWORD val, BYTE attrib)
 int SWD_WriteD32(DWORD adr, DWORD val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -904,7 +987,7 @@ int SWD_WriteD16(DWORD adr, WORD val, BYTE attrib)
 int SWD_WriteD16(DWORD adr, WORD val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -973,7 +1056,7 @@ int SWD_WriteD8(DWORD adr, BYTE val, BYTE attrib)
 int SWD_WriteD8(DWORD adr, BYTE val)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int         status = 0;
     AP_CONTEXT *apCtx;
@@ -1040,11 +1123,10 @@ int SWD_WriteD8(DWORD adr, BYTE val)
 //   return value: error status
 int SWD_ReadBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
-    int         status = 0;
-    AP_CONTEXT *apCtx;
-    DWORD       rwpage;
+    int   status = 0;
+    DWORD rwpage;
 
 #if DBGCM_DBG_DESCRIPTION || DBGCM_DS_MONITOR
     int pstatus = 0;
@@ -1077,59 +1159,8 @@ int SWD_ReadBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
         }
     }
 
-    // 27.06.2019: Updated AP handling
-    status = AP_Switch(&apCtx);
-    if (status)
-        goto end;
-
-#if DBGCM_V8M
-    status = SWD_UpdateDSCSR(adr, nMany, attrib);
-    if (status)
-        goto end;
-
-    status = _UpdateAPSecAttr(attrib);
-    if (status)
-        goto end;
-#endif // DBGCM_V8M
-
-    assert(attrib == 0);
-
-    do {
-        if (AP_Bank != 0) {
-            status = SWD_WriteDP(DP_SELECT, AP_Sel | 0);
-            if (status)
-                break;
-            AP_Bank = 0;
-        }
-
-        if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
-            apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
-            apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
-            status = SWD_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
-            if (status)
-                break;
-        }
-
-        status = SWD_WriteAP(AP_TAR, adr);
-        if (status)
-            break;
-
-        // Multiple Read AP DRW
-        status = rddi::DAP_RegReadRepeat(rddi::k_rddi_handle, 0,
-                                         nMany >> 2, DAP_AP_REG_DRW, (int *)pB);
-        status = SWD_CheckStatus(status);
-        if (status)
-            break;
-
-        status = SWD_StickyError();
-        if (status)
-            break;
-    } while (0);
-
-
-    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
-        status = EU14;
-    }
+    // AP handling, TAR, DRW and the sticky error check with as few DAP requests as possible
+    status = SWD_TransferRanges(&adr, &nMany, pB, 1, attrib, FALSE);
 
     // See "Setting up target memory accesses based on AP_Context" above in this file for how
     // to construct the AP CSW value to write.
@@ -1178,51 +1209,75 @@ end:
 }
 
 
-// SWD Write Data Block (32-bit Elements inside R/W Page Block)
-// Block parameters 'adr' and 'nMany' must be 4-Byte aligned to allow an efficient implementation.
-//   adr    : Address
-//   pB     : Pointer to Buffer
-//   nMany  : Number of bytes
-//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
-//   return value: error status
-int SWD_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+// Execute the DAP requests collected by SWD_TransferRanges and store the DRW and CTRL/STAT read values
+static int SWD_TransferRangesFlush(int nReg, int *regID, int *regData, BYTE **pData)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    int status, k;
 
-    // #if DBGCM_V8M
-    int status = 0;
-    // #endif // DBGCM_V8M
+    // R/W DAP Registers
+    status = SWD_RegAccessBlock(nReg, regID, regData);
+    status = SWD_CheckStatus(status);
+    if (status)
+        return (status);
 
-    AP_CONTEXT *apCtx;
-    DWORD       rwpage;
+    for (k = 0; k < nReg; k++) {
+        if (pData[k])
+            memcpy(pData[k], &regData[k], 4);
+    }
 
-    if (nMany == 0)
-        return (EU01);
-    if (nMany & 0x03)
-        return (EU01);
-    // if (nMany > RWPage) return (EU01);
+    return (0);
+}
 
-    if (!(attrib & BLOCK_NADDRINC)) {
-        rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
-        if (nMany > rwpage)
+
+// SWD Read/Write Data Ranges (32-bit Elements)
+// Transfers several address ranges with as few DAP requests as possible. Each request packs TAR writes
+// and DRW accesses of many ranges, TAR is reloaded at every auto-increment page boundary, so a range
+// may cross R/W pages. DP CTRL/STAT is read with the last request to check the sticky error, so a
+// transfer that fits into one request costs a single round trip.
+// Range addresses and lengths must be 4-Byte aligned.
+//   pAdr    : Array of range start addresses
+//   pLen    : Array of range lengths in bytes
+//   pB      : Pointer to Buffer, holds the data of all ranges back to back
+//   nRanges : Number of ranges
+//   attrib  : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   bWrite  : FALSE - Read, TRUE - Write
+//   return value: error status
+static int SWD_TransferRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges, BYTE attrib, BOOL bWrite)
+{
+    AS_Guard lk;
+
+    int         status = 0;
+    AP_CONTEXT *apCtx;
+    DWORD       rwpage, adr, n, i;
+    DWORD       dp_stat = 0;
+    int         nReg;
+    int         regID[BULK_BATCH_SIZE];
+    int         regData[BULK_BATCH_SIZE];
+    BYTE       *pData[BULK_BATCH_SIZE];
+
+    for (i = 0; i < nRanges; i++) {
+        if ((pAdr[i] & 0x03) || (pLen[i] & 0x03))
             return (EU01);
     }
 
-    // 27.06.2019: Updated AP handling
     status = AP_Switch(&apCtx);
     if (status)
         return (status);
 
 #if DBGCM_V8M
-    status = SWD_UpdateDSCSR(adr, nMany, attrib);
-    if (status)
-        return (status);
+    for (i = 0; i < nRanges; i++) {
+        status = SWD_UpdateDSCSR(pAdr[i], pLen[i], attrib);
+        if (status)
+            return (status);
+    }
 
     status = _UpdateAPSecAttr(attrib);
     if (status)
         return (status);
 #endif // DBGCM_V8M
 
+    rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
+
     do {
         if (AP_Bank != 0) {
             status = SWD_WriteDP(DP_SELECT, AP_Sel | 0);
@@ -1239,18 +1294,50 @@ int SWD_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
                 break;
         }
 
-        status = SWD_WriteAP(AP_TAR, adr);
+        nReg = 0;
+        for (i = 0; i < nRanges && status == 0; i++) {
+            adr = pAdr[i];
+            for (n = pLen[i]; n != 0; n -= 4, adr += 4, pB += 4) {
+                // Keep room for TAR, DRW and the final DP_CTRL_STAT read
+                if (nReg + 3 > BULK_BATCH_SIZE) {
+                    status = SWD_TransferRangesFlush(nReg, regID, regData, pData);
+                    if (status)
+                        break;
+                    nReg = 0;
+                }
+
+                // TAR at range start, page boundary and after each request
+                if (n == pLen[i] || (adr & (rwpage - 1)) == 0 || nReg == 0) {
+                    regID[nReg]   = DAP_AP_REG_TAR;
+                    regData[nReg] = adr;
+                    pData[nReg]   = NULL;
+                    nReg++;
+                }
+
+                if (bWrite) { // DRW write
+                    regID[nReg] = DAP_AP_REG_DRW;
+                    memcpy(&regData[nReg], pB, 4);
+                    pData[nReg] = NULL;
+                } else { // DRW read
+                    regID[nReg] = DAP_AP_REG_DRW | DAP_REG_RnW;
+                    pData[nReg] = pB;
+                }
+                nReg++;
+            }
+        }
         if (status)
             break;
 
-        // Multiple Write AP DRW
-        status = rddi::DAP_RegWriteRepeat(rddi::k_rddi_handle, 0,
-                                          nMany >> 2, DAP_AP_REG_DRW, (int *)pB);
-        status = SWD_CheckStatus(status);
+        // DP_CTRL_STAT read
+        regID[nReg] = DAP_REG_DP_0x4 | DAP_REG_RnW;
+        pData[nReg] = (BYTE *)&dp_stat;
+        nReg++;
+
+        status = SWD_TransferRangesFlush(nReg, regID, regData, pData);
         if (status)
             break;
 
-        status = SWD_StickyError();
+        status = SWD_CheckStickyError(dp_stat);
         if (status)
             break;
     } while (0);
@@ -1259,96 +1346,515 @@ int SWD_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
         status = EU14;
     }
 
+    return (status);
+}
 
-    // See "Setting up target memory accesses based on AP_Context" above in this file for how
-    // to construct the AP CSW value to write.
 
-    // Extend error message with details if memory access failed
-    // Ideally use the actual address of the failing access
-    if (status == EU14)
-        SetStatusMem(EU14, adr, STATUS_MEMWRITE, 4);
+// SWD Read Data Ranges (32-bit Elements)
+// Range addresses and lengths must be 4-Byte aligned.
+//   pAdr    : Array of range start addresses
+//   pLen    : Array of range lengths in bytes
+//   pB      : Pointer to Buffer, receives the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+int SWD_ReadRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges)
+{
+    int status;
+
+#if DBGCM_DBG_DESCRIPTION
+    int   pstatus = 0;
+    DWORD i;
+#endif // DBGCM_DBG_DESCRIPTION
+
+    status = SWD_TransferRanges(pAdr, pLen, pB, nRanges, BLOCK_SECTYPE_ANY, FALSE);
     if (status)
         return (status);
 
+#if DBGCM_DBG_DESCRIPTION
+    if (PDSCDebug_IsEnabled()) {
+        for (i = 0; i < nRanges; pB += pLen[i], i++) {
+            if (pLen[i] == 0)
+                continue;
+            pstatus = PDSCDebug_PatchData((U32)ACCESS_MEM, 4, pAdr[i], pLen[i], (UC8 *)pB, 0 /*attrib*/);
+            if (pstatus != 0 && pstatus != EU38)
+                return (pstatus);
+        }
+    }
+#endif // DBGCM_DBG_DESCRIPTION
+
     return (0);
 }
 
 
-// SWD Verify Data Block (32-bit Elements inside R/W Page Block)
-// Block parameters 'adr' and 'nMany' must be 4-Byte aligned to allow an efficient implementation.
+// SWD Write Data Ranges (32-bit Elements)
+// Range addresses and lengths must be 4-Byte aligned.
+//   pAdr    : Array of range start addresses
+//   pLen    : Array of range lengths in bytes
+//   pB      : Pointer to Buffer, holds the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+int SWD_WriteRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges)
+{
+    return (SWD_TransferRanges(pAdr, pLen, pB, nRanges, BLOCK_SECTYPE_ANY, TRUE));
+}
+
+
+// SWD Read Data Bulk (32-bit Elements, may cross R/W Pages)
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned.
 //   adr    : Address
 //   pB     : Pointer to Buffer
 //   nMany  : Number of bytes
-//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
-//   return value: error status or -1 on Verify Missmatch
-#if DBGCM_V8M
-int SWD_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
-{
-    // int status = 0;
-#else  // DBGCM_V8M
-int SWD_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany)
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+static int SWD_ReadBulk(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
 {
-#endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
-
-    int   status = 0;
-    int   flag   = 0;
-    DWORD rwpage, val;
-
-    AP_CONTEXT *apCtx;
+    int status;
 
-    if (nMany == 0)
-        return (EU01);
-    if (nMany & 0x03)
-        return (EU01);
-    // if (nMany > RWPage) return (EU01);
+#if DBGCM_DBG_DESCRIPTION
+    int pstatus = 0;
+#endif // DBGCM_DBG_DESCRIPTION
 
-    rwpage = AP_CurrentRWPage();
-    if (nMany > rwpage)
-        return (EU01);
+    status = SWD_TransferRanges(&adr, &nMany, pB, 1, attrib, FALSE);
 
-    status = AP_Switch(&apCtx);
+    // Extend error message with details if memory access failed
+    if (status == EU14)
+        SetStatusMem(EU14, adr, STATUS_MEMREAD, 4);
     if (status)
         return (status);
 
-#if DBGCM_V8M
-    status = SWD_UpdateDSCSR(adr, nMany, attrib);
-    if (status)
-        return (status);
+#if DBGCM_DBG_DESCRIPTION
+    if (PDSCDebug_IsEnabled()) {
+        pstatus = PDSCDebug_PatchData((U32)ACCESS_MEM, 4, adr, nMany, (UC8 *)pB, 0 /*attrib*/);
+        if (pstatus != 0 && pstatus != EU38)
+            return (pstatus);
+    }
+#endif // DBGCM_DBG_DESCRIPTION
 
-    status = _UpdateAPSecAttr(attrib);
-    if (status)
-        return (status);
-#endif // DBGCM_V8M
+    return (0);
+}
 
-    // See "Setting up target memory accesses based on AP_Context" above in this file for how
-    // to construct the AP CSW value to write.
 
-    if (AP_Bank != 0) {
-        status = SWD_WriteDP(DP_SELECT, AP_Sel | 0);
-        if (status)
-            goto fail;
-        AP_Bank = 0;
-    }
+// SWD Write Data Bulk (32-bit Elements, may cross R/W Pages)
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned.
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+static int SWD_WriteBulk(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+{
+    int status;
 
-    if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
-        apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
-        apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
-        status = SWD_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
-        if (status)
-            goto fail;
-    }
+    status = SWD_TransferRanges(&adr, &nMany, pB, 1, attrib, TRUE);
 
-    status = SWD_WriteAP(AP_TAR, adr);
-    if (status)
-        goto fail;
+    // Extend error message with details if memory access failed
+    if (status == EU14)
+        SetStatusMem(EU14, adr, STATUS_MEMWRITE, 4);
 
-    // Configure pushed compare
-    status = SWD_ReadDP(DP_CTRL_STAT, &val);
-    if (status)
-        goto fail;
-    val &= ~TRNMODE;
-    val |= TRNVERIFY | STICKYCMP;
+    return (status);
+}
+
+
+// Execute one item of SWD_ReadVector/SWD_WriteVector with the single access functions
+static int SWD_VectorItem(MEM_VECTOR *pV, BOOL bWrite, BYTE attrib)
+{
+    int  status = 0;
+    WORD v16;
+    BYTE v8;
+
+#if DBGCM_V8M
+    switch (pV->Size) {
+        case 1:
+            if (bWrite)
+                return (SWD_WriteD8(pV->Addr, (BYTE)pV->Val, attrib));
+            status = SWD_ReadD8(pV->Addr, &v8, attrib);
+            if (status == 0)
+                pV->Val = v8;
+            break;
+        case 2:
+            if (bWrite)
+                return (SWD_WriteD16(pV->Addr, (WORD)pV->Val, attrib));
+            status = SWD_ReadD16(pV->Addr, &v16, attrib);
+            if (status == 0)
+                pV->Val = v16;
+            break;
+        default:
+            if (bWrite)
+                return (SWD_WriteD32(pV->Addr, pV->Val, attrib));
+            status = SWD_ReadD32(pV->Addr, &pV->Val, attrib);
+            break;
+    }
+#else  // DBGCM_V8M
+    switch (pV->Size) {
+        case 1:
+            if (bWrite)
+                return (SWD_WriteD8(pV->Addr, (BYTE)pV->Val));
+            status = SWD_ReadD8(pV->Addr, &v8);
+            if (status == 0)
+                pV->Val = v8;
+            break;
+        case 2:
+            if (bWrite)
+                return (SWD_WriteD16(pV->Addr, (WORD)pV->Val));
+            status = SWD_ReadD16(pV->Addr, &v16);
+            if (status == 0)
+                pV->Val = v16;
+            break;
+        default:
+            if (bWrite)
+                return (SWD_WriteD32(pV->Addr, pV->Val));
+            status = SWD_ReadD32(pV->Addr, &pV->Val);
+            break;
+    }
+#endif // DBGCM_V8M
+
+    return (status);
+}
+
+
+// SWD Read/Write Data Vector
+// All items are packed into as few DAP requests as possible: a CSW write only where the access
+// size changes, then TAR and DRW for each item. If a request faults, the items the probe
+// completed are kept, and only the failing item is repeated with SWD_ReadD32/SWD_ReadD16/
+// SWD_ReadD8 (or the write functions) to report its error, then the vector resumes after it.
+//   pV     : Pointer to Items
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   bWrite : FALSE - Read, TRUE - Write
+//   return value: error status
+static int SWD_AccessVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib, BOOL bWrite)
+{
+    AS_Guard lk;
+
+    int         status = 0;
+    AP_CONTEXT *apCtx;
+    MEM_VECTOR *p;
+    DWORD       i, first, last, csw, sh;
+    BOOL        bSingle = FALSE;
+    int         nReg, nDone, k;
+    int         regID[VECTOR_BATCH_SIZE];
+    int         regData[VECTOR_BATCH_SIZE];
+    DWORD       regItem[VECTOR_BATCH_SIZE]; // Item of each register
+
+#if DBGCM_DBG_DESCRIPTION
+    int pstatus = 0;
+#endif // DBGCM_DBG_DESCRIPTION
+
+    VectorDone = 0;
+    for (i = 0; i < nMany; i++) {
+        if ((pV[i].Size != 1 && pV[i].Size != 2 && pV[i].Size != 4) || (pV[i].Addr & (pV[i].Size - 1)))
+            return (EU01);
+#if DBGCM_DS_MONITOR
+        if (pV[i].Addr == DBG_HCSR)
+            bSingle = TRUE; // Monitor must be suspended around DHCSR accesses
+#endif // DBGCM_DS_MONITOR
+    }
+
+    if (bSingle) {
+        for (i = 0; i < nMany; i++) {
+            status = SWD_VectorItem(&pV[i], bWrite, attrib);
+            if (status)
+                return (status);
+            VectorDone = i + 1;
+        }
+        return (0);
+    }
+
+    status = AP_Switch(&apCtx);
+    if (status)
+        return (status);
+
+#if DBGCM_V8M
+    for (i = 0; i < nMany; i++) {
+        status = SWD_UpdateDSCSR(pV[i].Addr, pV[i].Size, attrib);
+        if (status)
+            return (status);
+    }
+
+    status = _UpdateAPSecAttr(attrib);
+    if (status)
+        return (status);
+#endif // DBGCM_V8M
+
+    do {
+        if (AP_Bank != 0) {
+            status = SWD_WriteDP(DP_SELECT, AP_Sel | 0);
+            if (status)
+                break;
+            AP_Bank = 0;
+        }
+
+        nReg  = 0;
+        first = 0;
+        for (i = 0; i < nMany; i++) {
+            switch (pV[i].Size) {
+                case 1:
+                    csw = CSW_SIZE8;
+                    sh  = (pV[i].Addr & 0x03) << 3;
+                    break;
+                case 2:
+                    csw = CSW_SIZE16;
+                    sh  = (pV[i].Addr & 0x02) << 3;
+                    break;
+                default:
+                    csw = CSW_SIZE32;
+                    sh  = 0;
+                    break;
+            }
+
+            // CSW only where the access size changes
+            if ((apCtx->CSW_Val_Base & CSW_SIZE) != csw) {
+                apCtx->CSW_Val_Base &= ~CSW_SIZE;
+                apCtx->CSW_Val_Base |= csw;
+                regID[nReg]   = DAP_AP_REG_CSW;
+                regData[nReg] = apCtx->CSW_Val_Base;
+                regItem[nReg] = i;
+                nReg++;
+            }
+
+            // TAR = adr
+            regID[nReg]   = DAP_AP_REG_TAR;
+            regData[nReg] = pV[i].Addr;
+            regItem[nReg] = i;
+            nReg++;
+
+            // DRW read or write, data is placed on the byte lanes of the address
+            if (bWrite) {
+                regID[nReg]   = DAP_AP_REG_DRW;
+                regData[nReg] = pV[i].Val << sh;
+            } else {
+                regID[nReg] = DAP_AP_REG_DRW | DAP_REG_RnW;
+            }
+            regItem[nReg] = i;
+            nReg++;
+
+            if (nReg + 3 <= VECTOR_BATCH_SIZE && i + 1 < nMany)
+                continue;
+
+            // R/W DAP Registers
+            status = SWD_RegAccessBlock(nReg, regID, regData);
+            status = SWD_CheckStatus(status);
+            last   = i + 1; // Items before 'last' are complete
+            if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+                nDone = SWD_RegAccessDone();
+                if (nDone < 0) {
+                    // Failing item not known, sync CSW with the base value
+                    status = SWD_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+                    if (status == 0)
+                        status = rddi::RDDI_DAP_ERROR_MEMORY;
+                    break; // Items from 'first' on are not known
+                }
+                // A DRW access faults with the next AP transfer (or the final
+                // RDBUFF check), so the failing item is the last DRW completed
+                for (k = nDone; k > 0 && (regID[k - 1] & ~DAP_REG_RnW) != DAP_AP_REG_DRW; k--)
+                    ;
+                if (k > 0)
+                    last = regItem[k - 1];
+                else
+                    last = regItem[(nDone < nReg) ? nDone : nReg - 1];
+            } else if (status)
+                break;
+
+            if (!bWrite) {
+                for (k = 0; k < nReg; k++) {
+                    if ((regID[k] & DAP_REG_RnW) == 0 || regItem[k] >= last)
+                        continue;
+                    p = &pV[regItem[k]];
+                    switch (p->Size) {
+                        case 1:
+                            p->Val = (BYTE)((DWORD)regData[k] >> ((p->Addr & 0x03) << 3));
+                            break;
+                        case 2:
+                            p->Val = (WORD)((DWORD)regData[k] >> ((p->Addr & 0x02) << 3));
+                            break;
+                        default:
+                            p->Val = (DWORD)regData[k];
+                            break;
+                    }
+                }
+
+#if DBGCM_DBG_DESCRIPTION
+                if (PDSCDebug_IsEnabled()) {
+                    for (; first < last; first++) {
+                        pstatus = PDSCDebug_PatchData((U32)ACCESS_MEM, pV[first].Size, pV[first].Addr, pV[first].Size, (UC8 *)&pV[first].Val, attrib);
+                        if (pstatus != 0 && pstatus != EU38)
+                            return (pstatus);
+                    }
+                }
+#endif // DBGCM_DBG_DESCRIPTION
+            }
+
+            if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+                // Sync CSW with the base value, then repeat the failing item alone
+                status = SWD_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+                if (status)
+                    break;
+                VectorDone = last;
+                status     = SWD_VectorItem(&pV[last], bWrite, attrib);
+                if (status)
+                    return (status);
+                i = last; // Resume after the failing item
+            }
+
+            nReg       = 0;
+            first      = i + 1;
+            VectorDone = first;
+        }
+    } while (0);
+
+    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+        status = EU14;
+    }
+    if (status)
+        return (status);
+
+    return (0);
+}
+
+
+// SWD Read Data Vector
+//   pV     : Pointer to Items, 'Addr' and 'Size' are inputs, 'Val' receives the value
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+int SWD_ReadVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib)
+{
+    return (SWD_AccessVector(pV, nMany, attrib, FALSE));
+}
+
+
+// SWD Write Data Vector
+//   pV     : Pointer to Items, 'Addr', 'Size' and 'Val' are inputs
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+int SWD_WriteVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib)
+{
+    return (SWD_AccessVector(pV, nMany, attrib, TRUE));
+}
+
+
+// SWD Write Data Block (32-bit Elements inside R/W Page Block)
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned to allow an efficient implementation.
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
+//   return value: error status
+int SWD_WriteBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+{
+    AS_Guard lk;
+
+    // #if DBGCM_V8M
+    int status = 0;
+    // #endif // DBGCM_V8M
+
+    DWORD rwpage;
+
+    if (nMany == 0)
+        return (EU01);
+    if (nMany & 0x03)
+        return (EU01);
+    // if (nMany > RWPage) return (EU01);
+
+    if (!(attrib & BLOCK_NADDRINC)) {
+        rwpage = AP_CurrentRWPage(); // Get effective RWPage based on DP/AP selection
+        if (nMany > rwpage)
+            return (EU01);
+    }
+
+    // AP handling, TAR, DRW and the sticky error check with as few DAP requests as possible
+    status = SWD_TransferRanges(&adr, &nMany, pB, 1, attrib, TRUE);
+
+    // See "Setting up target memory accesses based on AP_Context" above in this file for how
+    // to construct the AP CSW value to write.
+
+    // Extend error message with details if memory access failed
+    // Ideally use the actual address of the failing access
+    if (status == EU14)
+        SetStatusMem(EU14, adr, STATUS_MEMWRITE, 4);
+    if (status)
+        return (status);
+
+    return (0);
+}
+
+
+// SWD Verify Data Block (32-bit Elements inside R/W Page Block)
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned to allow an efficient implementation.
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   attrib : Attributes for memory access (Bit 0 - NoAddrIncr, Bits [2..1] - Security Attribute)
+//   return value: error status or -1 on Verify Missmatch
+#if DBGCM_V8M
+int SWD_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib)
+{
+    // int status = 0;
+#else  // DBGCM_V8M
+int SWD_VerifyBlock(DWORD adr, BYTE *pB, DWORD nMany)
+{
+#endif // DBGCM_V8M
+    AS_Guard lk;
+
+    int   status = 0;
+    int   flag   = 0;
+    DWORD rwpage, val;
+
+    AP_CONTEXT *apCtx;
+
+    if (nMany == 0)
+        return (EU01);
+    if (nMany & 0x03)
+        return (EU01);
+    // if (nMany > RWPage) return (EU01);
+
+    rwpage = AP_CurrentRWPage();
+    if (nMany > rwpage)
+        return (EU01);
+
+    status = AP_Switch(&apCtx);
+    if (status)
+        return (status);
+
+#if DBGCM_V8M
+    status = SWD_UpdateDSCSR(adr, nMany, attrib);
+    if (status)
+        return (status);
+
+    status = _UpdateAPSecAttr(attrib);
+    if (status)
+        return (status);
+#endif // DBGCM_V8M
+
+    // See "Setting up target memory accesses based on AP_Context" above in this file for how
+    // to construct the AP CSW value to write.
+
+    if (AP_Bank != 0) {
+        status = SWD_WriteDP(DP_SELECT, AP_Sel | 0);
+        if (status)
+            goto fail;
+        AP_Bank = 0;
+    }
+
+    if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
+        apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
+        apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
+        status = SWD_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+        if (status)
+            goto fail;
+    }
+
+    status = SWD_WriteAP(AP_TAR, adr);
+    if (status)
+        goto fail;
+
+    // Configure pushed compare
+    status = SWD_ReadDP(DP_CTRL_STAT, &val);
+    if (status)
+        goto fail;
+    val &= ~TRNMODE;
+    val |= TRNVERIFY | STICKYCMP;
     status = SWD_WriteDP(DP_CTRL_STAT, val);
     if (status)
         goto fail;
@@ -1424,7 +1930,7 @@ int SWD_ReadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib)
 int SWD_ReadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int   status   = 0;
     int   acc_size = 0;
@@ -1462,6 +1968,21 @@ int SWD_ReadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
         nMany -= 2;
     }
 
+    // Read Data Blocks across R/W Pages with one bulk transfer. If it faults, the
+    // page wise loop below finds the failing address. DHCSR is left to SWD_ReadBlock.
+    n = nMany & 0xFFFFFFFC;
+    if (n > rwpage - (*nAdr & (rwpage - 1)) && !(*nAdr <= DBG_HCSR && (*nAdr + n) > DBG_HCSR)) {
+        acc_size = 4;
+        status   = SWD_ReadBulk(*nAdr, pB, n, attrib);
+        if (status == 0) {
+            pB += n;
+            *nAdr += n;
+            nMany -= n;
+        } else if (status != rddi::RDDI_DAP_ERROR_MEMORY && status != EU14) {
+            goto out;
+        }
+    }
+
     // Read Data Block (32-bit Aligned)
     while (nMany >= 4) {
         acc_size = 4;
@@ -1555,7 +2076,7 @@ int SWD_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib)
 int SWD_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int   status   = 0;
     int   acc_size = 0;
@@ -1593,6 +2114,21 @@ int SWD_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
         nMany -= 2;
     }
 
+    // Write Data Blocks across R/W Pages with one bulk transfer. If it faults, the
+    // page wise loop below finds the failing address. DHCSR is left to SWD_WriteBlock.
+    n = nMany & 0xFFFFFFFC;
+    if (n > rwpage - (*nAdr & (rwpage - 1)) && !(*nAdr <= DBG_HCSR && (*nAdr + n) > DBG_HCSR)) {
+        acc_size = 4;
+        status   = SWD_WriteBulk(*nAdr, pB, n, attrib);
+        if (status == 0) {
+            pB += n;
+            *nAdr += n;
+            nMany -= n;
+        } else if (status != rddi::RDDI_DAP_ERROR_MEMORY && status != EU14) {
+            goto out;
+        }
+    }
+
     // Write Data Block (32-bit Aligned)
     while (nMany >= 4) {
         acc_size = 4;
@@ -1672,6 +2208,129 @@ out:
 }
 
 
+// SWD Load Data Bulk (32-bit Elements, may cross R/W Pages)
+// Written with the load packets of RAMLoad_Transfer, DP CTRL/STAT is read once at the end.
+// Block parameters 'adr' and 'nMany' must be 4-Byte aligned.
+//   adr    : Address
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes
+//   return value: error status
+static int SWD_LoadBulk(DWORD adr, BYTE *pB, DWORD nMany)
+{
+    AS_Guard lk;
+
+    int         status = 0;
+    AP_CONTEXT *apCtx;
+
+    status = AP_Switch(&apCtx);
+    if (status)
+        return (status);
+
+#if DBGCM_V8M
+    status = SWD_UpdateDSCSR(adr, nMany, BLOCK_SECTYPE_ANY);
+    if (status)
+        return (status);
+
+    status = _UpdateAPSecAttr(BLOCK_SECTYPE_ANY);
+    if (status)
+        return (status);
+#endif // DBGCM_V8M
+
+    do {
+        status = SWD_AbortPending();
+        status = SWD_CheckStatus(status);
+        if (status)
+            break;
+
+        if (AP_Bank != 0) {
+            status = SWD_WriteDP(DP_SELECT, AP_Sel | 0);
+            if (status)
+                break;
+            AP_Bank = 0;
+        }
+
+        if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
+            apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
+            apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
+            status = SWD_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+            if (status)
+                break;
+        }
+
+        status = RAMLoad_Transfer(0, adr, pB, nMany, AP_CurrentRWPage());
+        if (status) {
+            // The probe stopped at a fault, queue the sticky flag clear for the next request
+            status = (SWD_StickyError() == rddi::RDDI_DAP_ERROR_MEMORY) ? rddi::RDDI_DAP_ERROR_MEMORY : rddi::RDDI_DAP_ERROR;
+            break;
+        }
+
+        // One sticky error check for all load packets
+        status = SWD_StickyError();
+    } while (0);
+
+    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+        status = EU14;
+    }
+
+    return (status);
+}
+
+
+// SWD Load ARM Memory (Program Download to RAM)
+// Word aligned data is written with load packets and one sticky error check, the unaligned
+// head and tail with SWD_WriteARMMem. On error the caller writes the range again with
+// WriteARMMem to find the failing address.
+//   nAdr   : Start Address (used also to return error addresses)
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes to Write
+//   return value: error status
+int SWD_LoadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
+{
+    AS_Guard lk;
+
+    int   status = 0;
+    DWORD n;
+
+    // Write unaligned Head
+    n = (4 - (*nAdr & 0x03)) & 0x03;
+    if (n > nMany)
+        n = nMany;
+    if (n) {
+#if DBGCM_V8M
+        status = SWD_WriteARMMem(nAdr, pB, n, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+        status = SWD_WriteARMMem(nAdr, pB, n);
+#endif // DBGCM_V8M
+        if (status)
+            return (status);
+        pB += n;
+        nMany -= n;
+    }
+
+    // Write Data Blocks, DHCSR is left to SWD_WriteARMMem
+    n = nMany & 0xFFFFFFFC;
+    if (n && !(*nAdr <= DBG_HCSR && (*nAdr + n) > DBG_HCSR)) {
+        status = SWD_LoadBulk(*nAdr, pB, n);
+        if (status)
+            return (status);
+        pB += n;
+        *nAdr += n;
+        nMany -= n;
+    }
+
+    // Write the Rest
+    if (nMany) {
+#if DBGCM_V8M
+        status = SWD_WriteARMMem(nAdr, pB, nMany, BLOCK_SECTYPE_ANY);
+#else  // DBGCM_V8M
+        status = SWD_WriteARMMem(nAdr, pB, nMany);
+#endif // DBGCM_V8M
+    }
+
+    return (status);
+}
+
+
 // SWD Verify ARM Memory
 // No aligment required for access parameters 'nAdr' and 'nMany'
 //   nAdr   : Start Address (used also to return error addresses)
@@ -1686,7 +2345,7 @@ int SWD_VerifyARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib)
 int SWD_VerifyARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     // No requirement to how the target memory is verified. Can be for example a combination of 8, 16, and
     // 32 Bit accesses. It is valid to call other access functions implemented in this source file.
@@ -1826,91 +2485,107 @@ int SWD_GetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, RgARMV8MSE *rsec, U64 mask)
 int SWD_GetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, U64 mask)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     if (mask == 0)
         return (EU01);
 
     int   status;
-    int   regID[3 * 64];
-    int   regData[3 * 64];
+    int   regID[5 + 3 * 64 + 1];
+    int   regData[5 + 3 * 64 + 1];
     int   i, n, m;
     DWORD val;
 
-    // Match Retry = 100
-    regID[0]   = DAP_REG_MATCH_RETRY;
-    regData[0] = 100;
-
-    // Match Mask = 0x00010000
-    regID[1]   = DAP_REG_MATCH_MASK;
-    regData[1] = 0x00010000;
+    // Setup and register reads are sent with one request
+    for (;;) {
+        // Match Retry = 100
+        regID[0]   = DAP_REG_MATCH_RETRY;
+        regData[0] = 100;
+
+        // Match Mask = S_REGRDY
+        regID[1]   = DAP_REG_MATCH_MASK;
+        regData[1] = S_REGRDY;
+
+        // SELECT = AP_Sel
+        regID[2]   = DAP_DP_REG_APSEL;
+        regData[2] = AP_Sel;
+
+        // TAR = DBG_Addr
+        regID[3]   = DAP_AP_REG_TAR;
+        regData[3] = DBG_Addr;
+
+        // SELECT = AP_Sel | 0x10, DHCSR/DCRSR/DCRDR are accessed through the banked data registers
+        regID[4]   = DAP_DP_REG_APSEL;
+        regData[4] = AP_Sel | 0x10;
+
+        // Prepare Register Access
+        for (i = 5, n = 0; n < 64; n++) {
+            if (mask & (1ULL << n)) {
+                // Get register selector
+                if (n < 21) {
+                    m = n; // Core Registers
+                } else if (n >= 32) {
+                    m = 64 + (n - 32); // FPU Sn
+                } else if (n == 31) {
+                    m = 33; // FPU FPCSR
+                } else {
+                    continue;
+                }
 
-    // SELECT = AP_Sel
-    regID[2]   = DAP_DP_REG_APSEL;
-    regData[2] = AP_Sel;
+                // Select register to read (write to DCRSR)
+                regID[i + 0]   = DAP_REG_AP_0x4;
+                regData[i + 0] = m;
+                if (kSWDRegRdyWait) {
+                    // Read and wait for register ready flag (read DHCSR.16)
+                    regID[i + 1]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
+                    regData[i + 1] = S_REGRDY; // Value to Match
+                } else {
+                    // Read register ready flag (read DHCSR.16), checked below
+                    regID[i + 1] = DAP_REG_AP_0x0 | DAP_REG_RnW;
+                }
+                // Read register value (read DCRDR)
+                regID[i + 2] = DAP_REG_AP_0x8 | DAP_REG_RnW;
 
-    // TAR = DBG_Addr
-    regID[3]   = DAP_AP_REG_TAR;
-    regData[3] = DBG_Addr;
+                i += 3;
+            }
+        }
 
-    // SELECT = AP_Sel | 0x10
-    regID[4]   = DAP_DP_REG_APSEL;
-    regData[4] = AP_Sel | 0x10;
+        // skip empty request
+        if (i == 5)
+            return 0;
 
-    // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, 5, regID, regData);
-    status = SWD_CheckStatus(status);
-    if (status) {
-        goto fail;
-    }
+        // DP_CTRL_STAT read
+        regID[i] = DAP_REG_DP_0x4 | DAP_REG_RnW;
 
+        // R/W DAP Registers
+        status = SWD_RegAccessBlock(i + 1, regID, regData);
+        status = SWD_CheckStatus(status);
+        if (status)
+            goto fail;
 
-    AP_Bank = 0x10;
+        AP_Bank = 0x10;
 
-    // Prepare Register Access
-    for (i = 0, n = 0; n < 64; n++) {
-        if (mask & (1ULL << n)) {
-            // Get register selector
-            if (n < 21) {
-                m = n; // Core Registers
-            } else if (n >= 32) {
-                m = 64 + (n - 32); // FPU Sn
-            } else if (n == 31) {
-                m = 33; // FPU FPCSR
-            } else {
-                continue;
-            }
+        status = SWD_CheckStickyError(regData[i]);
+        if (status)
+            goto fail;
 
-            // Select register to read (write to DCRSR)
-            regID[i + 0]   = DAP_REG_AP_0x4;
-            regData[i + 0] = m;
-            // Read and wait for register ready flag (read DHCSR.16)
-            regID[i + 1]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
-            regData[i + 1] = 0x00010000; // Value to Match
-            // Read register value (read DCRDR)
-            regID[i + 2] = DAP_REG_AP_0x8 | DAP_REG_RnW;
+        if (kSWDRegRdyWait)
+            break;
 
-            i += 3;
+        // The core usually completes the transfer before DHCSR is read
+        for (m = 5; m < i; m += 3) {
+            if ((regData[m + 1] & S_REGRDY) == 0)
+                break;
         }
-    }
-
-    // skip empty request
-    if (i == 0)
-        return 0;
-
-    // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, i, regID, regData);
-    status = SWD_CheckStatus(status);
-    if (status)
-        goto fail;
+        if (m >= i)
+            break;
 
-    status = SWD_StickyError();
-    if (status)
-        goto fail;
+        kSWDRegRdyWait = TRUE; // Too slow for this debug clock, wait for the flag from now on
+    }
 
     // Store register values
-    for (i = 0, n = 0; n < 64; n++) {
-        if (mask & (1ULL << n)) {
+    for (i = 5, n = 0; n < 64; n++) {
+        if ((mask & (1ULL << n)) && (n < 21 || n >= 31)) {
             val = regData[i + 2];
             i += 3;
             if ((n < 21) && regs) {
@@ -1965,7 +2640,7 @@ int SWD_SetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, RgARMV8MSE *rsec, U64 mask)
 int SWD_SetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, U64 mask)
 {
 #endif // DBGCM_V8M
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     if (mask == 0)
         return (EU01);
@@ -1997,7 +2672,7 @@ int SWD_SetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, U64 mask)
     regData[4] = AP_Sel | 0x10;
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, 5, regID, regData);
+    status = SWD_RegAccessBlock(5, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         goto fail;
@@ -2037,7 +2712,7 @@ int SWD_SetARMRegs(RgARMCM *regs, RgARMFPU *rfpu, U64 mask)
     }
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, i, regID, regData);
+    status = SWD_RegAccessBlock(i, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         goto fail;
@@ -2062,7 +2737,7 @@ fail:
 //   return value: error status
 int SWD_SysCallExec(RgARMCM *regs)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int   status;
     int   regID[3 * 16];
@@ -2088,7 +2763,7 @@ int SWD_SysCallExec(RgARMCM *regs)
     regData[3] = AP_Sel | 0x10;
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, 4, regID, regData);
+    status = SWD_RegAccessBlock(4, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         goto fail;
@@ -2122,16 +2797,16 @@ int SWD_SysCallExec(RgARMCM *regs)
         }
     }
 
-    // DHCSR = DBGKEY | C_DEBUGEN
+    // DHCSR = DBGKEY | C_DEBUGEN | DHCSR_MaskIntsSysCall
     regID[i]   = DAP_REG_AP_0x0;
-    regData[i] = DBGKEY | C_DEBUGEN;
+    regData[i] = DBGKEY | C_DEBUGEN | DHCSR_MaskIntsSysCall;
     i++;
 
     // DP_CTRL_STAT read
     regID[i] = DAP_REG_DP_0x4 | DAP_REG_RnW;
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, i + 1, regID, regData);
+    status = SWD_RegAccessBlock(i + 1, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         goto fail;
@@ -2154,7 +2829,7 @@ fail:
 //   return value: error status
 int SWD_SysCallRes(DWORD *rval)
 {
-    std::lock_guard<std::recursive_mutex> lk(kSWDOpMutex);
+    AS_Guard lk;
 
     int status;
     int regID[4];
@@ -2178,7 +2853,7 @@ int SWD_SysCallRes(DWORD *rval)
     regData[3] = AP_Sel | 0x10;
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, 4, regID, regData);
+    status = SWD_RegAccessBlock(4, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         goto fail;
@@ -2198,7 +2873,7 @@ int SWD_SysCallRes(DWORD *rval)
     regID[3] = DAP_REG_DP_0x4 | DAP_REG_RnW;
 
     // R/W DAP Registers
-    status = rddi::DAP_RegAccessBlock(rddi::k_rddi_handle, 0, 4, regID, regData);
+    status = SWD_RegAccessBlock(4, regID, regData);
     status = SWD_CheckStatus(status);
     if (status)
         goto fail;
@@ -2221,6 +2896,103 @@ fail:
 }
 
 
+// SWD Wait for System Call completion and read the Result
+//   The probe reads DHCSR until S_HALT is set (at most SYSCALL_MATCH_RETRY times)
+//   and reads R0 with the same request.
+//   rval   : Pointer to Result Value
+//   done   : Set to TRUE if the System Call completed and *rval is valid
+//   return value: error status
+int SWD_SysCallWait(DWORD *rval, BOOL *done)
+{
+    AS_Guard lk;
+
+    int   status;
+    int   regID[10];
+    int   regData[10];
+    DWORD val;
+
+    *done = FALSE;
+
+    // Match Retry = SYSCALL_MATCH_RETRY
+    regID[0]   = DAP_REG_MATCH_RETRY;
+    regData[0] = SYSCALL_MATCH_RETRY;
+
+    // Match Mask = S_HALT
+    regID[1]   = DAP_REG_MATCH_MASK;
+    regData[1] = S_HALT;
+
+    // TAR = DBG_Addr
+    regID[2]   = DAP_AP_REG_TAR;
+    regData[2] = DBG_Addr;
+
+    // SELECT = AP_Sel | 0x10
+    regID[3]   = DAP_DP_REG_APSEL;
+    regData[3] = AP_Sel | 0x10;
+
+    // Read and wait for halt (read DHCSR.17)
+    regID[4]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
+    regData[4] = S_HALT; // Value to Match
+
+    // Match Mask = S_REGRDY
+    regID[5]   = DAP_REG_MATCH_MASK;
+    regData[5] = S_REGRDY;
+
+    // Select register R0 to read (write to DCRSR)
+    regID[6]   = DAP_REG_AP_0x4;
+    regData[6] = 0;
+    // Read and wait for register ready flag (read DHCSR.16)
+    regID[7]   = DAP_REG_AP_0x0 | DAP_REG_RnW | DAP_REG_WaitForValue;
+    regData[7] = S_REGRDY; // Value to Match
+    // Read register value (read DCRDR)
+    regID[8] = DAP_REG_AP_0x8 | DAP_REG_RnW;
+
+    // DP_CTRL_STAT read
+    regID[9] = DAP_REG_DP_0x4 | DAP_REG_RnW;
+
+    // R/W DAP Registers
+    status = SWD_RegAccessBlock(10, regID, regData);
+    status = SWD_CheckStatus(status);
+
+    AP_Bank = 0x10; // SELECT is written before the wait
+
+    if (status) {
+        // A value mismatch fails the request, check if the core is still running
+#if DBGCM_V8M
+        if (SWD_ReadD32(DBG_HCSR, &val, BLOCK_SECTYPE_ANY))
+            goto fail;
+#else  // DBGCM_V8M
+        if (SWD_ReadD32(DBG_HCSR, &val))
+            goto fail;
+#endif // DBGCM_V8M
+        if ((val & S_HALT) == 0)
+            return (0);
+
+        // Halted after the last match retry
+        status = SWD_SysCallRes(rval);
+        if (status == 0)
+            *done = TRUE;
+        return (status);
+    }
+
+    status = SWD_CheckStickyError(regData[9]);
+    if (status)
+        goto fail;
+
+
+    *rval = regData[8];
+    *done = TRUE;
+
+fail:
+    if (status == rddi::RDDI_DAP_ERROR_MEMORY) {
+        return EU14;
+    } else if (status != 0) {
+        return EU01;
+    }
+
+    return (0);
+}
+
+
 // SWD Init Debugger
 //   return value: error status
 int SWD_DebugInit(void)
@@ -2229,6 +3001,8 @@ int SWD_DebugInit(void)
     DWORD tick;
     DWORD val;
 
+    kSWDRegRdyWait = FALSE; // Try without waiting, checked with each register read
+
     if ((SWD_IDCode & 1) && ((SWD_IDCode & DPID_DESIGN_M) == (DPID_DESIGNER << DPID_DESIGN_P))) {
         DP_Ver = (BYTE)((SWD_IDCode & DPID_VER_M) >> DPID_VER_P);
         DP_Min = (SWD_IDCode & DPID_MIN) ? TRUE : FALSE;
@@ -2351,10 +3125,11 @@ int SWD_DAPAbortVal(DWORD val)
 {
     int status;
 
-    // Write Abort Register
-    status = rddi::DAP_WriteReg(rddi::k_rddi_handle, 0, DAP_REG_DP_ABORT, val);
+    // Write Abort Register, together with the pending bits of a previous error
+    status = rddi::DAP_WriteReg(rddi::k_rddi_handle, 0, DAP_REG_DP_ABORT, val | kSWDAbortPending);
     if (status)
         return (rddi::RDDI_DAP_ERROR_DEBUG);
+    kSWDAbortPending = 0;
 
     return (0);
 }
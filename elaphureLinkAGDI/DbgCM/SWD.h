@@ -32,6 +32,8 @@
 
 #include "COLLECT.H"
 
+typedef struct MEM_VECTOR MEM_VECTOR; // Memory Vector Item, see Debug.h
+
 extern DWORD SWD_IDCode; // SWD ID Code
 
 
@@ -155,6 +157,36 @@ extern int SWD_WriteD8(DWORD adr, BYTE val);
 //   return value: error status
 extern int SWD_ReadBlock(DWORD adr, BYTE *pB, DWORD nMany, BYTE attrib);
 
+// SWD Read Data Ranges (32-bit Elements)
+//   pAdr    : Array of range start addresses (4-Byte aligned)
+//   pLen    : Array of range lengths in bytes (4-Byte aligned)
+//   pB      : Pointer to Buffer, receives the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+extern int SWD_ReadRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges);
+
+// SWD Write Data Ranges (32-bit Elements)
+//   pAdr    : Array of range start addresses (4-Byte aligned)
+//   pLen    : Array of range lengths in bytes (4-Byte aligned)
+//   pB      : Pointer to Buffer, holds the data of all ranges back to back
+//   nRanges : Number of ranges
+//   return value: error status
+extern int SWD_WriteRanges(const DWORD *pAdr, const DWORD *pLen, BYTE *pB, DWORD nRanges);
+
+// SWD Read Data Vector (8/16/32-bit Elements at individual addresses)
+//   pV     : Pointer to Items, 'Addr' and 'Size' are inputs, 'Val' receives the value
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+extern int SWD_ReadVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);
+
+// SWD Write Data Vector (8/16/32-bit Elements at individual addresses)
+//   pV     : Pointer to Items, 'Addr', 'Size' and 'Val' are inputs
+//   nMany  : Number of Items
+//   attrib : Attributes for memory access (Bits [2..1] - Security Attribute)
+//   return value: error status
+extern int SWD_WriteVector(MEM_VECTOR *pV, DWORD nMany, BYTE attrib);
+
 // SWD Write Data Block (32-bit Elements inside R/W Page Block)
 //   adr    : Address
 //   pB     : Pointer to Buffer
@@ -200,6 +232,13 @@ extern int SWD_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany, BYTE attrib);
 extern int SWD_WriteARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany);
 #endif // DBGCM_V8M
 
+// SWD Load ARM Memory (Program Download to RAM)
+//   nAdr   : Start Address (used also to return error addresses)
+//   pB     : Pointer to Buffer
+//   nMany  : Number of bytes to Write
+//   return value: error status
+extern int SWD_LoadARMMem(DWORD *nAdr, BYTE *pB, DWORD nMany);
+
 // SWD Verify ARM Memory
 //   nAdr   : Start Address (used also to return error addresses)
 //   pB     : Pointer to Buffer
@@ -248,6 +287,12 @@ extern int SWD_SysCallExec(RgARMCM *regs);
 //   return value: error status
 extern int SWD_SysCallRes(DWORD *rval);
 
+// SWD Wait for System Call completion and read the Result
+//   rval   : Pointer to Result Value
+//   done   : Set to TRUE if the System Call completed and *rval is valid
+//   return value: error status
+extern int SWD_SysCallWait(DWORD *rval, BOOL *done);
+
 
 // SWD Init Debugger
 //   return value: error status
@@ -73,6 +73,7 @@ ON_CBN_SELCHANGE(IDC_CONFIG_CLK, OnSelchangeConfigClk)
 ON_BN_CLICKED(IDC_CONFIG_SWJ, OnConfigSwj)
 ON_BN_CLICKED(IDC_CACHE_CODE, OnCacheCode)
 ON_BN_CLICKED(IDC_CACHE_MEM, OnCacheMem)
+ON_BN_CLICKED(IDC_CACHE_WRITE, OnCacheWrite)
 ON_BN_CLICKED(IDC_CODE_VERIFY, OnCodeVerify)
 ON_BN_CLICKED(IDC_FLASH_LOAD, OnFlashLoad)
 ON_BN_CLICKED(IDC_BOOT_RESET, OnBootReset)
@@ -561,6 +562,7 @@ BOOL CSetupDbg::OnInitDialog()
     //--- Initialize CheckBox controls:
     CheckDlgButton(IDC_CACHE_CODE, (MonConf.Opt & CACHE_CODE) ? 1 : 0);
     CheckDlgButton(IDC_CACHE_MEM, (MonConf.Opt & CACHE_MEM) ? 1 : 0);
+    CheckDlgButton(IDC_CACHE_WRITE, (MonConf.Opt & CACHE_WRITE) ? 1 : 0);
     CheckDlgButton(IDC_CODE_VERIFY, (MonConf.Opt & CODE_VERIFY) ? 1 : 0);
     CheckDlgButton(IDC_FLASH_LOAD, (MonConf.Opt & FLASH_LOAD) ? 1 : 0);
     CheckDlgButton(IDC_BOOT_RESET, (MonConf.Opt & BOOT_RESET) ? 1 : 0);
@@ -698,6 +700,14 @@ void CSetupDbg::OnCacheMem()
     }
 }
 
+void CSetupDbg::OnCacheWrite()
+{
+    MonConf.Opt &= ~CACHE_WRITE;
+    if (IsDlgButtonChecked(IDC_CACHE_WRITE)) {
+        MonConf.Opt |= CACHE_WRITE;
+    }
+}
+
 void CSetupDbg::OnCodeVerify()
 {
     MonConf.Opt &= ~CODE_VERIFY;
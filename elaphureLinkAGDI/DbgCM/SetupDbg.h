@@ -61,6 +61,7 @@ class CSetupDbg : public CPropertyPage
     afx_msg void OnConfigSwj();
     afx_msg void OnCacheCode();
     afx_msg void OnCacheMem();
+    afx_msg void OnCacheWrite();
     afx_msg void OnCodeVerify();
     afx_msg void OnFlashLoad();
     afx_msg void OnBootReset();
@@ -90,6 +90,7 @@ ON_BN_CLICKED(IDC_FLASH_ERASENONE, OnFlashErase)
 ON_BN_CLICKED(IDC_FLASH_PROGRAM, OnFlashProgram)
 ON_BN_CLICKED(IDC_FLASH_VERIFY, OnFlashVerify)
 ON_BN_CLICKED(IDC_FLASH_RESETRUN, OnFlashResetRun)
+ON_BN_CLICKED(IDC_FLASH_DELTA, OnFlashDelta)
 ON_EN_KILLFOCUS(IDC_FLASH_START, OnKillfocusFlashStart)
 ON_EN_KILLFOCUS(IDC_FLASH_SIZE, OnKillfocusFlashSize)
 ON_EN_KILLFOCUS(IDC_FLASH_RAMSTART, OnKillfocusRAMStart)
@@ -238,6 +239,7 @@ BOOL CSetupFD::OnInitDialog()
     CheckDlgButton(IDC_FLASH_PROGRAM, (FlashConf.Opt & FLASH_PROGRAM) ? 1 : 0);
     CheckDlgButton(IDC_FLASH_VERIFY, (FlashConf.Opt & FLASH_VERIFY) ? 1 : 0);
     CheckDlgButton(IDC_FLASH_RESETRUN, (FlashConf.Opt & FLASH_RESETRUN) ? 1 : 0);
+    CheckDlgButton(IDC_FLASH_DELTA, (FlashConf.Opt & FLASH_DELTA) ? 1 : 0);
 
     StringHex8(GetDlgItem(IDC_FLASH_RAMSTART), FlashConf.RAMStart);
     //StringHex4(GetDlgItem(IDC_FLASH_RAMSIZE),  FlashConf.RAMSize);
@@ -363,6 +365,14 @@ void CSetupFD::OnFlashResetRun()
     }
 }
 
+void CSetupFD::OnFlashDelta()
+{
+    FlashConf.Opt &= ~FLASH_DELTA;
+    if (IsDlgButtonChecked(IDC_FLASH_DELTA)) {
+        FlashConf.Opt |= FLASH_DELTA;
+    }
+}
+
 
 void CSetupFD::OnKillfocusFlashStart()
 {
@@ -51,6 +51,7 @@ class CSetupFD : public CPropertyPage
     afx_msg void OnFlashProgram();
     afx_msg void OnFlashVerify();
     afx_msg void OnFlashResetRun();
+    afx_msg void OnFlashDelta();
     afx_msg void OnKillfocusFlashStart();
     afx_msg void OnKillfocusFlashSize();
     afx_msg void OnKillfocusRAMStart();
@@ -33,6 +33,7 @@
 #include "..\BOM.h"
 #include "Collect.h"
 #include "Debug.h"
+#include "AccessScheduler.h"
 #include "Trace.h"
 #include "SWV.h"
 #include "ETB.h"
@@ -1542,13 +1543,10 @@ int Trace_Setup(void)
     }
 
     if (TraceConf.Protocol != TPIU_ETB) {
-        status = LinkCom(1); // Apply lock to protect AP_Sel
+        status = AS_BeginAPTransaction(TPIU_Location.AP << APSEL_P, &APSel); // Switch to TPIU Access Port
         if (status)
             return (status);
 
-        APSel  = AP_Sel;                        // Save AP_Sel
-        AP_Sel = (TPIU_Location.AP << APSEL_P); // Switch to TPIU Access Port
-
         if (TraceConf.Protocol != TPIU_TRACE_PORT) {
             // Autodetect SWO Prescaler
             if (TraceConf.SWV_Pre & 0x8000) {
@@ -1618,12 +1616,10 @@ int Trace_Setup(void)
 #endif // DBGCM_V8M
 
     end_tpiu:
-        AP_Sel = APSel; // Restore AP_Sel
-
         if (status) {
-            LinkCom(0);
+            AS_EndAPTransaction(APSel);
         } else {
-            status = LinkCom(0);
+            status = AS_EndAPTransaction(APSel);
         }
         if (status)
             return (status);
@@ -1964,13 +1960,10 @@ int Trace_ClkSync(void)
     if (status)
         return (status);
 
-    status = LinkCom(1); // Apply lock to protect AP_Sel
+    status = AS_BeginAPTransaction(TPIU_Location.AP << APSEL_P, &APSel); // Switch to TPIU Access Port
     if (status)
         return (status);
 
-    APSel  = AP_Sel;                        // Save AP_Sel
-    AP_Sel = (TPIU_Location.AP << APSEL_P); // Switch to TPIU Access Port
-
     // Setup TPIU
 #if DBGCM_V8M
     status = WriteD32(TPIU_ASYNCLKPRES, (TraceConf.SWV_Pre & 0x1FFF), BLOCK_SECTYPE_ANY);
@@ -1980,12 +1973,10 @@ int Trace_ClkSync(void)
     // if (status) return (status);
 #endif // DBGCM_V8M
 
-    AP_Sel = APSel; // Restore AP_Sel
-
     if (status) {
-        LinkCom(0);
+        AS_EndAPTransaction(APSel);
     } else {
-        status = LinkCom(0);
+        status = AS_EndAPTransaction(APSel);
     }
     if (status)
         return (status);
@@ -0,0 +1,219 @@
+﻿/**
+ * @file WriteBuffer.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Write-back buffer for target memory writes while the target is halted
+ *
+ * Debugger scripts, memory fills and variable edits write the target in small pieces,
+ * each one a synchronous round trip. With the option enabled, writes to the RAM ranges
+ * of the memory map are kept word by word with one valid bit per byte. Other writes go
+ * to the target directly, so their errors are reported at once. The driver flushes the
+ * buffer before the target executes, before overlapping reads and before unbuffered
+ * writes. Complete words go out with one WriteRanges() call, partial words with byte
+ * accesses. A failing flush is reported with its address in the command window.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stdafx.h"
+#include "..\ComTyp.h"
+#include "COLLECT.H"
+#include "..\BOM.H"
+#include "Debug.h"
+
+#include "WriteBuffer.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+
+struct WB_WORD {
+    BYTE data[4]; // Buffered bytes
+    BYTE mask;    // Valid bytes, bit n for byte n
+};
+
+
+static std::mutex               kWBMutex;
+static std::map<DWORD, WB_WORD> kWBWords; // Buffered words by word address
+
+
+static BOOL IsSFR(DWORD nStart, DWORD nEnd)
+{
+    return (nStart <= MonConf.SFREnd && nEnd > MonConf.SFRStart);
+}
+
+
+// Check if [nStart, nEnd] lies inside one RAM range of the memory map (RAM1..3, IRAM1..2)
+static BOOL IsRAM(DWORD nStart, DWORD nEnd)
+{
+    struct dbgext *pX;
+    DWORD          used[5];
+    int            i;
+
+    if (pdbg == NULL || pdbg->pDbgX == NULL) {
+        return (FALSE);
+    }
+    pX = pdbg->pDbgX;
+
+    used[0] = pX->uRAM1;
+    used[1] = pX->uRAM2;
+    used[2] = pX->uRAM3;
+    used[3] = pX->uIRAM1;
+    used[4] = pX->uIRAM2;
+
+    for (i = 0; i < 5; i++) {
+        const MEMRANGE &r = pX->rOCR[5 + i]; // [5]:=RAM1 ... [9]:=IRAM2
+        if (!used[i] || r.nSize == 0)
+            continue;
+        if (nStart >= r.nStart && nEnd - r.nStart < r.nSize)
+            return (TRUE);
+    }
+    return (FALSE);
+}
+
+
+int WriteBuffer_Write(DWORD nAdr, const BYTE *pB, DWORD nMany)
+{
+    std::lock_guard<std::mutex> lk(kWBMutex);
+    DWORD                       nWords, adr, n;
+
+    if (nMany == 0 || nAdr + nMany - 1 < nAdr) {
+        return (0);
+    }
+    if (nAdr + nMany > PPBAddr) {
+        return (0); // Debug registers are written directly
+    }
+    if (IsSFR(nAdr, nAdr + nMany)) {
+        return (0); // SFR writes have side effects, keep their order
+    }
+    if (!IsRAM(nAdr, nAdr + nMany - 1)) {
+        return (0); // Flash, ROM and unmapped addresses are written directly, errors are reported at once
+    }
+
+    // New words needed for this write
+    nWords = 0;
+    for (adr = nAdr & ~3UL; adr < nAdr + nMany; adr += 4) {
+        if (kWBWords.find(adr) == kWBWords.end())
+            nWords++;
+    }
+    if (kWBWords.size() + nWords > WB_MAX_WORDS) {
+        return (0);
+    }
+
+    for (n = 0; n < nMany; n++) {
+        adr = nAdr + n;
+
+        WB_WORD &w      = kWBWords[adr & ~3UL]; // value initialized if new
+        w.data[adr & 3] = pB[n];
+        w.mask |= 1 << (adr & 3);
+    }
+
+    return (1);
+}
+
+
+BOOL WriteBuffer_Overlaps(DWORD nAdr, DWORD nMany)
+{
+    std::lock_guard<std::mutex> lk(kWBMutex);
+
+    if (kWBWords.empty() || nMany == 0) {
+        return (FALSE);
+    }
+
+    // First buffered word ending after nAdr
+    auto it = kWBWords.lower_bound(nAdr & ~3UL);
+    return (it != kWBWords.end() && it->first < nAdr + nMany);
+}
+
+
+BOOL WriteBuffer_Pending(void)
+{
+    std::lock_guard<std::mutex> lk(kWBMutex);
+
+    return (!kWBWords.empty());
+}
+
+
+// Write buffered bytes with the regular memory access, *pAdr receives the failing address
+static int WriteBuffer_Direct(DWORD *pAdr, BYTE *pB, DWORD nMany)
+{
+#if DBGCM_V8M
+    return (WriteARMMem(pAdr, pB, nMany, BLOCK_SECTYPE_ANY));
+#else  // DBGCM_V8M
+    return (WriteARMMem(pAdr, pB, nMany));
+#endif // DBGCM_V8M
+}
+
+
+int WriteBuffer_Flush(DWORD *pErrAdr)
+{
+    std::lock_guard<std::mutex> lk(kWBMutex);
+    std::vector<DWORD>          adr, len;
+    std::vector<BYTE>           data;
+    DWORD                       a, i, n, k;
+    BYTE                       *pB;
+    int                         status = 0;
+
+    if (kWBWords.empty()) {
+        return (0);
+    }
+
+    // Complete words, adjacent words form one range
+    for (auto &w : kWBWords) {
+        if (w.second.mask != 0x0F)
+            continue;
+        if (!adr.empty() && adr.back() + len.back() == w.first) {
+            len.back() += 4;
+        } else {
+            adr.push_back(w.first);
+            len.push_back(4);
+        }
+        data.insert(data.end(), w.second.data, w.second.data + 4);
+    }
+
+    if (!adr.empty()) {
+        if (WriteRanges != NULL) {
+            status = WriteRanges(adr.data(), len.data(), data.data(), (DWORD)adr.size());
+        }
+        if (WriteRanges == NULL || status) {
+            // Write range by range to find the failing address
+            pB = data.data();
+            for (i = 0; i < adr.size(); pB += len[i], i++) {
+                a      = adr[i];
+                status = WriteBuffer_Direct(&a, pB, len[i]);
+                if (status) {
+                    *pErrAdr = a;
+                    goto out;
+                }
+            }
+        }
+    }
+
+    // Partial words, one access per run of valid bytes
+    for (auto &w : kWBWords) {
+        if (w.second.mask == 0x0F)
+            continue;
+        k = 0;
+        while (k < 4) {
+            if (!(w.second.mask & (1 << k))) {
+                k++; // byte not written
+                continue;
+            }
+            n = 1;
+            while (k + n < 4 && (w.second.mask & (1 << (k + n))))
+                n++;
+
+            a      = w.first + k;
+            status = WriteBuffer_Direct(&a, &w.second.data[k], n);
+            if (status) {
+                *pErrAdr = a;
+                goto out;
+            }
+            k += n;
+        }
+    }
+
+out:
+    kWBWords.clear();
+    return (status);
+}
@@ -0,0 +1,40 @@
+﻿/**
+ * @file WriteBuffer.h
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Write-back buffer for target memory writes while the target is halted
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#define WB_MAX_WORDS 1024 // Words held before the buffer must be flushed (4KB)
+
+
+/**
+ * @brief Buffer a memory write. Overlapping and adjacent writes are merged.
+ *
+ * @return 1: buffered, 0: not RAM of the memory map, SFR/PPB range or buffer full,
+ *         the caller writes to the target
+ */
+extern int WriteBuffer_Write(DWORD nAdr, const BYTE *pB, DWORD nMany);
+
+/**
+ * @brief Check if buffered data overlaps a range, it must be flushed before the range is read.
+ */
+extern BOOL WriteBuffer_Overlaps(DWORD nAdr, DWORD nMany);
+
+/**
+ * @brief Check if the buffer holds data.
+ */
+extern BOOL WriteBuffer_Pending(void);
+
+/**
+ * @brief Write all buffered data to the target with one WriteRanges() call. If that fails
+ *        the data is written range by range to find the failing address. The buffer is
+ *        empty afterwards in any case.
+ *
+ * @param pErrAdr receives the address of the failing access
+ * @return 0: OK, else error code
+ */
+extern int WriteBuffer_Flush(DWORD *pErrAdr);
@@ -42,6 +42,8 @@ decltype(::CMSIS_DAP_ConfigureDAP) *CMSIS_DAP_ConfigureDAP = nullptr;
 decltype(::CMSIS_DAP_Capabilities) *CMSIS_DAP_Capabilities = nullptr;
 decltype(::CMSIS_DAP_SWJ_Sequence) *CMSIS_DAP_SWJ_Sequence = nullptr;
 decltype(::CMSIS_DAP_SWJ_Pins)     *CMSIS_DAP_SWJ_Pins     = nullptr;
+decltype(::DAP_SetCommTimeout)     *DAP_SetCommTimeout     = nullptr;
+decltype(::DAP_GetRegAccessDone)   *DAP_GetRegAccessDone   = nullptr;
 
 
 RDDIHandle k_rddi_handle;
@@ -45,6 +45,8 @@ extern decltype(::CMSIS_DAP_GetGUID)            *CMSIS_DAP_GetGUID;
 extern decltype(::CMSIS_DAP_Capabilities)       *CMSIS_DAP_Capabilities;
 extern decltype(::CMSIS_DAP_SWJ_Sequence)       *CMSIS_DAP_SWJ_Sequence;
 extern decltype(::CMSIS_DAP_SWJ_Pins)           *CMSIS_DAP_SWJ_Pins;
+extern decltype(::DAP_SetCommTimeout)           *DAP_SetCommTimeout;
+extern decltype(::DAP_GetRegAccessDone)         *DAP_GetRegAccessDone;
 
 enum {
     RDDI_DAP_ERROR          = 0x2000, // RDDI-DAP Error
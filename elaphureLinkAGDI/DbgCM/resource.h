@@ -50,6 +50,7 @@
 #define IDC_INIT_RST                 1035
 #define IDC_RST_TYPE                 1036
 #define IDC_BOOT_RUN                 1037
+#define IDC_CACHE_WRITE              1038
 #define IDC_TRACE_CLOCK              1100
 #define IDC_TRACE_ENABLE             1101
 #define IDC_ETM_ENABLE               1102
@@ -122,6 +123,7 @@
 #define IDC_FLASH_START              1208
 #define IDC_FLASH_SIZE               1209
 #define IDC_FLASH_ALGLIST            1210
+#define IDC_FLASH_DELTA              1211
 #define ID_ADD                       1220
 #define ID_REMOVE                    1221
 #define IDC_TRACE_RECLIST            1300
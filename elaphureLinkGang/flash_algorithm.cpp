@@ -0,0 +1,122 @@
+﻿/**
+ * @file flash_algorithm.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief CMSIS flash algorithm (FLM) loader of the gang programmer
+ *
+ * Follows LoadFlashDevice() and LoadFlashAlgorithm() of the debug driver (DbgCM/Flash.cpp):
+ * the same symbols, the same stubs for missing functions and the same RAM layout, so an
+ * algorithm behaves as it does when it is programmed from uVision. The FLM is parsed by
+ * common/flm.cpp, the same parser the driver uses. The object can be shared by any number
+ * of targets.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "flash_algorithm.hpp"
+
+
+// ARM SW Break Point Code - Thumb Mode (BKPT 0)
+static const uint8_t kBreakPointARM[] = {
+    0x00, 0xBE
+};
+
+// ARM - Thumb Blank Check Function, see DbgCM/Flash.cpp
+static const uint8_t kBlankCheckARM[] = {
+    0x05, 0xE0, 0x03, 0x78, 0x40, 0x1C, 0x93, 0x42,
+    0x01, 0xD0, 0x01, 0x20, 0x70, 0x47, 0x49, 0x1E,
+    0xF7, 0xD2, 0x00, 0x20, 0x70, 0x47
+};
+
+
+bool FlashAlgorithm::load(const std::string &path, uint32_t ram_start, uint32_t ram_size, std::string &error)
+{
+    flm::File      file;
+    flm::Device    dev;
+    flm::Algorithm alg;
+
+    if (!file.load(path, error) || !file.get_device(dev, error) || !file.get_algorithm(alg, error)) {
+        return false;
+    }
+
+    // FlashDevice structure
+    dev_name    = dev.name;
+    dev_adr     = dev.adr;
+    dev_size    = dev.size;
+    page_size   = dev.page_size;
+    value_empty = dev.value_empty;
+    to_prog     = dev.to_prog;
+    to_erase    = dev.to_erase;
+    if (page_size > flm::kPageMax)
+        page_size = flm::kPageMax;
+    if (page_size == 0)
+        page_size = 1;
+
+    for (auto &s : dev.sectors) {
+        if (s.size == 0) {
+            error = "FlashDevice has an empty sector";
+            return false;
+        }
+    }
+    if (dev.sectors.empty()) {
+        error = "FlashDevice has no sectors";
+        return false;
+    }
+    sectors = std::move(dev.sectors);
+
+    // Programming Algorithms
+    break_point  = alg.break_point;
+    init         = alg.init;
+    uninit       = alg.uninit;
+    blank_check  = alg.blank_check;
+    erase_sector = alg.erase_sector;
+    program_page = alg.program_page;
+    static_base  = alg.static_base;
+
+    // Stubs of missing functions go in front of the algorithm
+    const bool break_stub = (break_point == flm::kNotFound);
+    const bool blank_stub = (blank_check == flm::kNotFound);
+
+    code.clear();
+    if (break_stub) {
+        break_point = (ram_start + (uint32_t)code.size()) | 1;
+        code.insert(code.end(), kBreakPointARM, kBreakPointARM + sizeof(kBreakPointARM));
+    }
+    if (blank_stub) {
+        blank_check = (ram_start + (uint32_t)code.size()) | 1;
+        code.insert(code.end(), kBlankCheckARM, kBlankCheckARM + sizeof(kBlankCheckARM));
+    }
+    const uint32_t ofs = ((uint32_t)code.size() + 3) & ~0x00000003;
+    code.resize(ofs, 0);
+
+    const uint32_t base = ram_start + ofs;
+    if (!break_stub)
+        break_point += base;
+    if (!blank_stub)
+        blank_check += base;
+    init += base;
+    uninit += base;
+    erase_sector += base;
+    program_page += base;
+    static_base += base;
+    stack_ptr = ram_start + ram_size;
+    load_adr  = ram_start;
+
+    uint32_t stack_size = (alg.stack_size + 7) & ~0x00000007;
+    if (stack_size < 32)
+        stack_size = 32;
+
+    const uint32_t szm = (alg.code_memsz + ofs + 3) & ~0x00000003;
+    if ((uint64_t)szm + page_size + stack_size > ram_size) {
+        error = "insufficient RAM for flash algorithms";
+        return false;
+    }
+    prg_buf = ram_start + szm; // Append Buffer at end of Algorithm
+    code.insert(code.end(), alg.code.begin(), alg.code.end());
+    return true;
+}
+
+
+void FlashAlgorithm::find_sector(uint32_t adr, uint32_t *sector_adr, uint32_t *sector_size) const
+{
+    flm::find_sector(sectors, dev_adr, adr, sector_adr, sector_size);
+}
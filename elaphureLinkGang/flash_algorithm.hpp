@@ -0,0 +1,63 @@
+﻿/**
+ * @file flash_algorithm.hpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief CMSIS flash algorithm (FLM) loader of the gang programmer
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#include "common/flm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/*
+ * Flash device description and algorithm of one FLM file, relocated to the RAM given to
+ * load(). The object is read only afterwards and shared by all targets.
+ */
+class FlashAlgorithm
+{
+    public:
+    /**
+     * @brief Load the FlashDevice description and the algorithm code of an FLM file.
+     *
+     * @param path FLM file
+     * @param ram_start RAM start for the flash functions
+     * @param ram_size RAM size for the flash functions
+     * @param error receives the reason on failure
+     * @return true on success
+     */
+    bool load(const std::string &path, uint32_t ram_start, uint32_t ram_size, std::string &error);
+
+    /**
+     * @brief Find the sector which holds an address, sectors repeat up to the end of the device.
+     */
+    void find_sector(uint32_t adr, uint32_t *sector_adr, uint32_t *sector_size) const;
+
+    // FlashDevice
+    std::string              dev_name;
+    uint32_t                 dev_adr     = 0; // Device Start Address
+    uint32_t                 dev_size    = 0; // Total Size of Device
+    uint32_t                 page_size   = 0; // Programming Page Size
+    uint8_t                  value_empty = 0; // Content of Erased Memory
+    uint32_t                 to_prog     = 0; // Time Out of Program Page Function (ms)
+    uint32_t                 to_erase    = 0; // Time Out of Erase Sector Function (ms)
+    std::vector<flm::Sector> sectors;
+
+    // Algorithm, relocated
+    uint32_t             load_adr = 0; // Load Address of code
+    std::vector<uint8_t> code;         // Code and data, stubs first
+    uint32_t             break_point  = 0;
+    uint32_t             init         = 0;
+    uint32_t             uninit       = 0;
+    uint32_t             blank_check  = 0;
+    uint32_t             erase_sector = 0;
+    uint32_t             program_page = 0;
+    uint32_t             static_base  = 0;
+    uint32_t             stack_ptr    = 0;
+    uint32_t             prg_buf      = 0; // RAM Buffer for the Page Data
+};
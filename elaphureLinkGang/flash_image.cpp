@@ -0,0 +1,200 @@
+﻿/**
+ * @file flash_image.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Image loader and programming plan of the gang programmer
+ *
+ * The pages are planned by flm::plan_pages(), the planner the debug driver uses: fragments are
+ * sorted by address and merged into page buffers padded with the empty value, so each page
+ * needs one ProgramPage call no matter how the image is split.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "flash_image.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+static int hex_value(const char *p)
+{
+    int v = 0;
+    for (int i = 0; i < 2; i++) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9')
+            v |= c - '0';
+        else if (c >= 'A' && c <= 'F')
+            v |= c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f')
+            v |= c - 'a' + 10;
+        else
+            return -1;
+    }
+    return v;
+}
+
+
+static bool load_hex(FILE *fh, std::vector<ImageFragment> &fragments, std::string &error)
+{
+    char     line[600];
+    uint8_t  rec[256 + 5];
+    uint32_t upper = 0; // Extended segment or linear address
+    int      line_no = 0;
+
+    while (fgets(line, sizeof(line), fh)) {
+        line_no++;
+
+        size_t len = strlen(line);
+        while (len && (line[len - 1] == '\r' || line[len - 1] == '\n' || line[len - 1] == ' '))
+            line[--len] = '\0';
+        if (len == 0)
+            continue;
+        if (line[0] != ':' || len < 11 || (len - 1) % 2) {
+            error = "bad HEX record in line " + std::to_string(line_no);
+            return false;
+        }
+
+        size_t  n   = (len - 1) / 2;
+        uint8_t sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            int v = hex_value(&line[1 + i * 2]);
+            if (v < 0 || i >= sizeof(rec)) {
+                error = "bad HEX record in line " + std::to_string(line_no);
+                return false;
+            }
+            rec[i] = (uint8_t)v;
+            sum += rec[i];
+        }
+        if (sum != 0 || rec[0] + 5u != n) {
+            error = "HEX checksum error in line " + std::to_string(line_no);
+            return false;
+        }
+
+        const uint32_t cnt = rec[0];
+        const uint32_t ofs = (rec[1] << 8) | rec[2];
+        switch (rec[3]) {
+            case 0x00: { // Data
+                const uint32_t adr = upper + ofs;
+                if (!fragments.empty() && fragments.back().adr + fragments.back().data.size() == adr) {
+                    fragments.back().data.insert(fragments.back().data.end(), &rec[4], &rec[4 + cnt]);
+                } else {
+                    fragments.push_back({ adr, std::vector<uint8_t>(&rec[4], &rec[4 + cnt]) });
+                }
+                break;
+            }
+            case 0x01: // End of file
+                return true;
+            case 0x02: // Extended segment address
+                if (cnt != 2)
+                    goto bad;
+                upper = ((rec[4] << 8) | rec[5]) << 4;
+                break;
+            case 0x04: // Extended linear address
+                if (cnt != 2)
+                    goto bad;
+                upper = ((rec[4] << 8) | rec[5]) << 16;
+                break;
+            case 0x03: // Start segment address
+            case 0x05: // Start linear address
+                break;
+            default:
+                goto bad;
+        }
+        continue;
+
+    bad:
+        error = "unsupported HEX record in line " + std::to_string(line_no);
+        return false;
+    }
+
+    return true; // Missing end record
+}
+
+
+bool image_load(const std::string &path, uint32_t base, std::vector<ImageFragment> &fragments, std::string &error)
+{
+    std::string ext;
+    size_t      dot = path.rfind('.');
+    if (dot != std::string::npos) {
+        ext = path.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    }
+
+    fragments.clear();
+
+    FILE *fh = fopen(path.c_str(), ext == "hex" || ext == "ihex" ? "r" : "rb");
+    if (fh == nullptr) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    bool ok = true;
+    if (ext == "hex" || ext == "ihex") {
+        ok = load_hex(fh, fragments, error);
+    } else {
+        ImageFragment f{ base, {} };
+        uint8_t       buf[4096];
+        size_t        n;
+        while ((n = fread(buf, 1, sizeof(buf), fh)) > 0) {
+            f.data.insert(f.data.end(), buf, buf + n);
+        }
+        fragments.push_back(std::move(f));
+    }
+    fclose(fh);
+
+    if (ok && fragments.empty()) {
+        error = "empty image";
+        ok    = false;
+    }
+    return ok;
+}
+
+
+bool plan_build(const FlashAlgorithm &alg, std::vector<ImageFragment> &fragments, FlashPlan &plan, std::string &error)
+{
+    const uint32_t             start = alg.dev_adr;
+    std::vector<flm::Fragment> frags;
+    uint32_t                   sec_adr, sec_sz;
+
+    plan = FlashPlan();
+
+    for (auto &f : fragments) {
+        if (f.data.empty())
+            continue;
+        if (f.adr < start || (uint64_t)f.adr + f.data.size() > (uint64_t)start + alg.dev_size) {
+            char buf[96];
+            snprintf(buf, sizeof(buf), "image 0x%08X - 0x%08X is outside the flash device",
+                     f.adr, (uint32_t)(f.adr + f.data.size() - 1));
+            error = buf;
+            return false;
+        }
+        frags.push_back({ f.adr, (uint32_t)f.data.size(), f.data.data(), 0 });
+    }
+
+    // One page layout, the gang runs a single algorithm
+    flm::plan_pages(frags, { { start, alg.page_size, alg.value_empty } }, false, plan.pages, plan.buffer);
+    for (auto &p : plan.pages) {
+        plan.image_bytes += p.cnt;
+    }
+
+    // Sectors touched by the pages
+    for (auto &p : plan.pages) {
+        uint32_t adr = p.adr;
+        while (adr < p.adr + p.sz) {
+            alg.find_sector(adr, &sec_adr, &sec_sz);
+            if (plan.sectors.empty() || plan.sectors.back().adr != sec_adr)
+                plan.sectors.push_back({ sec_adr, sec_sz });
+            adr = sec_adr + sec_sz;
+            if (adr <= sec_adr)
+                break; // End of the address space
+        }
+    }
+
+    if (plan.pages.empty()) {
+        error = "empty image";
+        return false;
+    }
+    return true;
+}
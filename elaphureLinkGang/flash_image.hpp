@@ -0,0 +1,58 @@
+﻿/**
+ * @file flash_image.hpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Image loader and programming plan of the gang programmer
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#include "flash_algorithm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct ImageFragment {
+    uint32_t             adr;
+    std::vector<uint8_t> data;
+};
+
+
+struct PlanSector {
+    uint32_t adr;
+    uint32_t size;
+};
+
+/*
+ * Sectors and pages to program, built once and shared read only by all targets.
+ */
+struct FlashPlan {
+    std::vector<PlanSector> sectors; // Sectors to erase in address order
+    std::vector<flm::Page>  pages;   // Pages to program in address order
+    std::vector<uint8_t>    buffer;  // Page data padded with the empty value, whole words
+    uint32_t                image_bytes = 0;
+};
+
+
+/**
+ * @brief Load an image file. Intel HEX files (.hex, .ihex) carry their addresses, every other
+ *        file is taken as a raw binary at base.
+ *
+ * @param path image file
+ * @param base load address of a binary file
+ * @param fragments receives the image data
+ * @param error receives the reason on failure
+ * @return true on success
+ */
+extern bool image_load(const std::string &path, uint32_t base, std::vector<ImageFragment> &fragments, std::string &error);
+
+/**
+ * @brief Build the programming plan: the image is merged into pages padded with the empty
+ *        value, sectors which hold image data are erased.
+ *
+ * @return true on success, false if the image is not inside the flash device
+ */
+extern bool plan_build(const FlashAlgorithm &alg, std::vector<ImageFragment> &fragments, FlashPlan &plan, std::string &error);
@@ -0,0 +1,273 @@
+﻿/**
+ * @file gang.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Headless gang programmer: flash one image to many elaphureLink probes in parallel
+ *
+ * The FLM is parsed and the image is planned once, then each target runs its own
+ * ProbeSession on a worker thread. Sessions share the algorithm and the plan read only and
+ * have no other common state, so targets are programmed concurrently and one failing
+ * target does not stop the others.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "flash_algorithm.hpp"
+#include "flash_image.hpp"
+#include "probe_session.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct GangConfig {
+    std::string              algo;
+    std::string              image;
+    uint32_t                 base      = 0;
+    uint32_t                 ram_start = 0x20000000;
+    uint32_t                 ram_size  = 0x1000;
+    int                      jobs      = 0; // 0: all targets at once
+    GangOptions              options;
+    std::vector<std::string> probes;
+};
+
+
+static const char *kPhaseName[] = {
+    "wait", "connect", "load", "erase", "program", "verify", "reset", "done", "FAILED"
+};
+
+
+static void print_usage()
+{
+    printf("usage: elaphureLinkGang --algo FILE.FLM --image FILE [options] PROBE [PROBE ...]\n"
+           "  PROBE                   probe address HOST[:PORT], port 3240 by default\n"
+           "  --algo FILE             CMSIS flash algorithm (FLM)\n"
+           "  --image FILE            Intel HEX (.hex) or binary image\n"
+           "  --base ADDR             load address of a binary image (default: flash start)\n"
+           "  --ram ADDR:SIZE         RAM for the flash algorithm (default 0x20000000:0x1000)\n"
+           "  --probes FILE           read more probe addresses from FILE, one per line\n"
+           "  --jobs N                targets programmed at the same time (default: all)\n"
+           "  --swj-clock HZ          SWD clock (default 10000000)\n"
+           "  --cpu-clock HZ          clock passed to Init() of the algorithm (default 12000000)\n"
+           "  --timeout-ms N          timeout of one probe exchange (default 3000)\n"
+           "  --init-timeout-ms N     timeout of Init() and UnInit() of the algorithm (default 3000)\n"
+           "  --verify                read back and compare the programmed pages\n"
+           "  --reset-run             reset and run the targets when done\n");
+}
+
+static bool parse_number(const char *s, uint32_t &value)
+{
+    char *end;
+    value = strtoul(s, &end, 0);
+    return *s != '\0' && *end == '\0';
+}
+
+static bool read_probe_list(const char *path, std::vector<std::string> &probes)
+{
+    FILE *fh = fopen(path, "r");
+    if (fh == nullptr) {
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), fh)) {
+        std::string s = line;
+        size_t      hash = s.find('#');
+        if (hash != std::string::npos)
+            s.erase(hash);
+        s.erase(0, s.find_first_not_of(" \t\r\n"));
+        s.erase(s.find_last_not_of(" \t\r\n") + 1);
+        if (!s.empty())
+            probes.push_back(s);
+    }
+    fclose(fh);
+    return true;
+}
+
+static bool parse_args(int argc, char **argv, GangConfig &config, bool &has_base)
+{
+    uint32_t v;
+
+    has_base = false;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (strcmp(arg, "--verify") == 0) {
+            config.options.verify = true;
+            continue;
+        }
+        if (strcmp(arg, "--reset-run") == 0) {
+            config.options.reset_run = true;
+            continue;
+        }
+        if (strncmp(arg, "--", 2) != 0) {
+            config.probes.push_back(arg);
+            continue;
+        }
+
+        const char *value = i + 1 < argc ? argv[++i] : nullptr;
+        if (value == nullptr) {
+            return false;
+        }
+
+        if (strcmp(arg, "--algo") == 0) {
+            config.algo = value;
+        } else if (strcmp(arg, "--image") == 0) {
+            config.image = value;
+        } else if (strcmp(arg, "--base") == 0) {
+            if (!parse_number(value, config.base))
+                return false;
+            has_base = true;
+        } else if (strcmp(arg, "--ram") == 0) {
+            std::string s   = value;
+            size_t      pos = s.find(':');
+            if (pos == std::string::npos || !parse_number(s.substr(0, pos).c_str(), config.ram_start) ||
+                !parse_number(s.substr(pos + 1).c_str(), config.ram_size))
+                return false;
+        } else if (strcmp(arg, "--probes") == 0) {
+            if (!read_probe_list(value, config.probes)) {
+                printf("cannot read %s\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--jobs") == 0) {
+            if (!parse_number(value, v))
+                return false;
+            config.jobs = (int)v;
+        } else if (strcmp(arg, "--swj-clock") == 0) {
+            if (!parse_number(value, config.options.swj_clock))
+                return false;
+        } else if (strcmp(arg, "--cpu-clock") == 0) {
+            if (!parse_number(value, config.options.cpu_clock))
+                return false;
+        } else if (strcmp(arg, "--timeout-ms") == 0) {
+            if (!parse_number(value, v) || v == 0)
+                return false;
+            config.options.timeout_ms = (int)v;
+        } else if (strcmp(arg, "--init-timeout-ms") == 0) {
+            if (!parse_number(value, config.options.init_timeout_ms) || config.options.init_timeout_ms == 0)
+                return false;
+        } else {
+            return false;
+        }
+    }
+
+    return !config.algo.empty() && !config.image.empty() && !config.probes.empty();
+}
+
+
+/*
+ * Print a line for each target whose phase changed or whose progress moved by 10%.
+ * Only the main thread prints.
+ */
+static void print_progress(const std::vector<std::unique_ptr<ProbeSession>> &sessions, std::vector<int> &last)
+{
+    for (size_t i = 0; i < sessions.size(); i++) {
+        const int phase   = sessions[i]->phase();
+        const int percent = sessions[i]->percent();
+        const int key     = phase * 1000 + percent / 10;
+
+        if (key == last[i] || phase == GANG_PHASE_WAIT)
+            continue;
+        last[i] = key;
+
+        if (phase == GANG_PHASE_ERASE || phase == GANG_PHASE_PROGRAM || phase == GANG_PHASE_VERIFY) {
+            printf("[%2zu] %-24s %-8s %3d%%\n", i, sessions[i]->address().c_str(), kPhaseName[phase], percent);
+        } else {
+            printf("[%2zu] %-24s %s\n", i, sessions[i]->address().c_str(), kPhaseName[phase]);
+        }
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    GangConfig                 config;
+    FlashAlgorithm             alg;
+    std::vector<ImageFragment> fragments;
+    FlashPlan                  plan;
+    std::string                error;
+    bool                       has_base;
+
+    setvbuf(stdout, nullptr, _IONBF, 0);
+    if (!parse_args(argc, argv, config, has_base)) {
+        print_usage();
+        return 2;
+    }
+
+    // One algorithm and one plan for all targets
+    if (!alg.load(config.algo, config.ram_start, config.ram_size, error)) {
+        printf("%s: %s\n", config.algo.c_str(), error.c_str());
+        return 2;
+    }
+    if (!image_load(config.image, has_base ? config.base : alg.dev_adr, fragments, error)) {
+        printf("%s: %s\n", config.image.c_str(), error.c_str());
+        return 2;
+    }
+    if (!plan_build(alg, fragments, plan, error)) {
+        printf("%s: %s\n", config.image.c_str(), error.c_str());
+        return 2;
+    }
+
+    printf("algorithm: %s, 0x%08X, %u KB, page %u\n", alg.dev_name.c_str(), alg.dev_adr, alg.dev_size / 1024, alg.page_size);
+    printf("image: %u bytes, %zu sectors, %zu pages, %zu targets\n",
+           plan.image_bytes, plan.sectors.size(), plan.pages.size(), config.probes.size());
+
+    std::vector<std::unique_ptr<ProbeSession>> sessions;
+    for (auto &probe : config.probes) {
+        sessions.push_back(std::make_unique<ProbeSession>(probe));
+    }
+
+    // Each worker takes the next target until all are done
+    std::atomic<size_t>      next(0);
+    std::atomic<size_t>      finished(0);
+    std::vector<double>      seconds(sessions.size(), 0);
+    std::vector<std::thread> workers;
+    size_t                   jobs = config.jobs > 0 ? (size_t)config.jobs : sessions.size();
+    if (jobs > sessions.size())
+        jobs = sessions.size();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t w = 0; w < jobs; w++) {
+        workers.emplace_back([&]() {
+            size_t i;
+            while ((i = next++) < sessions.size()) {
+                const auto t = std::chrono::steady_clock::now();
+                sessions[i]->run(alg, plan, config.options);
+                seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+                finished++;
+            }
+        });
+    }
+
+    std::vector<int> last(sessions.size(), -1);
+    while (finished < sessions.size()) {
+        print_progress(sessions, last);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    print_progress(sessions, last);
+
+    const double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Results
+    int failed = 0;
+    printf("\n%-4s %-24s %-7s %8s  %s\n", "#", "probe", "result", "time(s)", "message");
+    for (size_t i = 0; i < sessions.size(); i++) {
+        const bool ok = sessions[i]->phase() == GANG_PHASE_DONE;
+        if (!ok)
+            failed++;
+        printf("%-4zu %-24s %-7s %8.2f  %s\n", i, sessions[i]->address().c_str(), ok ? "OK" : "FAILED", seconds[i],
+               ok ? "" : sessions[i]->error().c_str());
+    }
+    printf("\n%zu passed, %d failed, %.2f s\n", sessions.size() - failed, failed, total);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,895 @@
+﻿/**
+ * @file probe_session.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief One target of the gang programmer: probe connection and flash sequence
+ *
+ * The connection follows SocketClient of the proxy: handshake, then one CMSIS-DAP request and
+ * one response per exchange, every exchange with a deadline. The flash sequence follows the
+ * debug driver (DbgCM/Flash.cpp and ELVendor.cpp): with the FlashOS vendor commands the probe
+ * loads the algorithm and runs Init, EraseSector, ProgramPage and UnInit by itself, the host
+ * only sends the page data. Other probes get the algorithm and the page data with
+ * DAP_TransferBlock and the host runs each function through the core debug registers, as
+ * SWD_SysCallExec and SWD_SysCallWait do. Native DAP commands are used to attach, halt, verify
+ * and reset the target.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "probe_session.hpp"
+
+#include "common/dap.hpp"
+#include "elaphureLinkProxy/protocol.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+
+#define DP_ABORT       0x00
+#define DP_IDCODE      0x02 // Read
+#define DP_CTRL_STAT_W 0x04
+#define DP_CTRL_STAT_R 0x06
+#define DP_SELECT      0x08
+#define AP_CSW         0x01
+#define AP_TAR         0x05
+#define AP_DRW_W       0x0D
+#define AP_DRW_R       0x0F
+#define AP_BD0_W       0x01 // Banked data of bank 1 with TAR = DHCSR: DHCSR, DCRSR, DCRDR
+#define AP_BD0_R       0x03
+#define AP_BD1_W       0x05
+#define AP_BD2_W       0x09
+#define AP_BD2_R       0x0B
+#define BANK_DHCSR     0x10 // SELECT of AP 0 bank 1
+
+#define TRANSFER_RnW         0x02
+#define TRANSFER_MATCH_VALUE 0x10 // Read until the value matches under the match mask
+#define TRANSFER_MATCH_MASK  0x20 // Write the match mask
+
+#define CSW_VALUE      0x23000012 // 32-bit, single auto increment, DbgSwEnable, privileged data
+#define CSYSPWRUPREQ   0x40000000
+#define CDBGPWRUPREQ   0x10000000
+#define CSYSPWRUPACK   0x80000000
+#define CDBGPWRUPACK   0x20000000
+#define STICKY_CLEAR   0x0000001E // STKCMPCLR, STKERRCLR, WDERRCLR, ORUNERRCLR
+
+#define DHCSR          0xE000EDF0
+#define DEMCR          0xE000EDFC
+#define AIRCR          0xE000ED0C
+#define DBGKEY         0xA05F0000
+#define C_DEBUGEN      0x00000001
+#define C_HALT         0x00000002
+#define S_REGRDY       0x00010000
+#define S_HALT         0x00020000
+#define DCRSR_REGWnR   0x00010000
+#define SYSRESETREQ    0x05FA0004
+
+#define ELV_HEADER_SIZE  4    // Prefix, command type, payload length
+#define ELV_CHUNK_SIZE   1024 // Data bytes per command, one request must fit into the 1400 bytes MTU
+#define ELV_CAP_FLASHOS  0x3F // Command types 0x2 - 0x7 in the first bitmap byte, left bit first
+#define ELV_DESC_PRESENT 0x80 // First bit of load_algorithm: FlashOS description present
+#define ELV_LAST_DATA    0x80 // First bit of program_page: last data of the page
+#define ELV_COMM_MARGIN  1000 // Time in ms added to the function timeout for the transfer
+
+#define CONNECT_TIMEOUT_MS 5000
+#define HALT_TIMEOUT_MS    500
+
+
+static void put_u32(uint8_t *p, uint32_t val)
+{
+    p[0] = (uint8_t)val;
+    p[1] = (uint8_t)(val >> 8);
+    p[2] = (uint8_t)(val >> 16);
+    p[3] = (uint8_t)(val >> 24);
+}
+
+static void put_be32(uint8_t *p, uint32_t val)
+{
+    p[0] = (uint8_t)(val >> 24);
+    p[1] = (uint8_t)(val >> 16);
+    p[2] = (uint8_t)(val >> 8);
+    p[3] = (uint8_t)val;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+
+ProbeSession::ProbeSession(const std::string &address)
+    : address_(address),
+      port_("3240"),
+      phase_(GANG_PHASE_WAIT),
+      percent_(0),
+      socket_(io_context_),
+      res_len_(0),
+      packet_size_(64),
+      swj_clock_(10000000),
+      timeout_ms_(3000),
+      flashos_(false)
+{
+    size_t pos = address.rfind(':');
+    if (pos != std::string::npos) {
+        host_ = address.substr(0, pos);
+        port_ = address.substr(pos + 1);
+    } else {
+        host_ = address;
+    }
+}
+
+
+bool ProbeSession::fail(const std::string &what)
+{
+    if (error_.empty()) {
+        error_ = what;
+    }
+    return false;
+}
+
+
+/*
+ * Run the pending operations of this session. On timeout the socket is closed, which
+ * aborts the operations, and the session is unusable afterwards.
+ */
+bool ProbeSession::wait(int timeout_ms)
+{
+    io_context_.restart();
+    io_context_.run_for(std::chrono::milliseconds(timeout_ms));
+    if (io_context_.stopped()) {
+        return true;
+    }
+
+    asio::error_code ignore;
+    socket_.close(ignore);
+    io_context_.run(); // complete the aborted handlers
+    return false;
+}
+
+
+bool ProbeSession::connect()
+{
+    asio::error_code ec = asio::error::would_block;
+
+    asio::ip::tcp::resolver resolver(io_context_);
+    auto                    endpoints = resolver.resolve(host_, port_, ec);
+    if (ec) {
+        return fail("resolve failed: " + ec.message());
+    }
+
+    ec = asio::error::would_block;
+    asio::async_connect(socket_, endpoints, [&](const asio::error_code &e, const asio::ip::tcp::endpoint &) { ec = e; });
+    if (!wait(CONNECT_TIMEOUT_MS)) {
+        return fail("connect timeout");
+    }
+    if (ec) {
+        return fail("connect failed: " + ec.message());
+    }
+
+    asio::ip::tcp::no_delay option(true);
+    socket_.set_option(option, ec);
+
+    // handshake phase
+    put_be32(&req_[0], EL_LINK_IDENTIFIER);
+    put_be32(&req_[4], EL_COMMAND_HANDSHAKE);
+    put_be32(&req_[8], EL_DAP_VERSION);
+
+    asio::error_code ec_read = asio::error::would_block;
+    asio::async_write(socket_, asio::buffer(req_.data(), 12), [&](const asio::error_code &e, size_t) { ec = e; });
+    asio::async_read(socket_, asio::buffer(res_.data(), 12), [&](const asio::error_code &e, size_t) { ec_read = e; });
+    if (!wait(timeout_ms_)) {
+        return fail("handshake timeout");
+    }
+    if (ec || ec_read) {
+        return fail("handshake failed: " + (ec ? ec : ec_read).message());
+    }
+    if (get_be32(&res_[0]) != EL_LINK_IDENTIFIER || get_be32(&res_[4]) != EL_COMMAND_HANDSHAKE) {
+        return fail("handshake failed: not an elaphureLink probe");
+    }
+
+    return true;
+}
+
+
+// Send req_, the response is in res_ / res_len_
+bool ProbeSession::exchange(size_t req_len, int timeout_ms)
+{
+    asio::error_code ec_write, ec_read = asio::error::would_block;
+
+    res_len_ = 0;
+    asio::async_write(socket_, asio::buffer(req_.data(), req_len), [&](const asio::error_code &e, size_t) { ec_write = e; });
+    socket_.async_read_some(asio::buffer(res_), [&](const asio::error_code &e, size_t n) {
+        ec_read  = e;
+        res_len_ = n;
+    });
+    if (!wait(timeout_ms)) {
+        return fail("probe response timeout");
+    }
+    if (ec_write || ec_read) {
+        return fail("connection lost: " + (ec_write ? ec_write : ec_read).message());
+    }
+    if (res_len_ == 0 || res_[0] != req_[0]) {
+        return fail("unexpected response");
+    }
+
+    return true;
+}
+
+
+// Native command which answers with its id and a status byte of 0 (DAP_OK)
+bool ProbeSession::command(const uint8_t *req, size_t req_len)
+{
+    memcpy(req_.data(), req, req_len);
+    if (!exchange(req_len, timeout_ms_)) {
+        return false;
+    }
+    if (res_len_ < 2 || res_[1] != 0) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "DAP command 0x%02X failed", req[0]);
+        return fail(buf);
+    }
+    return true;
+}
+
+
+// The operations are split into requests that fit into the packet size of the probe
+bool ProbeSession::transfer(const DapOp *ops, size_t count, uint32_t *rdata)
+{
+    while (count) {
+        size_t n = 3, res_n = 3, k;
+
+        req_[0] = ID_DAP_Transfer;
+        req_[1] = 0; // DAP index
+        for (k = 0; k < count && k < 255; k++) {
+            // Writes and value matches send data, plain reads return data
+            bool wdata = !(ops[k].request & TRANSFER_RnW) || (ops[k].request & TRANSFER_MATCH_VALUE);
+            if (n + (wdata ? 5 : 1) > packet_size_ || (!wdata && res_n + 4 > packet_size_))
+                break;
+
+            req_[n++] = ops[k].request;
+            if (wdata) {
+                put_u32(&req_[n], ops[k].data);
+                n += 4;
+            } else {
+                res_n += 4;
+            }
+        }
+        req_[2] = (uint8_t)k;
+
+        if (!exchange(n, timeout_ms_)) {
+            return false;
+        }
+        if (res_len_ < 3 || res_[1] != k || res_[2] != DAP_RES_OK) {
+            // The next access must not fail with the sticky error of this one
+            const uint8_t abort[] = { ID_DAP_WriteABORT, 0, STICKY_CLEAR, 0, 0, 0 };
+            memcpy(req_.data(), abort, sizeof(abort));
+            exchange(sizeof(abort), timeout_ms_);
+            return fail("DAP transfer failed");
+        }
+        if (res_len_ < res_n) {
+            return fail("short DAP transfer response");
+        }
+
+        n = 3;
+        for (size_t i = 0; i < k; i++) {
+            if ((ops[i].request & (TRANSFER_RnW | TRANSFER_MATCH_VALUE)) == TRANSFER_RnW) {
+                if (rdata) {
+                    *rdata++ = get_u32(&res_[n]);
+                }
+                n += 4;
+            }
+        }
+
+        ops += k;
+        count -= k;
+    }
+
+    return true;
+}
+
+
+bool ProbeSession::mem_write(uint32_t adr, uint32_t val)
+{
+    const DapOp ops[] = { { AP_TAR, adr }, { AP_DRW_W, val } };
+    return transfer(ops, 2);
+}
+
+
+bool ProbeSession::mem_read(uint32_t adr, uint32_t *val)
+{
+    const DapOp ops[] = { { AP_TAR, adr }, { AP_DRW_R, 0 } };
+    return transfer(ops, 2, val);
+}
+
+
+// Word aligned read with DAP_TransferBlock, TAR auto increment wraps at 1KB
+bool ProbeSession::mem_read_block(uint32_t adr, uint8_t *buf, uint32_t size)
+{
+    const uint32_t max_words = (packet_size_ - 4) / 4;
+
+    while (size) {
+        uint32_t words = (0x400 - (adr & 0x3FF)) / 4;
+        if (words > max_words)
+            words = max_words;
+        if (words > (size + 3) / 4)
+            words = (size + 3) / 4;
+
+        const DapOp tar[] = { { AP_TAR, adr } };
+        if (!transfer(tar, 1)) {
+            return false;
+        }
+
+        req_[0] = ID_DAP_TransferBlock;
+        req_[1] = 0; // DAP index
+        req_[2] = (uint8_t)words;
+        req_[3] = (uint8_t)(words >> 8);
+        req_[4] = AP_DRW_R;
+        if (!exchange(5, timeout_ms_)) {
+            return false;
+        }
+        if (res_len_ < 4 + words * 4 || (uint32_t)(res_[1] | (res_[2] << 8)) != words || res_[3] != DAP_RES_OK) {
+            return fail("DAP block read failed");
+        }
+
+        const uint32_t n = (words * 4 > size) ? size : words * 4;
+        memcpy(buf, &res_[4], n);
+        adr += n;
+        buf += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+
+// Write with DAP_TransferBlock, the last word is padded with zeros
+bool ProbeSession::mem_write_block(uint32_t adr, const uint8_t *buf, uint32_t size)
+{
+    const uint32_t max_words = (packet_size_ - 5) / 4;
+
+    while (size) {
+        uint32_t words = (0x400 - (adr & 0x3FF)) / 4;
+        if (words > max_words)
+            words = max_words;
+        if (words > (size + 3) / 4)
+            words = (size + 3) / 4;
+
+        const DapOp tar[] = { { AP_TAR, adr } };
+        if (!transfer(tar, 1)) {
+            return false;
+        }
+
+        const uint32_t n = (words * 4 > size) ? size : words * 4;
+        req_[0]          = ID_DAP_TransferBlock;
+        req_[1]          = 0; // DAP index
+        req_[2]          = (uint8_t)words;
+        req_[3]          = (uint8_t)(words >> 8);
+        req_[4]          = AP_DRW_W;
+        memset(&req_[5], 0, words * 4);
+        memcpy(&req_[5], buf, n);
+        if (!exchange(5 + words * 4, timeout_ms_)) {
+            return false;
+        }
+        if (res_len_ < 4 || (uint32_t)(res_[1] | (res_[2] << 8)) != words || res_[3] != DAP_RES_OK) {
+            return fail("DAP block write failed");
+        }
+
+        adr += n;
+        buf += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+
+// AP 0 bank 0 and the CSW, the probe changes both inside the vendor scope
+bool ProbeSession::ap_select()
+{
+    const DapOp ops[] = { { DP_SELECT, 0 }, { AP_CSW, CSW_VALUE } };
+    return transfer(ops, 2);
+}
+
+
+bool ProbeSession::dap_init()
+{
+    uint32_t val;
+
+    // Packet size of the probe, limits the block reads
+    req_[0] = ID_DAP_Info;
+    req_[1] = 0xFF;
+    if (!exchange(2, timeout_ms_)) {
+        return false;
+    }
+    if (res_len_ >= 4 && res_[1] == 2) {
+        packet_size_ = res_[2] | (res_[3] << 8);
+        if (packet_size_ > res_.size())
+            packet_size_ = (uint32_t)res_.size();
+        if (packet_size_ < 64)
+            packet_size_ = 64;
+    }
+
+    const uint8_t connect[] = { ID_DAP_Connect, 1 }; // SWD
+    memcpy(req_.data(), connect, sizeof(connect));
+    if (!exchange(sizeof(connect), timeout_ms_)) {
+        return false;
+    }
+    if (res_len_ < 2 || res_[1] != 1) {
+        return fail("probe has no SWD port");
+    }
+
+    uint8_t clock[5] = { ID_DAP_SWJ_Clock };
+    put_u32(&clock[1], swj_clock_);
+    const uint8_t xfer_cfg[]  = { ID_DAP_TransferConfigure, 0, 100, 0, 100, 0 }; // idle cycles, WAIT retries, match retries
+    const uint8_t swd_cfg[]   = { ID_DAP_SWD_Configure, 0 };
+    const uint8_t line_rst[]  = { ID_DAP_SWJ_Sequence, 51, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    const uint8_t jtag2swd[]  = { ID_DAP_SWJ_Sequence, 16, 0x9E, 0xE7 };
+    const uint8_t idle[]      = { ID_DAP_SWJ_Sequence, 8, 0x00 };
+    if (!command(clock, sizeof(clock)) || !command(xfer_cfg, sizeof(xfer_cfg)) || !command(swd_cfg, sizeof(swd_cfg)) ||
+        !command(line_rst, sizeof(line_rst)) || !command(jtag2swd, sizeof(jtag2swd)) ||
+        !command(line_rst, sizeof(line_rst)) || !command(idle, sizeof(idle))) {
+        return false;
+    }
+
+    // DPIDR read ends the line reset, then clear the sticky errors and power up the debug domain
+    const DapOp id[] = { { DP_IDCODE, 0 } };
+    if (!transfer(id, 1, &val)) {
+        return fail("no SWD target");
+    }
+    const DapOp pwr[] = { { DP_ABORT, STICKY_CLEAR }, { DP_CTRL_STAT_W, CSYSPWRUPREQ | CDBGPWRUPREQ } };
+    if (!transfer(pwr, 2)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        const DapOp stat[] = { { DP_CTRL_STAT_R, 0 } };
+        if (!transfer(stat, 1, &val)) {
+            return false;
+        }
+        if ((val & (CSYSPWRUPACK | CDBGPWRUPACK)) == (CSYSPWRUPACK | CDBGPWRUPACK)) {
+            break;
+        }
+        if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(timeout_ms_)) {
+            return fail("debug power up failed");
+        }
+    }
+
+    return ap_select();
+}
+
+
+bool ProbeSession::halt()
+{
+    uint32_t val;
+
+    if (!mem_write(DHCSR, DBGKEY | C_HALT | C_DEBUGEN)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        if (!mem_read(DHCSR, &val)) {
+            return false;
+        }
+        if (val & S_HALT) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(HALT_TIMEOUT_MS)) {
+            return fail("cannot halt the target");
+        }
+    }
+}
+
+
+bool ProbeSession::reset_run()
+{
+    // Leave debug state first, the system reset restarts the core from the new image
+    if (!mem_write(DEMCR, 0) || !mem_write(DHCSR, DBGKEY)) {
+        return false;
+    }
+
+    // The target drops the access of the reset request, that is not an error
+    const DapOp ops[] = { { AP_TAR, AIRCR }, { AP_DRW_W, SYSRESETREQ } };
+    transfer(ops, 2);
+    error_.clear();
+    return true;
+}
+
+
+/*
+ * Send one vendor command, the payload is already in req_ behind the header. *status
+ * receives the response status.
+ */
+bool ProbeSession::vendor(uint8_t type, uint32_t payload_len, uint32_t timeout_ms, uint8_t *status)
+{
+    req_[0] = ID_DAP_Vendor8;
+    req_[1] = type;
+    req_[2] = (uint8_t)payload_len;
+    req_[3] = (uint8_t)(payload_len >> 8);
+
+    if (!exchange(ELV_HEADER_SIZE + payload_len, timeout_ms ? timeout_ms + ELV_COMM_MARGIN : timeout_ms_)) {
+        return false;
+    }
+    if (res_len_ < ELV_HEADER_SIZE || (uint32_t)(res_[2] | (res_[3] << 8)) > res_len_ - ELV_HEADER_SIZE) {
+        return fail("unexpected vendor response");
+    }
+
+    *status = res_[1];
+    return true;
+}
+
+
+// Command without response payload, every status except OK is a failure
+bool ProbeSession::vendor_simple(uint8_t type, uint32_t payload_len, uint32_t timeout_ms, const char *what)
+{
+    uint8_t status;
+
+    if (!vendor(type, payload_len, timeout_ms, &status)) {
+        return false;
+    }
+    if (status != EL_VENDOR_STATUS_OK) {
+        return fail(what);
+    }
+    return true;
+}
+
+
+bool ProbeSession::flashos_capable()
+{
+    uint8_t status;
+
+    req_[ELV_HEADER_SIZE] = 0x00; // Capabilities of all commands
+    if (!vendor(EL_VENDOR_CAPABILITY, 1, 0, &status)) {
+        error_.clear();
+        return false;
+    }
+
+    // Bitmap: command type n is bit (7 - n % 8) of byte n / 8
+    return status == EL_VENDOR_STATUS_OK && res_len_ >= ELV_HEADER_SIZE + 2 &&
+           res_[ELV_HEADER_SIZE] == 0x00 && (res_[ELV_HEADER_SIZE + 1] & ELV_CAP_FLASHOS) == ELV_CAP_FLASHOS;
+}
+
+
+bool ProbeSession::flashos_load(const FlashAlgorithm &alg)
+{
+    const uint8_t *pB    = alg.code.data();
+    uint32_t       nMany = (uint32_t)alg.code.size();
+    uint32_t       nAdr  = alg.load_adr;
+    bool           desc  = true;
+
+    do {
+        uint8_t *p = &req_[ELV_HEADER_SIZE];
+
+        // The description goes with the first command only
+        put_u32(p, desc ? ELV_DESC_PRESENT : 0);
+        put_u32(p + 4, nAdr);
+        p += 8;
+        if (desc) {
+            put_u32(p + 0, alg.break_point);
+            put_u32(p + 4, alg.stack_ptr);
+            put_u32(p + 8, alg.static_base);
+            put_u32(p + 12, alg.program_page);
+            put_u32(p + 16, alg.blank_check);
+            put_u32(p + 20, alg.erase_sector);
+            put_u32(p + 24, alg.prg_buf);
+            put_u32(p + 28, alg.value_empty); // Value Empty, 24 reserved bits
+            p += 32;
+            desc = false;
+        }
+
+        uint32_t n = (nMany > ELV_CHUNK_SIZE) ? ELV_CHUNK_SIZE : nMany;
+        memcpy(p, pB, n);
+        p += n;
+
+        if (!vendor_simple(EL_FLASHOS_LOAD_ALGORITHM, (uint32_t)(p - &req_[ELV_HEADER_SIZE]), 0, "cannot load the flash algorithm")) {
+            return false;
+        }
+
+        nAdr += n;
+        pB += n;
+        nMany -= n;
+    } while (nMany);
+
+    return true;
+}
+
+
+// Download of the algorithm, the probe loads it if it can, else the host writes it to RAM
+bool ProbeSession::load(const FlashAlgorithm &alg)
+{
+    const uint32_t size = (uint32_t)alg.code.size();
+
+    // The DAP download is the fallback, as in DownloadFlashAlgorithm
+    if (flashos_) {
+        if (flashos_load(alg)) {
+            return true;
+        }
+        if (!socket_.is_open()) {
+            return false;
+        }
+        error_.clear();
+        flashos_ = false;
+        if (!vendor_simple(EL_VENDOR_SCOPE_EXIT, 0, 0, "cannot exit the vendor scope") || !ap_select()) {
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> buf(size);
+    if (!mem_write_block(alg.load_adr, alg.code.data(), size) || !mem_read_block(alg.load_adr, buf.data(), size)) {
+        return false;
+    }
+    if (buf != alg.code) {
+        return fail("cannot write to RAM for the flash algorithm");
+    }
+    return true;
+}
+
+
+/*
+ * Run one function of the algorithm, a result other than 0 fails with what. Without FlashOS
+ * the host runs it like SWD_SysCallExec and SWD_SysCallWait: the registers are written through
+ * DCRDR / DCRSR, DHCSR starts the core, the breakpoint at the exit point halts it and R0 holds
+ * the result.
+ */
+bool ProbeSession::execute(const FlashAlgorithm &alg, uint32_t pc, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t timeout_ms, const char *what)
+{
+    if (flashos_) {
+        uint8_t *p = &req_[ELV_HEADER_SIZE];
+
+        put_u32(p + 0, r0);
+        put_u32(p + 4, r1);
+        put_u32(p + 8, r2);
+        put_u32(p + 12, 0);
+        put_u32(p + 16, pc);
+        put_u32(p + 20, alg.static_base);
+        put_u32(p + 24, alg.stack_ptr);
+        put_u32(p + 28, alg.break_point); // LR: Exit Point
+
+        return vendor_simple(EL_FLASHOS_EXECUTE_FUNCTION, 32, timeout_ms, what);
+    }
+
+    // Register number and value
+    const uint32_t regs[][2] = {
+        { 0, r0 },                // R0: Argument 1
+        { 1, r1 },                // R1: Argument 2
+        { 2, r2 },                // R2: Argument 3
+        { 3, 0 },                 // R3: Argument 4
+        { 9, alg.static_base },   // SB: Static Base
+        { 13, alg.stack_ptr },    // SP: Stack Pointer
+        { 14, alg.break_point },  // LR: Exit Point
+        { 15, pc },               // PC: Entry Point
+        { 16, 0x01000000 },       // xPSR: T = 1, ISR = 0
+    };
+    DapOp    ops[3 + 3 * 9 + 1];
+    size_t   n = 0;
+    uint32_t val;
+
+    // Bank 1 of AP 0 with TAR = DHCSR maps DHCSR, DCRSR and DCRDR
+    ops[n++] = { AP_TAR, DHCSR };
+    ops[n++] = { DP_SELECT, BANK_DHCSR };
+    ops[n++] = { TRANSFER_MATCH_MASK, S_REGRDY };
+    for (const auto &reg : regs) {
+        ops[n++] = { AP_BD2_W, reg[1] };                          // DCRDR = value
+        ops[n++] = { AP_BD1_W, DCRSR_REGWnR | reg[0] };           // DCRSR = write register
+        ops[n++] = { AP_BD0_R | TRANSFER_MATCH_VALUE, S_REGRDY }; // Wait for DHCSR.S_REGRDY
+    }
+    ops[n++] = { AP_BD0_W, DBGKEY | C_DEBUGEN }; // Run
+    if (!transfer(ops, n)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (;;) {
+        const DapOp stat[] = { { AP_BD0_R, 0 } };
+        if (!transfer(stat, 1, &val)) {
+            return false;
+        }
+        if (val & S_HALT) {
+            break;
+        }
+        if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(timeout_ms)) {
+            const DapOp bank[] = { { DP_SELECT, 0 } };
+            transfer(bank, 1);
+            return fail(std::string(what) + " (timeout)");
+        }
+    }
+
+    const DapOp res[] = {
+        { AP_BD1_W, 0 },                                // DCRSR = read R0
+        { AP_BD0_R | TRANSFER_MATCH_VALUE, S_REGRDY },  // Wait for DHCSR.S_REGRDY
+        { AP_BD2_R, 0 },                                // R0 from DCRDR
+        { DP_SELECT, 0 },                               // Back to bank 0 for TAR / DRW
+    };
+    if (!transfer(res, 4, &val)) {
+        return false;
+    }
+    if (val != 0) {
+        return fail(what);
+    }
+    return true;
+}
+
+
+bool ProbeSession::erase(const FlashAlgorithm &alg, const FlashPlan &plan, const GangOptions &options)
+{
+    if (!execute(alg, alg.init, alg.dev_adr, options.cpu_clock, 1, options.init_timeout_ms, "Init (Erase) failed")) {
+        return false;
+    }
+
+    for (size_t i = 0; i < plan.sectors.size(); i++) {
+        char what[48];
+        snprintf(what, sizeof(what), "erase failed at 0x%08X", plan.sectors[i].adr);
+
+        bool ok;
+        if (flashos_) {
+            uint8_t *p = &req_[ELV_HEADER_SIZE];
+            put_u32(p + 0, plan.sectors[i].adr);
+            put_u32(p + 4, plan.sectors[i].size);
+            ok = vendor_simple(EL_FLASHOS_ERASE_SECTOR, 8, alg.to_erase, what);
+        } else {
+            ok = execute(alg, alg.erase_sector, plan.sectors[i].adr, 0, 0, alg.to_erase, what);
+        }
+        if (!ok) {
+            return false;
+        }
+        percent_ = (int)((i + 1) * 100 / plan.sectors.size());
+    }
+
+    return execute(alg, alg.uninit, 1, 0, 0, options.init_timeout_ms, "UnInit (Erase) failed");
+}
+
+
+bool ProbeSession::program(const FlashAlgorithm &alg, const FlashPlan &plan, const GangOptions &options)
+{
+    uint8_t status;
+
+    if (!execute(alg, alg.init, alg.dev_adr, options.cpu_clock, 2, options.init_timeout_ms, "Init (Program) failed")) {
+        return false;
+    }
+
+    for (size_t i = 0; i < plan.pages.size(); i++) {
+        const flm::Page &page = plan.pages[i];
+        const uint8_t  *pB   = &plan.buffer[page.ofs];
+        uint32_t        cnt  = (page.sz + 3) & ~0x00000003;
+        char            what[48];
+
+        snprintf(what, sizeof(what), "program failed at 0x%08X", page.adr);
+
+        // The host writes the page buffer, then ProgramPage runs in the target
+        if (!flashos_) {
+            if (!mem_write_block(alg.prg_buf, pB, cnt) ||
+                !execute(alg, alg.program_page, page.adr, page.sz, alg.prg_buf, alg.to_prog, what)) {
+                return false;
+            }
+            percent_ = (int)((i + 1) * 100 / plan.pages.size());
+            continue;
+        }
+
+        // The page data is sent in chunks, the probe programs the page with the last one
+        do {
+            uint8_t *p = &req_[ELV_HEADER_SIZE];
+            uint32_t n = (cnt > ELV_CHUNK_SIZE) ? ELV_CHUNK_SIZE : cnt;
+
+            if (n == cnt) {
+                *p++ = ELV_LAST_DATA;
+                put_u32(p, page.adr);
+                put_u32(p + 4, page.sz);
+                p += 8;
+            } else {
+                *p++ = 0;
+            }
+            memcpy(p, pB, n);
+            p += n;
+
+            if (!vendor(EL_FLASHOS_PROGRAM_PAGE, (uint32_t)(p - &req_[ELV_HEADER_SIZE]), (n == cnt) ? alg.to_prog : 0, &status)) {
+                return false;
+            }
+            if (status != EL_VENDOR_STATUS_OK && (n == cnt || status != EL_VENDOR_STATUS_PENDING)) {
+                return fail(what);
+            }
+
+            pB += n;
+            cnt -= n;
+        } while (cnt);
+
+        percent_ = (int)((i + 1) * 100 / plan.pages.size());
+    }
+
+    return execute(alg, alg.uninit, 2, 0, 0, options.init_timeout_ms, "UnInit (Program) failed");
+}
+
+
+bool ProbeSession::verify(const FlashPlan &plan)
+{
+    std::vector<uint8_t> buf;
+
+    for (size_t i = 0; i < plan.pages.size(); i++) {
+        const flm::Page &page = plan.pages[i];
+
+        buf.resize(page.sz);
+        if (!mem_read_block(page.adr, buf.data(), page.sz)) {
+            return false;
+        }
+        for (uint32_t k = 0; k < page.sz; k++) {
+            if (buf[k] != plan.buffer[page.ofs + k]) {
+                char msg[48];
+                snprintf(msg, sizeof(msg), "verify failed at 0x%08X", page.adr + k);
+                return fail(msg);
+            }
+        }
+        percent_ = (int)((i + 1) * 100 / plan.pages.size());
+    }
+
+    return true;
+}
+
+
+bool ProbeSession::run(const FlashAlgorithm &alg, const FlashPlan &plan, const GangOptions &options)
+{
+    bool ok;
+
+    timeout_ms_ = options.timeout_ms;
+    swj_clock_  = options.swj_clock;
+
+    phase_ = GANG_PHASE_CONNECT;
+    ok     = connect() && dap_init() && halt();
+
+    if (ok) {
+        // The probe runs the algorithm if it has the FlashOS commands, else the host does
+        flashos_ = flashos_capable() && vendor_simple(EL_VENDOR_SCOPE_ENTER, 0, 0, "cannot enter the vendor scope");
+        if (!flashos_) {
+            error_.clear();
+        }
+
+        phase_ = GANG_PHASE_LOAD;
+        ok     = load(alg);
+        if (ok) {
+            phase_   = GANG_PHASE_ERASE;
+            percent_ = 0;
+            ok       = erase(alg, plan, options);
+        }
+        if (ok) {
+            phase_   = GANG_PHASE_PROGRAM;
+            percent_ = 0;
+            ok       = program(alg, plan, options);
+        }
+
+        // Leave the scope in any case, a failed exit is reported only if all else passed
+        if (flashos_ && socket_.is_open()) {
+            bool exit = vendor_simple(EL_VENDOR_SCOPE_EXIT, 0, 0, "cannot exit the vendor scope");
+            ok        = ok && exit && ap_select();
+        }
+    }
+
+    if (ok && options.verify) {
+        phase_   = GANG_PHASE_VERIFY;
+        percent_ = 0;
+        ok       = verify(plan);
+    }
+
+    if (ok && options.reset_run) {
+        phase_ = GANG_PHASE_RESET;
+        ok     = reset_run();
+    }
+
+    if (socket_.is_open()) {
+        const uint8_t disconnect[] = { ID_DAP_Disconnect };
+        memcpy(req_.data(), disconnect, sizeof(disconnect));
+        exchange(sizeof(disconnect), timeout_ms_);
+
+        asio::error_code ignore;
+        socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ignore);
+        socket_.close(ignore);
+    }
+    if (ok) {
+        error_.clear(); // A failed disconnect does not matter
+    }
+
+    phase_ = ok ? GANG_PHASE_DONE : GANG_PHASE_FAILED;
+    return ok;
+}
@@ -0,0 +1,121 @@
+﻿/**
+ * @file probe_session.hpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief One target of the gang programmer: probe connection and flash sequence
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#ifdef _WIN32
+#include <sdkddkver.h>
+#endif
+#include "thirdparty/asio/include/asio.hpp"
+
+#include "flash_algorithm.hpp"
+#include "flash_image.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+struct GangOptions {
+    uint32_t swj_clock       = 10000000; // SWD clock of the probe (Hz)
+    uint32_t cpu_clock       = 12000000; // Clock passed to Init() of the algorithm (Hz)
+    bool     verify          = false;    // Read back and compare the programmed pages
+    bool     reset_run       = false;    // Reset and run the target when done
+    int      timeout_ms      = 3000;     // Timeout of one probe exchange
+    uint32_t init_timeout_ms = 3000;     // Timeout of Init() and UnInit() of the algorithm
+};
+
+
+// One DP/AP access of DAP_Transfer
+struct DapOp {
+    uint8_t  request; // APnDP, RnW, A[3:2]
+    uint32_t data;    // Write data
+};
+
+
+enum GangPhase {
+    GANG_PHASE_WAIT = 0,
+    GANG_PHASE_CONNECT,
+    GANG_PHASE_LOAD,
+    GANG_PHASE_ERASE,
+    GANG_PHASE_PROGRAM,
+    GANG_PHASE_VERIFY,
+    GANG_PHASE_RESET,
+    GANG_PHASE_DONE,
+    GANG_PHASE_FAILED,
+};
+
+
+/*
+ * Programs one target through one probe. The connection runs on its own io_context in the
+ * calling thread, so each session is independent of the others. Phase and percent can be
+ * read from any thread while run() is in progress.
+ */
+class ProbeSession
+{
+    public:
+    explicit ProbeSession(const std::string &address);
+
+    /**
+     * @brief Connect the probe, halt the target and program the plan, with the FlashOS vendor
+     *        commands if the probe has them. The probe connection is closed when the function
+     *        returns.
+     *
+     * @return true on success, else error() holds the reason
+     */
+    bool run(const FlashAlgorithm &alg, const FlashPlan &plan, const GangOptions &options);
+
+    const std::string &address() const { return address_; }
+    const std::string &error() const { return error_; }
+    int                phase() const { return phase_; }
+    int                percent() const { return percent_; }
+
+    private:
+    bool fail(const std::string &what);
+    bool wait(int timeout_ms);
+    bool connect();
+    bool exchange(size_t req_len, int timeout_ms);
+    bool command(const uint8_t *req, size_t req_len);
+
+    bool dap_init();
+    bool transfer(const DapOp *ops, size_t count, uint32_t *rdata = nullptr);
+    bool mem_write(uint32_t adr, uint32_t val);
+    bool mem_read(uint32_t adr, uint32_t *val);
+    bool mem_read_block(uint32_t adr, uint8_t *buf, uint32_t size);
+    bool mem_write_block(uint32_t adr, const uint8_t *buf, uint32_t size);
+    bool ap_select();
+    bool halt();
+    bool reset_run();
+
+    bool vendor(uint8_t type, uint32_t payload_len, uint32_t timeout_ms, uint8_t *status);
+    bool vendor_simple(uint8_t type, uint32_t payload_len, uint32_t timeout_ms, const char *what);
+    bool flashos_capable();
+    bool flashos_load(const FlashAlgorithm &alg);
+    bool load(const FlashAlgorithm &alg);
+    bool execute(const FlashAlgorithm &alg, uint32_t pc, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t timeout_ms, const char *what);
+    bool erase(const FlashAlgorithm &alg, const FlashPlan &plan, const GangOptions &options);
+    bool program(const FlashAlgorithm &alg, const FlashPlan &plan, const GangOptions &options);
+    bool verify(const FlashPlan &plan);
+
+    std::string             address_;
+    std::string             host_;
+    std::string             port_;
+    std::string             error_;
+    std::atomic<int>        phase_;
+    std::atomic<int>        percent_;
+    asio::io_context        io_context_;
+    asio::ip::tcp::socket   socket_;
+    std::array<uint8_t, 1500> req_;
+    std::array<uint8_t, 1500> res_;
+    size_t                  res_len_;
+    uint32_t                packet_size_;
+    uint32_t                swj_clock_;
+    int                     timeout_ms_;
+    bool                    flashos_; // The probe runs the algorithm (FlashOS vendor commands)
+};
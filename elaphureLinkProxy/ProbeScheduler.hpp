@@ -0,0 +1,246 @@
+﻿/**
+ * @file ProbeScheduler.hpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Share one probe between several RDDI clients
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "pch.h"
+
+
+/*
+ * The DAP state a client expects to be kept between its requests: the SWD/JTAG clock, the
+ * transfer configuration, DP SELECT and the CSW/TAR of the MEM-APs it has used. The same type
+ * tracks the state the probe really holds, so that the state of a client can be restored when
+ * the probe switches to it.
+ */
+class DapContext
+{
+    public:
+    static constexpr int kMaxRestoreCount    = 64;
+    static constexpr int kMaxRestoreCommands = 4; // WriteABORT, SWJ_Clock, TransferConfigure, Transfer
+    static constexpr int kMaxRestoreLength   = 6 + 5 + 6 + 3 + kMaxRestoreCount * 5;
+
+    DapContext()
+        : is_select_valid_(false),
+          is_config_valid_(false),
+          is_clock_valid_(false),
+          is_sticky_error_(false),
+          select_(0),
+          clock_(0),
+          config_(),
+          dap_index_(0)
+    {
+    }
+
+    void invalidate()
+    {
+        is_select_valid_ = false;
+        is_config_valid_ = false;
+        is_clock_valid_  = false;
+        is_sticky_error_ = true; // unknown
+        ap_.clear();
+    }
+
+    /**
+     * @return true: a transfer may have left sticky errors in the DP
+     */
+    bool has_sticky_error() const
+    {
+        return is_sticky_error_;
+    }
+
+    /**
+     * @brief Apply the executed part of a DAP command.
+     *
+     * @param req DAP request of a single command
+     * @param res DAP response of the command, nullptr if all transfers succeed
+     * @param res_len length of the response
+     * @return false: the command may change the state in an unknown way
+     */
+    bool track_command(const uint8_t *req, const uint8_t *res, int res_len);
+
+    /**
+     * @brief Build the commands that bring the probe from `probe` to this context. They follow
+     *        each other in `buf`: DAP_WriteABORT, DAP_SWJ_Clock, DAP_TransferConfigure and a
+     *        DAP_Transfer for DP SELECT and CSW/TAR, each one only if needed.
+     *
+     * @param clear_sticky clear the sticky errors another client may have left in the DP
+     * @param buf at least `kMaxRestoreLength` bytes
+     * @param commands receives the number of commands
+     * @return length of the commands, 0 if nothing needs to be restored
+     */
+    int make_restore_command(const DapContext &probe, bool clear_sticky, uint8_t *buf, int *commands) const;
+
+    private:
+    struct ApContext {
+        bool     is_csw_valid = false;
+        bool     is_tar_valid = false;
+        uint32_t csw          = 0;
+        uint32_t tar          = 0;
+    };
+
+    void track_access(uint8_t request, uint32_t data);
+
+    private:
+    bool                         is_select_valid_;
+    bool                         is_config_valid_;
+    bool                         is_clock_valid_;
+    bool                         is_sticky_error_; // only meaningful for the probe
+    uint32_t                     select_;
+    uint32_t                     clock_;
+    uint8_t                      config_[5]; // DAP_TransferConfigure: idle cycles, WAIT retry, match retry
+    uint8_t                      dap_index_;
+    std::map<uint8_t, ApContext> ap_;
+};
+
+
+/**
+ * @brief Length of a DAP_Transfer, DAP_TransferBlock, DAP_TransferConfigure, DAP_WriteABORT or
+ *        DAP_SWJ_Clock request.
+ *
+ * @return request length, -1 for other commands
+ */
+int get_command_request_length(const uint8_t *req);
+
+/**
+ * @brief Length of the response for a request accepted by get_command_request_length().
+ *
+ * @param req DAP request
+ * @param res DAP response, nullptr to get the length when all transfers succeed
+ * @return response length, -1 for other commands
+ */
+int get_command_response_length(const uint8_t *req, const uint8_t *res);
+
+/**
+ * @brief Check that a command, or every command of a DAP_ExecuteCommands, has been executed
+ *        completely with an OK status.
+ */
+bool is_response_ok(const uint8_t *req, const uint8_t *res, int res_len);
+
+
+/*
+ * Decide which client the probe serves next. Higher priority comes first, clients of the same
+ * priority are served round robin. A client that has been passed over `kMaxSkipCount` times is
+ * served before the others, so background clients always make progress.
+ *
+ * A client inside the elaphureLink vendor scope owns the probe: until it leaves the scope no
+ * other client is served, because the probe does not accept native commands in the scope.
+ */
+class ProbeScheduler
+{
+    public:
+    static constexpr int kMaxSkipCount = 8;
+
+    ProbeScheduler()
+        : pending_mask_(0),
+          last_served_(EL_MAX_PROXY_CLIENT - 1),
+          exclusive_(-1)
+    {
+        for (int i = 0; i < EL_MAX_PROXY_CLIENT; i++) {
+            priority_[i]   = EL_CLIENT_PRIORITY_NORMAL;
+            skip_count_[i] = 0;
+        }
+    }
+
+    void set_pending(int client, int priority)
+    {
+        pending_mask_ |= 1U << client;
+        priority_[client] = priority;
+    }
+
+    bool has_pending()
+    {
+        if (exclusive_ >= 0) {
+            return (pending_mask_ & (1U << exclusive_)) != 0;
+        }
+        return pending_mask_ != 0;
+    }
+
+    /**
+     * @brief Serve only `client` until the exclusive access is cleared.
+     *
+     * @param client client inside the vendor scope, -1: clear
+     */
+    void set_exclusive(int client)
+    {
+        exclusive_ = client;
+    }
+
+    int get_exclusive()
+    {
+        return exclusive_;
+    }
+
+    /**
+     * @return pending clients in service order
+     */
+    std::vector<int> get_service_order()
+    {
+        std::vector<int> order;
+        if (exclusive_ >= 0) {
+            order.push_back(exclusive_);
+            return order;
+        }
+
+        for (int i = 1; i <= EL_MAX_PROXY_CLIENT; i++) {
+            int client = (last_served_ + i) % EL_MAX_PROXY_CLIENT;
+            if (pending_mask_ & (1U << client)) {
+                order.push_back(client);
+            }
+        }
+
+        // stable: keep the round robin order within the same rank
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+            return get_rank(a) > get_rank(b);
+        });
+
+        return order;
+    }
+
+    /**
+     * @param served clients whose requests have been sent, the first one is the head of the batch
+     */
+    void mark_served(const std::vector<int> &served)
+    {
+        for (int client : served) {
+            pending_mask_ &= ~(1U << client);
+            skip_count_[client] = 0;
+        }
+
+        for (int i = 0; i < EL_MAX_PROXY_CLIENT; i++) {
+            if ((pending_mask_ & (1U << i)) && exclusive_ < 0) {
+                skip_count_[i]++;
+            }
+        }
+
+        if (!served.empty()) {
+            last_served_ = served[0];
+        }
+    }
+
+    private:
+    int get_rank(int client)
+    {
+        if (skip_count_[client] >= kMaxSkipCount) {
+            return EL_CLIENT_PRIORITY_HIGH + 1;
+        }
+
+        return priority_[client];
+    }
+
+    private:
+    uint32_t pending_mask_;
+    int      last_served_;
+    int      exclusive_;
+    int      priority_[EL_MAX_PROXY_CLIENT];
+    int      skip_count_[EL_MAX_PROXY_CLIENT];
+};
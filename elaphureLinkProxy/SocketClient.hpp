@@ -1,45 +1,72 @@
 ﻿#pragma once
+#include <array>
 #include <iostream>
 #include <mutex>
 #include <condition_variable>
+#include <future>
+#include <vector>
 
 #include <sdkddkver.h>
 #include "thirdparty/asio/include/asio.hpp"
 
 #include "pch.h"
+#include "ProbeScheduler.hpp"
+#include "protocol.hpp"
 
 using asio::ip::tcp;
 
-class SocketClient
+/*
+ * One probe connection. All clients share the io_context thread pool of the proxy,
+ * the handlers of a client are serialized by its own strand.
+ *
+ * Up to `EL_MAX_PROXY_CLIENT` RDDI clients can use the probe at the same time, each one through
+ * its own channel. Their requests are ordered by `ProbeScheduler` and batched when possible.
+ * A client inside the vendor scope has the probe to itself until it leaves the scope.
+ *
+ * Nothing blocks a thread of the pool: the connection runs as a coroutine (see `run()`) that
+ * awaits the RDDI requests and the probe responses, each exchange has a deadline.
+ */
+class SocketClient : public std::enable_shared_from_this<SocketClient>
 {
     public:
-    SocketClient()
+    SocketClient(asio::io_context &io_context, el_proxy_instance *instance)
         : is_running_(false),
+          is_timed_out_(false),
+          strand_(asio::make_strand(io_context)),
+          deadline_timer_(strand_),
+          request_signal_(strand_),
+          deadline_id_(0),
+          instance_(instance),
+          last_client_(-1),
+          is_scope_orphaned_(false),
+          round_timeout_ms_(kDefaultCommTimeoutMs),
           connect_callback_(nullptr),
           disconnect_callback_(nullptr)
     {
-    }
-
-    void do_something();
+        producer_event_handle_.reserve(EL_MAX_PROXY_CLIENT);
+        for (auto &channel : instance_->channel) {
+            // object_handle owns the handle it wraps
+            HANDLE event = nullptr;
+            DuplicateHandle(GetCurrentProcess(), channel.producer_event,
+                            GetCurrentProcess(), &event,
+                            0, FALSE, DUPLICATE_SAME_ACCESS);
+            producer_event_handle_.emplace_back(strand_);
+            producer_event_handle_.back().assign(event);
+        }
 
-    ~SocketClient()
-    {
-        // FIXME: access violation
+        client_owner_.fill(0);
 
-        // ~thread() require to join or detach
-        if (main_thread_.joinable()) {
-            main_thread_.join();
-        }
+        // never expires, cancelled to signal a new request
+        request_signal_.expires_at(asio::steady_timer::time_point::max());
     }
 
     int init_socket(std::string address, std::string port = "3240")
     {
         socket_.reset(nullptr); // prevent double free
 
-        io_context_ = std::make_unique<asio::io_context>();
-        tcp::resolver resolver(get_io_context());
+        tcp::resolver resolver(strand_);
 
-        socket_ = std::make_unique<asio::ip::tcp::socket>(get_io_context());
+        socket_ = std::make_unique<asio::ip::tcp::socket>(strand_);
 
         try {
             endpoint_ = resolver.resolve(address, port);
@@ -53,18 +80,9 @@ class SocketClient
 
     void kill()
     {
-        is_running_ = false;
-        if (k_is_proxy_init) {
-            k_shared_memory_ptr->info_page.is_proxy_ready       = 0;
-            k_shared_memory_ptr->consumer_page.command_response = 0xFFFFFFFF; // invalid value
-            SetEvent(k_producer_event);                                       // wake up
-            SetEvent(k_consumer_event);
-        }
-
-        socket_.get()->close();
-        io_context_.get()->stop();
-        // Resources should not be released immediately, as this will result in a deadlock.
-        Sleep(100);
+        // The pending handlers hold a reference to the client, it is released once they are cancelled.
+        // Returns after the waits on the producer events are cancelled, see close().
+        close();
     }
 
     int start()
@@ -79,37 +97,18 @@ class SocketClient
         is_running_post_done_ = false;
         is_running_           = true;
 
-        do_connect(endpoint_);
-
-        main_thread_ = std::thread([&]() { // start main thread
-            try {
-                get_io_context().run();
-            } catch (std::exception &e) {
-                set_running_status(false, e.what());
-            }
-
-        });
+        asio::post(strand_, [this, self = shared_from_this()]() { run(); });
 
         running_cv_.wait(lk, [this]() { return is_running_post_done_; });
 
         return !is_running_;
     }
 
-    void wait_main_thread()
-    {
-        main_thread_.join();
-    }
-
 
     //
     //
     // setter/getter
     public:
-    asio::io_context &get_io_context()
-    {
-        return *(io_context_.get());
-    }
-
     asio::ip::tcp::socket &get_socket()
     {
         return *(socket_.get());
@@ -145,70 +144,173 @@ class SocketClient
     }
 
     private:
+    void wake_up_rddi()
+    {
+        for (auto &channel : instance_->channel) {
+            el_memory_t *memory = channel.shared_memory_ptr;
+
+            memory->info_page.is_proxy_ready       = 0;
+            memory->consumer_page.command_response = 0xFFFFFFFF; // invalid value
+            SetEvent(channel.consumer_event);                    // wake up
+        }
+    }
+
     void close()
     {
         is_running_ = false;
-        if (k_is_proxy_init) {
-            k_shared_memory_ptr->info_page.is_proxy_ready       = 0;
-            k_shared_memory_ptr->consumer_page.command_response = 0xFFFFFFFF; // invalid value
-            SetEvent(k_producer_event);                                       // wake up
-            SetEvent(k_consumer_event);
+        wake_up_rddi();
+
+        auto cancel = [this]() {
+            asio::error_code ec;
+            for (auto &handle : producer_event_handle_) {
+                handle.cancel(ec);
+            }
+            deadline_timer_.cancel();
+            request_signal_.cancel();
+            get_socket().close(ec);
+        };
+
+        if (strand_.running_in_this_thread()) {
+            cancel();
+            return;
         }
 
-        asio::post(get_io_context(),
-                   [this]() {
-                       get_socket().close();
-                   });
+        // The producer events are auto-reset and shared with the next connection of the instance,
+        // a wait that is still armed would take its signal. Return after the cancel has run.
+        std::promise<void> done;
+        asio::dispatch(strand_, [&]() {
+            cancel();
+            done.set_value();
+        });
+        done.get_future().wait();
     }
 
-    void do_connect(const tcp::resolver::results_type &endpoints)
+    void set_consumer_status(el_memory_t *memory, int status)
     {
-        asio::async_connect(get_socket(), endpoints,
-                            [&](std::error_code ec, tcp::endpoint) {
-                                //is_running_post_done_ = true;
-                                if (!ec) {
-                                    asio::ip::tcp::no_delay option(true);
-                                    get_socket().set_option(option);
-
-                                    set_keep_alive();
-
-                                    do_handshake();
-                                } else {
-                                    notify_connection_status(false, ec.message());
-                                    close();
-                                }
-                            });
+        memory->consumer_page.command_response = status;
     }
+
     void set_keep_alive();
 
+    auto resume()
+    {
+        return [this, self = shared_from_this()](asio::error_code ec, std::size_t n) { run(ec, n); };
+    }
+
+    auto resume_wait()
+    {
+        return [this, self = shared_from_this()](asio::error_code ec) { run(ec, 0); };
+    }
+
+    void run(asio::error_code ec = asio::error_code(), std::size_t n = 0);
+
+    // deadline of the pending exchange
+    void        arm_deadline(int timeout_ms);
+    void        cancel_deadline();
+    std::string get_error_message(const asio::error_code &ec);
+    void        fail_connect(const asio::error_code &ec);
+    void        fail_data_phase(const asio::error_code &ec);
+
     // handshake phase
-    void do_handshake();
+    int  store_device_info(int index, int res_len);
+    void set_proxy_ready();
 
     // data phase
-    void get_device_info();
-    void do_data_process();
+    enum ExchangeType {
+        kExchangeRestore,   // restore the DAP state of the next client
+        kExchangeSingle,    // one request of a client, sent as it is
+        kExchangeBatch,     // requests of several clients in one DAP_ExecuteCommands
+        kExchangeScopeExit, // leave the vendor scope of a client that has gone
+    };
+
+    struct Exchange {
+        ExchangeType   type;
+        int            client;
+        const uint8_t *req;
+        int            req_len;
+    };
+
+    struct BatchCommand {
+        int            client; // -1: state restore
+        const uint8_t *req;
+    };
+
+    void wait_client_request(int client);
+    int  get_comm_timeout(int client);
+    void prepare_round();
+    void prepare_single_request(int client);
+    void prepare_batch_request(const std::vector<int> &order);
+    int  complete_exchange(const Exchange &exchange, int res_len);
+    void complete_batch_request(int res_len);
+    void finish_round();
+    bool is_batchable_request(int client);
+    void track_request(int client, const uint8_t *req, const uint8_t *res, int res_len);
+    void track_vendor_scope(int client, const uint8_t *req, int req_len, const uint8_t *res, int res_len);
+    void release_stale_scope();
+    int  parse_response(el_memory_t *memory, const uint8_t *res, int res_len);
 
     void notify_connection_status(bool status, const std::string msg)
     {
-        is_running_post_done_ = true;
         set_running_status(status, msg);
+        {
+            std::lock_guard<std::mutex> lk(running_status_mutex_);
+            is_running_post_done_ = true;
+        }
         running_cv_.notify_all();
     }
 
 
     private:
+    // keep a batch within the packet size used by RDDI
+    static constexpr int kMaxBatchLength = 1400;
+
+    static constexpr int kConnectTimeoutMs     = 5000;
+    static constexpr int kDefaultCommTimeoutMs = EL_DEFAULT_COMM_TIMEOUT_MS;
+
+    static constexpr int     kDeviceInfoNum                = 4;
+    static constexpr uint8_t kDeviceInfoId[kDeviceInfoNum] = { 0x02, 0x03, 0x04, 0xF0 };
+
+    static constexpr uint8_t kScopeExitRequest[4] = { ID_DAP_Vendor8, EL_VENDOR_SCOPE_EXIT, 0x00, 0x00 };
+
     bool                    is_running_;
     bool                    is_running_post_done_;
+    bool                    is_timed_out_;
     std::mutex              running_status_mutex_;
     std::condition_variable running_cv_;
 
-    std::unique_ptr<asio::io_context> io_context_;
-    std::unique_ptr<tcp::socket>      socket_;
+    asio::strand<asio::io_context::executor_type> strand_;
+    std::unique_ptr<tcp::socket>                  socket_;
+    std::vector<asio::windows::object_handle>     producer_event_handle_;
+    asio::steady_timer                            deadline_timer_;
+    asio::steady_timer                            request_signal_;
+    uint32_t                                      deadline_id_;
+    asio::coroutine                               coroutine_;
+
+    el_request_handshake_t  handshake_req_;
+    el_response_handshake_t handshake_res_;
+    int                     info_index_;
+
+    el_proxy_instance *instance_;
+
+    ProbeScheduler                              scheduler_;
+    DapContext                                  probe_context_;
+    std::array<DapContext, EL_MAX_PROXY_CLIENT> client_context_;
+    std::array<uint32_t, EL_MAX_PROXY_CLIENT>   client_owner_;
+    int                                         last_client_;
+    bool                                        is_scope_orphaned_; // the scope owner has gone, the probe is still in the scope
+    std::array<uint8_t, 1500>                   req_buffer_;
+    std::array<uint8_t, 1500>                   res_buffer_;
+
+    // the round in progress
+    std::vector<Exchange>                              exchanges_;
+    size_t                                             exchange_index_;
+    std::vector<int>                                   served_;
+    std::vector<BatchCommand>                          batch_commands_;
+    std::array<uint8_t, 2 + DapContext::kMaxRestoreLength> restore_buffer_; // DAP_ExecuteCommands header and the restore
+    int                                                round_timeout_ms_;
 
     tcp::resolver::results_type endpoint_;
 
-    std::thread main_thread_;
-
     onSocketConnectCallbackType    connect_callback_;
     onSocketDisconnectCallbackType disconnect_callback_;
 };
@@ -4,11 +4,9 @@
 
 bool k_is_proxy_init = false;
 
-HANDLE       k_shared_memory_handle = nullptr;
-el_memory_t *k_shared_memory_ptr    = nullptr;
+el_proxy_instance k_proxy_instance[EL_MAX_PROXY_INSTANCE];
 
-HANDLE k_producer_event = nullptr;
-HANDLE k_consumer_event = nullptr;
+struct el_proxy_config k_proxy_config = { 0 };
 
 struct WindowsVersionNumber k_windows_version_number;
 
@@ -18,9 +16,9 @@ struct WindowsVersionNumber k_windows_version_number;
 
 inline void el_proxy_deinit();
 
-inline void fill_el_version_string()
+inline void fill_el_version_string(el_memory_t *memory)
 {
-    strncpy_s(k_shared_memory_ptr->info_page.version_string, sizeof(k_shared_memory_ptr->info_page.version_string), EL_GIT_TAG_INFO, sizeof(k_shared_memory_ptr->info_page.version_string) - 1);
+    strncpy_s(memory->info_page.version_string, sizeof(memory->info_page.version_string), EL_GIT_TAG_INFO, sizeof(memory->info_page.version_string) - 1);
 }
 
 BOOL APIENTRY DllMain(HMODULE hModule,
@@ -62,50 +60,125 @@ inline void get_windows_version_number()
     k_windows_version_number.build_number  = ovi.dwBuildNumber;
 }
 
-PROXY_DLL_FUNCTION int el_proxy_init()
+el_proxy_instance *el_proxy_get_instance(int instance)
 {
-    if (k_is_proxy_init) {
-        return 0;
+    if (instance < 0 || instance >= EL_MAX_PROXY_INSTANCE) {
+        return nullptr;
+    }
+
+    el_proxy_instance *p = &k_proxy_instance[instance];
+    if (p->channel[0].shared_memory_ptr == nullptr) {
+        return nullptr;
     }
-    k_shared_memory_handle = CreateFileMapping(INVALID_HANDLE_VALUE,
-                                               NULL,
-                                               PAGE_READWRITE,
-                                               0,
-                                               EL_SHARED_MEMORY_SIZE,
-                                               EL_SHARED_MEMORY_NAME);
-    if (nullptr == k_shared_memory_handle || INVALID_HANDLE_VALUE == k_shared_memory_handle) {
+
+    return p;
+}
+
+inline void el_proxy_channel_deinit(el_proxy_channel *p)
+{
+    CloseHandle(p->producer_event);
+    CloseHandle(p->consumer_event);
+    if (p->shared_memory_ptr != nullptr)
+        UnmapViewOfFile(p->shared_memory_ptr);
+    CloseHandle(p->shared_memory_handle);
+
+    p->shared_memory_handle = nullptr;
+    p->shared_memory_ptr    = nullptr;
+    p->producer_event       = nullptr;
+    p->consumer_event       = nullptr;
+}
+
+inline int el_proxy_channel_init(el_proxy_channel *p, int instance, int client)
+{
+    char name[EL_OBJECT_NAME_MAX_LEN];
+
+    el_get_client_object_name(name, EL_SHARED_MEMORY_NAME, instance, client);
+    p->shared_memory_handle = CreateFileMapping(INVALID_HANDLE_VALUE,
+                                                NULL,
+                                                PAGE_READWRITE,
+                                                0,
+                                                EL_SHARED_MEMORY_SIZE,
+                                                name);
+    if (nullptr == p->shared_memory_handle || INVALID_HANDLE_VALUE == p->shared_memory_handle) {
         return -1;
     }
 
 
-    void *ptr = MapViewOfFile(k_shared_memory_handle,
+    void *ptr = MapViewOfFile(p->shared_memory_handle,
                               FILE_MAP_ALL_ACCESS,
                               0,
                               0,
                               EL_SHARED_MEMORY_SIZE);
 
-    k_shared_memory_ptr = static_cast<el_memory_t *>(ptr);
+    if (nullptr == ptr) {
+        return -1;
+    }
 
-    if (nullptr == k_shared_memory_ptr) {
+    el_get_client_object_name(name, EL_EVENT_PRODUCER_NAME, instance, client);
+    p->producer_event = CreateEvent(NULL,
+                                    FALSE, // auto reset
+                                    FALSE,
+                                    name);
+
+    el_get_client_object_name(name, EL_EVENT_CONSUMER_NAME, instance, client);
+    p->consumer_event = CreateEvent(NULL,
+                                    FALSE, // auto reset
+                                    FALSE,
+                                    name);
+
+    if (nullptr == p->producer_event || nullptr == p->consumer_event
+        || INVALID_HANDLE_VALUE == p->producer_event || INVALID_HANDLE_VALUE == p->consumer_event) {
+        UnmapViewOfFile(ptr);
         return -1;
     }
 
-    k_producer_event = CreateEvent(NULL,
-                                   FALSE, // auto reset
-                                   FALSE,
-                                   EL_EVENT_PRODUCER_NAME);
+    el_memory_t *memory = static_cast<el_memory_t *>(ptr);
+
+    fill_el_version_string(memory);
+    memory->info_page.enable_vendor_command = k_proxy_config.enable_vendor_command;
 
-    k_consumer_event = CreateEvent(NULL,
-                                   FALSE, // auto reset
-                                   FALSE,
-                                   EL_EVENT_CONSUMER_NAME);
+    p->shared_memory_ptr = memory;
+    return 0;
+}
 
-    if (nullptr == k_producer_event || nullptr == k_consumer_event
-        || INVALID_HANDLE_VALUE == k_producer_event || INVALID_HANDLE_VALUE == k_consumer_event) {
+int el_proxy_instance_init(int instance)
+{
+    if (instance < 0 || instance >= EL_MAX_PROXY_INSTANCE) {
         return -1;
     }
 
-    fill_el_version_string();
+    el_proxy_instance *p = &k_proxy_instance[instance];
+    if (p->channel[0].shared_memory_ptr != nullptr) {
+        return 0; // already init
+    }
+
+    // channel 0 is the last one, it marks the instance as init
+    for (int client = EL_MAX_PROXY_CLIENT - 1; client >= 0; client--) {
+        if (el_proxy_channel_init(&p->channel[client], instance, client)) {
+            for (auto &channel : p->channel) {
+                el_proxy_channel_deinit(&channel);
+            }
+            return -1;
+        }
+    }
+
+    el_memory_t *memory = p->channel[0].shared_memory_ptr;
+    for (int client = 0; client < EL_MAX_PROXY_CLIENT; client++) {
+        memory->info_page.client_priority[client] = EL_CLIENT_PRIORITY_NORMAL;
+    }
+
+    return 0;
+}
+
+PROXY_DLL_FUNCTION int el_proxy_init()
+{
+    if (k_is_proxy_init) {
+        return 0;
+    }
+
+    if (el_proxy_instance_init(0)) {
+        return -1;
+    }
 
     get_windows_version_number();
 
@@ -121,14 +194,23 @@ PROXY_DLL_FUNCTION void el_proxy_change_config(struct el_proxy_config *config)
             return;
     }
 
-    k_shared_memory_ptr->info_page.enable_vendor_command = config->enable_vendor_command;
+    k_proxy_config = *config;
+
+    for (int i = 0; i < EL_MAX_PROXY_INSTANCE; i++) {
+        el_proxy_instance *p = el_proxy_get_instance(i);
+        if (p) {
+            for (auto &channel : p->channel) {
+                channel.shared_memory_ptr->info_page.enable_vendor_command = config->enable_vendor_command;
+            }
+        }
+    }
 }
 
 inline void el_proxy_deinit()
 {
-    CloseHandle(k_producer_event);
-    CloseHandle(k_consumer_event);
-    if (k_shared_memory_ptr != nullptr)
-        UnmapViewOfFile(k_shared_memory_ptr);
-    CloseHandle(k_shared_memory_handle);
-}
\ No newline at end of file
+    for (auto &p : k_proxy_instance) {
+        for (auto &channel : p.channel) {
+            el_proxy_channel_deinit(&channel);
+        }
+    }
+}
@@ -10,11 +10,31 @@
 
 extern bool k_is_proxy_init;
 
-extern HANDLE       k_shared_memory_handle;
-extern el_memory_t *k_shared_memory_ptr;
+// IPC resources of one RDDI client
+struct el_proxy_channel {
+    HANDLE       shared_memory_handle;
+    el_memory_t *shared_memory_ptr;
 
-extern HANDLE k_producer_event;
-extern HANDLE k_consumer_event;
+    HANDLE producer_event;
+    HANDLE consumer_event;
+};
+
+// IPC resources of one proxy instance, channel 0 also holds the client slot table
+struct el_proxy_instance {
+    el_proxy_channel channel[EL_MAX_PROXY_CLIENT];
+};
+
+/**
+ * @brief Create the shared memory and events of all client channels of the instance, do nothing if it's already created.
+ *
+ * @return 0: on success, other on fail
+ */
+int el_proxy_instance_init(int instance);
+
+/**
+ * @return IPC resources of the instance, nullptr if it is not initialized
+ */
+el_proxy_instance *el_proxy_get_instance(int instance);
 
 struct WindowsVersionNumber {
     ULONG major_version;
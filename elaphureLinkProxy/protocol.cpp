@@ -36,311 +36,731 @@ void SocketClient::set_keep_alive()
     setsockopt(socket_.get()->native_handle(), IPPROTO_TCP, TCP_KEEPINTVL, (char *)&keepalive_strobe_interval_secs, sizeof(keepalive_strobe_interval_secs));
 }
 
-void SocketClient::do_handshake()
+/*
+ * The whole connection runs as one stackless coroutine on the strand of the client:
+ * connect, handshake, device info, then the data phase. Every exchange with the probe has a
+ * deadline, a probe that stops responding closes the connection instead of blocking RDDI.
+ */
+#include "thirdparty/asio/include/asio/yield.hpp"
+
+void SocketClient::run(asio::error_code ec, std::size_t n)
 {
-    el_request_handshake_t req;
-    req.el_link_identifier = htonl(EL_LINK_IDENTIFIER);
-    req.command            = htonl(EL_COMMAND_HANDSHAKE);
-    req.el_proxy_version   = htonl(EL_DAP_VERSION);
-
-    asio::error_code ec;
-    asio::write(get_socket(), asio::buffer(&req, sizeof(req)), ec);
-    if (ec) {
-        notify_connection_status(false, ec.message());
-        close();
-        return;
+    if (!is_running_) {
+        return; // closed
     }
 
-    // get response
-    el_response_handshake_t res;
+    reenter(coroutine_)
+    {
+        // connect phase
+        arm_deadline(kConnectTimeoutMs);
+        yield asio::async_connect(get_socket(), endpoint_,
+                                  [this, self = shared_from_this()](std::error_code ec, tcp::endpoint) {
+                                      run(ec, 0);
+                                  });
+        if (ec) {
+            return fail_connect(ec);
+        }
 
-    size_t n = asio::read(get_socket(),
-                          asio::buffer(&res, sizeof(res)),
-                          asio::transfer_exactly(sizeof(res)),
-                          ec);
-    if (ec) {
-        notify_connection_status(false, ec.message());
-        close();
-        return;
-    }
+        {
+            asio::ip::tcp::no_delay option(true);
+            get_socket().set_option(option, ec);
+        }
+        set_keep_alive();
 
-    if (ntohl(res.el_link_identifier) != EL_LINK_IDENTIFIER) {
-        notify_connection_status(false, "connect failed: unexpected identifier");
-        close();
-        return;
+        // handshake phase
+        handshake_req_.el_link_identifier = htonl(EL_LINK_IDENTIFIER);
+        handshake_req_.command            = htonl(EL_COMMAND_HANDSHAKE);
+        handshake_req_.el_proxy_version   = htonl(EL_DAP_VERSION);
+
+        arm_deadline(kDefaultCommTimeoutMs);
+        yield asio::async_write(get_socket(), asio::buffer(&handshake_req_, sizeof(handshake_req_)), resume());
+        if (ec) {
+            return fail_connect(ec);
+        }
+
+        yield asio::async_read(get_socket(), asio::buffer(&handshake_res_, sizeof(handshake_res_)), resume());
+        if (ec) {
+            return fail_connect(ec);
+        }
+
+        if (ntohl(handshake_res_.el_link_identifier) != EL_LINK_IDENTIFIER) {
+            notify_connection_status(false, "connect failed: unexpected identifier");
+            close();
+            return;
+        }
+
+        if (ntohl(handshake_res_.command) != EL_COMMAND_HANDSHAKE) {
+            notify_connection_status(false, "connect failed: unexpected command");
+            close();
+            return;
+        }
+
+        // get device info
+        for (info_index_ = 0; info_index_ < kDeviceInfoNum; info_index_++) {
+            req_buffer_[0] = ID_DAP_Info;
+            req_buffer_[1] = kDeviceInfoId[info_index_];
+
+            arm_deadline(kDefaultCommTimeoutMs);
+            yield asio::async_write(get_socket(), asio::buffer(req_buffer_.data(), 2), resume());
+            if (ec) {
+                return fail_connect(ec);
+            }
+
+            yield get_socket().async_read_some(asio::buffer(res_buffer_), resume());
+            if (ec) {
+                return fail_connect(ec);
+            }
+
+            if (store_device_info(info_index_, static_cast<int>(n)) != 0) {
+                notify_connection_status(false, "connect failed: unexpected device info");
+                close();
+                return;
+            }
+        }
+        cancel_deadline();
+
+        // Ready to receive data of RDDI, drop a signal left by a request to the previous connection
+        for (auto &channel : instance_->channel) {
+            ResetEvent(channel.producer_event);
+        }
+        set_proxy_ready();
+        notify_connection_status(true, "connect succeeded");
+        for (int client = 0; client < EL_MAX_PROXY_CLIENT; client++) {
+            wait_client_request(client);
+        }
+
+        // data phase
+        for (;;) {
+            while (!scheduler_.has_pending()) {
+                yield request_signal_.async_wait(resume_wait());
+            }
+
+            // Run after the other completed waits, so that requests arriving together can be batched
+            yield asio::post(strand_, [this, self = shared_from_this()]() { run(); });
+
+            prepare_round();
+            for (exchange_index_ = 0; exchange_index_ < exchanges_.size(); exchange_index_++) {
+                arm_deadline(round_timeout_ms_);
+                yield asio::async_write(get_socket(),
+                                        asio::buffer(exchanges_[exchange_index_].req, exchanges_[exchange_index_].req_len),
+                                        resume());
+                if (ec) {
+                    return fail_data_phase(ec);
+                }
+
+                yield get_socket().async_read_some(asio::buffer(res_buffer_), resume());
+                if (ec) {
+                    return fail_data_phase(ec);
+                }
+                cancel_deadline();
+
+                if (complete_exchange(exchanges_[exchange_index_], static_cast<int>(n)) != 0) {
+                    set_running_status(false, "unexpected response");
+                    close();
+                    return;
+                }
+            }
+
+            finish_round();
+        }
     }
+}
 
-    if (ntohl(req.command) != EL_COMMAND_HANDSHAKE) {
-        notify_connection_status(false, "connect failed: unexpected command");
-        close();
-        return;
+#include "thirdparty/asio/include/asio/unyield.hpp"
+
+
+void SocketClient::arm_deadline(int timeout_ms)
+{
+    const uint32_t id = ++deadline_id_;
+
+    deadline_timer_.expires_after(std::chrono::milliseconds(timeout_ms));
+    deadline_timer_.async_wait([this, self = shared_from_this(), id](asio::error_code ec) {
+        if (ec || id != deadline_id_) {
+            return; // cancelled, or the operation has completed
+        }
+
+        // abort the pending operation, the coroutine gets operation_aborted
+        is_timed_out_ = true;
+        asio::error_code ignore;
+        get_socket().cancel(ignore);
+    });
+}
+
+void SocketClient::cancel_deadline()
+{
+    ++deadline_id_;
+    deadline_timer_.cancel();
+}
+
+std::string SocketClient::get_error_message(const asio::error_code &ec)
+{
+    if (is_timed_out_ && ec == asio::error::operation_aborted) {
+        return "probe response timeout";
     }
 
-    return get_device_info();
+    return ec.message();
 }
 
-void SocketClient::get_device_info()
+void SocketClient::fail_connect(const asio::error_code &ec)
 {
-    // get device info
-    std::array<char, 1500> info_res_buffer;
+    notify_connection_status(false, get_error_message(ec));
+    close();
+}
 
+void SocketClient::fail_data_phase(const asio::error_code &ec)
+{
+    // RDDI clients of this round are woken up with an invalid response by close()
+    set_running_status(false, get_error_message(ec));
+    close();
+}
 
-    auto get_dap_info = [&](std::array<uint8_t, 2> buf) {
-        asio::error_code ec;
-        asio::write(get_socket(), asio::buffer(buf), asio::transfer_exactly(2), ec);
-        if (ec) {
-            notify_connection_status(false, ec.message());
-            close();
-            return false;
-        }
+// return: 0 on success, -1 if the response is not a DAP_Info response
+int SocketClient::store_device_info(int index, int res_len)
+{
+    el_memory_t *memory = instance_->channel[0].shared_memory_ptr;
 
-        get_socket().read_some(asio::buffer(info_res_buffer), ec);
-        //asio::read(get_socket(), asio::buffer(info_res_buffer), asio::transfer_all(), ec);
-        if (ec) {
-            notify_connection_status(false, ec.message());
-            close();
-            return false;
-        }
+    // command, len, info
+    if (res_len < 2 || res_buffer_[0] != ID_DAP_Info) {
+        return -1;
+    }
 
-        assert(info_res_buffer[0] == 0x00); // command
-        assert(info_res_buffer[1] >= 1);    // len
+    int len = (std::min)(static_cast<int>(res_buffer_[1]), res_len - 2);
 
-        return true;
+    // strings keep their terminator
+    auto store_string = [&](char *field, int size) {
+        len = (std::min)(len, size - 1);
+        memcpy(field, &res_buffer_[2], len);
+        field[len] = '\0';
     };
 
-    if (!get_dap_info({ 0x00, 0x02 })) { // Product Name
-        return;
+    switch (index) {
+        case 0: // Product Name
+            store_string(memory->info_page.product_name, sizeof(memory->info_page.product_name));
+            break;
+        case 1: // Serial Number
+            store_string(memory->info_page.serial_number, sizeof(memory->info_page.serial_number));
+            break;
+        case 2: // CMSIS-DAP Protocol Version(firmware version)
+            store_string(memory->info_page.firmware_version, sizeof(memory->info_page.firmware_version));
+            break;
+        case 3: // Capabilities
+            if (len < 1) {
+                return -1;
+            }
+            len = (std::min)(len, static_cast<int>(sizeof(memory->info_page.capabilities)));
+            memory->info_page.capabilities = 0;
+            memcpy(&(memory->info_page.capabilities), &res_buffer_[2], len);
+            break;
     }
-    int len = info_res_buffer[1];
-    memcpy(&(k_shared_memory_ptr->info_page.product_name), &info_res_buffer[2], len);
 
+    return 0;
+}
+
+void SocketClient::set_proxy_ready()
+{
+    el_memory_t *memory = instance_->channel[0].shared_memory_ptr;
 
+    for (int client = 1; client < EL_MAX_PROXY_CLIENT; client++) {
+        el_memory_t *client_memory = instance_->channel[client].shared_memory_ptr;
 
-    if (!get_dap_info({ 0x00, 0x03 })) { // Serial Number
-        return;
+        client_memory->info_page.capabilities           = memory->info_page.capabilities;
+        client_memory->info_page.device_dap_buffer_size = memory->info_page.device_dap_buffer_size;
+        memcpy(client_memory->info_page.product_name, memory->info_page.product_name, sizeof(memory->info_page.product_name));
+        memcpy(client_memory->info_page.serial_number, memory->info_page.serial_number, sizeof(memory->info_page.serial_number));
+        memcpy(client_memory->info_page.firmware_version, memory->info_page.firmware_version, sizeof(memory->info_page.firmware_version));
     }
-    len = info_res_buffer[1];
-    memcpy(&(k_shared_memory_ptr->info_page.serial_number), &info_res_buffer[2], len);
 
-    if (!get_dap_info({ 0x00, 0x04 })) { // CMSIS-DAP Protocol Version(firmware version)
-        return;
+    for (auto &channel : instance_->channel) {
+        channel.shared_memory_ptr->info_page.is_proxy_ready = 1;
     }
-    len = info_res_buffer[1];
-    memcpy(&(k_shared_memory_ptr->info_page.firmware_version), &info_res_buffer[2], len);
+}
 
-    if (!get_dap_info({ 0x00, 0xF0 })) { // Capabilities
-        return;
+void SocketClient::wait_client_request(int client)
+{
+    // wait for a request from RDDI without holding a thread of the pool
+    producer_event_handle_[client].async_wait([this, self = shared_from_this(), client](asio::error_code ec) {
+        if (ec || !is_running_) {
+            return; // socket close
+        }
+
+        el_memory_t *memory = instance_->channel[0].shared_memory_ptr;
+        scheduler_.set_pending(client, memory->info_page.client_priority[client]);
+        release_stale_scope();
+
+        // wake up the coroutine if it is waiting for a request
+        request_signal_.cancel();
+    });
+}
+
+int SocketClient::get_comm_timeout(int client)
+{
+    const uint32_t timeout = instance_->channel[client].shared_memory_ptr->info_page.comm_timeout_ms;
+    return timeout ? static_cast<int>(timeout) : kDefaultCommTimeoutMs;
+}
+
+void SocketClient::prepare_round()
+{
+    el_memory_t *memory = instance_->channel[0].shared_memory_ptr;
+
+    release_stale_scope();
+
+    // a new owner of the slot knows nothing about the previous one
+    for (int client = 0; client < EL_MAX_PROXY_CLIENT; client++) {
+        if (client_owner_[client] != memory->info_page.client_owner[client]) {
+            client_owner_[client] = memory->info_page.client_owner[client];
+            client_context_[client].invalidate();
+        }
     }
-    len = info_res_buffer[1];
-    assert(len == 1 || len == 2);
-    memcpy(&(k_shared_memory_ptr->info_page.capabilities), &info_res_buffer[2], len);
 
+    std::vector<int> order = scheduler_.get_service_order();
 
-    // Ready to receive data of RDDI
-    k_shared_memory_ptr->info_page.is_proxy_ready = 1;
-    notify_connection_status(true, "connect succeeded");
-    return do_data_process();
+    exchanges_.clear();
+    served_.clear();
+    round_timeout_ms_ = get_comm_timeout(order[0]);
+
+    if (is_scope_orphaned_) {
+        exchanges_.push_back({ kExchangeScopeExit, -1, kScopeExitRequest, static_cast<int>(sizeof(kScopeExitRequest)) });
+        is_scope_orphaned_ = false;
+    }
+
+    // nothing is batched with the requests of a client inside the vendor scope
+    if (scheduler_.get_exclusive() < 0 && is_batchable_request(order[0])) {
+        prepare_batch_request(order);
+    } else {
+        prepare_single_request(order[0]);
+    }
 }
 
-void SocketClient::do_data_process()
+void SocketClient::prepare_single_request(int client)
 {
-    asio::error_code          ec;
-    std::array<uint8_t, 1500> res_buffer;
-    int                       data_len;
-
-    for (;;) {
-        // step1: send request
-        WaitForSingleObject(k_producer_event, INFINITE);
-        if (!is_running_) {
-            return; // socket close
+    el_memory_t *memory = instance_->channel[client].shared_memory_ptr;
+
+    // the probe accepts only vendor commands inside the vendor scope
+    if (client != last_client_ && scheduler_.get_exclusive() < 0) {
+        int       commands;
+        const int len = client_context_[client].make_restore_command(probe_context_, probe_context_.has_sticky_error(),
+                                                                     restore_buffer_.data() + 2, &commands);
+        if (commands == 1) {
+            exchanges_.push_back({ kExchangeRestore, -1, restore_buffer_.data() + 2, len });
+        } else if (commands > 1) {
+            restore_buffer_[0] = ID_DAP_ExecuteCommands;
+            restore_buffer_[1] = static_cast<uint8_t>(commands);
+            exchanges_.push_back({ kExchangeRestore, -1, restore_buffer_.data(), 2 + len });
         }
+    }
+    last_client_ = client;
 
-        asio::write(get_socket(),
-                    asio::buffer(&(k_shared_memory_ptr->producer_page.data), k_shared_memory_ptr->producer_page.data_len),
-                    ec);
-        if (ec) {
-            set_running_status(false, ec.message());
-            close();
-            return;
+    exchanges_.push_back({ kExchangeSingle, client, memory->producer_page.data, static_cast<int>(memory->producer_page.data_len) });
+}
+
+/*
+ * Put the transfers of several clients into one DAP_ExecuteCommands. The DAP state of each
+ * client is restored in front of its own transfer when the previous command belongs to
+ * another client. The probe executes all commands even if one faults, so the sticky errors
+ * are cleared before each client that follows another one in the batch.
+ */
+void SocketClient::prepare_batch_request(const std::vector<int> &order)
+{
+    std::array<uint8_t, DapContext::kMaxRestoreLength> restore;
+
+    DapContext probe       = probe_context_; // probe state after the commands collected so far
+    int        last_client = last_client_;
+    int        req_len     = 2;
+    int        res_len     = 2;
+    bool       has_restore = false;
+
+    batch_commands_.clear();
+    for (int client : order) {
+        if (!is_batchable_request(client)) {
+            continue;
         }
 
-        // step2: receive response
-        data_len = get_socket().read_some(asio::buffer(res_buffer), ec);
-        if (ec) {
-            set_running_status(false, ec.message());
-            close();
-            return;
+        el_memory_t   *memory       = instance_->channel[client].shared_memory_ptr;
+        const uint8_t *req          = memory->producer_page.data;
+        const int      len          = memory->producer_page.data_len;
+        int            rst_len      = 0;
+        int            rst_commands = 0;
+        int            rst_res_len  = 0;
+
+        if (client != last_client) {
+            const bool clear_sticky = !batch_commands_.empty() || probe.has_sticky_error();
+            rst_len = client_context_[client].make_restore_command(probe, clear_sticky, restore.data(), &rst_commands);
+        }
+        for (const uint8_t *rp = restore.data(); rp < restore.data() + rst_len; rp += get_command_request_length(rp)) {
+            rst_res_len += get_command_response_length(rp, nullptr);
+        }
+
+        const int need_req = rst_len + len;
+        const int need_res = rst_res_len + get_command_response_length(req, nullptr);
+        if (req_len + need_req > kMaxBatchLength || res_len + need_res > kMaxBatchLength
+            || batch_commands_.size() + rst_commands + 1 > 255) {
+            continue;
+        }
+
+        if (rst_len) {
+            memcpy(&req_buffer_[req_len], restore.data(), rst_len);
+            for (uint8_t *rp = &req_buffer_[req_len]; rp < &req_buffer_[req_len + rst_len]; rp += get_command_request_length(rp)) {
+                probe.track_command(rp, nullptr, 0);
+                batch_commands_.push_back({ -1, rp });
+            }
+            has_restore = true;
+        }
+        memcpy(&req_buffer_[req_len + rst_len], req, len);
+        probe.track_command(req, nullptr, 0);
+        batch_commands_.push_back({ client, &req_buffer_[req_len + rst_len] });
+
+        req_len += need_req;
+        res_len += need_res;
+        last_client = client;
+    }
+
+    if (batch_commands_.empty() || (batch_commands_.size() == 1 && !has_restore)) {
+        // nothing to batch, keep the original packet
+        return prepare_single_request(order[0]);
+    }
+
+    req_buffer_[0] = ID_DAP_ExecuteCommands;
+    req_buffer_[1] = static_cast<uint8_t>(batch_commands_.size());
+
+    exchanges_.push_back({ kExchangeBatch, -1, req_buffer_.data(), req_len });
+}
+
+int SocketClient::complete_exchange(const Exchange &exchange, int res_len)
+{
+    switch (exchange.type) {
+        case kExchangeRestore:
+            if (res_len < 2 || res_buffer_[0] != exchange.req[0]) {
+                probe_context_.invalidate();
+                return 0;
+            }
+
+            if (!probe_context_.track_command(exchange.req, res_buffer_.data(), res_len)
+                || !is_response_ok(exchange.req, res_buffer_.data(), res_len)) {
+                // let the client find the error by itself
+                probe_context_.invalidate();
+            }
+            return 0;
+
+        case kExchangeSingle: {
+            el_memory_t *memory = instance_->channel[exchange.client].shared_memory_ptr;
+
+            if (parse_response(memory, res_buffer_.data(), res_len) != 0) {
+                return -1;
+            }
+
+            track_request(exchange.client, exchange.req, res_buffer_.data(), res_len);
+            track_vendor_scope(exchange.client, exchange.req, exchange.req_len, res_buffer_.data(), res_len);
+            served_.push_back(exchange.client);
+            return 0;
         }
 
-        //// FIXME: verify response data length
+        case kExchangeBatch:
+            complete_batch_request(res_len);
+            return 0;
 
-        // step3: parse response
-        uint8_t *p        = res_buffer.data();
-        int      count    = *p == ID_DAP_ExecuteCommands ? *(p + 1) : 1;
-        bool     out_flag = false;
+        case kExchangeScopeExit:
+            probe_context_.invalidate();
+            return 0;
+    }
 
-        if (*p == ID_DAP_ExecuteCommands) { // skip header
-            p += 2;
+    return -1;
+}
+
+void SocketClient::complete_batch_request(int res_len)
+{
+    const uint8_t *p         = res_buffer_.data() + 2;
+    const uint8_t *end       = res_buffer_.data() + res_len;
+    const int      res_count = res_buffer_[0] == ID_DAP_ExecuteCommands ? res_buffer_[1] : 0;
+
+    for (int i = 0; i < static_cast<int>(batch_commands_.size()); i++) {
+        const BatchCommand &command = batch_commands_[i];
+
+        int len = -1;
+        if (i < res_count && p + 2 <= end) {
+            len = get_command_response_length(command.req, p);
         }
 
-        for (; count > 0; count--) {
-            switch (*p) {
-                case ID_DAP_Connect: {
-                    p += 2;
-                    break;
-                }
-                case ID_DAP_Disconnect: {
-                    p += 2;
-                    break;
-                }
+        if (len < 0 || p + len > end) {
+            // malformed response, the state of the probe is unknown
+            probe_context_.invalidate();
+            if (command.client >= 0) {
+                el_memory_t *memory = instance_->channel[command.client].shared_memory_ptr;
+                set_consumer_status(memory, DAP_RES_ERROR);
+                served_.push_back(command.client);
+            }
+            continue;
+        }
 
-                case ID_DAP_TransferConfigure: {
-                    p += 2;
-                    set_consumer_status(DAP_RES_OK); // FIXME: check response status?
-                    break;
-                }
-                case ID_DAP_Transfer: {
-                    int transfer_count = (int)*++p;
-                    int status         = (int)*++p;
-                    p++; // point to data
+        if (command.client < 0) {
+            if (!probe_context_.track_command(command.req, p, len) || !is_response_ok(command.req, p, len)) {
+                probe_context_.invalidate();
+            }
+        } else {
+            el_memory_t *memory = instance_->channel[command.client].shared_memory_ptr;
 
-                    if (transfer_count != k_shared_memory_ptr->producer_page.command_count) {
-                        out_flag = true;
+            parse_response(memory, p, len);
+            track_request(command.client, command.req, p, len);
+            last_client_ = command.client;
+            served_.push_back(command.client);
+        }
 
-                        set_consumer_status(DAP_RES_FAULT);
-                        break;
-                    }
+        p += len;
+    }
+}
 
-                    set_consumer_status(status);
-                    if (status != DAP_RES_OK) {
-                        // not OK
-                        out_flag = true;
-                        break;
-                    }
+void SocketClient::finish_round()
+{
+    scheduler_.mark_served(served_);
+    for (int client : served_) {
+        SetEvent(instance_->channel[client].consumer_event);
+        wait_client_request(client);
+    }
+}
 
-                    int remain_data_len = data_len - (p - res_buffer.data());
-                    assert(remain_data_len % 4 == 0); // FIXME: close and clean up
-                    k_shared_memory_ptr->consumer_page.data_len = remain_data_len;
-                    memcpy(k_shared_memory_ptr->consumer_page.data, p, remain_data_len);
+bool SocketClient::is_batchable_request(int client)
+{
+    el_memory_t *memory = instance_->channel[client].shared_memory_ptr;
 
-                    break;
-                }
+    if (memory->producer_page.data_len < 4) {
+        return false;
+    }
 
-                case ID_DAP_TransferBlock: {
-                    p++;
-                    const int transfer_count = ((*(p + 1)) << 8) | (*p);
-                    p += 2;
+    const uint8_t command = memory->producer_page.data[0];
+    return command == ID_DAP_Transfer || command == ID_DAP_TransferBlock;
+}
 
-                    const int status = *p++;
+void SocketClient::track_request(int client, const uint8_t *req, const uint8_t *res, int res_len)
+{
+    client_context_[client].track_command(req, res, res_len);
+    if (!probe_context_.track_command(req, res, res_len)) {
+        probe_context_.invalidate();
+    }
+}
 
+// The client that entered the vendor scope is served alone until it exits the scope
+void SocketClient::track_vendor_scope(int client, const uint8_t *req, int req_len, const uint8_t *res, int res_len)
+{
+    if (req_len < 2 || req[0] != ID_DAP_Vendor8 || res_len < 2 || res[0] != ID_DAP_Vendor8) {
+        return;
+    }
 
-                    if (transfer_count != k_shared_memory_ptr->producer_page.command_count) {
-                        // FIXME:
-                        out_flag = true;
+    if (req[1] == EL_VENDOR_SCOPE_ENTER && res[1] == EL_VENDOR_STATUS_OK) {
+        scheduler_.set_exclusive(client);
+    } else if (req[1] == EL_VENDOR_SCOPE_EXIT && scheduler_.get_exclusive() == client) {
+        scheduler_.set_exclusive(-1);
+    }
+}
 
-                        set_consumer_status(DAP_RES_FAULT);
-                        break;
-                    }
+// The owner of the vendor scope released its slot without exiting the scope
+void SocketClient::release_stale_scope()
+{
+    el_memory_t *memory = instance_->channel[0].shared_memory_ptr;
+    const int    client = scheduler_.get_exclusive();
 
-                    set_consumer_status(status);
-                    if (status != DAP_RES_OK && status != DAP_RES_FAULT) {
-                        // not OK
-                        out_flag = true;
-                        break;
-                    }
+    if (client >= 0 && client_owner_[client] != memory->info_page.client_owner[client]) {
+        scheduler_.set_exclusive(-1);
+        is_scope_orphaned_ = true;
+    }
+}
 
-                    const int remain_data_len = data_len - (p - res_buffer.data());
-                    assert(remain_data_len % 4 == 0); // FIXME:
-                    k_shared_memory_ptr->consumer_page.data_len = remain_data_len;
-                    memcpy(k_shared_memory_ptr->consumer_page.data, p, remain_data_len);
+int SocketClient::parse_response(el_memory_t *memory, const uint8_t *res, int res_len)
+{
+    // step3: parse response
+    const uint8_t *p        = res;
+    int            count    = *p == ID_DAP_ExecuteCommands ? *(p + 1) : 1;
+    int            blocks   = 0; // transfers of the DAP_TransferBlock commands so far
+    bool           out_flag = false;
+
+    if (*p == ID_DAP_ExecuteCommands) { // skip header
+        p += 2;
+    }
+
+    for (; count > 0; count--) {
+        switch (*p) {
+            case ID_DAP_Connect: {
+                p += 2;
+                break;
+            }
+            case ID_DAP_Disconnect: {
+                p += 2;
+                break;
+            }
 
+            case ID_DAP_TransferConfigure: {
+                p += 2;
+                set_consumer_status(memory, DAP_RES_OK); // FIXME: check response status?
+                break;
+            }
+            case ID_DAP_Transfer: {
+                int transfer_count = (int)*++p;
+                int status         = (int)*++p;
+                p++; // point to data
+
+                if (transfer_count != memory->producer_page.command_count || status != DAP_RES_OK) {
+                    out_flag = true;
+
+                    // Pass the completed transfers and the values read so far, so that the
+                    // caller can tell which transfer failed.
+                    int remain_data_len = res_len - (p - res);
+                    remain_data_len -= remain_data_len % 4;
+                    memcpy(memory->consumer_page.data, &transfer_count, 4);
+                    memcpy(memory->consumer_page.data + 4, p, remain_data_len);
+                    memory->consumer_page.data_len = 4 + remain_data_len;
+
+                    set_consumer_status(memory, transfer_count != memory->producer_page.command_count ? DAP_RES_FAULT : status);
                     break;
                 }
 
-                case ID_DAP_WriteABORT: {
-                    if (*(p + 1) != 0) { // status code
-                        set_consumer_status(DAP_RES_FAULT);
+                set_consumer_status(memory, status);
+
+                int remain_data_len = res_len - (p - res);
+                assert(remain_data_len % 4 == 0); // FIXME: close and clean up
+                memory->consumer_page.data_len = remain_data_len;
+                memcpy(memory->consumer_page.data, p, remain_data_len);
+
+                break;
+            }
+
+            case ID_DAP_TransferBlock: {
+                p++;
+                const int transfer_count = ((*(p + 1)) << 8) | (*p);
+                p += 2;
+
+                const int status = *p++;
+
+                blocks += transfer_count;
+                if (count > 1) {
+                    // load packet of write blocks, no data and more blocks follow
+                    if (status != DAP_RES_OK) {
                         out_flag = true;
-                    } else {
-                        set_consumer_status(DAP_RES_OK);
+                        set_consumer_status(memory, status);
                     }
-
                     break;
                 }
 
-                case ID_DAP_ResetTarget: {
-                    p += 3;
+                if (blocks != memory->producer_page.command_count) {
+                    // FIXME:
+                    out_flag = true;
+
+                    set_consumer_status(memory, DAP_RES_FAULT);
                     break;
                 }
-                case ID_DAP_SWJ_Pins: {
-                    k_shared_memory_ptr->consumer_page.data_len = 1;
-                    k_shared_memory_ptr->consumer_page.data[0]  = *(p + 1);
-                    set_consumer_status(DAP_RES_OK);
-                    p += 2;
+
+                set_consumer_status(memory, status);
+                if (status != DAP_RES_OK && status != DAP_RES_FAULT) {
+                    // not OK
+                    out_flag = true;
                     break;
                 }
-                case ID_DAP_JTAG_Sequence: {
-                    if (*(p + 1) != 0) { // status code
-                        set_consumer_status(DAP_RES_FAULT);
-                        out_flag = true;
-                        break;
-                    }
 
-                    p += 2;
+                const int remain_data_len = res_len - (p - res);
+                assert(remain_data_len % 4 == 0); // FIXME:
+                memory->consumer_page.data_len = remain_data_len;
+                memcpy(memory->consumer_page.data, p, remain_data_len);
 
-                    const int remain_data_len = data_len - (p - res_buffer.data());
-                    if (remain_data_len != k_shared_memory_ptr->producer_page.command_count) {
-                        out_flag = true;
-                        set_consumer_status(DAP_RES_FAULT);
-                        break;
-                    }
-                    k_shared_memory_ptr->consumer_page.data_len = remain_data_len;
-                    memcpy(k_shared_memory_ptr->consumer_page.data, p, remain_data_len);
+                break;
+            }
 
-                    set_consumer_status(DAP_RES_OK);
-                    break;
+            case ID_DAP_WriteABORT: {
+                if (*(p + 1) != 0) { // status code
+                    set_consumer_status(memory, DAP_RES_FAULT);
+                    out_flag = true;
+                } else {
+                    set_consumer_status(memory, DAP_RES_OK);
                 }
 
-                case ID_DAP_JTAG_Configure: {
-                    int status = *(p + 1);
-                    p += 2;
+                break;
+            }
 
-                    set_consumer_status(status == 0 ? DAP_RES_OK : DAP_RES_ERROR);
+            case ID_DAP_ResetTarget: {
+                p += 3;
+                break;
+            }
+            case ID_DAP_SWJ_Pins: {
+                memory->consumer_page.data_len = 1;
+                memory->consumer_page.data[0]  = *(p + 1);
+                set_consumer_status(memory, DAP_RES_OK);
+                p += 2;
+                break;
+            }
+            case ID_DAP_JTAG_Sequence: {
+                if (*(p + 1) != 0) { // status code
+                    set_consumer_status(memory, DAP_RES_FAULT);
+                    out_flag = true;
                     break;
                 }
 
-                case ID_DAP_SWJ_Clock: {
-                    p += 2;
-                    break;
-                }
-                case ID_DAP_SWJ_Sequence: {
-                    int status = *(p + 1);
-                    p += 2;
+                p += 2;
 
-                    set_consumer_status(status == 0 ? DAP_RES_OK : DAP_RES_ERROR);
+                const int remain_data_len = res_len - (p - res);
+                if (remain_data_len != memory->producer_page.command_count) {
+                    out_flag = true;
+                    set_consumer_status(memory, DAP_RES_FAULT);
                     break;
                 }
-                case ID_DAP_SWD_Configure: {
-                    p += 2;
-                    break;
-                }
-                default:
-                    close();
-                    return;
+                memory->consumer_page.data_len = remain_data_len;
+                memcpy(memory->consumer_page.data, p, remain_data_len);
+
+                set_consumer_status(memory, DAP_RES_OK);
+                break;
             }
 
-            if (out_flag)
+            case ID_DAP_JTAG_Configure: {
+                int status = *(p + 1);
+                p += 2;
+
+                set_consumer_status(memory, status == 0 ? DAP_RES_OK : DAP_RES_ERROR);
                 break;
-        }
+            }
 
-        if (out_flag) {
-            // set out_command invalid
-        }
+            case ID_DAP_SWJ_Clock: {
+                p += 2;
+                break;
+            }
+            case ID_DAP_SWJ_Sequence: {
+                int status = *(p + 1);
+                p += 2;
 
+                set_consumer_status(memory, status == 0 ? DAP_RES_OK : DAP_RES_ERROR);
+                break;
+            }
+            case ID_DAP_SWD_Configure: {
+                p += 2;
+                break;
+            }
+            case ID_DAP_Vendor8: {
+                // the whole vendor response goes to RDDI, the caller checks its status
+                const int remain_data_len = res_len - (p - res);
+                if (remain_data_len < 4 || remain_data_len < 4 + (p[2] | (p[3] << 8))) {
+                    out_flag = true;
+                    set_consumer_status(memory, DAP_RES_ERROR);
+                    break;
+                }
 
+                memory->consumer_page.data_len = 4 + (p[2] | (p[3] << 8));
+                memcpy(memory->consumer_page.data, p, memory->consumer_page.data_len);
 
+                set_consumer_status(memory, DAP_RES_OK);
+                p += memory->consumer_page.data_len;
+                break;
+            }
+            case ID_DAP_Invalid: {
+                // command not implemented by the probe, e.g. vendor commands of an older firmware
+                out_flag = true;
+                set_consumer_status(memory, DAP_RES_ERROR);
+                break;
+            }
+            default:
+                return -1;
+        }
 
-        // step4: notify
-        SetEvent(k_consumer_event);
+        if (out_flag)
+            break;
     }
+
+    if (out_flag) {
+        // set out_command invalid
+    }
+
+    return 0;
 }
@@ -2,101 +2,238 @@
 
 #include "SocketClient.hpp"
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+ * All proxy instances share one io_context. The data phase waits on the producer event
+ * asynchronously, so a few threads are enough to serve many probes.
+ *
+ * The pool lives until the process exits: its threads can not be joined under the loader
+ * lock, and a pool destroyed without the join would free the io_context under them. It is
+ * never deleted, and the module is pinned once the threads run, so that no FreeLibrary
+ * unloads their code.
+ */
+class ProxyIoContextPool
+{
+    public:
+    static ProxyIoContextPool &get()
+    {
+        static ProxyIoContextPool *pool = new ProxyIoContextPool();
+        return *pool;
+    }
+
+    asio::io_context &get_io_context()
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (threads_.empty()) {
+            HMODULE module;
+            GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+                               reinterpret_cast<LPCWSTR>(&ProxyIoContextPool::get), &module);
+
+            const unsigned int thread_num = (std::max)(2U, std::thread::hardware_concurrency());
+            for (unsigned int i = 0; i < thread_num; i++) {
+                threads_.emplace_back([this]() {
+                    for (;;) {
+                        try {
+                            io_context_.run();
+                            return;
+                        } catch (std::exception &e) {
+                            // keep the other instances alive
+                        }
+                    }
+                });
+            }
+        }
+
+        return io_context_;
+    }
+
+    private:
+    ProxyIoContextPool()
+        : work_guard_(asio::make_work_guard(io_context_))
+    {
+    }
+
+    asio::io_context                                           io_context_;
+    asio::executor_work_guard<asio::io_context::executor_type> work_guard_;
+    std::vector<std::thread>                                   threads_;
+    std::mutex                                                 mutex_;
+};
+
 
 class ProxyManager
 {
     public:
     ProxyManager()
-        : on_connect_callback_(nullptr),
-          on_socket_disconnect_callback_(nullptr)
     {
+        for (auto &instance : instances_) {
+            instance.on_connect_callback           = nullptr;
+            instance.on_socket_disconnect_callback = nullptr;
+        }
     }
 
-    bool is_proxy_running()
+    bool is_proxy_running(int instance)
     {
-        if (client_.get()) {
-            return client_.get()->is_socket_running();
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto                       &client = instances_[instance].client;
+        if (client.get()) {
+            return client.get()->is_socket_running();
         }
 
         return false;
     }
 
-    void set_on_proxy_connect_callback(onSocketConnectCallbackType callback)
+    void set_on_proxy_connect_callback(int instance, onSocketConnectCallbackType callback)
     {
-        on_connect_callback_ = callback;
+        std::lock_guard<std::mutex> lk(mutex_);
+        instances_[instance].on_connect_callback = callback;
 
-        if (client_.get()) {
-            client_.get()->set_connect_callback(callback);
+        if (instances_[instance].client.get()) {
+            instances_[instance].client.get()->set_connect_callback(callback);
         }
     }
 
-    void set_on_proxy_disconnect_callback(onSocketDisconnectCallbackType callback)
+    void set_on_proxy_disconnect_callback(int instance, onSocketDisconnectCallbackType callback)
     {
-        on_socket_disconnect_callback_ = callback;
+        std::lock_guard<std::mutex> lk(mutex_);
+        instances_[instance].on_socket_disconnect_callback = callback;
 
-        if (client_.get()) {
-            client_.get()->set_disconnect_callback(callback);
+        if (instances_[instance].client.get()) {
+            instances_[instance].client.get()->set_disconnect_callback(callback);
         }
     }
 
-    int start_with_address(std::string address)
+    int start_with_address(int instance, std::string address)
     {
-        stop();
-        client_ = std::make_unique<SocketClient>();
+        std::lock_guard<std::mutex> lifecycle_lk(lifecycle_mutex_);
+
+        if (el_proxy_instance_init(instance)) {
+            return -1;
+        }
+
+        // returns after the previous connection released the producer events
+        stop_client(instance);
+
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto                       &slot   = instances_[instance];
+        auto                        client = std::make_shared<SocketClient>(ProxyIoContextPool::get().get_io_context(),
+                                                                            el_proxy_get_instance(instance));
 
-        if (on_connect_callback_) {
-            client_.get()->set_connect_callback(on_connect_callback_);
+        if (slot.on_connect_callback) {
+            client.get()->set_connect_callback(slot.on_connect_callback);
         }
-        if (on_socket_disconnect_callback_) {
-            client_.get()->set_disconnect_callback(on_socket_disconnect_callback_);
+        if (slot.on_socket_disconnect_callback) {
+            client.get()->set_disconnect_callback(slot.on_socket_disconnect_callback);
         }
 
-        int ret = client_.get()->init_socket(address, "3240");
+        int ret = client.get()->init_socket(address, "3240");
         if (ret != 0) {
             return ret;
         }
 
-        return client_.get()->start();
+        slot.client = client;
+        return client.get()->start();
     }
 
-    void stop()
+    void stop(int instance)
     {
-        if (client_.get()) {
-            client_.get()->kill();
-        }
-        client_.reset(nullptr);
+        std::lock_guard<std::mutex> lifecycle_lk(lifecycle_mutex_);
+        stop_client(instance);
     }
 
     private:
-    onSocketConnectCallbackType    on_connect_callback_;
-    onSocketDisconnectCallbackType on_socket_disconnect_callback_;
-    std::unique_ptr<SocketClient>  client_;
+    void stop_client(int instance)
+    {
+        std::shared_ptr<SocketClient> client;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            client = std::move(instances_[instance].client);
+        }
+
+        if (client.get()) {
+            client.get()->kill();
+        }
+    }
+
+    struct ProxyInstanceSlot {
+        onSocketConnectCallbackType    on_connect_callback;
+        onSocketDisconnectCallbackType on_socket_disconnect_callback;
+        std::shared_ptr<SocketClient>  client;
+    };
+
+    std::array<ProxyInstanceSlot, EL_MAX_PROXY_INSTANCE> instances_;
+    std::mutex                                           mutex_;
+    std::mutex                                           lifecycle_mutex_; // serializes start and stop of the instances
 };
 
 ProxyManager k_manager;
 
 
+inline bool is_valid_instance(int instance)
+{
+    return instance >= 0 && instance < EL_MAX_PROXY_INSTANCE;
+}
+
+
 PROXY_DLL_FUNCTION int el_proxy_start_with_address(char *address)
 {
-    return k_manager.start_with_address(address);
+    return el_proxy_start_instance_with_address(0, address);
 }
 
 
 PROXY_DLL_FUNCTION void el_proxy_stop()
 {
-    if (k_is_proxy_init) {
-        return k_manager.stop();
-    }
+    return el_proxy_stop_instance(0);
 }
 
 
 PROXY_DLL_FUNCTION void el_proxy_set_on_connect_callback(onSocketConnectCallbackType callback)
 {
-    return k_manager.set_on_proxy_connect_callback(callback);
+    return el_proxy_set_instance_on_connect_callback(0, callback);
 }
 
 
 PROXY_DLL_FUNCTION void el_proxy_set_on_disconnect_callback(onSocketDisconnectCallbackType callback)
 {
-    return k_manager.set_on_proxy_disconnect_callback(callback);
+    return el_proxy_set_instance_on_disconnect_callback(0, callback);
+}
+
+
+PROXY_DLL_FUNCTION int el_proxy_start_instance_with_address(int instance, char *address)
+{
+    if (!k_is_proxy_init || !is_valid_instance(instance)) {
+        return -1;
+    }
+
+    return k_manager.start_with_address(instance, address);
+}
+
+
+PROXY_DLL_FUNCTION void el_proxy_stop_instance(int instance)
+{
+    if (k_is_proxy_init && is_valid_instance(instance)) {
+        return k_manager.stop(instance);
+    }
+}
+
+
+PROXY_DLL_FUNCTION void el_proxy_set_instance_on_connect_callback(int instance, onSocketConnectCallbackType callback)
+{
+    if (is_valid_instance(instance)) {
+        return k_manager.set_on_proxy_connect_callback(instance, callback);
+    }
+}
+
+
+PROXY_DLL_FUNCTION void el_proxy_set_instance_on_disconnect_callback(int instance, onSocketDisconnectCallbackType callback)
+{
+    if (is_valid_instance(instance)) {
+        return k_manager.set_on_proxy_disconnect_callback(instance, callback);
+    }
 }
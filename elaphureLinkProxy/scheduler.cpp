@@ -0,0 +1,389 @@
+﻿/**
+ * @file scheduler.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief DAP state tracking for probe multiplexing
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "pch.h"
+
+#include "ProbeScheduler.hpp"
+
+#include <cstring>
+
+
+// DAP_Transfer request bits
+#define DAP_TRANSFER_APnDP       (1U << 0)
+#define DAP_TRANSFER_RnW         (1U << 1)
+#define DAP_TRANSFER_A32         (3U << 2)
+#define DAP_TRANSFER_MATCH_VALUE (1U << 4)
+#define DAP_TRANSFER_MATCH_MASK  (1U << 5)
+#define DAP_TRANSFER_TIMESTAMP   (1U << 7)
+
+#define DP_ABORT_STICKY_CLEAR    0x1E // STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR
+
+#define DP_SELECT                0x08
+#define AP_CSW                   0x00
+#define AP_TAR                   0x04
+#define AP_DRW                   0x0C
+
+
+static inline uint32_t read_u32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline bool has_request_data(uint8_t request)
+{
+    return !(request & DAP_TRANSFER_RnW) || (request & DAP_TRANSFER_MATCH_VALUE);
+}
+
+static inline bool has_response_data(uint8_t request)
+{
+    return (request & DAP_TRANSFER_RnW) && !(request & DAP_TRANSFER_MATCH_VALUE);
+}
+
+
+int get_command_request_length(const uint8_t *req)
+{
+    switch (req[0]) {
+        case ID_DAP_Transfer: {
+            const uint8_t *p = req + 3;
+            for (int i = 0; i < req[2]; i++) {
+                p += has_request_data(*p) ? 5 : 1;
+            }
+            return static_cast<int>(p - req);
+        }
+        case ID_DAP_TransferBlock: {
+            const int count = req[2] | (req[3] << 8);
+            return 5 + ((req[4] & DAP_TRANSFER_RnW) ? 0 : count * 4);
+        }
+        case ID_DAP_TransferConfigure:
+        case ID_DAP_WriteABORT:
+            return 6;
+        case ID_DAP_SWJ_Clock:
+            return 5;
+        default:
+            return -1;
+    }
+}
+
+int get_command_response_length(const uint8_t *req, const uint8_t *res)
+{
+    switch (req[0]) {
+        case ID_DAP_Transfer: {
+            const int      executed = res ? res[1] : req[2];
+            const uint8_t *p        = req + 3;
+            int            len      = 3;
+
+            for (int i = 0; i < executed; i++) {
+                const uint8_t request = *p;
+                p += has_request_data(request) ? 5 : 1;
+                len += (request & DAP_TRANSFER_TIMESTAMP) ? 4 : 0;
+                len += has_response_data(request) ? 4 : 0;
+            }
+            return len;
+        }
+        case ID_DAP_TransferBlock: {
+            const int executed = res ? (res[1] | (res[2] << 8)) : (req[2] | (req[3] << 8));
+            return 4 + ((req[4] & DAP_TRANSFER_RnW) ? executed * 4 : 0);
+        }
+        case ID_DAP_TransferConfigure:
+        case ID_DAP_WriteABORT:
+        case ID_DAP_SWJ_Clock:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+bool is_response_ok(const uint8_t *req, const uint8_t *res, int res_len)
+{
+    if (res_len < 2 || res[0] != req[0]) {
+        return false;
+    }
+
+    switch (req[0]) {
+        case ID_DAP_Transfer:
+            return res_len >= 3 && res[1] == req[2] && res[2] == DAP_RES_OK;
+        case ID_DAP_TransferBlock:
+            return res_len >= 4 && res[1] == req[2] && res[2] == req[3] && res[3] == DAP_RES_OK;
+        case ID_DAP_TransferConfigure:
+        case ID_DAP_WriteABORT:
+        case ID_DAP_SWJ_Clock:
+            return res[1] == 0; // DAP_OK
+        case ID_DAP_ExecuteCommands: {
+            if (res[1] != req[1]) {
+                return false;
+            }
+
+            const uint8_t *rp  = req + 2;
+            const uint8_t *sp  = res + 2;
+            const uint8_t *end = res + res_len;
+            for (int i = 0; i < req[1]; i++) {
+                const int req_len = get_command_request_length(rp);
+                const int cmd_len = sp + 2 <= end ? get_command_response_length(rp, sp) : -1;
+                if (req_len < 0 || cmd_len < 0 || sp + cmd_len > end || !is_response_ok(rp, sp, cmd_len)) {
+                    return false;
+                }
+                rp += req_len;
+                sp += cmd_len;
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+
+void DapContext::track_access(uint8_t request, uint32_t data)
+{
+    const bool    is_read = request & DAP_TRANSFER_RnW;
+    const uint8_t addr    = request & DAP_TRANSFER_A32;
+
+    if (!(request & DAP_TRANSFER_APnDP)) {
+        if (!is_read && addr == DP_SELECT) {
+            is_select_valid_ = true;
+            select_          = data;
+        }
+        return;
+    }
+
+    if (!is_select_valid_) {
+        return;
+    }
+
+    ApContext    &ap  = ap_[static_cast<uint8_t>(select_ >> 24)];
+    const uint8_t reg = (select_ & 0xF0) | addr;
+
+    if (!is_read && reg == AP_CSW) {
+        ap.is_csw_valid = true;
+        ap.csw          = data;
+    } else if (!is_read && reg == AP_TAR) {
+        ap.is_tar_valid = true;
+        ap.tar          = data;
+    } else if (reg == AP_DRW && ap.is_tar_valid) {
+        if (!ap.is_csw_valid || (ap.csw & 0x7) > 2 || (request & DAP_TRANSFER_MATCH_VALUE)) {
+            // the number of reads done by a value match is unknown
+            ap.is_tar_valid = false;
+            return;
+        }
+
+        // TAR auto increment, only guaranteed within a 1KB boundary
+        uint32_t increment;
+        switch ((ap.csw >> 4) & 0x3) {
+            case 0: // off
+                increment = 0;
+                break;
+            case 1: // single
+                increment = 1U << (ap.csw & 0x7);
+                break;
+            case 2: // packed
+                increment = 4;
+                break;
+            default:
+                ap.is_tar_valid = false;
+                return;
+        }
+
+        ap.tar = (ap.tar & ~0x3FFU) | ((ap.tar + increment) & 0x3FFU);
+    }
+}
+
+bool DapContext::track_command(const uint8_t *req, const uint8_t *res, int res_len)
+{
+    switch (req[0]) {
+        case ID_DAP_Transfer: {
+            const int      executed = res ? res[1] : req[2];
+            const uint8_t *p        = req + 3;
+
+            dap_index_ = req[1];
+            if (res && res[2] != DAP_RES_OK) {
+                is_sticky_error_ = true; // a fault sets the sticky error flags of the DP
+            }
+            for (int i = 0; i < executed; i++) {
+                const uint8_t request = *p++;
+                uint32_t      data    = 0;
+                if (has_request_data(request)) {
+                    data = read_u32(p);
+                    p += 4;
+                }
+
+                if (request & DAP_TRANSFER_MATCH_MASK) {
+                    continue; // probe side match mask, not a register access
+                }
+                track_access(request, data);
+            }
+            return true;
+        }
+        case ID_DAP_TransferBlock: {
+            const int     executed = res ? (res[1] | (res[2] << 8)) : (req[2] | (req[3] << 8));
+            const uint8_t request  = req[4];
+
+            dap_index_ = req[1];
+            if (res && res[3] != DAP_RES_OK) {
+                is_sticky_error_ = true;
+            }
+            for (int i = 0; i < executed; i++) {
+                track_access(request, (request & DAP_TRANSFER_RnW) ? 0 : read_u32(req + 5 + i * 4));
+            }
+            return true;
+        }
+        case ID_DAP_ExecuteCommands: {
+            if (res == nullptr) {
+                return false;
+            }
+
+            const uint8_t *rp = req + 2;
+            const uint8_t *sp = res + 2;
+            for (int i = 0; i < res[1]; i++) {
+                const int req_len = get_command_request_length(rp);
+                const int cmd_len = get_command_response_length(rp, sp);
+                if (req_len < 0 || cmd_len < 0 || sp + cmd_len > res + res_len) {
+                    return false;
+                }
+
+                if (!track_command(rp, sp, cmd_len)) {
+                    return false;
+                }
+                rp += req_len;
+                sp += cmd_len;
+            }
+            return true;
+        }
+
+        // idle cycles, WAIT retry and match retry of the probe
+        case ID_DAP_TransferConfigure:
+            if (res && res[1] != 0) {
+                return false;
+            }
+            is_config_valid_ = true;
+            memcpy(config_, req + 1, sizeof(config_));
+            return true;
+
+        case ID_DAP_SWJ_Clock:
+            if (res && res[1] != 0) {
+                return false;
+            }
+            is_clock_valid_ = true;
+            clock_          = read_u32(req + 1);
+            return true;
+
+        // the sticky errors are shared by all clients, they are not part of the context
+        case ID_DAP_WriteABORT:
+            if ((read_u32(req + 2) & DP_ABORT_STICKY_CLEAR) == DP_ABORT_STICKY_CLEAR && (res == nullptr || res[1] == 0)) {
+                is_sticky_error_ = false;
+            }
+            return true;
+
+        // no effect on the DAP state
+        case ID_DAP_Info:
+        case ID_DAP_HostStatus:
+        case ID_DAP_Delay:
+        case ID_DAP_SWJ_Pins:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+int DapContext::make_restore_command(const DapContext &probe, bool clear_sticky, uint8_t *buf, int *commands) const
+{
+    uint8_t *p = buf;
+
+    *commands = 0;
+
+    // the sticky errors of another client would fail the first transfer of this one
+    if (clear_sticky) {
+        const uint32_t abort = DP_ABORT_STICKY_CLEAR;
+
+        *p++ = ID_DAP_WriteABORT;
+        *p++ = dap_index_;
+        memcpy(p, &abort, sizeof(abort));
+        p += 4;
+        (*commands)++;
+    }
+
+    if (is_clock_valid_ && !(probe.is_clock_valid_ && probe.clock_ == clock_)) {
+        *p++ = ID_DAP_SWJ_Clock;
+        memcpy(p, &clock_, sizeof(clock_));
+        p += 4;
+        (*commands)++;
+    }
+
+    if (is_config_valid_ && !(probe.is_config_valid_ && memcmp(probe.config_, config_, sizeof(config_)) == 0)) {
+        *p++ = ID_DAP_TransferConfigure;
+        memcpy(p, config_, sizeof(config_));
+        p += sizeof(config_);
+        (*commands)++;
+    }
+
+    if (!is_select_valid_) {
+        return static_cast<int>(p - buf);
+    }
+
+    uint8_t *transfer = p;
+    int      count    = 0;
+
+    p += 3;
+
+    auto put_write = [&](uint8_t request, uint32_t data) {
+        *p++ = request;
+        memcpy(p, &data, sizeof(data));
+        p += 4;
+        count++;
+    };
+
+    bool     is_select_valid = probe.is_select_valid_;
+    uint32_t select          = probe.select_;
+
+    for (auto &item : ap_) {
+        if (count + 4 > kMaxRestoreCount) {
+            break;
+        }
+
+        const ApContext &ap       = item.second;
+        auto             probe_ap = probe.ap_.find(item.first);
+        const bool       has_ap   = probe_ap != probe.ap_.end();
+
+        const bool need_csw = ap.is_csw_valid && !(has_ap && probe_ap->second.is_csw_valid && probe_ap->second.csw == ap.csw);
+        const bool need_tar = ap.is_tar_valid && !(has_ap && probe_ap->second.is_tar_valid && probe_ap->second.tar == ap.tar);
+        if (!need_csw && !need_tar) {
+            continue;
+        }
+
+        const uint32_t bank0 = (static_cast<uint32_t>(item.first) << 24) | (select_ & 0x0F);
+        if (!is_select_valid || select != bank0) {
+            put_write(DP_SELECT, bank0);
+            is_select_valid = true;
+            select          = bank0;
+        }
+
+        if (need_csw) {
+            put_write(DAP_TRANSFER_APnDP | AP_CSW, ap.csw);
+        }
+        if (need_tar) {
+            put_write(DAP_TRANSFER_APnDP | AP_TAR, ap.tar);
+        }
+    }
+
+    if (!is_select_valid || select != select_) {
+        put_write(DP_SELECT, select_);
+    }
+
+    if (count == 0) {
+        return static_cast<int>(transfer - buf);
+    }
+
+    transfer[0] = ID_DAP_Transfer;
+    transfer[1] = dap_index_;
+    transfer[2] = static_cast<uint8_t>(count);
+    (*commands)++;
+
+    return static_cast<int>(p - buf);
+}
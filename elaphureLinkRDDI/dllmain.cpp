@@ -12,6 +12,14 @@ el_memory_t *k_shared_memory_ptr    = nullptr;
 HANDLE k_producer_event = nullptr;
 HANDLE k_consumer_event = nullptr;
 
+// Objects of the instance (client 0), kept while a client channel is in use
+static int          k_proxy_instance          = 0;
+static int          k_client_slot             = -1;
+static HANDLE       k_instance_memory_handle  = nullptr;
+static el_memory_t *k_instance_memory_ptr     = nullptr;
+static HANDLE       k_instance_producer_event = nullptr;
+static HANDLE       k_instance_consumer_event = nullptr;
+
 inline int  el_rddi_init();
 inline void el_rddi_deinit();
 
@@ -51,11 +59,34 @@ BOOL APIENTRY DllMain(HMODULE hModule,
 }
 
 
+// Proxy instance selected by `ELAPHURELINK_INSTANCE`, 0 by default
+inline int el_get_proxy_instance()
+{
+    char  buf[16];
+    DWORD len = GetEnvironmentVariable(EL_INSTANCE_ENV_NAME, buf, sizeof(buf));
+    if (len == 0 || len >= sizeof(buf)) {
+        return 0;
+    }
+
+    int instance = atoi(buf);
+    if (instance < 0 || instance >= EL_MAX_PROXY_INSTANCE) {
+        return 0;
+    }
+
+    return instance;
+}
+
 inline int el_rddi_init()
 {
+    const int instance = el_get_proxy_instance();
+    char      name[EL_OBJECT_NAME_MAX_LEN];
+
+    k_proxy_instance = instance;
+
+    el_get_instance_object_name(name, EL_SHARED_MEMORY_NAME, instance);
     k_shared_memory_handle = OpenFileMapping(FILE_MAP_ALL_ACCESS,
                                              FALSE,
-                                             EL_SHARED_MEMORY_NAME);
+                                             name);
 
     if (nullptr == k_shared_memory_handle || INVALID_HANDLE_VALUE == k_shared_memory_handle) {
         return FALSE;
@@ -73,18 +104,20 @@ inline int el_rddi_init()
     }
 
 
+    el_get_instance_object_name(name, EL_EVENT_PRODUCER_NAME, instance);
     k_producer_event = OpenEvent(EVENT_ALL_ACCESS,
                                  FALSE,
-                                 EL_EVENT_PRODUCER_NAME);
+                                 name);
 
     if (nullptr == k_producer_event
         || INVALID_HANDLE_VALUE == k_producer_event) {
         return FALSE;
     }
 
+    el_get_instance_object_name(name, EL_EVENT_CONSUMER_NAME, instance);
     k_consumer_event = OpenEvent(EVENT_ALL_ACCESS,
                                  FALSE,
-                                 EL_EVENT_CONSUMER_NAME);
+                                 name);
 
     if (nullptr == k_consumer_event
         || INVALID_HANDLE_VALUE == k_consumer_event) {
@@ -96,9 +129,148 @@ inline int el_rddi_init()
 
 void el_rddi_deinit()
 {
+    el_rddi_release_client();
+
     CloseHandle(k_producer_event);
     CloseHandle(k_consumer_event);
     if (k_shared_memory_ptr != nullptr)
         UnmapViewOfFile(k_shared_memory_ptr);
     CloseHandle(k_shared_memory_handle);
 }
+
+
+// Client priority selected by `ELAPHURELINK_PRIORITY`, normal by default
+inline uint32_t el_get_client_priority()
+{
+    char  buf[16];
+    DWORD len = GetEnvironmentVariable(EL_PRIORITY_ENV_NAME, buf, sizeof(buf));
+    if (len == 0 || len >= sizeof(buf)) {
+        return EL_CLIENT_PRIORITY_NORMAL;
+    }
+
+    if (_stricmp(buf, "low") == 0) {
+        return EL_CLIENT_PRIORITY_LOW;
+    } else if (_stricmp(buf, "high") == 0) {
+        return EL_CLIENT_PRIORITY_HIGH;
+    }
+
+    return EL_CLIENT_PRIORITY_NORMAL;
+}
+
+inline bool el_is_process_alive(DWORD pid)
+{
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (process == nullptr) {
+        return false;
+    }
+
+    const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+
+    return alive;
+}
+
+inline int el_open_client_channel(int client)
+{
+    char name[EL_OBJECT_NAME_MAX_LEN];
+
+    el_get_client_object_name(name, EL_SHARED_MEMORY_NAME, k_proxy_instance, client);
+    HANDLE memory_handle = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, name);
+    if (nullptr == memory_handle || INVALID_HANDLE_VALUE == memory_handle) {
+        return -1;
+    }
+
+    void *ptr = MapViewOfFile(memory_handle, FILE_MAP_ALL_ACCESS, 0, 0, EL_SHARED_MEMORY_SIZE);
+
+    el_get_client_object_name(name, EL_EVENT_PRODUCER_NAME, k_proxy_instance, client);
+    HANDLE producer_event = OpenEvent(EVENT_ALL_ACCESS, FALSE, name);
+
+    el_get_client_object_name(name, EL_EVENT_CONSUMER_NAME, k_proxy_instance, client);
+    HANDLE consumer_event = OpenEvent(EVENT_ALL_ACCESS, FALSE, name);
+
+    if (nullptr == ptr || nullptr == producer_event || nullptr == consumer_event) {
+        CloseHandle(producer_event);
+        CloseHandle(consumer_event);
+        if (ptr != nullptr)
+            UnmapViewOfFile(ptr);
+        CloseHandle(memory_handle);
+        return -1;
+    }
+
+    k_shared_memory_handle = memory_handle;
+    k_shared_memory_ptr    = static_cast<el_memory_t *>(ptr);
+    k_producer_event       = producer_event;
+    k_consumer_event       = consumer_event;
+
+    return 0;
+}
+
+inline void el_close_client_channel()
+{
+    CloseHandle(k_producer_event);
+    CloseHandle(k_consumer_event);
+    UnmapViewOfFile(k_shared_memory_ptr);
+    CloseHandle(k_shared_memory_handle);
+
+    k_shared_memory_handle = k_instance_memory_handle;
+    k_shared_memory_ptr    = k_instance_memory_ptr;
+    k_producer_event       = k_instance_producer_event;
+    k_consumer_event       = k_instance_consumer_event;
+}
+
+int el_rddi_claim_client()
+{
+    if (k_client_slot != -1) {
+        return 0; // already claimed
+    }
+
+    k_instance_memory_handle  = k_shared_memory_handle;
+    k_instance_memory_ptr     = k_shared_memory_ptr;
+    k_instance_producer_event = k_producer_event;
+    k_instance_consumer_event = k_consumer_event;
+
+    const DWORD pid  = GetCurrentProcessId();
+    auto       &info = k_instance_memory_ptr->info_page;
+
+    for (int client = 0; client < EL_MAX_PROXY_CLIENT; client++) {
+        auto  owner_ptr = reinterpret_cast<volatile LONG *>(&info.client_owner[client]);
+        DWORD owner     = InterlockedCompareExchange(owner_ptr, pid, 0);
+
+        if (owner != 0 && owner != pid) {
+            // the owner may have exited without releasing the slot
+            if (el_is_process_alive(owner) || static_cast<DWORD>(InterlockedCompareExchange(owner_ptr, pid, owner)) != owner) {
+                continue;
+            }
+        }
+
+        if (client != 0 && el_open_client_channel(client) != 0) {
+            InterlockedExchange(owner_ptr, 0);
+            return -1; // proxy without client channels
+        }
+
+        info.client_priority[client] = el_get_client_priority();
+        k_client_slot                = client;
+
+        k_shared_memory_ptr->info_page.comm_timeout_ms = 0; // default
+        return 0;
+    }
+
+    return -1; // all slots are in use
+}
+
+void el_rddi_release_client()
+{
+    if (k_client_slot == -1) {
+        return;
+    }
+
+    if (k_client_slot != 0) {
+        el_close_client_channel();
+    }
+
+    auto &info = k_instance_memory_ptr->info_page;
+
+    info.client_priority[k_client_slot] = EL_CLIENT_PRIORITY_NORMAL;
+    InterlockedExchange(reinterpret_cast<volatile LONG *>(&info.client_owner[k_client_slot]), 0);
+    k_client_slot = -1;
+}
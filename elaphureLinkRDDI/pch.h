@@ -22,6 +22,15 @@ extern el_memory_t *k_shared_memory_ptr;
 extern HANDLE k_producer_event;
 extern HANDLE k_consumer_event;
 
+/**
+ * @brief Claim a client slot of the proxy instance, and switch the IPC objects above to its channel.
+ *
+ * @return 0: on success, other on fail
+ */
+int el_rddi_claim_client();
+
+void el_rddi_release_client();
+
 
 #define EL_SHOW_WARNING_MSG_BOX(msg, title) MessageBox(NULL, const_cast<LPCSTR>(msg), const_cast<LPCSTR>(title), MB_ICONWARNING | MB_SYSTEMMODAL)
 
@@ -32,6 +32,9 @@ inline const uint8_t k_dap_reg_offset_map[] = {
     0x01, 0x05, 0x09, 0x0D, // for AP_0x0, AP_0x4, AP_0x8, AP_0xC  ---> this field set APnDP
 };
 
+// Registers of the last failed DAP_RegAccessBlock that the probe completed, -1: unknown
+static int k_reg_access_done = -1;
+
 RDDI_FUNC int RDDI_Open(RDDIHandle *pHandle, const void *pDetails)
 {
     EL_DEBUG_BREAK();
@@ -56,6 +59,11 @@ RDDI_FUNC int RDDI_Open(RDDIHandle *pHandle, const void *pDetails)
         return RDDI_TOOMANYCONNECTIONS;
     }
 
+    if (el_rddi_claim_client() != 0) {
+        // all clients of the probe are in use
+        return RDDI_TOOMANYCONNECTIONS;
+    }
+
     *pHandle = 1;
     kContext.set_rddi_handle(1);
 
@@ -77,6 +85,7 @@ RDDI_FUNC int RDDI_Close(RDDIHandle handle)
     }
 
     kContext.set_rddi_handle(-1); // set invalid handle
+    el_rddi_release_client();
 
     // TODO: context status clean up
 
@@ -276,6 +285,9 @@ RDDI_FUNC int DAP_RegAccessBlock(const RDDIHandle handle, const int DAP_ID, cons
 
 
     std::vector<int> read_reg_index_array;
+    std::vector<int> transfer_reg_index_array; // register of each DAP transfer
+
+    k_reg_access_done = -1;
 
     constexpr int transfer_version_transfer_count_index = 0x2;
     constexpr int transfer_version_array_initial_length = 3;
@@ -327,6 +339,25 @@ RDDI_FUNC int DAP_RegAccessBlock(const RDDIHandle handle, const int DAP_ID, cons
             transfer_count, dap_transfer_array.size());
 
         if (k_shared_memory_ptr->consumer_page.command_response == DAP_RES_FAULT) {
+            // The proxy returns the completed transfers followed by the values read so far
+            const int data_len = k_shared_memory_ptr->consumer_page.data_len;
+            if (data_len >= 4) {
+                int done;
+                memcpy(&done, k_shared_memory_ptr->consumer_page.data, 4);
+
+                const int *p_res_data = reinterpret_cast<const int *>(k_shared_memory_ptr->consumer_page.data + 4);
+                const int  read_num   = (std::min)(static_cast<int>(read_reg_index_array.size()), (data_len - 4) / 4);
+                for (int j = 0; j < read_num; j++) {
+                    dataArray[read_reg_index_array[j]] = p_res_data[j];
+                }
+
+                if (done >= 0 && done < static_cast<int>(transfer_reg_index_array.size())) {
+                    k_reg_access_done = transfer_reg_index_array[done];
+                } else if (!transfer_reg_index_array.empty()) {
+                    // all transfers are acknowledged, the last one failed the final check
+                    k_reg_access_done = transfer_reg_index_array.back() + 1;
+                }
+            }
             return RDDI_DAP_DP_STICKY_ERR;
         } else if (k_shared_memory_ptr->consumer_page.command_response != DAP_RES_OK) {
             return RDDI_INTERNAL_ERROR;
@@ -359,6 +390,7 @@ RDDI_FUNC int DAP_RegAccessBlock(const RDDIHandle handle, const int DAP_ID, cons
         int read_register_command_count = 0;
 
         read_reg_index_array.clear();
+        transfer_reg_index_array.clear();
 
         for (; i < numRegs; i++) {
             const uint32_t regID    = regIDArray[i];
@@ -373,6 +405,7 @@ RDDI_FUNC int DAP_RegAccessBlock(const RDDIHandle handle, const int DAP_ID, cons
             } else if (reg_low == DAP_REG_MATCH_MASK) {
                 // Write Match Mask (instead of Register)
                 dap_transfer_command_count++;
+                transfer_reg_index_array.push_back(i);
 
                 const int      value_to_match   = dataArray[i];
                 const uint8_t *p_value_to_match = reinterpret_cast<const uint8_t *>(&value_to_match);
@@ -385,6 +418,7 @@ RDDI_FUNC int DAP_RegAccessBlock(const RDDIHandle handle, const int DAP_ID, cons
             } else if (reg_high == (DAP_REG_RnW | DAP_REG_WaitForValue) >> 16) {
                 // Value Match Read
                 dap_transfer_command_count++;
+                transfer_reg_index_array.push_back(i);
 
                 const int      value_to_match   = dataArray[i];
                 const uint8_t *p_value_to_match = reinterpret_cast<const uint8_t *>(&value_to_match);
@@ -396,6 +430,7 @@ RDDI_FUNC int DAP_RegAccessBlock(const RDDIHandle handle, const int DAP_ID, cons
 
             } else {
                 dap_transfer_command_count++;
+                transfer_reg_index_array.push_back(i);
 
                 if (reg_high & (DAP_REG_RnW >> 16)) {
                     // read reg
@@ -953,6 +988,95 @@ RDDI_FUNC int CMSIS_DAP_DetectDAPIDList(const RDDIHandle handle, int *DAP_ID_Arr
     return RDDI_SUCCESS;
 }
 
+/**
+ * @brief Send one elaphureLink vendor command and return the whole vendor response.
+ *        The status byte of the vendor response is left to the caller.
+ *
+ * @param resp_len size of the response buffer, receives the response length
+ */
+static int vendor_command(const uint8_t *request, int req_len, uint8_t *response, int *resp_len)
+{
+    if (!k_shared_memory_ptr->info_page.is_proxy_ready) {
+        // proxy not ready
+        return RDDI_FAILED;
+    }
+
+    if (!k_shared_memory_ptr->info_page.enable_vendor_command) {
+        return RDDI_FAILED; // disabled by the user
+    }
+
+    if (req_len > 1400) { // 1400 MTU
+        return RDDI_BADARG;
+    }
+
+    memcpy(&(k_shared_memory_ptr->producer_page.data), request, req_len);
+
+    produce_and_wait_consumer_response(1, req_len);
+
+    if (k_shared_memory_ptr->consumer_page.command_response != DAP_RES_OK) {
+        return RDDI_INTERNAL_ERROR;
+    }
+
+    const int len = k_shared_memory_ptr->consumer_page.data_len;
+    if (len > *resp_len) {
+        return RDDI_BUFFER_OVERFLOW;
+    }
+
+    memcpy(response, k_shared_memory_ptr->consumer_page.data, len);
+    *resp_len = len;
+
+    return RDDI_SUCCESS;
+}
+
+/**
+ * @brief Send DAP_ExecuteCommands load packets one after the other, each one waits for its
+ *        response. A load packet holds only
+ *        DAP_TransferBlock writes, usually a TAR write followed by the DRW writes up to the
+ *        next R/W page boundary, so a RAM image goes out in packets which fill the MTU.
+ *        No response data is returned, only the transfer status is checked.
+ */
+static int load_command(int num, unsigned char **request, const int *req_len)
+{
+    if (!k_shared_memory_ptr->info_page.is_proxy_ready) {
+        // proxy not ready
+        return RDDI_FAILED;
+    }
+
+    for (int i = 0; i < num; i++) {
+        const uint8_t *req = request[i];
+        const int      len = req_len[i];
+
+        if (len < 2 || len > 1400 || req[0] != ID_DAP_ExecuteCommands) { // 1400 MTU
+            return RDDI_BADARG;
+        }
+
+        int transfer_count = 0;
+        int offset         = 2;
+        for (int n = 0; n < req[1]; n++) {
+            if (offset + 5 > len || req[offset] != ID_DAP_TransferBlock || (req[offset + 4] & 0x02)) {
+                return RDDI_BADARG; // write blocks only
+            }
+
+            const int count = req[offset + 2] | (req[offset + 3] << 8);
+            transfer_count += count;
+            offset += 5 + 4 * count;
+        }
+        if (offset != len) {
+            return RDDI_BADARG;
+        }
+
+        memcpy(&(k_shared_memory_ptr->producer_page.data), req, len);
+
+        produce_and_wait_consumer_response(transfer_count, len);
+
+        if (k_shared_memory_ptr->consumer_page.command_response != DAP_RES_OK) {
+            return RDDI_INTERNAL_ERROR;
+        }
+    }
+
+    return RDDI_SUCCESS;
+}
+
 RDDI_FUNC int CMSIS_DAP_Commands(const RDDIHandle handle, int num, unsigned char **request, int *req_len,
                                  unsigned char **response, int *resp_len)
 {
@@ -962,6 +1086,14 @@ RDDI_FUNC int CMSIS_DAP_Commands(const RDDIHandle handle, int num, unsigned char
         return RDDI_INVHANDLE;
     }
 
+    if (num == 1 && *req_len >= 4 && request[0][0] == ID_DAP_Vendor8) {
+        return vendor_command(request[0], *req_len, response[0], resp_len);
+    }
+
+    if (num >= 1 && *req_len >= 2 && request[0][0] == ID_DAP_ExecuteCommands) {
+        return load_command(num, request, req_len);
+    }
+
     if (num != 1 || *req_len != 1 || *resp_len != 1) {
         return 8204;
     }
@@ -993,10 +1125,50 @@ RDDI_FUNC int CMSIS_DAP_Disconnect()
     return 8204;
 }
 
-RDDI_FUNC int DAP_SetCommTimeout()
+/**
+ * @brief Set the time the proxy waits for a probe response.
+ *        A request that times out fails and the proxy closes the connection to the probe.
+ *
+ * @param timeout timeout in milliseconds, 0: default
+ */
+RDDI_FUNC int DAP_SetCommTimeout(const RDDIHandle handle, const int timeout)
 {
-    __debugbreak();
-    return 8204;
+    if (handle != kContext.get_rddi_handle()) {
+        return RDDI_INVHANDLE;
+    }
+
+    if (timeout < 0) {
+        return RDDI_BADARG;
+    }
+
+    k_shared_memory_ptr->info_page.comm_timeout_ms = timeout;
+
+    return RDDI_SUCCESS;
+}
+
+/**
+ * @brief Get the registers of the last failed DAP_RegAccessBlock call that were completed.
+ *        The values of the completed register reads are already stored in its data array.
+ *
+ * @param count number of registers before the failing one
+ */
+RDDI_FUNC int DAP_GetRegAccessDone(const RDDIHandle handle, int *count)
+{
+    if (handle != kContext.get_rddi_handle()) {
+        return RDDI_INVHANDLE;
+    }
+
+    if (count == nullptr) {
+        return RDDI_BADARG;
+    }
+
+    if (k_reg_access_done < 0) {
+        return RDDI_FAILED;
+    }
+
+    *count = k_reg_access_done;
+
+    return RDDI_SUCCESS;
 }
 
 RDDI_FUNC int CMSIS_DAP_GetInterfaceVersion()
@@ -0,0 +1,172 @@
+﻿/**
+ * @file agdi_host.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Hosts the SWD layer of the AGDI driver inside the benchmark process
+ *
+ * The benchmark links DbgCM's SWD.cpp and rddi_dll.cpp unchanged. This file provides the
+ * driver state they use, normally owned by AGDI.CPP, Debug.cpp, JTAG.cpp and DbgCM.cpp,
+ * for a connected SW-DP with a halted Cortex-M core on AP 0. Debug description, the device
+ * state monitor and the RAM loader are not used by the benchmark.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "../../elaphureLinkAGDI/DbgCM/stdafx.h"
+#include "../../elaphureLinkAGDI/AGDI.H"
+#include "../../elaphureLinkAGDI/DbgCM/COLLECT.H"
+#include "../../elaphureLinkAGDI/DbgCM/Debug.h"
+#include "../../elaphureLinkAGDI/DbgCM/JTAG.h"
+#include "../../elaphureLinkAGDI/BOM.H"
+#include "../../elaphureLinkAGDI/DbgCM/AccessScheduler.h"
+#include "../../elaphureLinkAGDI/DbgCM/RAMLoad.h"
+#include "../../elaphureLinkAGDI/DbgCM/DSMonitor.h"
+
+
+// AGDI.CPP
+static struct bom kBom; // uVision interface, no Security Extensions
+
+struct bom *pio = &kBom;
+
+DWORD nCPU;   // Number of selected CPU within the JTAG chain
+UC8   iRun;   // target is currently executing
+UC8   iBpCmd; // currently executing breakpoint command
+
+// DbgCM.cpp
+struct MONCONF MonConf; // holds target-setup values
+BYTE           SetupMode;
+
+// JTAG.cpp
+JDEVS JTAG_devs; // JTAG Device List
+
+// Debug.cpp
+BYTE  DP_Ver         = 1;          // Debug Port Version (V0, V1, V2)
+BOOL  DP_Min         = FALSE;      // Minimal DP (without Pushed Verify/Compare)
+DWORD AP_Sel         = 0x00000000; // Current AP
+BYTE  AP_Bank        = 0x00;       // Current AP Bank
+BYTE  k_last_ap_bank = 0xE0;       // Last Recorded AP Bank
+
+DWORD DHCSR_MaskIntsSysCall = 0;          // Mask Interrupts while a system call runs
+WORD  SWJ_SwitchSeq         = 0xE79E;     // JTAG-to-SWD
+DWORD DBG_Addr              = 0xE000EDF0; // Core Debug Base Address
+BOOL  DSCSR_Has_CDSKEY      = FALSE;      // DSCSR has CDSKEY Bit (Security Extensions only)
+DWORD VectorDone;                         // Items of the last ReadVector/WriteVector before the failing one
+
+// Context of AP 0 as left by InitDebug() and AP_ReadID()
+static AP_CONTEXT kAPContext = {
+    0x24770011,                                                 // ID: AHB-AP
+    CSW_RESERVED | CSW_MSTRDBG | CSW_HPROT_PRIV | CSW_DBGSTAT,  // CSW_Val_Base
+    AP_ACCSZ_BYTE | AP_ACCSZ_HWORD | AP_ACCSZ_WORD,             // AccSizes
+    CSW_SPROT,                                                  // SPROT
+    FALSE,                                                      // KeepSPROT
+    TRUE,                                                       // PT
+    CSW_RWBITS,                                                 // RWBits
+};
+
+
+int SetStatusMem(int status, DWORD nAddr, DWORD type /*=0*/, int nSize /*=0*/)
+{
+    return status;
+}
+
+BYTE OverlapSCSv8M(DWORD adr, DWORD many)
+{
+    const DWORD scs = 0xE000E000;
+
+    if ((adr >= scs) && (adr < scs + 0x1000)) {
+        return (1);
+    }
+    if ((adr + many - 1 >= scs) && (adr + many - 1 < scs + 0x1000)) {
+        return (1);
+    }
+    if (adr < scs && adr + many - 1 > scs + 0x1000) {
+        return (1);
+    }
+    return (0);
+}
+
+DWORD AP_CurrentRWPage(void)
+{
+    return 0x400; // default RWPage
+}
+
+int AP_CurrentCtx(AP_CONTEXT **apCtx)
+{
+    if (apCtx == NULL)
+        return (EU01);
+
+    *apCtx = &kAPContext;
+    return (0);
+}
+
+int AP_Switch(AP_CONTEXT **apCtx)
+{
+    return AP_CurrentCtx(apCtx);
+}
+
+
+// AccessScheduler.cpp, the benchmark is the only thread accessing the target
+int AS_Lock(DWORD timeout)
+{
+    return (0);
+}
+
+int AS_Unlock(void)
+{
+    return (0);
+}
+
+
+// RAMLoad.cpp
+int RAMLoad_Transfer(int dap, DWORD adr, const BYTE *pB, DWORD nMany, DWORD rwpage)
+{
+    return (EU01); // No RAM loader in the benchmark
+}
+
+
+// DSMonitor.cpp
+int DSM_SuspendMonitor()
+{
+    return (0);
+}
+
+int DSM_ResumeMonitor()
+{
+    return (0);
+}
+
+int DSM_ExternalDHCSR(DWORD dhcsr)
+{
+    return (0);
+}
+
+
+// PDSCDebug.cpp, no debug description
+bool PDSCDebug_IsSupported(void)
+{
+    return false;
+}
+
+bool PDSCDebug_IsEnabled(void)
+{
+    return false;
+}
+
+bool PDSCDebug_DevicesScanned(void)
+{
+    return false;
+}
+
+U32 PDSCDebug_SetActiveDP(U32 id)
+{
+    return (0);
+}
+
+U32 PDSCDebug_PatchData(U32 accType, BYTE accSize, U32 addr, U32 many, UC8 *data, BYTE attrib)
+{
+    return (EU38); // Nothing patched
+}
+
+U32 PDSCDebug_DebugPortStart(void)
+{
+    return (0);
+}
@@ -0,0 +1,210 @@
+﻿/**
+ * @file benchmark.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief End-to-end throughput benchmark of the AGDI -> RDDI -> proxy -> probe path
+ *
+ * Usage: benchmark.exe [--rtt-us N] [--iterations N] [--scenario NAME|all]
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "stand_in_server.hpp"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include "../../common/proxy_export.hpp"
+#include "../../common/rddi_dap.h"
+
+#include "rddi_host.hpp"
+#include "scenarios.hpp"
+
+
+namespace
+{
+StandInServer k_server;
+RDDIHandle    k_handle = -1;
+
+std::mutex              k_connect_mutex;
+std::condition_variable k_connect_cv;
+bool                    k_is_connected = false;
+
+struct ScenarioResult {
+    const char         *name;
+    uint64_t            words;
+    uint64_t            round_trips;
+    double              total_us;
+    std::vector<double> op_us;
+};
+
+void on_connect(const char *msg)
+{
+    std::lock_guard<std::mutex> lk(k_connect_mutex);
+    k_is_connected = true;
+    k_connect_cv.notify_all();
+}
+
+void on_disconnect(const char *msg)
+{
+    printf("proxy disconnected: %s\n", msg);
+}
+
+
+double percentile(std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[(std::min)(index, sorted.size() - 1)];
+}
+
+int run_scenario(const Scenario &scenario, int iterations, ScenarioResult &result)
+{
+    using clock = std::chrono::steady_clock;
+
+    result      = {};
+    result.name = scenario.name;
+    iterations  = (std::max)(1, iterations / scenario.iteration_scale);
+    result.op_us.reserve(iterations);
+
+    if (scenario.prepare && scenario.prepare() != 0) {
+        printf("%s: prepare failed\n", scenario.name);
+        return -1;
+    }
+
+    const uint64_t round_trip_start = k_server.get_round_trip_count();
+    const auto     start            = clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+        uint64_t   words    = 0;
+        const auto op_start = clock::now();
+
+        int ret = scenario.op(&words);
+        if (ret != 0) {
+            printf("%s: operation %d failed with %d\n", scenario.name, i, ret);
+            return ret;
+        }
+
+        result.op_us.push_back(std::chrono::duration<double, std::micro>(clock::now() - op_start).count());
+        result.words += words;
+    }
+
+    result.total_us    = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+    result.round_trips = k_server.get_round_trip_count() - round_trip_start;
+    return 0;
+}
+
+void print_result(ScenarioResult &result)
+{
+    std::sort(result.op_us.begin(), result.op_us.end());
+
+    const size_t ops         = result.op_us.size();
+    const double words_per_s = result.total_us > 0 ? result.words * 1e6 / result.total_us : 0;
+
+    printf("%-20s %8zu %14.0f %12.2f %12.1f %12.1f\n",
+           result.name,
+           ops,
+           words_per_s,
+           ops ? static_cast<double>(result.round_trips) / ops : 0,
+           percentile(result.op_us, 0.50),
+           percentile(result.op_us, 0.99));
+}
+
+void print_usage()
+{
+    printf("usage: benchmark [--rtt-us N] [--iterations N] [--scenario NAME|all]\n");
+    printf("scenarios:");
+    for (auto &scenario : bench_get_scenarios()) {
+        printf(" %s", scenario.name);
+    }
+    printf("\n");
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    int         rtt_us        = 0;
+    int         iterations    = 200;
+    std::string scenario_name = "all";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rtt-us") == 0 && i + 1 < argc) {
+            rtt_us = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            scenario_name = argv[++i];
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    k_server.set_rtt_us(rtt_us);
+    if (k_server.start() != 0) {
+        printf("can not listen on 127.0.0.1:3240, is another elaphureLink instance running?\n");
+        return 1;
+    }
+
+    if (el_proxy_init() != 0) {
+        printf("el_proxy_init failed\n");
+        return 1;
+    }
+
+    el_proxy_set_on_connect_callback(on_connect);
+    el_proxy_set_on_disconnect_callback(on_disconnect);
+
+    char address[] = "127.0.0.1";
+    if (el_proxy_start_with_address(address) != 0) {
+        printf("el_proxy_start_with_address failed\n");
+        return 1;
+    }
+
+    {
+        std::unique_lock<std::mutex> lk(k_connect_mutex);
+        if (!k_connect_cv.wait_for(lk, std::chrono::seconds(5), [] { return k_is_connected; })) {
+            printf("proxy connect timeout\n");
+            return 1;
+        }
+    }
+
+    if (bench_rddi_attach() != 0 || RDDI_Open(&k_handle, nullptr) != RDDI_SUCCESS) {
+        printf("RDDI open failed\n");
+        return 1;
+    }
+
+    bench_rddi_bind_driver(k_handle);
+
+    printf("rtt: %d us, iterations: %d\n\n", rtt_us, iterations);
+    printf("%-20s %8s %14s %12s %12s %12s\n",
+           "scenario", "ops", "words/s", "rt/op", "p50(us)", "p99(us)");
+
+    int ret = 0;
+    for (auto &scenario : bench_get_scenarios()) {
+        if (scenario_name != "all" && scenario_name != scenario.name) {
+            continue;
+        }
+
+        ScenarioResult result;
+        if ((ret = run_scenario(scenario, iterations, result)) != 0) {
+            break;
+        }
+        print_result(result);
+    }
+
+    RDDI_Close(k_handle);
+    el_proxy_stop();
+    bench_rddi_detach();
+    k_server.stop();
+
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+﻿/**
+ * @file rddi_host.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Hosts the RDDI sources inside the benchmark process
+ *
+ * The benchmark links the RDDI translation units directly and provides the globals normally
+ * owned by its dllmain.cpp. The RDDI function pointers of the hosted AGDI driver are bound to
+ * them here instead of GetProcAddress on elaphureRddi.dll.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "../../elaphureLinkRDDI/pch.h"
+#include "../../elaphureLinkRDDI/ElaphureLinkRDDIContext.h"
+#include "../../elaphureLinkAGDI/DbgCM/rddi_dll.hpp"
+
+#include "rddi_host.hpp"
+
+
+ElaphureLinkRDDIContext kContext;
+
+HANDLE       k_shared_memory_handle = nullptr;
+el_memory_t *k_shared_memory_ptr    = nullptr;
+
+HANDLE k_producer_event = nullptr;
+HANDLE k_consumer_event = nullptr;
+
+
+int bench_rddi_attach()
+{
+    k_shared_memory_handle = OpenFileMapping(FILE_MAP_ALL_ACCESS,
+                                             FALSE,
+                                             EL_SHARED_MEMORY_NAME);
+
+    if (nullptr == k_shared_memory_handle || INVALID_HANDLE_VALUE == k_shared_memory_handle) {
+        return -1;
+    }
+
+    void *ptr = MapViewOfFile(k_shared_memory_handle,
+                              FILE_MAP_ALL_ACCESS,
+                              0,
+                              0,
+                              EL_SHARED_MEMORY_SIZE);
+
+    k_shared_memory_ptr = static_cast<el_memory_t *>(ptr);
+    if (nullptr == k_shared_memory_ptr) {
+        return -1;
+    }
+
+    k_producer_event = OpenEvent(EVENT_ALL_ACCESS,
+                                 FALSE,
+                                 EL_EVENT_PRODUCER_NAME);
+
+    k_consumer_event = OpenEvent(EVENT_ALL_ACCESS,
+                                 FALSE,
+                                 EL_EVENT_CONSUMER_NAME);
+
+    if (nullptr == k_producer_event || nullptr == k_consumer_event
+        || INVALID_HANDLE_VALUE == k_producer_event || INVALID_HANDLE_VALUE == k_consumer_event) {
+        return -1;
+    }
+
+    return 0;
+}
+
+void bench_rddi_detach()
+{
+    CloseHandle(k_producer_event);
+    CloseHandle(k_consumer_event);
+    if (k_shared_memory_ptr != nullptr)
+        UnmapViewOfFile(k_shared_memory_ptr);
+    CloseHandle(k_shared_memory_handle);
+
+    k_shared_memory_ptr = nullptr;
+}
+
+// Same function set as LoadRddiDllFunction() of DbgCM.cpp
+#define RDDI_BIND_FUNCTION(func) rddi::func = ::func
+
+void bench_rddi_bind_driver(RDDIHandle handle)
+{
+    rddi::rddi_Open  = ::RDDI_Open;
+    rddi::rddi_Close = ::RDDI_Close;
+
+    RDDI_BIND_FUNCTION(DAP_ReadReg);
+    RDDI_BIND_FUNCTION(DAP_WriteReg);
+    RDDI_BIND_FUNCTION(DAP_RegAccessBlock);
+    RDDI_BIND_FUNCTION(DAP_RegWriteRepeat);
+    RDDI_BIND_FUNCTION(DAP_RegReadRepeat);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_Detect);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_Identify);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_ConfigureInterface);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_ConfigureDAP);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_Capabilities);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_DetectNumberOfDAPs);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_DetectDAPIDList);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_Commands);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_SWJ_Sequence);
+    RDDI_BIND_FUNCTION(CMSIS_DAP_SWJ_Pins);
+    RDDI_BIND_FUNCTION(DAP_SetCommTimeout);
+    RDDI_BIND_FUNCTION(DAP_GetRegAccessDone);
+
+    rddi::k_rddi_handle   = handle;
+    rddi::k_rddi_if_index = 0;
+}
+
+// The benchmark is the only client of the probe, it always uses the channel of the instance
+int el_rddi_claim_client()
+{
+    return 0;
+}
+
+void el_rddi_release_client()
+{
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "rddi.h"
+
+/**
+ * @brief Open the shared memory and events created by `el_proxy_init`.
+ *
+ * @return 0: on success, other on fail
+ */
+int bench_rddi_attach();
+
+void bench_rddi_detach();
+
+/**
+ * @brief Point the RDDI functions of the hosted AGDI driver to the hosted RDDI, and use `handle`
+ * for its accesses like `RddiOpenInstance` does.
+ */
+void bench_rddi_bind_driver(RDDIHandle handle);
@@ -0,0 +1,227 @@
+﻿/**
+ * @file scenarios.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Benchmark scenarios on top of the SWD layer of the AGDI driver
+ *
+ * Each scenario calls the DbgCM functions uVision reaches for the named operation, so the
+ * request sequences measured here are the ones of SWD.cpp and follow its changes.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#include "../../elaphureLinkAGDI/DbgCM/stdafx.h"
+#include "../../elaphureLinkAGDI/AGDI.H"
+#include "../../elaphureLinkAGDI/DbgCM/COLLECT.H"
+#include "../../elaphureLinkAGDI/DbgCM/Debug.h"
+#include "../../elaphureLinkAGDI/DbgCM/JTAG.h"
+#include "../../elaphureLinkAGDI/DbgCM/SWD.h"
+#include "../../elaphureLinkAGDI/DbgCM/rddi_dll.hpp"
+#include "../../elaphureLinkAGDI/DbgCM/AccessScheduler.h"
+
+#include "scenarios.hpp"
+
+
+namespace
+{
+constexpr DWORD k_test_ram  = 0x20000000; // RAM of the stand-in target
+constexpr DWORD k_test_size = 64 * 1024;
+constexpr DWORD k_page_size = 1024; // AP_CurrentRWPage() of the hosted driver
+
+// Flash algorithm layout in the test RAM, the stand-in halts the core after a few DHCSR polls
+constexpr DWORD k_algo_base    = k_test_ram;
+constexpr DWORD k_algo_prg_buf = k_test_ram + 0x1000;
+constexpr DWORD k_algo_stack   = k_test_ram + 0x2000;
+constexpr DWORD k_algo_timeout = 3000; // ms, FlashDev.toProg of a typical algorithm
+
+
+// Block read with DAP_RegReadRepeat, set up like the pushed verify of SWD_VerifyBlock.
+// The driver has no caller of DAP_RegReadRepeat, this is the path a repeat-read optimized
+// SWD_ReadBlock would take.
+int read_repeat(DWORD adr, BYTE *pB, DWORD nMany)
+{
+    AS_Guard lk;
+
+    int         status;
+    DWORD       val;
+    AP_CONTEXT *apCtx;
+
+    status = AP_Switch(&apCtx);
+    if (status)
+        return (status);
+
+    if (AP_Bank != 0) {
+        status = SWD_WriteDP(DP_SELECT, AP_Sel | 0);
+        if (status)
+            return (status);
+        AP_Bank = 0;
+    }
+
+    if ((apCtx->CSW_Val_Base & (CSW_SIZE | CSW_ADDRINC)) != (CSW_SIZE32 | CSW_SADDRINC)) {
+        apCtx->CSW_Val_Base &= ~(CSW_SIZE | CSW_ADDRINC);
+        apCtx->CSW_Val_Base |= (CSW_SIZE32 | CSW_SADDRINC);
+        status = SWD_WriteAP(AP_CSW, apCtx->CSW_Val_Base);
+        if (status)
+            return (status);
+    }
+
+    status = SWD_WriteAP(AP_TAR, adr);
+    if (status)
+        return (status);
+
+    status = rddi::DAP_RegReadRepeat(rddi::k_rddi_handle, 0,
+                                     nMany >> 2, DAP_AP_REG_DRW, (int *)pB);
+    if (status != RDDI_SUCCESS)
+        return (EU01);
+
+    status = SWD_ReadDP(DP_CTRL_STAT, &val);
+    if (status)
+        return (status);
+    if (val & (STICKYERR | WDATAERR))
+        return (EU14);
+
+    return (0);
+}
+
+
+// SWD_ReadDP of DP CTRL/STAT
+int op_single_reg_read(uint64_t *words)
+{
+    DWORD val;
+
+    *words = 1;
+    return SWD_ReadDP(DP_CTRL_STAT, &val);
+}
+
+// SWD_ReadARMMem of 64KB
+int op_mem_read_64k(uint64_t *words)
+{
+    std::vector<BYTE> buf(k_test_size);
+    DWORD             adr = k_test_ram;
+
+    *words = k_test_size / 4;
+    return SWD_ReadARMMem(&adr, buf.data(), k_test_size, BLOCK_SECTYPE_ANY);
+}
+
+// SWD_WriteARMMem of 64KB
+int op_mem_write_64k(uint64_t *words)
+{
+    std::vector<BYTE> buf(k_test_size, 0xA5);
+    DWORD             adr = k_test_ram;
+
+    *words = k_test_size / 4;
+    return SWD_WriteARMMem(&adr, buf.data(), k_test_size, BLOCK_SECTYPE_ANY);
+}
+
+int prepare_mem_verify_64k()
+{
+    std::vector<BYTE> buf(k_test_size, 0x5A);
+    DWORD             adr = k_test_ram;
+
+    return SWD_WriteARMMem(&adr, buf.data(), k_test_size, BLOCK_SECTYPE_ANY);
+}
+
+// SWD_VerifyARMMem of 64KB, pushed verify of each page with DAP_RegWriteRepeat
+int op_mem_verify_64k(uint64_t *words)
+{
+    std::vector<BYTE> buf(k_test_size, 0x5A);
+    DWORD             adr = k_test_ram;
+    int               status;
+
+    *words = k_test_size / 4;
+    status = SWD_VerifyARMMem(&adr, buf.data(), k_test_size, BLOCK_SECTYPE_ANY);
+    if (status)
+        return (status);
+
+    // adr stops at the first mismatch
+    return (adr == k_test_ram + k_test_size) ? 0 : -1;
+}
+
+// 64KB read with DAP_RegReadRepeat, one request per page
+int op_mem_read_repeat_64k(uint64_t *words)
+{
+    std::vector<BYTE> buf(k_test_size);
+    int               status;
+
+    for (DWORD n = 0; n < k_test_size; n += k_page_size) {
+        status = read_repeat(k_test_ram + n, &buf[n], k_page_size);
+        if (status)
+            return (status);
+    }
+
+    *words = k_test_size / 4;
+    return (0);
+}
+
+// SWD_GetARMRegs of R0-R15, xPSR, MSP, PSP and SYS
+int op_core_reg_fetch(uint64_t *words)
+{
+    RgARMCM regs;
+
+    *words = 21;
+    return SWD_GetARMRegs(&regs, NULL, NULL, 0x1FFFFF);
+}
+
+// One page of the native flash download of Flash.cpp: ProgramPage() writes the page buffer,
+// ExecuteStart() and ExecuteWait() run the algorithm function
+int op_flash_page_program(uint64_t *words)
+{
+    static DWORD page_index = 0;
+
+    std::vector<BYTE> buf(k_page_size, static_cast<BYTE>(page_index));
+    RgARMCM           regs = {};
+    DWORD             adr  = k_algo_prg_buf;
+    DWORD             rval = 0;
+    BOOL              done = FALSE;
+    DWORD             tick;
+    int               status;
+
+    status = SWD_WriteARMMem(&adr, buf.data(), k_page_size, BLOCK_SECTYPE_ANY);
+    if (status)
+        return (status);
+
+    regs.xPSR = 0x01000000;                                     // xPSR: T = 1, ISR = 0
+    regs.SB   = k_algo_base + 0x800;                            // SB: Static Base
+    regs.SP   = k_algo_stack;                                   // SP: Stack Pointer
+    regs.LR   = k_algo_base + 1;                                // LR: Exit Point
+    regs.A1   = 0x08000000 + (page_index++ % 64) * k_page_size; // R0: Argument 1
+    regs.A2   = k_page_size;                                    // R1: Argument 2
+    regs.A3   = k_algo_prg_buf;                                 // R2: Argument 3
+    regs.PC   = k_algo_base + 0x100;                            // PC: Entry Point
+
+    status = SWD_SysCallExec(&regs);
+    if (status)
+        return (status);
+
+    tick = GetTickCount();
+    do {
+        status = SWD_SysCallWait(&rval, &done);
+        if (status)
+            return (status);
+        if (done)
+            break;
+    } while (GetTickCount() - tick < k_algo_timeout);
+
+    if (!done)
+        return (EU01);
+
+    *words = k_page_size / 4;
+    return static_cast<int>(rval); // ProgramPage result, 0: OK
+}
+
+} // namespace
+
+
+const std::vector<Scenario> &bench_get_scenarios()
+{
+    static const std::vector<Scenario> scenarios = {
+        { "single_reg_read", 1, op_single_reg_read, nullptr },
+        { "mem_read_64k", 20, op_mem_read_64k, nullptr },
+        { "mem_write_64k", 20, op_mem_write_64k, nullptr },
+        { "mem_verify_64k", 20, op_mem_verify_64k, prepare_mem_verify_64k },
+        { "mem_read_repeat_64k", 20, op_mem_read_repeat_64k, nullptr },
+        { "core_reg_fetch", 1, op_core_reg_fetch, nullptr },
+        { "flash_page_program", 4, op_flash_page_program, nullptr },
+    };
+
+    return scenarios;
+}
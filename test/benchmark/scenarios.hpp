@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// one operation of a scenario, return 0: OK
+using ScenarioOp = std::function<int(uint64_t *words)>;
+
+struct Scenario {
+    const char *name;
+    int         iteration_scale; // divide iterations for long operations
+    ScenarioOp  op;
+    int (*prepare)();            // target setup before the timed operations, may be nullptr
+};
+
+/**
+ * @brief Scenarios of the benchmark, each one calls the DbgCM functions it is named after.
+ *
+ * The RDDI function pointers of the driver have to be bound with `bench_rddi_bind_driver` first.
+ */
+const std::vector<Scenario> &bench_get_scenarios();
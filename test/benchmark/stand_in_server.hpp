@@ -0,0 +1,802 @@
+﻿/**
+ * @file stand_in_server.hpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief Loopback stand-in for an elaphureLink probe, with a simple MEM-AP target model
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#pragma once
+
+#include <sdkddkver.h>
+#include "thirdparty/asio/include/asio.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../../common/dap.hpp"
+#include "../../elaphureLinkProxy/protocol.hpp"
+
+
+/*
+ * Target model used by the stand-in server.
+ *
+ * Only the parts the benchmark scenarios touch are modelled: DP CTRL/STAT, SELECT, RDBUFF,
+ * a MEM-AP with CSW/TAR/DRW/BD0-3 (TAR auto increment wraps at 1KB like real hardware),
+ * pushed verify of DRW writes, a RAM region and the core debug registers (DHCSR/DCRSR/DCRDR).
+ */
+class StandInTarget
+{
+    public:
+    StandInTarget()
+        : ram_(k_ram_size / 4, 0)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        dp_ctrl_stat_ = 0;
+        dp_select_    = 0;
+        dp_rdbuff_    = 0;
+        ap_csw_       = 0x23000052; // 32-bit, auto increment single
+        ap_tar_       = 0;
+
+        dhcsr_      = 0x00030003; // S_HALT | S_REGRDY | C_HALT | C_DEBUGEN
+        dcrdr_      = 0;
+        run_polls_  = 0;
+        match_mask_ = 0xFFFFFFFF;
+        core_regs_.fill(0);
+        other_mem_.clear();
+    }
+
+    // DAP_TransferConfigure
+    void set_match_retry(uint16_t retry)
+    {
+        match_retry_ = retry;
+    }
+
+    /**
+     * @brief Process one transfer request
+     *
+     * @param request DAP transfer request byte
+     * @param value write data / match value
+     * @param read_value read data
+     * @return DAP_RES_OK, or DAP_RES_OK | DAP_RES_VALUE_MISMATCH
+     */
+    int transfer(uint8_t request, uint32_t value, uint32_t *read_value)
+    {
+        const bool    APnDP = request & 0x01;
+        const bool    RnW   = request & 0x02;
+        const uint8_t A32   = request & 0x0C;
+
+        if (request & 0x20) { // Match Mask
+            match_mask_ = value;
+            return DAP_RES_OK;
+        }
+
+        if (request & 0x10) { // Value Match
+            uint32_t data;
+            int      retry = match_retry_;
+            do {
+                data = APnDP ? ap_read(A32) : dp_read(A32);
+            } while (((data & match_mask_) != value) && retry--);
+
+            if ((data & match_mask_) != value) {
+                return DAP_RES_OK | DAP_RES_VALUE_MISMATCH;
+            }
+            return DAP_RES_OK;
+        }
+
+        if (RnW) {
+            *read_value = APnDP ? ap_read(A32) : dp_read(A32);
+        } else {
+            APnDP ? ap_write(A32, value) : dp_write(A32, value);
+        }
+
+        return DAP_RES_OK;
+    }
+
+    void write_abort(uint32_t value)
+    {
+        (void)value;
+        dp_ctrl_stat_ &= ~0xB2U; // clear sticky flags
+    }
+
+    private:
+    uint32_t dp_read(uint8_t addr)
+    {
+        switch (addr) {
+            case 0x0:
+                return 0x2BA01477; // IDCODE
+            case 0x4:
+                // mirror CSYSPWRUPREQ/CDBGPWRUPREQ into their ACK bits
+                return dp_ctrl_stat_ | ((dp_ctrl_stat_ & 0x50000000) << 1);
+            case 0x8:
+                return dp_select_;
+            default:
+                return dp_rdbuff_;
+        }
+    }
+
+    void dp_write(uint8_t addr, uint32_t value)
+    {
+        switch (addr) {
+            case 0x4:
+                // sticky flags are read-only on an SW-DP, ABORT clears them
+                dp_ctrl_stat_ = (value & ~0xB2U) | (dp_ctrl_stat_ & 0xB2U);
+                break;
+            case 0x8:
+                dp_select_ = value;
+                break;
+            default:
+                break;
+        }
+    }
+
+    uint32_t ap_read(uint8_t addr)
+    {
+        uint32_t value;
+        switch ((dp_select_ & 0xF0) | addr) {
+            case 0x00:
+                value = ap_csw_;
+                break;
+            case 0x04:
+                value = ap_tar_;
+                break;
+            case 0x0C:
+                value = mem_read(ap_tar_);
+                tar_increment();
+                break;
+            case 0x10:
+            case 0x14:
+            case 0x18:
+            case 0x1C:
+                value = mem_read((ap_tar_ & ~0xFU) | (addr & 0xC));
+                break;
+            case 0xF8:
+                value = 0xE00FF003; // BASE
+                break;
+            case 0xFC:
+                value = 0x24770011; // IDR
+                break;
+            default:
+                value = 0;
+                break;
+        }
+
+        dp_rdbuff_ = value;
+        return value;
+    }
+
+    void ap_write(uint8_t addr, uint32_t value)
+    {
+        switch ((dp_select_ & 0xF0) | addr) {
+            case 0x00:
+                ap_csw_ = value;
+                break;
+            case 0x04:
+                ap_tar_ = value;
+                break;
+            case 0x0C:
+                if ((dp_ctrl_stat_ & 0x0C) == 0x04) { // TRNMODE: pushed verify
+                    if (mem_read(ap_tar_) != value) {
+                        dp_ctrl_stat_ |= 0x10; // STICKYCMP
+                    }
+                } else {
+                    mem_write(ap_tar_, value);
+                }
+                tar_increment();
+                break;
+            case 0x10:
+            case 0x14:
+            case 0x18:
+            case 0x1C:
+                mem_write((ap_tar_ & ~0xFU) | (addr & 0xC), value);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void tar_increment()
+    {
+        if ((ap_csw_ & 0x30) == 0) {
+            return; // auto increment off
+        }
+
+        const uint32_t size = 1U << (ap_csw_ & 0x7);
+        // only the 10 LSBs of TAR are guaranteed to increment
+        ap_tar_ = (ap_tar_ & ~0x3FFU) | ((ap_tar_ + size) & 0x3FF);
+    }
+
+    uint32_t mem_read(uint32_t addr)
+    {
+        addr &= ~0x3U;
+        switch (addr) {
+            case 0xE000EDF0: // DHCSR
+                if (run_polls_ && --run_polls_ == 0) {
+                    dhcsr_ |= 0x00020002; // S_HALT | C_HALT, the algorithm returned
+                    core_regs_[0] = 0;
+                }
+                return dhcsr_;
+            case 0xE000EDF8: // DCRDR
+                return dcrdr_;
+            default:
+                break;
+        }
+
+        if (addr >= k_ram_base && addr < k_ram_base + k_ram_size) {
+            return ram_[(addr - k_ram_base) / 4];
+        }
+
+        auto it = other_mem_.find(addr);
+        return it == other_mem_.end() ? 0 : it->second;
+    }
+
+    void mem_write(uint32_t addr, uint32_t value)
+    {
+        const uint32_t lane_mask = [&]() -> uint32_t {
+            switch (ap_csw_ & 0x7) {
+                case 0:
+                    return 0xFFU << ((addr & 0x3) * 8);
+                case 1:
+                    return 0xFFFFU << ((addr & 0x2) * 8);
+                default:
+                    return 0xFFFFFFFF;
+            }
+        }();
+
+        addr &= ~0x3U;
+        switch (addr) {
+            case 0xE000EDF0: // DHCSR
+                if ((value >> 16) == 0xA05F) {
+                    dhcsr_ = (dhcsr_ & ~0xFU) | (value & 0xF);
+                    if (value & 0x2) {
+                        dhcsr_ |= 0x00020000; // S_HALT
+                        run_polls_ = 0;
+                    } else {
+                        dhcsr_ &= ~0x00020000U;
+                        run_polls_ = k_run_polls;
+                    }
+                }
+                return;
+            case 0xE000EDF4: // DCRSR
+                if (value & 0x10000) {
+                    core_regs_[value & 0x7F] = dcrdr_; // REGWnR
+                } else {
+                    dcrdr_ = core_regs_[value & 0x7F];
+                }
+                return;
+            case 0xE000EDF8: // DCRDR
+                dcrdr_ = value;
+                return;
+            default:
+                break;
+        }
+
+        uint32_t *p;
+        if (addr >= k_ram_base && addr < k_ram_base + k_ram_size) {
+            p = &ram_[(addr - k_ram_base) / 4];
+        } else {
+            p = &other_mem_[addr];
+        }
+        *p = (*p & ~lane_mask) | (value & lane_mask);
+    }
+
+    public:
+    static constexpr uint32_t k_ram_base  = 0x20000000;
+    static constexpr uint32_t k_ram_size  = 256 * 1024;
+    static constexpr int      k_run_polls = 4; // DHCSR polls until a started "algorithm" halts again
+
+    private:
+    uint32_t dp_ctrl_stat_;
+    uint32_t dp_select_;
+    uint32_t dp_rdbuff_;
+    uint32_t ap_csw_;
+    uint32_t ap_tar_;
+
+    uint32_t                  dhcsr_;
+    uint32_t                  dcrdr_;
+    int                       run_polls_;
+    std::array<uint32_t, 128> core_regs_;
+
+    uint32_t match_mask_;
+    uint16_t match_retry_ = 0;
+
+    std::vector<uint32_t>                  ram_;
+    std::unordered_map<uint32_t, uint32_t> other_mem_;
+};
+
+
+/*
+ * A single connection elaphureLink server that answers DAP commands from `StandInTarget`.
+ *
+ * Every request is delayed by the configured round-trip time before its response is sent,
+ * so the proxy/RDDI path sees a link similar to a real wireless probe.
+ *
+ * TCP does not keep the request boundaries, so requests are cut from the received stream
+ * by the length of their DAP commands. All socket operations run on the thread of
+ * `io_context_`, `stop()` only posts the close onto it.
+ */
+class StandInServer
+{
+    public:
+    StandInServer()
+        : is_running_(false),
+          rtt_us_(0),
+          round_trip_count_(0)
+    {
+    }
+
+    ~StandInServer()
+    {
+        stop();
+    }
+
+    void set_rtt_us(int rtt_us)
+    {
+        rtt_us_ = rtt_us;
+    }
+
+    uint64_t get_round_trip_count()
+    {
+        return round_trip_count_;
+    }
+
+    /**
+     * @brief Listen on the given address and serve one proxy connection at a time.
+     *
+     * @return 0: on success, other on fail
+     */
+    int start(const std::string &address = "127.0.0.1", unsigned short port = 3240)
+    {
+        asio::error_code ec;
+        asio::ip::tcp::endpoint endpoint(asio::ip::make_address(address, ec), port);
+        if (ec) {
+            return -1;
+        }
+
+        acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(io_context_);
+        acceptor_->open(endpoint.protocol(), ec);
+        if (!ec) {
+            acceptor_->bind(endpoint, ec);
+        }
+        if (!ec) {
+            acceptor_->listen(1, ec);
+        }
+        if (ec) {
+            acceptor_.reset();
+            return -1;
+        }
+
+        is_running_ = true;
+        io_context_.restart();
+        do_accept();
+
+        main_thread_ = std::thread([&]() {
+            io_context_.run();
+        });
+
+        return 0;
+    }
+
+    void stop()
+    {
+        if (!is_running_) {
+            return;
+        }
+
+        is_running_ = false;
+
+        // The acceptor and the socket belong to the io_context thread
+        asio::post(io_context_, [&]() {
+            asio::error_code ec;
+            acceptor_->close(ec);
+            close_session();
+        });
+
+        if (main_thread_.joinable()) {
+            main_thread_.join();
+        }
+    }
+
+    private:
+    void do_accept()
+    {
+        socket_ = std::make_unique<asio::ip::tcp::socket>(io_context_);
+        acceptor_->async_accept(*socket_, [&](const asio::error_code &ec) {
+            if (ec || !is_running_) {
+                return;
+            }
+
+            asio::error_code option_ec;
+            socket_->set_option(asio::ip::tcp::no_delay(true), option_ec);
+
+            target_.reset();
+            pending_.clear();
+            is_handshake_done_ = false;
+            do_read();
+        });
+    }
+
+    void close_session()
+    {
+        asio::error_code ec;
+        if (socket_) {
+            socket_->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+            socket_->close(ec);
+        }
+    }
+
+    // the connection is gone, serve the next one
+    void end_session()
+    {
+        close_session();
+        if (is_running_) {
+            do_accept();
+        }
+    }
+
+    void do_read()
+    {
+        socket_->async_read_some(asio::buffer(read_buffer_), [&](const asio::error_code &ec, size_t len) {
+            if (ec || !is_running_) {
+                end_session();
+                return;
+            }
+
+            pending_.insert(pending_.end(), read_buffer_.begin(), read_buffer_.begin() + len);
+            do_process();
+        });
+    }
+
+    // answer the next complete request, or read more data
+    void do_process()
+    {
+        size_t len;
+
+        if (!is_handshake_done_) {
+            len = pending_.size() >= sizeof(el_request_handshake_t) ? sizeof(el_request_handshake_t) : 0;
+        } else {
+            len = request_length(pending_.data(), pending_.size());
+        }
+        if (len == 0) {
+            do_read();
+            return;
+        }
+
+        response_.clear();
+        if (!is_handshake_done_) {
+            el_request_handshake_t req;
+            memcpy(&req, pending_.data(), sizeof(req));
+            if (ntohl(req.el_link_identifier) != EL_LINK_IDENTIFIER) {
+                end_session();
+                return;
+            }
+
+            el_response_handshake_t res;
+            res.el_link_identifier = htonl(EL_LINK_IDENTIFIER);
+            res.command            = htonl(EL_COMMAND_HANDSHAKE);
+            res.el_dap_version     = htonl(EL_DAP_VERSION);
+
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(&res);
+            response_.assign(p, p + sizeof(res));
+            is_handshake_done_ = true;
+        } else {
+            process_request(pending_.data(), len, response_);
+            round_trip_count_++;
+            delay_for_rtt();
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + len);
+
+        asio::async_write(*socket_, asio::buffer(response_), [&](const asio::error_code &ec, size_t) {
+            if (ec || !is_running_) {
+                end_session();
+                return;
+            }
+            do_process();
+        });
+    }
+
+    void delay_for_rtt()
+    {
+        if (rtt_us_ <= 0) {
+            return;
+        }
+
+        // Sleep() has a coarse granularity, spin for the sub-millisecond part.
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(rtt_us_);
+        if (rtt_us_ > 2000) {
+            std::this_thread::sleep_for(std::chrono::microseconds(rtt_us_ - 1500));
+        }
+        while (std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Length of the request at the start of the received data
+     *
+     * @return request length in bytes, 0 if more data is needed. Unknown commands take all
+     *         received data, they are answered with DAP_Invalid anyway.
+     */
+    static size_t request_length(const uint8_t *p, size_t avail)
+    {
+        if (avail == 0) {
+            return 0;
+        }
+        if (p[0] != ID_DAP_ExecuteCommands) {
+            return command_length(p, avail);
+        }
+
+        if (avail < 2) {
+            return 0;
+        }
+
+        size_t len = 2;
+        for (int count = p[1]; count > 0; count--) {
+            if (len >= avail) {
+                return 0;
+            }
+            size_t n = command_length(p + len, avail - len);
+            if (n == 0) {
+                return 0;
+            }
+            len += n;
+        }
+        return len;
+    }
+
+    // return: length of one DAP command, 0 if more data is needed
+    static size_t command_length(const uint8_t *p, size_t avail)
+    {
+        size_t len;
+
+        switch (p[0]) {
+            case ID_DAP_Disconnect:
+            case ID_DAP_ResetTarget:
+                len = 1;
+                break;
+            case ID_DAP_Info:
+            case ID_DAP_Connect:
+            case ID_DAP_SWD_Configure:
+                len = 2;
+                break;
+            case ID_DAP_SWJ_Clock:
+                len = 5;
+                break;
+            case ID_DAP_TransferConfigure:
+            case ID_DAP_WriteABORT:
+                len = 6;
+                break;
+            case ID_DAP_SWJ_Pins:
+                len = 7;
+                break;
+
+            case ID_DAP_SWJ_Sequence: {
+                if (avail < 2) {
+                    return 0;
+                }
+                const int bit_count = p[1] == 0 ? 256 : p[1];
+                len                 = 2 + (bit_count + 7) / 8;
+                break;
+            }
+
+            case ID_DAP_Transfer: {
+                if (avail < 3) {
+                    return 0;
+                }
+                len = 3;
+                for (int count = p[2]; count > 0; count--) {
+                    if (len >= avail) {
+                        return 0;
+                    }
+                    const uint8_t request = p[len++];
+                    if (!(request & 0x02) || (request & 0x30)) {
+                        len += 4; // write data or match value/mask
+                    }
+                }
+                break;
+            }
+
+            case ID_DAP_TransferBlock: {
+                if (avail < 5) {
+                    return 0;
+                }
+                const size_t count = p[2] | (p[3] << 8);
+                len                = 5 + ((p[4] & 0x02) ? 0 : count * 4);
+                break;
+            }
+
+            default:
+                return avail;
+        }
+
+        return len <= avail ? len : 0;
+    }
+
+    void process_request(const uint8_t *p, size_t len, std::vector<uint8_t> &res)
+    {
+        if (p[0] == ID_DAP_ExecuteCommands) {
+            int count = p[1];
+            res.insert(res.end(), { ID_DAP_ExecuteCommands, p[1] });
+
+            const uint8_t *end = p + len;
+            p += 2;
+            for (; count > 0 && p < end; count--) {
+                p += process_command(p, end - p, res);
+            }
+            return;
+        }
+
+        process_command(p, len, res);
+    }
+
+    // return: number of request bytes consumed
+    size_t process_command(const uint8_t *p, size_t len, std::vector<uint8_t> &res)
+    {
+        auto get_u32 = [](const uint8_t *q) -> uint32_t {
+            return q[0] | (q[1] << 8) | (q[2] << 16) | (static_cast<uint32_t>(q[3]) << 24);
+        };
+        auto put_u32 = [&](uint32_t v) {
+            res.insert(res.end(), { static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8),
+                                    static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 24) });
+        };
+
+        switch (p[0]) {
+            case ID_DAP_Info: {
+                std::string info;
+                switch (p[1]) {
+                    case 0x02:
+                        info = "CMSIS-DAP elaphureLink stand-in";
+                        break;
+                    case 0x03:
+                        info = "STANDIN0000";
+                        break;
+                    case 0x04:
+                        info = "2.1.0";
+                        break;
+                    case 0xF0:
+                        info = std::string(1, '\x01'); // SWD
+                        break;
+                    default:
+                        break;
+                }
+                res.push_back(ID_DAP_Info);
+                res.push_back(static_cast<uint8_t>(info.size()));
+                res.insert(res.end(), info.begin(), info.end());
+                return 2;
+            }
+
+            case ID_DAP_TransferConfigure: {
+                target_.set_match_retry(static_cast<uint16_t>(p[4] | (p[5] << 8)));
+                res.insert(res.end(), { ID_DAP_TransferConfigure, 0x00 });
+                return 6;
+            }
+
+            case ID_DAP_Transfer: {
+                const int count = p[2];
+                size_t    i     = 3;
+                int       done  = 0;
+                int       ack   = DAP_RES_OK;
+
+                const size_t header = res.size();
+                res.insert(res.end(), { ID_DAP_Transfer, 0x00, 0x00 });
+
+                for (; done < count; done++) {
+                    const uint8_t request = p[i++];
+                    uint32_t      value   = 0;
+                    if (!(request & 0x02) || (request & 0x30)) {
+                        value = get_u32(&p[i]);
+                        i += 4;
+                    }
+
+                    uint32_t read_value;
+                    ack = target_.transfer(request, value, &read_value);
+                    if (ack != DAP_RES_OK) {
+                        break;
+                    }
+                    if ((request & 0x02) && !(request & 0x30)) {
+                        put_u32(read_value);
+                    }
+                }
+
+                res[header + 1] = static_cast<uint8_t>(done);
+                res[header + 2] = static_cast<uint8_t>(ack);
+                return i;
+            }
+
+            case ID_DAP_TransferBlock: {
+                const int     count   = p[2] | (p[3] << 8);
+                const uint8_t request = p[4];
+                size_t        i       = 5;
+
+                res.insert(res.end(), { ID_DAP_TransferBlock, p[2], p[3], DAP_RES_OK });
+                for (int n = 0; n < count; n++) {
+                    uint32_t value = 0;
+                    if (request & 0x02) {
+                        target_.transfer(request, 0, &value);
+                        put_u32(value);
+                    } else {
+                        target_.transfer(request, get_u32(&p[i]), &value);
+                        i += 4;
+                    }
+                }
+                return i;
+            }
+
+            case ID_DAP_WriteABORT: {
+                target_.write_abort(get_u32(&p[2]));
+                res.insert(res.end(), { ID_DAP_WriteABORT, 0x00 });
+                return 6;
+            }
+
+            case ID_DAP_Connect: {
+                res.insert(res.end(), { ID_DAP_Connect, 0x01 }); // SWD
+                return 2;
+            }
+
+            case ID_DAP_Disconnect: {
+                res.insert(res.end(), { ID_DAP_Disconnect, 0x00 });
+                return 1;
+            }
+
+            case ID_DAP_ResetTarget: {
+                res.insert(res.end(), { ID_DAP_ResetTarget, 0x00, 0x00 });
+                return 1;
+            }
+
+            case ID_DAP_SWJ_Clock: {
+                res.insert(res.end(), { ID_DAP_SWJ_Clock, 0x00 });
+                return 5;
+            }
+
+            case ID_DAP_SWJ_Sequence: {
+                const int bit_count = p[1] == 0 ? 256 : p[1];
+                res.insert(res.end(), { ID_DAP_SWJ_Sequence, 0x00 });
+                return 2 + (bit_count + 7) / 8;
+            }
+
+            case ID_DAP_SWJ_Pins: {
+                res.insert(res.end(), { ID_DAP_SWJ_Pins, 0xFF });
+                return 7;
+            }
+
+            case ID_DAP_SWD_Configure: {
+                res.insert(res.end(), { ID_DAP_SWD_Configure, 0x00 });
+                return 2;
+            }
+
+            default:
+                // unknown command, answer with DAP_Invalid and consume the rest
+                res.push_back(0xFF);
+                return len;
+        }
+    }
+
+    private:
+    asio::io_context                         io_context_;
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
+    std::unique_ptr<asio::ip::tcp::socket>   socket_;
+    std::thread                              main_thread_;
+
+    std::array<uint8_t, 1500> read_buffer_;
+    std::vector<uint8_t>      pending_;  // received data, not yet answered
+    std::vector<uint8_t>      response_; // owned until its async_write completes
+    bool                      is_handshake_done_ = false;
+
+    std::atomic<bool>     is_running_;
+    std::atomic<int>      rtt_us_;
+    std::atomic<uint64_t> round_trip_count_;
+
+    StandInTarget target_;
+};
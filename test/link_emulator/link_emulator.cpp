@@ -0,0 +1,478 @@
+﻿/**
+ * @file link_emulator.cpp
+ * @author windowsair (msdn_01@sina.com)
+ * @brief TCP relay that emulates a lossy wireless link between the proxy and a probe
+ *
+ * The relay accepts the proxy connection, connects to the real (or stand-in) probe and forwards
+ * both directions with configurable latency, jitter, bandwidth cap, segment splitting and
+ * head-of-line reordering delays. All random decisions come from a seeded generator, so a run
+ * can be repeated exactly.
+ *
+ * @copyright BSD-2-Clause
+ *
+ */
+#ifdef _WIN32
+#include <sdkddkver.h>
+#endif
+#include "thirdparty/asio/include/asio.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using asio::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+
+struct LinkConfig {
+    unsigned short listen_port    = 3240;
+    std::string    target_host    = "";
+    std::string    target_port    = "3240";
+    double         latency_ms     = 0; // one way
+    double         jitter_ms      = 0; // uniform [0, jitter]
+    double         bandwidth_kbps = 0; // 0: unlimited
+    size_t         split_min      = 0; // 0: do not split
+    size_t         split_max      = 0;
+    double         reorder_prob   = 0; // probability that a segment is held back
+    double         reorder_ms     = 0; // extra delay of a held segment
+    double         reset_after_ms = 0; // 0: never reset the connection
+    unsigned int   seed           = 1;
+};
+
+
+/*
+ * One direction of a relayed connection.
+ *
+ * TCP never delivers bytes out of order, so a "reordered" segment is modelled the way the
+ * receiver observes it: the segment is delayed and everything behind it waits (head-of-line
+ * blocking), which is what a retransmission or a late wireless frame looks like to the proxy.
+ */
+class LinkPipe : public std::enable_shared_from_this<LinkPipe>
+{
+    public:
+    LinkPipe(const char *name, tcp::socket &from, tcp::socket &to,
+             const LinkConfig &config, unsigned int seed)
+        : name_(name),
+          from_(from),
+          to_(to),
+          config_(config),
+          rng_(seed),
+          timer_(from.get_executor()),
+          is_writing_(false),
+          is_closed_(false),
+          link_free_at_(clock_type::now()),
+          last_deliver_at_(clock_type::now()),
+          bytes_(0),
+          segments_(0),
+          held_segments_(0),
+          total_delay_us_(0)
+    {
+    }
+
+    void start()
+    {
+        do_read();
+    }
+
+    void close()
+    {
+        is_closed_ = true;
+        timer_.cancel();
+    }
+
+    void print_statistics()
+    {
+        printf("  %s: %llu bytes, %llu segments, %llu held, avg added delay %.1f us\n",
+               name_,
+               static_cast<unsigned long long>(bytes_),
+               static_cast<unsigned long long>(segments_),
+               static_cast<unsigned long long>(held_segments_),
+               segments_ ? total_delay_us_ / segments_ : 0.0);
+    }
+
+    std::function<void()> on_error;
+
+    private:
+    struct Segment {
+        clock_type::time_point deliver_at;
+        std::vector<uint8_t>   data;
+    };
+
+    void do_read()
+    {
+        auto self = shared_from_this();
+        from_.async_read_some(asio::buffer(read_buffer_),
+                              [this, self](const asio::error_code &ec, size_t length) {
+                                  if (ec || is_closed_) {
+                                      fail();
+                                      return;
+                                  }
+
+                                  enqueue(read_buffer_.data(), length);
+                                  do_read();
+                              });
+    }
+
+    void enqueue(const uint8_t *data, size_t length)
+    {
+        const auto now = clock_type::now();
+        bytes_ += length;
+
+        while (length > 0) {
+            size_t n = length;
+            if (config_.split_min > 0) {
+                std::uniform_int_distribution<size_t> split(config_.split_min,
+                                                            (std::max)(config_.split_min, config_.split_max));
+                n = (std::min)(length, split(rng_));
+            }
+
+            Segment segment;
+            segment.data.assign(data, data + n);
+            segment.deliver_at = now + get_delay(n);
+
+            // keep the byte order of the stream
+            segment.deliver_at = (std::max)(segment.deliver_at, last_deliver_at_);
+            last_deliver_at_   = segment.deliver_at;
+
+            total_delay_us_ += std::chrono::duration<double, std::micro>(segment.deliver_at - now).count();
+            segments_++;
+
+            queue_.push_back(std::move(segment));
+            data += n;
+            length -= n;
+        }
+
+        do_write();
+    }
+
+    clock_type::duration get_delay(size_t length)
+    {
+        using us = std::chrono::microseconds;
+
+        double delay_ms = config_.latency_ms;
+        if (config_.jitter_ms > 0) {
+            std::uniform_real_distribution<double> jitter(0, config_.jitter_ms);
+            delay_ms += jitter(rng_);
+        }
+
+        if (config_.reorder_prob > 0) {
+            std::bernoulli_distribution hold(config_.reorder_prob);
+            if (hold(rng_)) {
+                delay_ms += config_.reorder_ms;
+                held_segments_++;
+            }
+        }
+
+        auto delay = std::chrono::duration_cast<clock_type::duration>(us(static_cast<int64_t>(delay_ms * 1000)));
+
+        if (config_.bandwidth_kbps > 0) {
+            // serialization time on a shared link
+            const auto now      = clock_type::now();
+            const auto transmit = us(static_cast<int64_t>(length * 8 * 1000 / config_.bandwidth_kbps));
+
+            link_free_at_ = (std::max)(link_free_at_, now) + transmit;
+            delay += link_free_at_ - now;
+        }
+
+        return delay;
+    }
+
+    void do_write()
+    {
+        if (is_writing_ || queue_.empty() || is_closed_) {
+            return;
+        }
+
+        is_writing_ = true;
+        auto self   = shared_from_this();
+
+        timer_.expires_at(queue_.front().deliver_at);
+        timer_.async_wait([this, self](const asio::error_code &ec) {
+            if (ec || is_closed_) {
+                fail();
+                return;
+            }
+
+            asio::async_write(to_, asio::buffer(queue_.front().data),
+                              [this, self](const asio::error_code &ec, size_t) {
+                                  if (ec) {
+                                      fail();
+                                      return;
+                                  }
+
+                                  queue_.pop_front();
+                                  is_writing_ = false;
+                                  do_write();
+                              });
+        });
+    }
+
+    void fail()
+    {
+        if (!is_closed_) {
+            is_closed_ = true;
+            // the callback may reset `on_error`, keep a copy alive while it runs
+            auto callback = on_error;
+            if (callback) {
+                callback();
+            }
+        }
+    }
+
+    private:
+    const char        *name_;
+    tcp::socket       &from_;
+    tcp::socket       &to_;
+    const LinkConfig  &config_;
+    std::mt19937       rng_;
+    asio::steady_timer timer_;
+
+    std::array<uint8_t, 4096> read_buffer_;
+    std::deque<Segment>       queue_;
+    bool                      is_writing_;
+    bool                      is_closed_;
+
+    clock_type::time_point link_free_at_;
+    clock_type::time_point last_deliver_at_;
+
+    uint64_t bytes_;
+    uint64_t segments_;
+    uint64_t held_segments_;
+    double   total_delay_us_;
+};
+
+
+class LinkSession : public std::enable_shared_from_this<LinkSession>
+{
+    public:
+    LinkSession(asio::io_context &io_context, tcp::socket client, const LinkConfig &config, unsigned int id)
+        : io_context_(io_context),
+          client_(std::move(client)),
+          server_(io_context),
+          reset_timer_(io_context),
+          config_(config),
+          id_(id),
+          is_closed_(false)
+    {
+    }
+
+    void start()
+    {
+        auto self = shared_from_this();
+
+        tcp::resolver resolver(io_context_);
+        asio::error_code ec;
+        auto endpoints = resolver.resolve(config_.target_host, config_.target_port, ec);
+        if (ec) {
+            printf("[%u] resolve %s failed: %s\n", id_, config_.target_host.c_str(), ec.message().c_str());
+            return;
+        }
+
+        asio::async_connect(server_, endpoints,
+                            [this, self](const asio::error_code &ec, const tcp::endpoint &) {
+                                if (ec) {
+                                    printf("[%u] connect failed: %s\n", id_, ec.message().c_str());
+                                    close();
+                                    return;
+                                }
+
+                                asio::error_code ignored;
+                                client_.set_option(tcp::no_delay(true), ignored);
+                                server_.set_option(tcp::no_delay(true), ignored);
+
+                                upstream_   = std::make_shared<LinkPipe>("proxy -> probe", client_, server_, config_, config_.seed + 2 * id_);
+                                downstream_ = std::make_shared<LinkPipe>("probe -> proxy", server_, client_, config_, config_.seed + 2 * id_ + 1);
+
+                                upstream_->on_error   = [this, self]() { close(); };
+                                downstream_->on_error = [this, self]() { close(); };
+
+                                upstream_->start();
+                                downstream_->start();
+
+                                start_reset_timer();
+                                printf("[%u] connected\n", id_);
+                            });
+    }
+
+    private:
+    void start_reset_timer()
+    {
+        if (config_.reset_after_ms <= 0) {
+            return;
+        }
+
+        auto self = shared_from_this();
+        reset_timer_.expires_after(std::chrono::microseconds(static_cast<int64_t>(config_.reset_after_ms * 1000)));
+        reset_timer_.async_wait([this, self](const asio::error_code &ec) {
+            if (!ec) {
+                printf("[%u] reset by emulator\n", id_);
+                close();
+            }
+        });
+    }
+
+    void close()
+    {
+        if (is_closed_) {
+            return;
+        }
+        is_closed_ = true;
+
+        asio::error_code ignored;
+        reset_timer_.cancel();
+        client_.close(ignored);
+        server_.close(ignored);
+
+        printf("[%u] closed\n", id_);
+        if (upstream_) {
+            upstream_->close();
+            upstream_->print_statistics();
+            upstream_->on_error = nullptr;
+        }
+        if (downstream_) {
+            downstream_->close();
+            downstream_->print_statistics();
+            downstream_->on_error = nullptr;
+        }
+    }
+
+    private:
+    asio::io_context  &io_context_;
+    tcp::socket        client_;
+    tcp::socket        server_;
+    asio::steady_timer reset_timer_;
+    const LinkConfig  &config_;
+    unsigned int       id_;
+    bool               is_closed_;
+
+    std::shared_ptr<LinkPipe> upstream_;
+    std::shared_ptr<LinkPipe> downstream_;
+};
+
+
+class LinkEmulator
+{
+    public:
+    LinkEmulator(asio::io_context &io_context, const LinkConfig &config)
+        : io_context_(io_context),
+          acceptor_(io_context, tcp::endpoint(tcp::v4(), config.listen_port)),
+          config_(config),
+          session_id_(0)
+    {
+    }
+
+    void start()
+    {
+        acceptor_.async_accept([this](const asio::error_code &ec, tcp::socket socket) {
+            if (!ec) {
+                std::make_shared<LinkSession>(io_context_, std::move(socket), config_, session_id_++)->start();
+            }
+            start();
+        });
+    }
+
+    private:
+    asio::io_context &io_context_;
+    tcp::acceptor     acceptor_;
+    const LinkConfig &config_;
+    unsigned int      session_id_;
+};
+
+
+static void print_usage()
+{
+    printf("usage: link_emulator --target HOST[:PORT] [options]\n"
+           "  --listen PORT           local port for the proxy (default 3240)\n"
+           "  --latency-ms F          one way latency\n"
+           "  --jitter-ms F           extra uniform random latency [0, F]\n"
+           "  --bandwidth-kbps F      link bandwidth cap, 0 for unlimited\n"
+           "  --split MIN[:MAX]       split the stream into segments of MIN..MAX bytes\n"
+           "  --reorder P:MS          hold a segment back for MS with probability P\n"
+           "  --reset-after-ms F      reset each connection after F ms (reconnect test)\n"
+           "  --seed N                random seed (default 1)\n");
+}
+
+static bool parse_args(int argc, char **argv, LinkConfig &config)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *arg   = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            return false;
+        }
+        i++;
+
+        if (strcmp(arg, "--target") == 0) {
+            std::string target = value;
+            size_t      pos    = target.rfind(':');
+            if (pos != std::string::npos) {
+                config.target_host = target.substr(0, pos);
+                config.target_port = target.substr(pos + 1);
+            } else {
+                config.target_host = target;
+            }
+        } else if (strcmp(arg, "--listen") == 0) {
+            config.listen_port = static_cast<unsigned short>(atoi(value));
+        } else if (strcmp(arg, "--latency-ms") == 0) {
+            config.latency_ms = atof(value);
+        } else if (strcmp(arg, "--jitter-ms") == 0) {
+            config.jitter_ms = atof(value);
+        } else if (strcmp(arg, "--bandwidth-kbps") == 0) {
+            config.bandwidth_kbps = atof(value);
+        } else if (strcmp(arg, "--split") == 0) {
+            config.split_min = strtoul(value, nullptr, 10);
+            const char *p    = strchr(value, ':');
+            config.split_max = p ? strtoul(p + 1, nullptr, 10) : config.split_min;
+        } else if (strcmp(arg, "--reorder") == 0) {
+            config.reorder_prob = atof(value);
+            const char *p       = strchr(value, ':');
+            config.reorder_ms   = p ? atof(p + 1) : 0;
+        } else if (strcmp(arg, "--reset-after-ms") == 0) {
+            config.reset_after_ms = atof(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+
+    return !config.target_host.empty();
+}
+
+
+int main(int argc, char **argv)
+{
+    LinkConfig config;
+
+    setvbuf(stdout, nullptr, _IONBF, 0);
+    if (!parse_args(argc, argv, config)) {
+        print_usage();
+        return 1;
+    }
+
+    printf("listen %u -> %s:%s, latency %.2f ms, jitter %.2f ms, bandwidth %.0f kbps, split %zu:%zu, reorder %.3f:%.2f ms, seed %u\n",
+           config.listen_port, config.target_host.c_str(), config.target_port.c_str(),
+           config.latency_ms, config.jitter_ms, config.bandwidth_kbps,
+           config.split_min, config.split_max, config.reorder_prob, config.reorder_ms, config.seed);
+
+    try {
+        asio::io_context io_context;
+        LinkEmulator     emulator(io_context, config);
+        emulator.start();
+        io_context.run();
+    } catch (std::exception &e) {
+        printf("%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}